@@ -0,0 +1,34 @@
+#ifndef BENCH_ALLOC_COUNTER_HPP
+#define BENCH_ALLOC_COUNTER_HPP
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+/**
+ * @brief 进程内 operator new 调用次数（由 alloc_counter.cpp 替换全局 operator new 统计）
+ */
+uint64_t allocation_count();
+
+/**
+ * @brief 统计基准循环内的内存分配次数，析构时写入 allocs_per_iter 计数器
+ */
+class AllocationCounter {
+public:
+    explicit AllocationCounter(benchmark::State& state) : state_(state), start_(allocation_count()) {}
+
+    ~AllocationCounter() {
+        uint64_t allocations = allocation_count() - start_;
+        state_.counters["allocs_per_iter"] =
+            benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+    }
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+private:
+    benchmark::State& state_;
+    uint64_t start_;
+};
+
+#endif  // BENCH_ALLOC_COUNTER_HPP
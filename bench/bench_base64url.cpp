@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "base64url.hpp"
+
+namespace {
+
+// 重写前 tools.hpp 中的 base64url_encode，作为对照
+std::string legacy_base64url_encode(const std::string& input) {
+    static const std::string base64url_chars =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789-_";
+
+    std::string ret;
+    int i = 0;
+    unsigned char char_array_3[3];
+    unsigned char char_array_4[4];
+    const char* bytes_to_encode = input.c_str();
+    int in_len = input.length();
+    int pos = 0;
+
+    while (in_len--) {
+        char_array_3[i++] = bytes_to_encode[pos++];
+        if (i == 3) {
+            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+            char_array_4[3] = char_array_3[2] & 0x3f;
+            for (i = 0; i < 4; i++) {
+                ret += base64url_chars[char_array_4[i]];
+            }
+            i = 0;
+        }
+    }
+    if (i) {
+        for (int j = i; j < 3; j++) {
+            char_array_3[j] = '\0';
+        }
+        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+        for (int j = 0; j < i + 1; j++) {
+            ret += base64url_chars[char_array_4[j]];
+        }
+    }
+    return ret;
+}
+
+// 典型DoH查询为30~60字节，带 EDNS padding 时为128字节
+std::string make_input(size_t length) {
+    std::string input(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        input[i] = static_cast<char>(i * 131 + 7);
+    }
+    return input;
+}
+
+void BM_LegacyBase64UrlEncode(benchmark::State& state) {
+    const std::string input = make_input(static_cast<size_t>(state.range(0)));
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacy_base64url_encode(input));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_LegacyBase64UrlEncode)->Arg(33)->Arg(128)->Arg(512);
+
+void BM_Base64UrlEncode(benchmark::State& state) {
+    const std::string input = make_input(static_cast<size_t>(state.range(0)));
+    state.SetLabel(base64url_implementation());
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base64url_encode(input));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Base64UrlEncode)->Arg(33)->Arg(128)->Arg(512);
+
+void BM_Base64UrlEncodeScalarIntoBuffer(benchmark::State& state) {
+    const std::string input = make_input(static_cast<size_t>(state.range(0)));
+    char out[1024];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base64url_detail::encode_scalar(
+            reinterpret_cast<const uint8_t*>(input.data()), input.size(), out));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Base64UrlEncodeScalarIntoBuffer)->Arg(33)->Arg(128)->Arg(512);
+
+void BM_Base64UrlEncodeIntoBuffer(benchmark::State& state) {
+    const std::string input = make_input(static_cast<size_t>(state.range(0)));
+    char out[1024];
+    state.SetLabel(base64url_implementation());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base64url_encode(input.data(), input.size(), out));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Base64UrlEncodeIntoBuffer)->Arg(33)->Arg(128)->Arg(512);
+
+void BM_Base64UrlDecode(benchmark::State& state) {
+    const std::string encoded = base64url_encode(make_input(static_cast<size_t>(state.range(0))));
+    uint8_t out[1024];
+    size_t written = 0;
+    state.SetLabel(base64url_implementation());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(base64url_decode(encoded.data(), encoded.size(), out, written));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_Base64UrlDecode)->Arg(33)->Arg(128)->Arg(512);
+
+}  // namespace
@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+#include "dns_cache_file.hpp"
+
+namespace {
+
+// 写入 entries 个各含两条A记录的条目，返回缓存文件路径
+std::string make_cache_file(int entries) {
+    auto path = (std::filesystem::temp_directory_path() /
+                 ("bench_dns_cache_" + std::to_string(getpid()) + "_" + std::to_string(entries) + ".bin"))
+                    .string();
+    CacheConfig config;
+    config.max_size = entries;
+    DnsCache cache(config);
+    for (int i = 0; i < entries; ++i) {
+        std::string domain = "host" + std::to_string(i) + ".example.com";
+        std::string suffix = "." + std::to_string(i / 256 % 256) + "." + std::to_string(i % 256);
+        cache.put(domain, DNSRecordType::A,
+                  {{domain, DNSRecordType::A, 300, "10.0" + suffix}, {domain, DNSRecordType::A, 300, "10.1" + suffix}});
+    }
+    DnsCacheFile::save(path, cache);
+    return path;
+}
+
+// 启动时加载：映射、校验并写入空缓存
+void BM_RestoreCacheFile(benchmark::State& state) {
+    const int entries = static_cast<int>(state.range(0));
+    const std::string path = make_cache_file(entries);
+    CacheConfig config;
+    config.max_size = entries;
+    for (auto _ : state) {
+        DnsCache cache(config);
+        auto file = DnsCacheFile::open(path);
+        benchmark::DoNotOptimize(file->restore(cache));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * entries);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_RestoreCacheFile)->Arg(1000)->Arg(10000);
+
+// 退出时写回：序列化、fsync 并替换原文件
+void BM_SaveCacheFile(benchmark::State& state) {
+    const int entries = static_cast<int>(state.range(0));
+    const std::string path = make_cache_file(entries);
+    CacheConfig config;
+    config.max_size = entries;
+    DnsCache cache(config);
+    DnsCacheFile::open(path)->restore(cache);
+    for (auto _ : state) {
+        DnsCacheFile::save(path, cache);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * entries);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_SaveCacheFile)->Arg(1000)->Arg(10000)->UseRealTime();
+
+}  // namespace
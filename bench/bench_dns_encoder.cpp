@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "tools.hpp"
+
+namespace {
+
+const char* const kDomains[] = {"example.com", "www.google.com", "ap4-tls.agora.io",
+                                "a.very.long.subdomain.name.example.org"};
+
+// 重写前的 create_dns_query_message，作为对照
+std::string legacy_create_dns_query_message(const std::string& domain, uint16_t query_type) {
+    std::string message;
+    uint16_t id = 0x1234;
+    message.push_back(static_cast<char>((id >> 8) & 0xFF));
+    message.push_back(static_cast<char>(id & 0xFF));
+    message.push_back(0x01);
+    message.push_back(0x00);
+    message.push_back(0);
+    message.push_back(1);
+    for (int i = 0; i < 6; ++i) {
+        message.push_back(0);
+    }
+    std::istringstream domainStream(domain);
+    std::string label;
+    while (std::getline(domainStream, label, '.')) {
+        message.push_back(static_cast<char>(label.length()));
+        message.append(label);
+    }
+    message.push_back(0);
+    message.push_back(static_cast<char>((query_type >> 8) & 0xFF));
+    message.push_back(static_cast<char>(query_type & 0xFF));
+    message.push_back(0);
+    message.push_back(1);
+    return message;
+}
+
+void BM_LegacyCreateQueryMessage(benchmark::State& state) {
+    const std::string domain = kDomains[state.range(0)];
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacy_create_dns_query_message(domain, 1));
+    }
+}
+BENCHMARK(BM_LegacyCreateQueryMessage)->DenseRange(0, 3);
+
+void BM_CreateDnsQueryMessage(benchmark::State& state) {
+    const std::string domain = kDomains[state.range(0)];
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(create_dns_query_message(domain, 1));
+    }
+}
+BENCHMARK(BM_CreateDnsQueryMessage)->DenseRange(0, 3);
+
+void BM_EncodeDnsQuery(benchmark::State& state) {
+    const std::string domain = kDomains[state.range(0)];
+    DnsQueryBuffer buffer;
+    DnsQueryOptions options;
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        options.id = random_dns_id();
+        benchmark::DoNotOptimize(buffer.encode(domain, 1, options));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_EncodeDnsQuery)->DenseRange(0, 3);
+
+void BM_EncodeDnsQueryEdnsPadded(benchmark::State& state) {
+    const std::string domain = kDomains[state.range(0)];
+    DnsQueryBuffer buffer;
+    DnsQueryOptions options;
+    options.edns.enabled = true;
+    options.edns.padding_block = 128;
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        options.id = random_dns_id();
+        benchmark::DoNotOptimize(buffer.encode(domain, 1, options));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_EncodeDnsQueryEdnsPadded)->DenseRange(0, 3);
+
+}  // namespace
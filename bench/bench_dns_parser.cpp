@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+
+#include "alloc_counter.hpp"
+#include "dns_corpus.hpp"
+#include "tools.hpp"
+
+namespace {
+
+// 只遍历视图，不生成字符串
+void BM_ParseRecordViews(benchmark::State& state) {
+    const auto& corpus = DnsCorpus::responses();
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        for (const auto& response : corpus) {
+            DnsMessageParser parser(response);
+            DnsRecordView record;
+            uint32_t ttl_sum = 0;
+            while (parser.next_record(record)) {
+                ttl_sum += record.ttl;
+            }
+            benchmark::DoNotOptimize(ttl_sum);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.size()));
+}
+BENCHMARK(BM_ParseRecordViews);
+
+// 解压名称并格式化RDATA，生成 DNSRecord
+void BM_ParseWireformatResponse(benchmark::State& state) {
+    const auto& corpus = DnsCorpus::responses();
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        for (const auto& response : corpus) {
+            benchmark::DoNotOptimize(parse_dns_wireformat_response(response));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.size()));
+}
+BENCHMARK(BM_ParseWireformatResponse);
+
+}  // namespace
@@ -0,0 +1,242 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "alloc_counter.hpp"
+#include "dns_cache.hpp"
+#include "dns_udp_client.hpp"
+#include "doh_async_client.hpp"
+#include "doh_client.hpp"
+#include "doh_forwarder.hpp"
+#include "doh_racer.hpp"
+#include "doh_stub_server.hpp"
+#include "resolver_service.hpp"
+#include "stub_zone.hpp"
+
+namespace {
+
+// 每个基准共用的本地服务器：一个正常（同时提供明文DNS），一个总是返回503
+struct StubServers {
+    std::unique_ptr<DoHStubServer> healthy;
+    std::unique_ptr<DoHStubServer> failing;
+
+    static StubServers& instance() {
+        static StubServers servers;
+        return servers;
+    }
+
+private:
+    StubServers() {
+        StubServerOptions plain_dns;
+        plain_dns.serve_dns = true;
+        healthy = std::make_unique<DoHStubServer>(make_stub_zone(), plain_dns);
+        healthy->start();
+
+        StubServerOptions options;
+        options.error_rate = 1.0;
+        failing = std::make_unique<DoHStubServer>(make_stub_zone(), options);
+        failing->start();
+    }
+};
+
+// 同步客户端，同一连接上串行查询；参数为 DoHMethod
+void BM_StubBlockingQuery(benchmark::State& state) {
+    auto method = static_cast<DoHMethod>(state.range(0));
+    auto& servers = StubServers::instance();
+    DoHClient client(servers.healthy->url(method == DoHMethod::JSON_GET ? "/resolve" : "/dns-query"));
+    client.set_method_cache(nullptr);  // 方法缓存会把已知可用的GET排在前面，测量的不再是指定的方法
+    for (auto _ : state) {
+        auto records = client.query("www.example.com", DNSRecordType::A, method, false);
+        if (records.size() != 2) {
+            state.SkipWithError("unexpected answer from stub server");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetLabel(doh_method_config_name(method));
+}
+BENCHMARK(BM_StubBlockingQuery)->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+
+// 缓存命中时的 DoHClientImpl::query，不发起网络请求
+void BM_StubCachedQuery(benchmark::State& state) {
+    auto& servers = StubServers::instance();
+    DoHClient client(servers.healthy->url());
+    client.set_cache(std::make_shared<DnsCache>(CacheConfig{}));
+    client.query("www.example.com", DNSRecordType::A, DoHMethod::GET, false);
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client.query("www.example.com", DNSRecordType::A, DoHMethod::GET, false));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_StubCachedQuery);
+
+// 异步客户端，保持 window 个请求在途
+void BM_StubAsyncThroughput(benchmark::State& state) {
+    const int window = static_cast<int>(state.range(0));
+    auto& servers = StubServers::instance();
+    AsyncDoHClient client(servers.healthy->url("/dns-query"));
+    for (auto _ : state) {
+        std::atomic<int> remaining{window};
+        std::promise<void> done;
+        for (int i = 0; i < window; ++i) {
+            client.query("example.com", DNSRecordType::A, DoHMethod::POST,
+                         [&](std::vector<DNSRecord>, std::exception_ptr) {
+                             if (--remaining == 0) {
+                                 done.set_value();
+                             }
+                         });
+        }
+        done.get_future().wait();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * window);
+}
+BENCHMARK(BM_StubAsyncThroughput)->Arg(1)->Arg(16)->Arg(128)->UseRealTime();
+
+// 明文DNS批量查询，每次迭代 batch 个查询经 sendmmsg/recvmmsg 收发；与 BM_StubAsyncThroughput 对比传输开销
+void BM_StubPlainDnsBatch(benchmark::State& state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    auto& servers = StubServers::instance();
+    DnsUdpClient client("127.0.0.1", servers.healthy->dns_port());
+    std::vector<DnsUdpQuestion> questions(batch, DnsUdpQuestion{"example.com", DNSRecordType::A});
+    for (auto _ : state) {
+        auto results = client.query_batch(questions);
+        if (results.back().records.size() != 1) {
+            state.SkipWithError("unexpected answer from stub server");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+    state.counters["tcp_fallbacks"] = static_cast<double>(client.tcp_fallbacks());
+}
+BENCHMARK(BM_StubPlainDnsBatch)->Arg(1)->Arg(16)->Arg(128)->UseRealTime();
+
+// 转发服务的明文DNS，查询在预热后全部由缓存应答；参数为并发客户端数，事件循环数与之相同
+void BM_ForwarderCachedUdp(benchmark::State& state) {
+    constexpr size_t kBatch = 128;
+    static std::unique_ptr<DoHForwarder> forwarder;
+    if (state.thread_index() == 0) {
+        ServeConfig config;
+        config.dns_port = 0;
+        config.http_port = 0;
+        config.threads = state.threads();
+        config.upstream_threads = 1;
+        auto cache = std::make_shared<DnsCache>(CacheConfig());
+        forwarder = std::make_unique<DoHForwarder>(config, StubServers::instance().healthy->url(), DoHMethod::POST,
+                                                   cache);
+        forwarder->start();
+        DnsUdpClient warmup("127.0.0.1", forwarder->dns_port());
+        warmup.query("example.com", DNSRecordType::A);
+    }
+    // 所有线程在第一次迭代前同步，此时服务已启动
+    std::unique_ptr<DnsUdpClient> client;
+    std::vector<DnsUdpQuestion> questions(kBatch, DnsUdpQuestion{"example.com", DNSRecordType::A});
+    for (auto _ : state) {
+        if (!client) {
+            client = std::make_unique<DnsUdpClient>("127.0.0.1", forwarder->dns_port());
+        }
+        auto results = client->query_batch(questions);
+        if (results.back().records.size() != 1) {
+            state.SkipWithError("unexpected answer from forwarder");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kBatch));
+    if (state.thread_index() == 0) {
+        state.counters["cache_hits"] = static_cast<double>(forwarder->stats().cache_hits);
+        forwarder.reset();
+    }
+}
+BENCHMARK(BM_ForwarderCachedUdp)->Threads(1)->Threads(4)->UseRealTime();
+
+// 多线程解析服务，每次迭代提交一批查询并等待全部完成；参数为工作线程数，从1到硬件并发数
+void BM_StubResolverService(benchmark::State& state) {
+    constexpr int kBatch = 256;
+    auto& servers = StubServers::instance();
+    ResolverService service(servers.healthy->url("/dns-query"), static_cast<size_t>(state.range(0)),
+                            DoHMethod::POST);
+    service.set_single_flight(nullptr);  // 测量实际的上游吞吐，不合并相同查询
+    service.set_method_cache(nullptr);   // 固定使用POST
+    for (auto _ : state) {
+        std::atomic<int> remaining{kBatch};
+        std::atomic<int> failed{0};
+        std::promise<void> done;
+        for (int i = 0; i < kBatch; ++i) {
+            service.resolve("example.com", DNSRecordType::A, [&](std::vector<DNSRecord> records) {
+                if (records.size() != 1) {
+                    ++failed;
+                }
+                if (--remaining == 0) {
+                    done.set_value();
+                }
+            });
+        }
+        done.get_future().wait();
+        if (failed.load() > 0) {
+            state.SkipWithError("resolver service query failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kBatch);
+    state.counters["steals"] = static_cast<double>(service.steals());
+}
+BENCHMARK(BM_StubResolverService)
+    ->Apply([](benchmark::internal::Benchmark* bench) {
+        int cores = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+        for (int threads = 1; threads < cores; threads *= 2) {
+            bench->Arg(threads);
+        }
+        bench->Arg(cores);
+    })
+    ->UseRealTime();
+
+// 优先级最高的服务商总是失败，竞速应转由第二个服务商应答
+void BM_StubRaceFailover(benchmark::State& state) {
+    auto& servers = StubServers::instance();
+    RaceConfig race;
+    race.enabled = true;
+    race.max_providers = 2;
+    race.stagger_ms = static_cast<int>(state.range(0));
+    // 不接入健康跟踪，每次都先请求失败的服务商
+    DoHRacer racer({{"failing", servers.failing->url(), {"get", "post"}, 1, 5, true},
+                    {"healthy", servers.healthy->url(), {"get", "post"}, 2, 5, true}},
+                   race, 5, &DoHConnectionPool::instance(), nullptr);
+    for (auto _ : state) {
+        auto records = racer.resolve("example.com", DNSRecordType::A, DoHMethod::GET);
+        if (records.size() != 1) {
+            state.SkipWithError("failover did not produce an answer");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_StubRaceFailover)->Arg(0)->Arg(10)->UseRealTime();
+
+// 接入健康跟踪：失败的服务商熔断后不再参与竞速
+void BM_StubRaceWithHealth(benchmark::State& state) {
+    auto& servers = StubServers::instance();
+    RaceConfig race;
+    race.enabled = true;
+    race.max_providers = 2;
+    race.stagger_ms = static_cast<int>(state.range(0));
+    ProviderHealth health;
+    DoHRacer racer({{"failing", servers.failing->url(), {"get", "post"}, 1, 5, true},
+                    {"healthy", servers.healthy->url(), {"get", "post"}, 2, 5, true}},
+                   race, 5, &DoHConnectionPool::instance(), &health);
+    for (auto _ : state) {
+        auto records = racer.resolve("example.com", DNSRecordType::A, DoHMethod::GET);
+        if (records.size() != 1) {
+            state.SkipWithError("race did not produce an answer");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_StubRaceWithHealth)->Arg(0)->Arg(10)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+
+#include <string>
+#include <vector>
+
+#include "alloc_counter.hpp"
+#include "tools.hpp"
+
+namespace {
+
+// JSON API 响应：answers 条 A 记录，前面带一条 CNAME
+std::string make_response(int answers) {
+    std::string json = R"({"Status":0,"TC":false,"RD":true,"RA":true,"AD":false,"CD":false,)"
+                       R"("Question":[{"name":"pool.example.com.","type":1}],"Answer":[)"
+                       R"({"name":"pool.example.com.","type":5,"TTL":300,"data":"pool.cdn.example.net."})";
+    for (int i = 0; i < answers; ++i) {
+        json += R"(,{"name":"pool.cdn.example.net.","type":1,"TTL":60,"data":"10.)" + std::to_string(i / 256 % 256) +
+                "." + std::to_string(i % 256) + R"(.1"})";
+    }
+    json += R"(],"Comment":"Response from 192.0.2.53."})";
+    return json;
+}
+
+// 重写前的DOM实现（去掉了stdout输出，保留PrettyWriter重新序列化）
+std::vector<DNSRecord> legacy_parse_json_response(const std::string& response) {
+    std::vector<DNSRecord> records;
+    rapidjson::Document document;
+    document.Parse(response.c_str());
+
+    rapidjson::StringBuffer pretty;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> pretty_writer(pretty);
+    document.Accept(pretty_writer);
+    benchmark::DoNotOptimize(pretty.GetString());
+
+    if (document.HasMember("Answer") && document["Answer"].IsArray()) {
+        for (const auto& answer : document["Answer"].GetArray()) {
+            DNSRecord record{};
+            if (answer.HasMember("name") && answer["name"].IsString()) {
+                record.name = answer["name"].GetString();
+            }
+            if (answer.HasMember("type") && answer["type"].IsInt()) {
+                record.type = static_cast<DNSRecordType>(answer["type"].GetInt());
+            }
+            if (answer.HasMember("TTL") && answer["TTL"].IsUint()) {
+                record.ttl = answer["TTL"].GetUint();
+            }
+            if (answer.HasMember("data") && answer["data"].IsString()) {
+                record.data = answer["data"].GetString();
+                if ((record.type == DNSRecordType::CNAME || record.type == DNSRecordType::NS) &&
+                    !record.data.empty() && record.data.back() == '.') {
+                    record.data.pop_back();
+                }
+            }
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+void BM_LegacyDomJsonResponse(benchmark::State& state) {
+    const std::string response = make_response(static_cast<int>(state.range(0)));
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacy_parse_json_response(response));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * response.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * (state.range(0) + 1));
+}
+BENCHMARK(BM_LegacyDomJsonResponse)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_SaxJsonResponse(benchmark::State& state) {
+    const std::string response = make_response(static_cast<int>(state.range(0)));
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_dns_json(response.data(), response.size()));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * response.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * (state.range(0) + 1));
+}
+BENCHMARK(BM_SaxJsonResponse)->Arg(1)->Arg(16)->Arg(256)->Arg(4096);
+
+// DoHRequest 实际调用的入口，含trace日志判断
+void BM_ParseJsonResponse(benchmark::State& state) {
+    const std::string response = make_response(static_cast<int>(state.range(0)));
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_json_response(response));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * (state.range(0) + 1));
+}
+BENCHMARK(BM_ParseJsonResponse)->Arg(1)->Arg(16);
+
+}  // namespace
@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include <spdlog/sinks/null_sink.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "logger.hpp"
+
+namespace {
+
+// 日志写入空sink，只测量格式化与入队的开销，不含I/O
+class NullSinkLogger {
+public:
+    NullSinkLogger(const std::string& level, size_t async_queue_size) {
+        Logger::init_with_sink(std::make_shared<spdlog::sinks::null_sink_mt>(), level, async_queue_size);
+    }
+    ~NullSinkLogger() { Logger::shutdown(); }
+};
+
+// 级别在运行时未启用：宏在求值参数之前返回，参数中的字符串拼接不会执行
+void BM_LogDisabledMacro(benchmark::State& state) {
+    NullSinkLogger logger("warn", 0);
+    std::string url = "https://dns.example/dns-query?dns=AAABAAABAAAAAAAAB2V4YW1wbGUDY29tAAABAAE";
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        DOH_LOG_INFO("GET request URL: {}", url + "&ct=application/dns-message");
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_LogDisabledMacro);
+
+// 级别在运行时未启用：直接调用 Logger::info，参数已求值但不做格式化
+void BM_LogDisabledCall(benchmark::State& state) {
+    NullSinkLogger logger("warn", 0);
+    std::string domain = "www.example.com";
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        Logger::info("Race for {} won by {} in {}ms", domain, "cloudflare", 12);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_LogDisabledCall);
+
+// 运行时级别为trace时的debug日志：低于 DOH_LOG_ACTIVE_LEVEL 时（Release构建）调用在编译期被删除，
+// 耗时应与空循环相同；否则包含完整的格式化与写入
+void BM_LogDebugAtTraceLevel(benchmark::State& state) {
+    NullSinkLogger logger("trace", 0);
+    std::string url = "https://dns.example/dns-query?dns=AAABAAABAAAAAAAAB2V4YW1wbGUDY29tAAABAAE";
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        DOH_LOG_DEBUG("GET request URL: {}", url + "&ct=application/dns-message");
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetLabel(Logger::compiled(spdlog::level::debug) ? "compiled in" : "compiled out");
+}
+BENCHMARK(BM_LogDebugAtTraceLevel);
+
+// 空循环，作为 BM_LogDebugAtTraceLevel 的基线
+void BM_LogBaseline(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_LogBaseline);
+
+// 级别启用（info在任何构建中都被编译进程序）：参数为异步队列容量，0表示在调用线程上同步格式化并写入sink
+void BM_LogEnabled(benchmark::State& state) {
+    // 所有线程在第一次迭代前和最后一次迭代后同步，由0号线程负责初始化与关闭
+    std::unique_ptr<NullSinkLogger> logger;
+    if (state.thread_index() == 0) {
+        logger = std::make_unique<NullSinkLogger>("info", static_cast<size_t>(state.range(0)));
+    }
+    std::string domain = "www.example.com";
+    AllocationCounter allocations(state);
+    for (auto _ : state) {
+        Logger::info("Race for {} won by {} in {}ms", domain, "cloudflare", 12);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    if (state.thread_index() == 0) {
+        state.counters["dropped"] = static_cast<double>(Logger::dropped_messages());
+    }
+}
+BENCHMARK(BM_LogEnabled)->Arg(0)->Arg(8192)->Threads(1)->Threads(4);
+
+}  // namespace
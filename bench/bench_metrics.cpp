@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "metrics.hpp"
+
+namespace {
+
+// 热路径上的计数：每个线程只写自己的分片，多线程时开销不应随线程数增长
+void BM_CounterInc(benchmark::State& state) {
+    static Counter counter = MetricsRegistry::instance().counter("bench_counter_total", "Benchmark counter");
+    for (auto _ : state) {
+        counter.inc();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_CounterInc)->Threads(1)->Threads(4)->Threads(8);
+
+// 以整数标签索引的计数器，例如HTTP状态码
+void BM_CounterArrayInc(benchmark::State& state) {
+    static CounterArray statuses =
+        MetricsRegistry::instance().counter_array("bench_status_total", "Benchmark status codes", "status", 100, 500);
+    long status = 200;
+    for (auto _ : state) {
+        statuses.inc(status);
+        status = status == 200 ? 404 : 200;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_CounterArrayInc)->Threads(1)->Threads(8);
+
+// 延迟直方图：计算桶下标并更新桶与总和
+void BM_HistogramRecord(benchmark::State& state) {
+    static Histogram histogram = MetricsRegistry::instance().histogram("bench_latency_seconds", "Benchmark latency");
+    uint64_t value = 12345;
+    for (auto _ : state) {
+        histogram.record(value);
+        value = value * 2862933555777941757ull + 3037000493ull;  // 让桶下标分散
+        value >>= 40;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_HistogramRecord)->Threads(1)->Threads(8);
+
+// 导出：汇总所有线程分片并格式化，按抓取频率发生，不在热路径上
+void BM_PrometheusText(benchmark::State& state) {
+    DoHMetrics::instance();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MetricsRegistry::instance().prometheus_text());
+    }
+}
+BENCHMARK(BM_PrometheusText);
+
+}  // namespace
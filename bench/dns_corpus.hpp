@@ -0,0 +1,158 @@
+#ifndef BENCH_DNS_CORPUS_HPP
+#define BENCH_DNS_CORPUS_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 基准测试用的DNS响应报文集合
+ * @details 设置环境变量 DNS_CORPUS_DIR 时加载该目录下抓包得到的 *.bin 原始报文（每个文件一个响应），
+ *          否则使用内置的典型响应：带压缩指针的CNAME链、多条A/AAAA、MX、TXT、NXDOMAIN+SOA和EDNS0。
+ */
+class DnsCorpus {
+public:
+    static const std::vector<std::string>& responses() {
+        static const std::vector<std::string> corpus = load();
+        return corpus;
+    }
+
+private:
+    static std::vector<std::string> load() {
+        std::vector<std::string> corpus;
+        if (const char* dir = std::getenv("DNS_CORPUS_DIR")) {
+            for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+                if (entry.path().extension() == ".bin") {
+                    std::ifstream file(entry.path(), std::ios::binary);
+                    corpus.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                }
+            }
+        }
+        if (corpus.empty()) {
+            corpus = builtin();
+        }
+        return corpus;
+    }
+
+    // 简单的报文拼装器，记录的所有者名称都压缩为指向问题名称的指针
+    struct Builder {
+        std::string msg;
+
+        void u8(uint8_t v) { msg.push_back(static_cast<char>(v)); }
+        void u16(uint16_t v) {
+            u8(static_cast<uint8_t>(v >> 8));
+            u8(static_cast<uint8_t>(v & 0xFF));
+        }
+        void u32(uint32_t v) {
+            u16(static_cast<uint16_t>(v >> 16));
+            u16(static_cast<uint16_t>(v & 0xFFFF));
+        }
+        void name(const std::string& dotted) {
+            size_t start = 0;
+            while (start < dotted.size()) {
+                size_t dot = dotted.find('.', start);
+                dot = dot == std::string::npos ? dotted.size() : dot;
+                u8(static_cast<uint8_t>(dot - start));
+                msg.append(dotted, start, dot - start);
+                start = dot + 1;
+            }
+            u8(0);
+        }
+        Builder(const std::string& qname, uint16_t qtype, uint16_t an, uint16_t ns, uint16_t ar,
+                uint16_t flags = 0x8180) {
+            u16(0), u16(flags), u16(1), u16(an), u16(ns), u16(ar);
+            name(qname);
+            u16(qtype), u16(1);
+        }
+        size_t record(uint16_t owner, uint16_t type, uint32_t ttl) {
+            u16(static_cast<uint16_t>(0xC000 | owner)), u16(type), u16(1), u32(ttl);
+            size_t at = msg.size();
+            u16(0);
+            return at;
+        }
+        void finish(size_t at) {
+            size_t length = msg.size() - at - 2;
+            msg[at] = static_cast<char>(length >> 8);
+            msg[at + 1] = static_cast<char>(length & 0xFF);
+        }
+        void opt() {
+            u8(0), u16(41), u16(1232), u32(0), u16(0);
+        }
+    };
+
+    static std::vector<std::string> builtin() {
+        std::vector<std::string> corpus;
+
+        {  // 单条A记录
+            Builder b("example.com", 1, 1, 0, 1);
+            size_t at = b.record(12, 1, 3600);
+            b.u32(0x5DB8D822);
+            b.finish(at);
+            b.opt();
+            corpus.push_back(b.msg);
+        }
+        {  // CNAME链 + 4条A记录（CDN风格）
+            Builder b("www.github.com", 1, 5, 0, 1);
+            size_t at = b.record(12, 5, 3600);
+            b.name("github.com");
+            b.finish(at);
+            uint16_t target = static_cast<uint16_t>(at + 2);
+            for (uint32_t i = 0; i < 4; ++i) {
+                at = b.record(target, 1, 60);
+                b.u32(0x8C527100 + i);
+                b.finish(at);
+            }
+            b.opt();
+            corpus.push_back(b.msg);
+        }
+        {  // 多条AAAA记录
+            Builder b("www.google.com", 28, 2, 0, 1);
+            for (uint8_t i = 0; i < 2; ++i) {
+                size_t at = b.record(12, 28, 300);
+                const uint8_t v6[16] = {0x24, 0x04, 0x68, 0x00, 0x40, 0x04, 0x08, 0x1b, 0, 0, 0, 0, 0, 0, 0x20, i};
+                b.msg.append(reinterpret_cast<const char*>(v6), 16);
+                b.finish(at);
+            }
+            b.opt();
+            corpus.push_back(b.msg);
+        }
+        {  // MX
+            Builder b("gmail.com", 15, 3, 0, 0);
+            for (uint16_t i = 0; i < 3; ++i) {
+                size_t at = b.record(12, 15, 3600);
+                b.u16(static_cast<uint16_t>(5 + i * 10));
+                b.name("alt" + std::to_string(i) + ".gmail-smtp-in.l.google.com");
+                b.finish(at);
+            }
+            corpus.push_back(b.msg);
+        }
+        {  // TXT
+            Builder b("example.org", 16, 2, 0, 0);
+            for (const char* text : {"v=spf1 include:_spf.example.org ~all",
+                                     "google-site-verification=abcdefghijklmnopqrstuvwxyz0123456789"}) {
+                size_t at = b.record(12, 16, 300);
+                b.u8(static_cast<uint8_t>(std::string(text).size()));
+                b.msg.append(text);
+                b.finish(at);
+            }
+            corpus.push_back(b.msg);
+        }
+        {  // NXDOMAIN，权威部分带SOA
+            Builder b("does-not-exist.example.com", 1, 0, 1, 1, 0x8183);
+            size_t at = b.record(12 + 15, 6, 900);
+            b.name("ns1.example.com");
+            b.name("hostmaster.example.com");
+            b.u32(2024010101), b.u32(7200), b.u32(3600), b.u32(1209600), b.u32(300);
+            b.finish(at);
+            b.opt();
+            corpus.push_back(b.msg);
+        }
+        return corpus;
+    }
+};
+
+#endif  // BENCH_DNS_CORPUS_HPP
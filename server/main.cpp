@@ -0,0 +1,122 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "doh_stub_server.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+static void print_stub_usage(const char *programName) {
+    std::cout << "Usage: " << programName << " [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Local DoH stand-in server: RFC 8484 GET/POST on /dns-query, JSON API on /resolve." << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --zone <file>             Zone file to serve (default: config/stub_server.zone)" << std::endl;
+    std::cout << "  --bind <address>          Listen address (default: 127.0.0.1)" << std::endl;
+    std::cout << "  --port <port>             Listen port, 0 picks a free port (default: 8053)" << std::endl;
+    std::cout << "  --dns-port <port>         Also serve plain DNS over UDP/TCP on this port, 0 picks a free port"
+              << std::endl;
+    std::cout << "  --latency-ms <ms>         Fixed delay added to every response" << std::endl;
+    std::cout << "  --jitter-ms <ms>          Random extra delay in [0, ms]" << std::endl;
+    std::cout << "  --error-rate <0..1>       Fraction of requests answered with --error-status" << std::endl;
+    std::cout << "  --error-status <code>     HTTP status for injected errors (default: 503)" << std::endl;
+    std::cout << "  --truncate-rate <0..1>    Fraction of responses truncated (TC set, no answers)" << std::endl;
+    std::cout << "  --log-level <level>       Log level: trace, debug, info, warn, error, critical" << std::endl;
+    std::cout << "  -h, --help                Show this help message" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Example:" << std::endl;
+    std::cout << "  " << programName << " --port 8053 --latency-ms 20 --error-rate 0.05 &" << std::endl;
+    std::cout << "  test_dns_server --server http://127.0.0.1:8053/dns-query --method get -d www.example.com"
+              << std::endl;
+    std::cout << "  " << programName << " --port 8053 --dns-port 5353 &" << std::endl;
+    std::cout << "  test_dns_server --dns-server 127.0.0.1:5353 -d www.example.com" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::string zone_path = "config/stub_server.zone";
+    std::string log_level = "info";
+    StubServerOptions options;
+    options.port = 8053;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                print_stub_usage(argv[0]);
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--zone") {
+                zone_path = value;
+            } else if (arg == "--bind") {
+                options.bind_address = value;
+            } else if (arg == "--port") {
+                options.port = static_cast<uint16_t>(std::stoi(value));
+            } else if (arg == "--dns-port") {
+                options.serve_dns = true;
+                options.dns_port = static_cast<uint16_t>(std::stoi(value));
+            } else if (arg == "--latency-ms") {
+                options.latency_ms = std::stoi(value);
+            } else if (arg == "--jitter-ms") {
+                options.latency_jitter_ms = std::stoi(value);
+            } else if (arg == "--error-rate") {
+                options.error_rate = std::stod(value);
+            } else if (arg == "--error-status") {
+                options.error_status = std::stoi(value);
+            } else if (arg == "--truncate-rate") {
+                options.truncate_rate = std::stod(value);
+            } else if (arg == "--log-level") {
+                log_level = value;
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                print_stub_usage(argv[0]);
+                return 1;
+            }
+        }
+
+        Logger::init(log_level, false);
+
+        // 在启动任何线程前屏蔽 SIGINT/SIGTERM，由主线程 sigwait 同步等待
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        DoHStubServer server(DnsZone::load_file(zone_path), options);
+        server.start();
+        Logger::info("Serving {} (GET/POST) and {} (JSON); latency={}+{}ms error_rate={} truncate_rate={}",
+                     server.url("/dns-query"), server.url("/resolve"), options.latency_ms, options.latency_jitter_ms,
+                     options.error_rate, options.truncate_rate);
+        if (options.serve_dns) {
+            Logger::info("Serving plain DNS on {} port {} (UDP with TCP fallback)", options.bind_address,
+                         server.dns_port());
+        }
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+        server.stop();
+
+        auto stats = server.stats();
+        Logger::info("Stub server stopped: connections={}, requests={}, injected_errors={}, truncated={}, "
+                     "bad_requests={}, dns_queries={}",
+                     stats.connections, stats.requests, stats.injected_errors, stats.truncated, stats.bad_requests,
+                     stats.dns_queries);
+        Logger::shutdown();
+        return 0;
+    } catch (const DoHException &e) {
+        std::cerr << "DoH Error: " << e.what() << std::endl;
+        Logger::shutdown();
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        Logger::shutdown();
+        return 1;
+    }
+}
@@ -0,0 +1,377 @@
+#ifndef BASE64URL_HPP
+#define BASE64URL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64URL_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Base64URL 编解码（RFC 4648 第5节，不带填充）
+ * @details 输出长度预先计算，一次分配。x86 平台上运行时检测 CPU 选择 AVX2 / SSSE3 内核，
+ *          其他平台或不支持的 CPU 使用标量实现；各实现的输出完全一致。
+ *          解码接受可选的 '=' 填充，拒绝非法字符、长度余1以及末尾多余位非0的非规范输入。
+ */
+
+// 编码后的长度（不带填充）
+inline size_t base64url_encoded_size(size_t length) { return (length * 4 + 2) / 3; }
+
+// 解码后的最大长度
+inline size_t base64url_decoded_max_size(size_t length) { return length * 3 / 4; }
+
+namespace base64url_detail {
+
+constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+constexpr uint8_t kInvalid = 0xFF;
+
+struct DecodeTable {
+    uint8_t values[256];
+
+    constexpr DecodeTable() : values() {
+        for (int i = 0; i < 256; ++i) {
+            values[i] = kInvalid;
+        }
+        for (int i = 0; i < 64; ++i) {
+            values[static_cast<uint8_t>(kAlphabet[i])] = static_cast<uint8_t>(i);
+        }
+    }
+};
+
+constexpr DecodeTable kDecodeTable{};
+
+// 标量编码，返回写入的字符数
+inline size_t encode_scalar(const uint8_t *in, size_t length, char *out) {
+    char *start = out;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t v = (static_cast<uint32_t>(in[i]) << 16) | (static_cast<uint32_t>(in[i + 1]) << 8) | in[i + 2];
+        *out++ = kAlphabet[(v >> 18) & 0x3F];
+        *out++ = kAlphabet[(v >> 12) & 0x3F];
+        *out++ = kAlphabet[(v >> 6) & 0x3F];
+        *out++ = kAlphabet[v & 0x3F];
+    }
+    if (length - i == 1) {
+        uint32_t v = static_cast<uint32_t>(in[i]) << 16;
+        *out++ = kAlphabet[(v >> 18) & 0x3F];
+        *out++ = kAlphabet[(v >> 12) & 0x3F];
+    } else if (length - i == 2) {
+        uint32_t v = (static_cast<uint32_t>(in[i]) << 16) | (static_cast<uint32_t>(in[i + 1]) << 8);
+        *out++ = kAlphabet[(v >> 18) & 0x3F];
+        *out++ = kAlphabet[(v >> 12) & 0x3F];
+        *out++ = kAlphabet[(v >> 6) & 0x3F];
+    }
+    return static_cast<size_t>(out - start);
+}
+
+// 标量解码（输入已去除填充），返回写入的字节数，非法输入返回 SIZE_MAX
+inline size_t decode_scalar(const char *in, size_t length, uint8_t *out) {
+    if (length % 4 == 1) {
+        return SIZE_MAX;
+    }
+    const uint8_t *table = kDecodeTable.values;
+    uint8_t *start = out;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint8_t a = table[static_cast<uint8_t>(in[i])];
+        uint8_t b = table[static_cast<uint8_t>(in[i + 1])];
+        uint8_t c = table[static_cast<uint8_t>(in[i + 2])];
+        uint8_t d = table[static_cast<uint8_t>(in[i + 3])];
+        if ((a | b | c | d) & 0xC0) {
+            return SIZE_MAX;
+        }
+        uint32_t v = (static_cast<uint32_t>(a) << 18) | (static_cast<uint32_t>(b) << 12) |
+                     (static_cast<uint32_t>(c) << 6) | d;
+        *out++ = static_cast<uint8_t>(v >> 16);
+        *out++ = static_cast<uint8_t>(v >> 8);
+        *out++ = static_cast<uint8_t>(v);
+    }
+
+    size_t rest = length - i;
+    if (rest >= 2) {
+        uint8_t a = table[static_cast<uint8_t>(in[i])];
+        uint8_t b = table[static_cast<uint8_t>(in[i + 1])];
+        uint8_t c = rest == 3 ? table[static_cast<uint8_t>(in[i + 2])] : 0;
+        if ((a | b | c) & 0xC0) {
+            return SIZE_MAX;
+        }
+        // 末尾不足一个字节的位必须为0（规范编码）
+        if ((rest == 2 && (b & 0x0F)) || (rest == 3 && (c & 0x03))) {
+            return SIZE_MAX;
+        }
+        *out++ = static_cast<uint8_t>((a << 2) | (b >> 4));
+        if (rest == 3) {
+            *out++ = static_cast<uint8_t>((b << 4) | (c >> 2));
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+#ifdef BASE64URL_HAVE_X86_KERNELS
+
+// 6位索引转换为字符：按区间选择偏移量（W. Muła 的查表法，针对 '-' '_' 调整了偏移表）
+__attribute__((target("ssse3"))) inline __m128i lookup_ssse3(__m128i indices) {
+    __m128i reduced = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    reduced = _mm_or_si128(reduced, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8(71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -17, 32, 65, 0, 0);
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(shift, reduced));
+}
+
+// 12字节（位于16字节寄存器低位）拆分为16个6位索引
+__attribute__((target("ssse3"))) inline __m128i split_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// 字符在 [lo, hi] 区间内的字节置为0xFF（有符号比较，>=0x80 的字节总是在区间外）
+__attribute__((target("ssse3"))) inline __m128i in_range_ssse3(__m128i chars, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), chars));
+}
+
+// 16个字符转换为6位值，含非法字符时返回false
+__attribute__((target("ssse3"))) inline bool translate_ssse3(__m128i chars, __m128i &values) {
+    __m128i upper = in_range_ssse3(chars, 'A', 'Z');
+    __m128i lower = in_range_ssse3(chars, 'a', 'z');
+    __m128i digit = in_range_ssse3(chars, '0', '9');
+    __m128i dash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'));
+    __m128i underscore = _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(dash, underscore)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+        return false;
+    }
+
+    __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-65));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(4)));
+    offset = _mm_or_si128(offset, _mm_and_si128(dash, _mm_set1_epi8(17)));
+    offset = _mm_or_si128(offset, _mm_and_si128(underscore, _mm_set1_epi8(-32)));
+    values = _mm_add_epi8(chars, offset);
+    return true;
+}
+
+// 16个6位值合并为12字节（位于寄存器低位）
+__attribute__((target("ssse3"))) inline __m128i pack_ssse3(__m128i values) {
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3"))) inline size_t encode_ssse3(const uint8_t *in, size_t length, char *out) {
+    char *start = out;
+    size_t i = 0;
+    // 每次读取16字节只使用12字节，保证不越界读取
+    for (; i + 16 <= length; i += 12) {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), lookup_ssse3(split_ssse3(data)));
+        out += 16;
+    }
+    out += encode_scalar(in + i, length - i, out);
+    return static_cast<size_t>(out - start);
+}
+
+__attribute__((target("ssse3"))) inline size_t decode_ssse3(const char *in, size_t length, uint8_t *out) {
+    if (length % 4 == 1) {
+        return SIZE_MAX;
+    }
+    uint8_t *start = out;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i values;
+        if (!translate_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), values)) {
+            return SIZE_MAX;
+        }
+        alignas(16) uint8_t packed[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(packed), pack_ssse3(values));
+        std::memcpy(out, packed, 12);
+        out += 12;
+    }
+    size_t tail = decode_scalar(in + i, length - i, out);
+    if (tail == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+    return static_cast<size_t>(out - start) + tail;
+}
+
+__attribute__((target("avx2"))) inline size_t encode_avx2(const uint8_t *in, size_t length, char *out) {
+    char *start = out;
+    size_t i = 0;
+    // 每次处理24字节：两个128位通道各读取16字节、使用12字节
+    for (; i + 28 <= length; i += 24) {
+        __m256i data = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12)), 1);
+
+        data = _mm256_shuffle_epi8(data, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, 10, 11,
+                                                         9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        __m256i t0 = _mm256_and_si256(data, _mm256_set1_epi32(0x0fc0fc00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(data, _mm256_set1_epi32(0x003f03f0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i reduced = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        reduced = _mm256_or_si256(reduced, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        const __m256i shift = _mm256_setr_epi8(71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -17, 32, 65, 0, 0, 71, -4,
+                                               -4, -4, -4, -4, -4, -4, -4, -4, -4, -17, 32, 65, 0, 0);
+        __m256i chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(shift, reduced));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), chars);
+        out += 32;
+    }
+    out += encode_ssse3(in + i, length - i, out);
+    return static_cast<size_t>(out - start);
+}
+
+__attribute__((target("avx2"))) inline __m256i in_range_avx2(__m256i chars, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), chars));
+}
+
+__attribute__((target("avx2"))) inline size_t decode_avx2(const char *in, size_t length, uint8_t *out) {
+    if (length % 4 == 1) {
+        return SIZE_MAX;
+    }
+    uint8_t *start = out;
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        __m256i upper = in_range_avx2(chars, 'A', 'Z');
+        __m256i lower = in_range_avx2(chars, 'a', 'z');
+        __m256i digit = in_range_avx2(chars, '0', '9');
+        __m256i dash = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'));
+        __m256i underscore = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('_'));
+
+        __m256i valid =
+            _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(dash, underscore)));
+        if (_mm256_movemask_epi8(valid) != -1) {
+            return SIZE_MAX;
+        }
+
+        __m256i offset = _mm256_and_si256(upper, _mm256_set1_epi8(-65));
+        offset = _mm256_or_si256(offset, _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+        offset = _mm256_or_si256(offset, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+        offset = _mm256_or_si256(offset, _mm256_and_si256(dash, _mm256_set1_epi8(17)));
+        offset = _mm256_or_si256(offset, _mm256_and_si256(underscore, _mm256_set1_epi8(-32)));
+        __m256i values = _mm256_add_epi8(chars, offset);
+
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        alignas(32) uint8_t packed[32];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(packed), merged);
+        std::memcpy(out, packed, 12);
+        std::memcpy(out + 12, packed + 16, 12);
+        out += 24;
+    }
+    size_t tail = decode_ssse3(in + i, length - i, out);
+    if (tail == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+    return static_cast<size_t>(out - start) + tail;
+}
+
+#endif  // BASE64URL_HAVE_X86_KERNELS
+
+using EncodeKernel = size_t (*)(const uint8_t *, size_t, char *);
+using DecodeKernel = size_t (*)(const char *, size_t, uint8_t *);
+
+struct Kernels {
+    const char *name;
+    EncodeKernel encode;
+    DecodeKernel decode;
+};
+
+// 按CPU能力选择实现，只检测一次
+inline const Kernels &kernels() {
+    static const Kernels selected = []() -> Kernels {
+#ifdef BASE64URL_HAVE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {"avx2", encode_avx2, decode_avx2};
+        }
+        if (__builtin_cpu_supports("ssse3")) {
+            return {"ssse3", encode_ssse3, decode_ssse3};
+        }
+#endif
+        return {"scalar", encode_scalar, decode_scalar};
+    }();
+    return selected;
+}
+
+}  // namespace base64url_detail
+
+/**
+ * @brief 当前使用的实现名称："avx2"、"ssse3" 或 "scalar"
+ */
+inline const char *base64url_implementation() { return base64url_detail::kernels().name; }
+
+/**
+ * @brief 编码到调用方缓冲区
+ * @param out 至少 base64url_encoded_size(length) 字节
+ * @return 写入的字符数
+ */
+inline size_t base64url_encode(const void *data, size_t length, char *out) {
+    return base64url_detail::kernels().encode(static_cast<const uint8_t *>(data), length, out);
+}
+
+/**
+ * @brief 编码为字符串，输出只分配一次
+ */
+inline std::string base64url_encode(std::string_view input) {
+    std::string output(base64url_encoded_size(input.size()), '\0');
+    base64url_encode(input.data(), input.size(), &output[0]);
+    return output;
+}
+
+/**
+ * @brief 解码到调用方缓冲区
+ * @param out 至少 base64url_decoded_max_size(length) 字节
+ * @param written 写入的字节数
+ * @return 输入非法时返回false
+ */
+inline bool base64url_decode(const char *input, size_t length, uint8_t *out, size_t &written) {
+    // 容忍 '=' 填充：去掉后按无填充处理
+    if (length % 4 == 0) {
+        for (int pad = 0; pad < 2 && length > 0 && input[length - 1] == '='; ++pad) {
+            --length;
+        }
+    }
+    size_t result = base64url_detail::kernels().decode(input, length, out);
+    if (result == SIZE_MAX) {
+        return false;
+    }
+    written = result;
+    return true;
+}
+
+/**
+ * @brief 解码为字符串
+ * @return 输入非法时返回false，output 内容未定义
+ */
+inline bool base64url_decode(std::string_view input, std::string &output) {
+    output.resize(base64url_decoded_max_size(input.size()));
+    size_t written = 0;
+    if (!base64url_decode(input.data(), input.size(), reinterpret_cast<uint8_t *>(&output[0]), written)) {
+        return false;
+    }
+    output.resize(written);
+    return true;
+}
+
+#endif  // BASE64URL_HPP
@@ -30,6 +30,47 @@ struct CacheConfig {
     bool enabled = true;
     int max_size = 1000;
     int default_ttl = 300;
+    int stale_ttl = 30;          // 过期后仍可返回旧记录的宽限期（秒），期间在后台刷新；0为禁用
+    int prefetch_percent = 90;   // 热点条目在TTL过去该百分比后提前刷新；0为禁用
+    int prefetch_min_hits = 3;   // 近期查询次数达到该值才视为热点
+    std::string persist_path;    // 缓存文件路径，启动时加载、退出时写回；为空则不持久化
+};
+
+/**
+ * @brief 多服务商竞速解析配置
+ */
+struct RaceConfig {
+    bool enabled = false;
+    int max_providers = 3;  // 同时参与竞速的服务商数量（按优先级取前N个）
+    int stagger_ms = 100;   // 相邻两个服务商的启动间隔（毫秒）
+};
+
+/**
+ * @brief 服务商健康跟踪与熔断配置
+ */
+struct HealthConfig {
+    int failure_threshold = 3;  // 连续失败多少次后打开熔断器
+    int open_ms = 30000;        // 熔断器打开后的初始冷却时间（毫秒）
+    int max_open_ms = 300000;   // 探测连续失败时冷却时间翻倍的上限（毫秒）
+};
+
+/**
+ * @brief 本地转发服务（--serve）配置
+ */
+struct ServeConfig {
+    std::string bind_address = "127.0.0.1";
+    int dns_port = 53;         // 明文DNS端口（UDP与TCP），0 表示由系统分配
+    int http_port = 8053;      // DoH端点（/dns-query）端口，0 表示由系统分配
+    int threads = 0;           // 事件循环数，0表示使用硬件并发数
+    int upstream_threads = 8;  // 转发缓存未命中查询的工作线程数
+    int max_in_flight = 4096;  // 每个事件循环等待上游结果的查询上限，超过时直接应答SERVFAIL
+};
+
+/**
+ * @brief 批量解析配置
+ */
+struct BatchConfig {
+    int max_in_flight = 256;  // 同时在途的最大查询数
 };
 
 /**
@@ -40,6 +81,8 @@ struct LogConfig {
     bool enable_file_logging = true;
     std::string log_file_path = "logs/doh_client.log";
     bool enable_console_logging = true;
+    int async_queue_size = 8192;     // 异步日志队列容量（条），0表示在调用线程上同步写入
+    bool block_on_overflow = false;  // 队列满时阻塞调用线程；默认覆盖最旧的消息，不拖慢查询
 };
 
 /**
@@ -58,8 +101,15 @@ public:
     int connect_timeout = 5;
     int retry_count = 3;
     bool enable_fallback = true;
+    int method_cache_ttl = 3600;  // 服务器DoH方法支持情况的缓存时间（秒）
+    int fallback_timeout_ms = 3500;  // 系统DNS回退的超时（毫秒）
+    bool race_system_dns = false;    // 发起DoH查询时同时启动系统DNS解析，DoH失败时直接使用其结果
     
     CacheConfig cache;
+    RaceConfig race;
+    HealthConfig health;
+    ServeConfig serve;
+    BatchConfig batch;
     LogConfig log;
     std::vector<DoHServerConfig> servers;
 
@@ -144,11 +194,11 @@ private:
 };
 
 // 实现
-Config::Config(const std::string& config_file) : config_file_path_(config_file) {
+inline Config::Config(const std::string& config_file) : config_file_path_(config_file) {
     init_defaults();
 }
 
-bool Config::load() {
+inline bool Config::load() {
     try {
         // 检查配置文件是否存在
         if (!std::filesystem::exists(config_file_path_)) {
@@ -198,7 +248,7 @@ bool Config::load() {
     }
 }
 
-bool Config::save() {
+inline bool Config::save() {
     try {
         // 创建目录
         auto parent_path = std::filesystem::path(config_file_path_).parent_path();
@@ -229,7 +279,7 @@ bool Config::save() {
     }
 }
 
-void Config::update_from_args(int argc, char* argv[]) {
+inline void Config::update_from_args(int argc, char* argv[]) {
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         
@@ -239,6 +289,18 @@ void Config::update_from_args(int argc, char* argv[]) {
             timeout = std::stoi(argv[++i]);
         } else if (arg == "--no-fallback") {
             enable_fallback = false;
+        } else if (arg == "--race-system-dns") {
+            race_system_dns = true;
+        } else if (arg == "--race") {
+            race.enabled = true;
+        } else if (arg == "--dns-port" && i + 1 < argc) {
+            serve.dns_port = std::stoi(argv[++i]);
+        } else if (arg == "--http-port" && i + 1 < argc) {
+            serve.http_port = std::stoi(argv[++i]);
+        } else if (arg == "--batch-window" && i + 1 < argc) {
+            batch.max_in_flight = std::stoi(argv[++i]);
+        } else if (arg == "--cache-file" && i + 1 < argc) {
+            cache.persist_path = argv[++i];
         } else if (arg == "--server" && i + 1 < argc) {
             default_server = argv[++i];
         } else if (arg == "--config" && i + 1 < argc) {
@@ -247,7 +309,7 @@ void Config::update_from_args(int argc, char* argv[]) {
     }
 }
 
-const DoHServerConfig* Config::get_server_config(const std::string& name) const {
+inline const DoHServerConfig* Config::get_server_config(const std::string& name) const {
     for (const auto& server : servers) {
         if (server.name == name) {
             return &server;
@@ -256,7 +318,7 @@ const DoHServerConfig* Config::get_server_config(const std::string& name) const
     return nullptr;
 }
 
-std::vector<DoHServerConfig> Config::get_servers_by_priority() const {
+inline std::vector<DoHServerConfig> Config::get_servers_by_priority() const {
     auto sorted_servers = servers;
     std::sort(sorted_servers.begin(), sorted_servers.end(),
               [](const DoHServerConfig& a, const DoHServerConfig& b) {
@@ -265,7 +327,7 @@ std::vector<DoHServerConfig> Config::get_servers_by_priority() const {
     return sorted_servers;
 }
 
-bool Config::validate() const {
+inline bool Config::validate() const {
     if (servers.empty()) {
         std::cerr << "No servers configured" << std::endl;
         return false;
@@ -276,10 +338,52 @@ bool Config::validate() const {
         return false;
     }
     
+    if (fallback_timeout_ms <= 0) {
+        std::cerr << "Invalid fallback timeout" << std::endl;
+        return false;
+    }
+    
+    if (method_cache_ttl < 0) {
+        std::cerr << "Invalid method cache TTL" << std::endl;
+        return false;
+    }
+    
+    if (race.max_providers <= 0 || race.stagger_ms < 0) {
+        std::cerr << "Invalid race settings" << std::endl;
+        return false;
+    }
+    
+    if (health.failure_threshold <= 0 || health.open_ms < 0 || health.max_open_ms < health.open_ms) {
+        std::cerr << "Invalid provider health settings" << std::endl;
+        return false;
+    }
+    
+    if (serve.dns_port < 0 || serve.dns_port > 65535 || serve.http_port < 0 || serve.http_port > 65535 ||
+        serve.threads < 0 || serve.upstream_threads <= 0 || serve.max_in_flight <= 0) {
+        std::cerr << "Invalid serve settings" << std::endl;
+        return false;
+    }
+    
+    if (batch.max_in_flight <= 0) {
+        std::cerr << "Invalid batch window" << std::endl;
+        return false;
+    }
+    
+    if (log.async_queue_size < 0) {
+        std::cerr << "Invalid log queue size" << std::endl;
+        return false;
+    }
+    
+    if (cache.stale_ttl < 0 || cache.prefetch_percent < 0 || cache.prefetch_percent >= 100 ||
+        cache.prefetch_min_hits < 0) {
+        std::cerr << "Invalid cache refresh settings" << std::endl;
+        return false;
+    }
+    
     return true;
 }
 
-void Config::print() const {
+inline void Config::print() const {
     std::cout << "=== DoH Client Configuration ===" << std::endl;
     std::cout << "Config File: " << config_file_path_ << std::endl;
     std::cout << "Default Server: " << default_server << std::endl;
@@ -287,25 +391,48 @@ void Config::print() const {
     std::cout << "Connect Timeout: " << connect_timeout << "s" << std::endl;
     std::cout << "Retry Count: " << retry_count << std::endl;
     std::cout << "Enable Fallback: " << (enable_fallback ? "Yes" : "No") << std::endl;
+    std::cout << "Method Cache TTL: " << method_cache_ttl << "s" << std::endl;
+    std::cout << "Fallback Timeout: " << fallback_timeout_ms << "ms"
+              << (race_system_dns ? " (raced with DoH)" : "") << std::endl;
     std::cout << "Log Level: " << log.level << std::endl;
-    std::cout << "Cache Enabled: " << (cache.enabled ? "Yes" : "No") << std::endl;
+    std::cout << "Cache Enabled: " << (cache.enabled ? "Yes" : "No");
+    if (cache.enabled) {
+        std::cout << " (stale: " << cache.stale_ttl << "s, prefetch at " << cache.prefetch_percent << "% TTL";
+        if (!cache.persist_path.empty()) {
+            std::cout << ", file: " << cache.persist_path;
+        }
+        std::cout << ")";
+    }
+    std::cout << std::endl;
+    std::cout << "Race Enabled: " << (race.enabled ? "Yes" : "No");
+    if (race.enabled) {
+        std::cout << " (providers: " << race.max_providers << ", stagger: " << race.stagger_ms << "ms)";
+    }
+    std::cout << std::endl;
+    std::cout << "Circuit Breaker: " << health.failure_threshold << " failures, " << health.open_ms << "-"
+              << health.max_open_ms << "ms cooldown" << std::endl;
+    std::cout << "Serve: " << serve.bind_address << " dns:" << serve.dns_port << " http:" << serve.http_port
+              << " (loops: " << (serve.threads == 0 ? "auto" : std::to_string(serve.threads))
+              << ", upstream threads: " << serve.upstream_threads << ", max in flight: " << serve.max_in_flight
+              << ")" << std::endl;
+    std::cout << "Batch Window: " << batch.max_in_flight << std::endl;
     std::cout << "Servers (" << servers.size() << "):" << std::endl;
     for (const auto& server : servers) {
         std::cout << "  - " << server.name << " (" << server.url << ") Priority: " << server.priority << std::endl;
     }
 }
 
-bool Config::create_default_config(const std::string& file_path) {
+inline bool Config::create_default_config(const std::string& file_path) {
     Config default_config;
     default_config.config_file_path_ = file_path;
     return default_config.save();
 }
 
-void Config::reset_to_defaults() {
+inline void Config::reset_to_defaults() {
     init_defaults();
 }
 
-void Config::init_defaults() {
+inline void Config::init_defaults() {
     // 初始化默认服务器列表
     servers = {
         {"cloudflare", "https://cloudflare-dns.com/dns-query", {"get", "post", "json"}, 1, 10, true},
@@ -319,7 +446,7 @@ void Config::init_defaults() {
     };
 }
 
-void Config::load_from_json(const rapidjson::Document& j) {
+inline void Config::load_from_json(const rapidjson::Document& j) {
     if (j.HasMember("default_server") && j["default_server"].IsString()) {
         default_server = j["default_server"].GetString();
     }
@@ -335,6 +462,15 @@ void Config::load_from_json(const rapidjson::Document& j) {
     if (j.HasMember("enable_fallback") && j["enable_fallback"].IsBool()) {
         enable_fallback = j["enable_fallback"].GetBool();
     }
+    if (j.HasMember("method_cache_ttl") && j["method_cache_ttl"].IsInt()) {
+        method_cache_ttl = j["method_cache_ttl"].GetInt();
+    }
+    if (j.HasMember("fallback_timeout_ms") && j["fallback_timeout_ms"].IsInt()) {
+        fallback_timeout_ms = j["fallback_timeout_ms"].GetInt();
+    }
+    if (j.HasMember("race_system_dns") && j["race_system_dns"].IsBool()) {
+        race_system_dns = j["race_system_dns"].GetBool();
+    }
     
     // 加载缓存配置
     if (j.HasMember("cache") && j["cache"].IsObject()) {
@@ -348,6 +484,77 @@ void Config::load_from_json(const rapidjson::Document& j) {
         if (cache_json.HasMember("default_ttl") && cache_json["default_ttl"].IsInt()) {
             cache.default_ttl = cache_json["default_ttl"].GetInt();
         }
+        if (cache_json.HasMember("stale_ttl") && cache_json["stale_ttl"].IsInt()) {
+            cache.stale_ttl = cache_json["stale_ttl"].GetInt();
+        }
+        if (cache_json.HasMember("prefetch_percent") && cache_json["prefetch_percent"].IsInt()) {
+            cache.prefetch_percent = cache_json["prefetch_percent"].GetInt();
+        }
+        if (cache_json.HasMember("prefetch_min_hits") && cache_json["prefetch_min_hits"].IsInt()) {
+            cache.prefetch_min_hits = cache_json["prefetch_min_hits"].GetInt();
+        }
+        if (cache_json.HasMember("persist_path") && cache_json["persist_path"].IsString()) {
+            cache.persist_path = cache_json["persist_path"].GetString();
+        }
+    }
+    
+    // 加载竞速解析配置
+    if (j.HasMember("race") && j["race"].IsObject()) {
+        const auto& race_json = j["race"];
+        if (race_json.HasMember("enabled") && race_json["enabled"].IsBool()) {
+            race.enabled = race_json["enabled"].GetBool();
+        }
+        if (race_json.HasMember("max_providers") && race_json["max_providers"].IsInt()) {
+            race.max_providers = race_json["max_providers"].GetInt();
+        }
+        if (race_json.HasMember("stagger_ms") && race_json["stagger_ms"].IsInt()) {
+            race.stagger_ms = race_json["stagger_ms"].GetInt();
+        }
+    }
+    
+    // 加载服务商健康跟踪配置
+    if (j.HasMember("health") && j["health"].IsObject()) {
+        const auto& health_json = j["health"];
+        if (health_json.HasMember("failure_threshold") && health_json["failure_threshold"].IsInt()) {
+            health.failure_threshold = health_json["failure_threshold"].GetInt();
+        }
+        if (health_json.HasMember("open_ms") && health_json["open_ms"].IsInt()) {
+            health.open_ms = health_json["open_ms"].GetInt();
+        }
+        if (health_json.HasMember("max_open_ms") && health_json["max_open_ms"].IsInt()) {
+            health.max_open_ms = health_json["max_open_ms"].GetInt();
+        }
+    }
+    
+    // 加载本地转发服务配置
+    if (j.HasMember("serve") && j["serve"].IsObject()) {
+        const auto& serve_json = j["serve"];
+        if (serve_json.HasMember("bind_address") && serve_json["bind_address"].IsString()) {
+            serve.bind_address = serve_json["bind_address"].GetString();
+        }
+        if (serve_json.HasMember("dns_port") && serve_json["dns_port"].IsInt()) {
+            serve.dns_port = serve_json["dns_port"].GetInt();
+        }
+        if (serve_json.HasMember("http_port") && serve_json["http_port"].IsInt()) {
+            serve.http_port = serve_json["http_port"].GetInt();
+        }
+        if (serve_json.HasMember("threads") && serve_json["threads"].IsInt()) {
+            serve.threads = serve_json["threads"].GetInt();
+        }
+        if (serve_json.HasMember("upstream_threads") && serve_json["upstream_threads"].IsInt()) {
+            serve.upstream_threads = serve_json["upstream_threads"].GetInt();
+        }
+        if (serve_json.HasMember("max_in_flight") && serve_json["max_in_flight"].IsInt()) {
+            serve.max_in_flight = serve_json["max_in_flight"].GetInt();
+        }
+    }
+    
+    // 加载批量解析配置
+    if (j.HasMember("batch") && j["batch"].IsObject()) {
+        const auto& batch_json = j["batch"];
+        if (batch_json.HasMember("max_in_flight") && batch_json["max_in_flight"].IsInt()) {
+            batch.max_in_flight = batch_json["max_in_flight"].GetInt();
+        }
     }
     
     // 加载日志配置
@@ -365,6 +572,12 @@ void Config::load_from_json(const rapidjson::Document& j) {
         if (log_json.HasMember("enable_console_logging") && log_json["enable_console_logging"].IsBool()) {
             log.enable_console_logging = log_json["enable_console_logging"].GetBool();
         }
+        if (log_json.HasMember("async_queue_size") && log_json["async_queue_size"].IsInt()) {
+            log.async_queue_size = log_json["async_queue_size"].GetInt();
+        }
+        if (log_json.HasMember("block_on_overflow") && log_json["block_on_overflow"].IsBool()) {
+            log.block_on_overflow = log_json["block_on_overflow"].GetBool();
+        }
     }
     
     // 加载服务器配置
@@ -405,7 +618,7 @@ void Config::load_from_json(const rapidjson::Document& j) {
     }
 }
 
-rapidjson::Document Config::to_json() const {
+inline rapidjson::Document Config::to_json() const {
     rapidjson::Document doc;
     doc.SetObject();
     
@@ -418,20 +631,58 @@ rapidjson::Document Config::to_json() const {
     doc.AddMember("connect_timeout", connect_timeout, allocator);
     doc.AddMember("retry_count", retry_count, allocator);
     doc.AddMember("enable_fallback", enable_fallback, allocator);
+    doc.AddMember("method_cache_ttl", method_cache_ttl, allocator);
+    doc.AddMember("fallback_timeout_ms", fallback_timeout_ms, allocator);
+    doc.AddMember("race_system_dns", race_system_dns, allocator);
     
     // 缓存配置
     rapidjson::Value cache_obj(rapidjson::kObjectType);
     cache_obj.AddMember("enabled", cache.enabled, allocator);
     cache_obj.AddMember("max_size", cache.max_size, allocator);
     cache_obj.AddMember("default_ttl", cache.default_ttl, allocator);
+    cache_obj.AddMember("stale_ttl", cache.stale_ttl, allocator);
+    cache_obj.AddMember("prefetch_percent", cache.prefetch_percent, allocator);
+    cache_obj.AddMember("prefetch_min_hits", cache.prefetch_min_hits, allocator);
+    cache_obj.AddMember("persist_path", rapidjson::StringRef(cache.persist_path.c_str()), allocator);
     doc.AddMember("cache", cache_obj, allocator);
     
+    // 竞速解析配置
+    rapidjson::Value race_obj(rapidjson::kObjectType);
+    race_obj.AddMember("enabled", race.enabled, allocator);
+    race_obj.AddMember("max_providers", race.max_providers, allocator);
+    race_obj.AddMember("stagger_ms", race.stagger_ms, allocator);
+    doc.AddMember("race", race_obj, allocator);
+    
+    // 服务商健康跟踪配置
+    rapidjson::Value health_obj(rapidjson::kObjectType);
+    health_obj.AddMember("failure_threshold", health.failure_threshold, allocator);
+    health_obj.AddMember("open_ms", health.open_ms, allocator);
+    health_obj.AddMember("max_open_ms", health.max_open_ms, allocator);
+    doc.AddMember("health", health_obj, allocator);
+    
+    // 本地转发服务配置
+    rapidjson::Value serve_obj(rapidjson::kObjectType);
+    serve_obj.AddMember("bind_address", rapidjson::StringRef(serve.bind_address.c_str()), allocator);
+    serve_obj.AddMember("dns_port", serve.dns_port, allocator);
+    serve_obj.AddMember("http_port", serve.http_port, allocator);
+    serve_obj.AddMember("threads", serve.threads, allocator);
+    serve_obj.AddMember("upstream_threads", serve.upstream_threads, allocator);
+    serve_obj.AddMember("max_in_flight", serve.max_in_flight, allocator);
+    doc.AddMember("serve", serve_obj, allocator);
+    
+    // 批量解析配置
+    rapidjson::Value batch_obj(rapidjson::kObjectType);
+    batch_obj.AddMember("max_in_flight", batch.max_in_flight, allocator);
+    doc.AddMember("batch", batch_obj, allocator);
+    
     // 日志配置
     rapidjson::Value log_obj(rapidjson::kObjectType);
     log_obj.AddMember("level", rapidjson::StringRef(log.level.c_str()), allocator);
     log_obj.AddMember("enable_file_logging", log.enable_file_logging, allocator);
     log_obj.AddMember("log_file_path", rapidjson::StringRef(log.log_file_path.c_str()), allocator);
     log_obj.AddMember("enable_console_logging", log.enable_console_logging, allocator);
+    log_obj.AddMember("async_queue_size", log.async_queue_size, allocator);
+    log_obj.AddMember("block_on_overflow", log.block_on_overflow, allocator);
     doc.AddMember("log", log_obj, allocator);
     
     // 服务器配置
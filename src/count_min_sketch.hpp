@@ -0,0 +1,128 @@
+#ifndef COUNT_MIN_SKETCH_HPP
+#define COUNT_MIN_SKETCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief 近似频率计数器（count-min sketch）
+ * @details 4行计数器，每行宽度为2的幂，由同一个64位哈希经双重哈希导出各行下标。
+ *          估计值取各行最小值，只会高估不会低估；写入采用保守更新，仅递增等于最小值的计数器。
+ *          累计写入达到 10 倍宽度后所有计数器减半，使频率反映近期访问而非历史总量。
+ *          计数器为原子变量，多线程并发写入无需加锁，并发减半期间的估计值允许略有偏差。
+ */
+class CountMinSketch {
+public:
+    /**
+     * @brief 构造函数
+     * @param width 每行计数器数量，向上取整为2的幂（至少64）
+     */
+    explicit CountMinSketch(size_t width);
+
+    /**
+     * @brief 记录一次访问
+     * @param hash 键的哈希值
+     * @return 记录后的估计频率
+     */
+    uint32_t increment(uint64_t hash);
+
+    /**
+     * @brief 估计频率
+     */
+    uint32_t estimate(uint64_t hash) const;
+
+    /**
+     * @brief 清零所有计数器
+     */
+    void clear();
+
+    /**
+     * @brief 每行计数器数量
+     */
+    size_t width() const { return mask_ + 1; }
+
+private:
+    static constexpr size_t kDepth = 4;
+    static constexpr size_t kSamplesPerCounter = 10;
+
+    size_t index(uint64_t hash, size_t row) const;
+    void age();
+
+    size_t mask_;
+    size_t sample_limit_;
+    std::atomic<size_t> samples_{0};
+    std::vector<std::atomic<uint32_t>> counters_;  // kDepth 行连续存放
+};
+
+// 实现
+inline CountMinSketch::CountMinSketch(size_t width) {
+    size_t rounded = 64;
+    while (rounded < width) {
+        rounded *= 2;
+    }
+    mask_ = rounded - 1;
+    sample_limit_ = rounded * kSamplesPerCounter;
+    counters_ = std::vector<std::atomic<uint32_t>>(rounded * kDepth);
+}
+
+inline size_t CountMinSketch::index(uint64_t hash, size_t row) const {
+    // splitmix64 终结函数打散输入，再按 h1 + row * h2 为每行取下标
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    return row * width() + ((h1 + row * h2) & mask_);
+}
+
+inline uint32_t CountMinSketch::increment(uint64_t hash) {
+    size_t slots[kDepth];
+    uint32_t minimum = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < kDepth; ++row) {
+        slots[row] = index(hash, row);
+        minimum = std::min(minimum, counters_[slots[row]].load(std::memory_order_relaxed));
+    }
+
+    if (minimum != std::numeric_limits<uint32_t>::max()) {
+        for (size_t slot : slots) {
+            uint32_t expected = minimum;
+            counters_[slot].compare_exchange_strong(expected, minimum + 1, std::memory_order_relaxed);
+        }
+        ++minimum;
+    }
+
+    if (samples_.fetch_add(1, std::memory_order_relaxed) + 1 == sample_limit_) {
+        age();
+    }
+    return minimum;
+}
+
+inline uint32_t CountMinSketch::estimate(uint64_t hash) const {
+    uint32_t minimum = std::numeric_limits<uint32_t>::max();
+    for (size_t row = 0; row < kDepth; ++row) {
+        minimum = std::min(minimum, counters_[index(hash, row)].load(std::memory_order_relaxed));
+    }
+    return minimum;
+}
+
+inline void CountMinSketch::clear() {
+    for (auto& counter : counters_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    samples_.store(0, std::memory_order_relaxed);
+}
+
+inline void CountMinSketch::age() {
+    for (auto& counter : counters_) {
+        counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+    samples_.fetch_sub(sample_limit_ / 2, std::memory_order_relaxed);
+}
+
+#endif  // COUNT_MIN_SKETCH_HPP
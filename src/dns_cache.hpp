@@ -0,0 +1,444 @@
+#ifndef DNS_CACHE_HPP
+#define DNS_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hpp"
+#include "count_min_sketch.hpp"
+#include "metrics.hpp"
+#include "tools.hpp"
+
+/**
+ * @brief 缓存统计信息
+ */
+struct CacheStats {
+    uint64_t hits = 0;         // 命中次数（含 stale_hits）
+    uint64_t stale_hits = 0;   // 在宽限期内返回已过期记录的次数
+    uint64_t refreshes = 0;    // 因条目过期触发的后台刷新次数
+    uint64_t prefetches = 0;   // 热点条目到期前触发的预取次数
+    uint64_t misses = 0;       // 未命中次数（包括已过期）
+    uint64_t expirations = 0;  // 因TTL过期而移除的条目数
+    uint64_t evictions = 0;    // 因容量不足被LRU淘汰的条目数
+    uint64_t insertions = 0;   // 写入（新增或更新）次数
+    size_t size = 0;           // 当前条目数
+};
+
+/**
+ * @brief DNS解析结果缓存
+ * @details 以 (domain, DNSRecordType) 为键，按键的哈希分片，每个分片持有独立的互斥锁、
+ *          索引和LRU链表，多个 DoHClient 可以共享同一个实例。条目在记录的最小TTL到期后失效，
+ *          总条目数达到 max_size 时淘汰所在分片中最久未使用的条目。
+ *
+ *          通过 set_refresher() 安装后台刷新函数后：条目过期后的 stale_ttl 秒内仍返回旧记录
+ *          （TTL报告为0）并触发一次刷新；查询频率（count-min sketch 估计）达到 prefetch_min_hits
+ *          的条目在TTL过去 prefetch_percent% 后提前刷新，使热点域名不会在TTL边界上出现未命中。
+ *          刷新函数在调用 get() 的线程上、分片锁之外调用，应只提交异步请求，结果通过 put() 写回。
+ *          同一条目在 put() 写回前最多每 kRefreshRetry 触发一次刷新。
+ *
+ *          put_negative() 写入否定条目（NXDOMAIN或NODATA，没有记录），按 get(DnsAnswer) 返回其RCODE；
+ *          以记录列表查询时命中否定条目得到空结果。否定条目不参与 for_each()，不随缓存文件持久化。
+ */
+class DnsCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 后台刷新函数，参数为需要重新解析的域名和记录类型
+     */
+    using Refresher = std::function<void(const std::string& domain, DNSRecordType type)>;
+
+    /**
+     * @brief 构造函数
+     * @param config 缓存配置（enabled/max_size/default_ttl）
+     */
+    explicit DnsCache(const CacheConfig& config);
+
+    /**
+     * @brief 查询缓存
+     * @param domain 域名
+     * @param type 记录类型
+     * @param records 命中时写入的记录，TTL为剩余生存时间（宽限期内的旧记录为0）
+     * @param now 当前时间（用于测试注入）
+     * @return 是否命中
+     */
+    bool get(const std::string& domain, DNSRecordType type, std::vector<DNSRecord>& records,
+             Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 查询缓存，同时返回RCODE
+     * @param answer 命中时写入的结果：记录同上；否定条目的 records 为空，negative_ttl 为剩余生存时间
+     * @return 是否命中
+     */
+    bool get(const std::string& domain, DNSRecordType type, DnsAnswer& answer, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 写入缓存，生存时间取记录中最小的TTL
+     * @details 记录为空或TTL为0时不缓存
+     */
+    void put(const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& records,
+             Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 以指定的生存时间写入缓存（用于不带TTL信息的系统DNS结果）
+     */
+    void put(const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& records,
+             std::chrono::seconds ttl, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 写入否定条目（RFC 2308）
+     * @param rcode 3 = NXDOMAIN，0 = NODATA
+     * @param ttl 生存时间，通常取SOA的MINIMUM；为0时不缓存
+     */
+    void put_negative(const std::string& domain, DNSRecordType type, int rcode, std::chrono::seconds ttl,
+                      Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 删除指定条目
+     */
+    void erase(const std::string& domain, DNSRecordType type);
+
+    /**
+     * @brief 清空缓存（统计信息保留）
+     */
+    void clear();
+
+    /**
+     * @brief 当前条目数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 遍历所有未过期的肯定条目（用于持久化）
+     * @details 回调在分片锁内执行，不应再访问缓存；expires 为条目的过期时刻
+     */
+    void for_each(const std::function<void(const std::string& domain, DNSRecordType type,
+                                           const std::vector<DNSRecord>& records, Clock::time_point expires)>& fn,
+                  Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief 汇总所有分片的统计信息
+     */
+    CacheStats stats() const;
+
+    /**
+     * @brief 安装后台刷新函数，传入nullptr则停止刷新（宽限期与预取随之关闭）
+     * @details 卸载后，已在其他线程取得刷新函数副本的 get() 仍可能再调用一次
+     */
+    void set_refresher(Refresher refresher);
+
+    /**
+     * @brief 缓存是否启用
+     */
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief 默认TTL（秒）
+     */
+    std::chrono::seconds default_ttl() const { return default_ttl_; }
+
+private:
+    struct Key {
+        std::string domain;
+        DNSRecordType type;
+
+        bool operator==(const Key& other) const { return type == other.type && domain == other.domain; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<std::string>()(key.domain) ^ (static_cast<size_t>(key.type) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<DNSRecord> records;
+        Clock::time_point expires;
+        Clock::time_point refresh_after;  // 此后的查询可触发刷新（预取时刻或重试时刻）
+        int rcode = 0;                    // 否定条目的RCODE，此时 records 为空
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  // 头部为最近使用
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        size_t capacity = 0;
+        CacheStats stats;
+    };
+
+    Shard& shard_for(size_t hash) { return shards_[hash & (shards_.size() - 1)]; }
+    Shard& shard_for(const Key& key) { return shard_for(KeyHash()(key)); }
+
+    void refresh(const std::string& domain, DNSRecordType type);
+
+    void insert(const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& records, int rcode,
+                std::chrono::seconds ttl, Clock::time_point now);
+
+    static constexpr size_t kMaxShards = 16;
+    static constexpr std::chrono::seconds kRefreshRetry{5};
+
+    bool enabled_;
+    std::chrono::seconds default_ttl_;
+    std::chrono::seconds stale_ttl_;
+    int prefetch_percent_;
+    uint32_t prefetch_min_hits_;
+    std::vector<Shard> shards_;
+
+    CountMinSketch popularity_;
+    std::atomic<bool> refreshing_{false};  // 是否已安装刷新函数，get() 据此跳过加锁
+    std::mutex refresher_mutex_;
+    std::shared_ptr<const Refresher> refresher_;
+};
+
+// 实现
+inline DnsCache::DnsCache(const CacheConfig& config)
+    : enabled_(config.enabled && config.max_size > 0),
+      default_ttl_(std::max(config.default_ttl, 0)),
+      stale_ttl_(std::max(config.stale_ttl, 0)),
+      prefetch_percent_(std::clamp(config.prefetch_percent, 0, 99)),
+      prefetch_min_hits_(static_cast<uint32_t>(std::max(config.prefetch_min_hits, 0))),
+      popularity_(static_cast<size_t>(std::max(config.max_size, 1))) {
+    // 分片数取不超过 max_size 的2的幂，保证总容量精确等于 max_size
+    size_t max_size = static_cast<size_t>(std::max(config.max_size, 1));
+    size_t shard_count = 1;
+    while (shard_count * 2 <= std::min(max_size, kMaxShards)) {
+        shard_count *= 2;
+    }
+
+    shards_ = std::vector<Shard>(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_[i].capacity = max_size / shard_count + (i < max_size % shard_count ? 1 : 0);
+    }
+}
+
+inline bool DnsCache::get(const std::string& domain, DNSRecordType type, std::vector<DNSRecord>& records,
+                          Clock::time_point now) {
+    DnsAnswer answer;
+    if (!get(domain, type, answer, now)) {
+        return false;
+    }
+    records = std::move(answer.records);
+    return true;
+}
+
+inline bool DnsCache::get(const std::string& domain, DNSRecordType type, DnsAnswer& answer, Clock::time_point now) {
+    if (!enabled_) {
+        return false;
+    }
+
+    Key key{domain, type};
+    size_t hash = KeyHash()(key);
+    bool refreshing = refreshing_.load(std::memory_order_acquire);
+    uint32_t popularity = refreshing ? popularity_.increment(hash) : 0;
+
+    Shard& shard = shard_for(hash);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            ++shard.stats.misses;
+            DoHMetrics::instance().cache_misses.inc();
+            return false;
+        }
+
+        auto entry = it->second;
+        bool stale = entry->expires <= now;
+        if (stale && (!refreshing || entry->expires + stale_ttl_ <= now)) {
+            shard.lru.erase(entry);
+            shard.index.erase(it);
+            ++shard.stats.expirations;
+            ++shard.stats.misses;
+            DoHMetrics::instance().cache_misses.inc();
+            return false;
+        }
+
+        // 移到LRU头部
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+        ++shard.stats.hits;
+        DoHMetrics::instance().cache_hits.inc();
+
+        // 返回剩余TTL，向上取整以免把仍有效的记录报告为0
+        auto remaining = stale ? 0 : std::chrono::ceil<std::chrono::seconds>(entry->expires - now).count();
+        answer.rcode = entry->rcode;
+        answer.records = entry->records;
+        for (auto& record : answer.records) {
+            record.ttl = std::min<uint32_t>(record.ttl, static_cast<uint32_t>(remaining));
+        }
+        answer.negative_ttl = answer.records.empty() ? static_cast<uint32_t>(remaining) : 0;
+
+        if (stale) {
+            ++shard.stats.stale_hits;
+        }
+        // 过期条目总是刷新；未过期条目仅在足够热门时预取
+        refreshing = refreshing && entry->refresh_after <= now && (stale || popularity >= prefetch_min_hits_);
+        if (refreshing) {
+            entry->refresh_after = now + kRefreshRetry;
+            ++(stale ? shard.stats.refreshes : shard.stats.prefetches);
+        }
+    }
+
+    if (refreshing) {
+        refresh(domain, type);
+    }
+    return true;
+}
+
+inline void DnsCache::put(const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& records,
+                          Clock::time_point now) {
+    if (records.empty()) {
+        return;
+    }
+    uint32_t min_ttl = records.front().ttl;
+    for (const auto& record : records) {
+        min_ttl = std::min(min_ttl, record.ttl);
+    }
+    put(domain, type, records, std::chrono::seconds(min_ttl), now);
+}
+
+inline void DnsCache::put(const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& records,
+                          std::chrono::seconds ttl, Clock::time_point now) {
+    if (!records.empty()) {
+        insert(domain, type, records, 0, ttl, now);
+    }
+}
+
+inline void DnsCache::put_negative(const std::string& domain, DNSRecordType type, int rcode, std::chrono::seconds ttl,
+                                   Clock::time_point now) {
+    insert(domain, type, {}, rcode, ttl, now);
+}
+
+inline void DnsCache::insert(const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& records,
+                             int rcode, std::chrono::seconds ttl, Clock::time_point now) {
+    if (!enabled_ || ttl.count() <= 0) {
+        return;
+    }
+
+    Key key{domain, type};
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.stats.insertions;
+
+    // 预取时刻取TTL的 prefetch_percent%，未启用预取时等于过期时刻
+    auto expires = now + ttl;
+    auto refresh_after =
+        prefetch_percent_ > 0 ? now + std::chrono::duration_cast<Clock::duration>(ttl) * prefetch_percent_ / 100 : expires;
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->records = records;
+        it->second->expires = expires;
+        it->second->refresh_after = refresh_after;
+        it->second->rcode = rcode;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    // 分片已满，淘汰最久未使用的条目（优先回收已过期的尾部条目）
+    while (shard.lru.size() >= shard.capacity) {
+        auto& victim = shard.lru.back();
+        if (victim.expires <= now) {
+            ++shard.stats.expirations;
+        } else {
+            ++shard.stats.evictions;
+        }
+        shard.index.erase(victim.key);
+        shard.lru.pop_back();
+    }
+
+    shard.lru.push_front(Entry{key, records, expires, refresh_after, rcode});
+    shard.index.emplace(std::move(key), shard.lru.begin());
+}
+
+inline void DnsCache::erase(const std::string& domain, DNSRecordType type) {
+    Key key{domain, type};
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+inline void DnsCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+    }
+}
+
+inline size_t DnsCache::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.lru.size();
+    }
+    return total;
+}
+
+inline void DnsCache::for_each(const std::function<void(const std::string& domain, DNSRecordType type,
+                                                       const std::vector<DNSRecord>& records,
+                                                       Clock::time_point expires)>& fn,
+                              Clock::time_point now) const {
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& entry : shard.lru) {
+            if (entry.expires > now && !entry.records.empty()) {
+                fn(entry.key.domain, entry.key.type, entry.records, entry.expires);
+            }
+        }
+    }
+}
+
+inline CacheStats DnsCache::stats() const {
+    CacheStats total;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total.hits += shard.stats.hits;
+        total.stale_hits += shard.stats.stale_hits;
+        total.refreshes += shard.stats.refreshes;
+        total.prefetches += shard.stats.prefetches;
+        total.misses += shard.stats.misses;
+        total.expirations += shard.stats.expirations;
+        total.evictions += shard.stats.evictions;
+        total.insertions += shard.stats.insertions;
+        total.size += shard.lru.size();
+    }
+    return total;
+}
+
+inline void DnsCache::set_refresher(Refresher refresher) {
+    std::lock_guard<std::mutex> lock(refresher_mutex_);
+    if (refresher) {
+        refresher_ = std::make_shared<const Refresher>(std::move(refresher));
+    } else {
+        refresher_.reset();
+        popularity_.clear();
+    }
+    refreshing_.store(refresher_ != nullptr, std::memory_order_release);
+}
+
+inline void DnsCache::refresh(const std::string& domain, DNSRecordType type) {
+    std::shared_ptr<const Refresher> refresher;
+    {
+        std::lock_guard<std::mutex> lock(refresher_mutex_);
+        refresher = refresher_;
+    }
+    if (refresher) {
+        (*refresher)(domain, type);
+    }
+}
+
+#endif  // DNS_CACHE_HPP
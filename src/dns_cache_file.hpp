@@ -0,0 +1,400 @@
+#ifndef DNS_CACHE_FILE_HPP
+#define DNS_CACHE_FILE_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "dns_cache.hpp"
+#include "dns_failure_tracker.hpp"
+#include "exceptions.hpp"
+
+/**
+ * @brief 解析器缓存文件
+ * @details 保存缓存条目（记录与墙上时钟过期时间）以及按域名的系统DNS/DoH失败时间，
+ *          进程重启后恢复，避免冷启动时集中发起DoH请求。
+ *
+ *          文件布局（本机字节序，所有段按8字节对齐）：
+ *            Header | Entry[entry_count] | Record[record_count] | Failure[failure_count] | 字符串区
+ *          各结构体为定长，字符串以 (偏移, 长度) 引用字符串区。打开时整个文件只读映射到内存，
+ *          校验头部、校验和与引用范围后，restore 按定长记录从映射中直接复制到缓存，不做文本解析。
+ *          写入时先写临时文件并 fsync，再 rename 覆盖原文件并 fsync 所在目录，
+ *          读者不会看到写了一半的文件，rename 本身也在掉电后保留。
+ */
+class DnsCacheFile {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    /**
+     * @brief 映射缓存文件
+     * @return 文件不存在时返回nullptr
+     * @throws CacheException 文件无法读取、版本不符或内容损坏
+     */
+    static std::unique_ptr<DnsCacheFile> open(const std::string& path);
+
+    /**
+     * @brief 将缓存与失败时间原子地写入文件，父目录不存在时自动创建
+     * @param failures 可为nullptr
+     * @throws CacheException 写入失败
+     */
+    static void save(const std::string& path, const DnsCache& cache, const DnsFailureTracker* failures = nullptr);
+
+    ~DnsCacheFile();
+
+    DnsCacheFile(const DnsCacheFile&) = delete;
+    DnsCacheFile& operator=(const DnsCacheFile&) = delete;
+
+    /**
+     * @brief 把仍未过期的条目写入缓存、失败时间写入 failures
+     * @param failures 可为nullptr
+     * @return 恢复的缓存条目数
+     */
+    size_t restore(DnsCache& cache, DnsFailureTracker* failures = nullptr) const;
+
+    /**
+     * @brief 文件中的缓存条目数（含已过期的）
+     */
+    size_t entry_count() const { return header().entry_count; }
+
+    /**
+     * @brief 文件中的失败时间记录数
+     */
+    size_t failure_count() const { return header().failure_count; }
+
+    /**
+     * @brief 文件写入时间
+     */
+    std::chrono::system_clock::time_point saved_at() const {
+        return std::chrono::system_clock::time_point(std::chrono::milliseconds(header().saved_unix_ms));
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;  // 写入 kByteOrder，字节序不同的机器读出的值不同
+        int64_t saved_unix_ms;
+        uint32_t entry_count;
+        uint32_t record_count;
+        uint32_t failure_count;
+        uint32_t reserved;
+        uint64_t strings_size;
+        uint64_t checksum;  // 头部之后所有字节的 FNV-1a
+    };
+
+    struct Entry {
+        uint32_t domain_offset;
+        uint32_t domain_length;
+        uint32_t first_record;
+        uint32_t record_count;
+        int64_t expires_unix_ms;
+        uint16_t type;
+        uint16_t reserved[3];
+    };
+
+    struct Record {
+        uint32_t name_offset;
+        uint32_t name_length;
+        uint32_t data_offset;
+        uint32_t data_length;
+        uint32_t ttl;
+        uint16_t type;
+        uint16_t reserved;
+    };
+
+    struct Failure {
+        uint32_t domain_offset;
+        uint32_t domain_length;
+        int64_t system_failed_ms;
+        int64_t doh_failed_ms;
+        uint16_t type;
+        uint16_t reserved[3];
+    };
+
+    static_assert(sizeof(Header) == 56 && sizeof(Entry) == 32 && sizeof(Record) == 24 && sizeof(Failure) == 32,
+                  "cache file layout must not depend on compiler padding");
+    static_assert(std::is_trivially_copyable<Header>::value && std::is_trivially_copyable<Entry>::value &&
+                      std::is_trivially_copyable<Record>::value && std::is_trivially_copyable<Failure>::value,
+                  "cache file structures are accessed in place");
+
+    static constexpr char kMagic[8] = {'D', 'O', 'H', 'C', 'A', 'C', 'H', 'E'};
+    static constexpr uint32_t kByteOrder = 0x01020304;
+
+    DnsCacheFile(const void* data, size_t size) : data_(static_cast<const char*>(data)), size_(size) {}
+
+    void validate(const std::string& path) const;
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(data_); }
+    const Entry* entries() const { return reinterpret_cast<const Entry*>(data_ + sizeof(Header)); }
+    const Record* records() const { return reinterpret_cast<const Record*>(entries() + header().entry_count); }
+    const Failure* failures() const { return reinterpret_cast<const Failure*>(records() + header().record_count); }
+    const char* strings() const { return reinterpret_cast<const char*>(failures() + header().failure_count); }
+
+    std::string_view string_at(uint32_t offset, uint32_t length) const { return {strings() + offset, length}; }
+
+    static uint64_t checksum(const char* data, size_t size);
+
+    const char* data_;
+    size_t size_;
+};
+
+// 实现
+inline std::unique_ptr<DnsCacheFile> DnsCacheFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return nullptr;
+        }
+        throw CacheException("Cannot open " + path + ": " + std::strerror(errno), "load");
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        int error = errno;
+        close(fd);
+        throw CacheException("Cannot stat " + path + ": " + std::strerror(error), "load");
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size < sizeof(Header)) {
+        close(fd);
+        throw CacheException("Cache file " + path + " is truncated", "load");
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw CacheException("Cannot map " + path + ": " + std::strerror(errno), "load");
+    }
+
+    std::unique_ptr<DnsCacheFile> file(new DnsCacheFile(data, size));
+    file->validate(path);
+    return file;
+}
+
+inline DnsCacheFile::~DnsCacheFile() { munmap(const_cast<char*>(data_), size_); }
+
+inline void DnsCacheFile::validate(const std::string& path) const {
+    const Header& h = header();
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw CacheException(path + " is not a DoH cache file", "load");
+    }
+    if (h.version != kVersion || h.byte_order != kByteOrder) {
+        throw CacheException(path + " has unsupported version " + std::to_string(h.version), "load");
+    }
+
+    uint64_t expected = sizeof(Header) + uint64_t{h.entry_count} * sizeof(Entry) +
+                        uint64_t{h.record_count} * sizeof(Record) + uint64_t{h.failure_count} * sizeof(Failure) +
+                        h.strings_size;
+    if (expected != size_) {
+        throw CacheException(path + " is truncated", "load");
+    }
+    if (checksum(data_ + sizeof(Header), size_ - sizeof(Header)) != h.checksum) {
+        throw CacheException(path + " is corrupted (checksum mismatch)", "load");
+    }
+
+    // 校验所有引用都落在各自的区域内，之后的访问无需再检查
+    auto in_strings = [&](uint32_t offset, uint32_t length) {
+        return uint64_t{offset} + length <= h.strings_size;
+    };
+    for (uint32_t i = 0; i < h.entry_count; ++i) {
+        const Entry& entry = entries()[i];
+        if (!in_strings(entry.domain_offset, entry.domain_length) ||
+            uint64_t{entry.first_record} + entry.record_count > h.record_count) {
+            throw CacheException(path + " has an invalid entry", "load");
+        }
+    }
+    for (uint32_t i = 0; i < h.record_count; ++i) {
+        const Record& record = records()[i];
+        if (!in_strings(record.name_offset, record.name_length) ||
+            !in_strings(record.data_offset, record.data_length)) {
+            throw CacheException(path + " has an invalid record", "load");
+        }
+    }
+    for (uint32_t i = 0; i < h.failure_count; ++i) {
+        const Failure& failure = failures()[i];
+        if (!in_strings(failure.domain_offset, failure.domain_length)) {
+            throw CacheException(path + " has an invalid failure entry", "load");
+        }
+    }
+}
+
+inline size_t DnsCacheFile::restore(DnsCache& cache, DnsFailureTracker* failure_tracker) const {
+    // 墙上时钟的过期时间换算为剩余时间，再以缓存的单调时钟写入
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+    auto steady_now = DnsCache::Clock::now();
+
+    size_t restored = 0;
+    std::vector<DNSRecord> entry_records;
+    for (uint32_t i = 0; i < header().entry_count; ++i) {
+        const Entry& entry = entries()[i];
+        auto remaining = std::chrono::seconds((entry.expires_unix_ms - now_ms) / 1000);
+        if (remaining.count() <= 0 || entry.record_count == 0) {
+            continue;
+        }
+
+        entry_records.clear();
+        for (uint32_t r = entry.first_record; r < entry.first_record + entry.record_count; ++r) {
+            const Record& record = records()[r];
+            entry_records.push_back(DNSRecord{std::string(string_at(record.name_offset, record.name_length)),
+                                              static_cast<DNSRecordType>(record.type), record.ttl,
+                                              std::string(string_at(record.data_offset, record.data_length))});
+        }
+        cache.put(std::string(string_at(entry.domain_offset, entry.domain_length)),
+                  static_cast<DNSRecordType>(entry.type), entry_records, remaining, steady_now);
+        ++restored;
+    }
+
+    if (failure_tracker) {
+        for (uint32_t i = 0; i < header().failure_count; ++i) {
+            const Failure& failure = failures()[i];
+            failure_tracker->set(std::string(string_at(failure.domain_offset, failure.domain_length)),
+                                 static_cast<DNSRecordType>(failure.type),
+                                 DnsFailureTimes{failure.system_failed_ms, failure.doh_failed_ms});
+        }
+    }
+    return restored;
+}
+
+inline void DnsCacheFile::save(const std::string& path, const DnsCache& cache, const DnsFailureTracker* failures) {
+    auto system_now = std::chrono::system_clock::now();
+    auto steady_now = DnsCache::Clock::now();
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(system_now.time_since_epoch()).count();
+
+    std::vector<Entry> entries;
+    std::vector<Record> records;
+    std::vector<Failure> failure_entries;
+    std::string strings;
+    auto intern = [&strings](const std::string& value, uint32_t& offset, uint32_t& length) {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(value.size());
+        strings += value;
+    };
+
+    cache.for_each(
+        [&](const std::string& domain, DNSRecordType type, const std::vector<DNSRecord>& entry_records,
+            DnsCache::Clock::time_point expires) {
+            Entry entry{};
+            intern(domain, entry.domain_offset, entry.domain_length);
+            entry.type = static_cast<uint16_t>(type);
+            entry.first_record = static_cast<uint32_t>(records.size());
+            entry.record_count = static_cast<uint32_t>(entry_records.size());
+            entry.expires_unix_ms =
+                now_ms + std::chrono::duration_cast<std::chrono::milliseconds>(expires - steady_now).count();
+            entries.push_back(entry);
+
+            for (const auto& record : entry_records) {
+                Record out{};
+                intern(record.name, out.name_offset, out.name_length);
+                intern(record.data, out.data_offset, out.data_length);
+                out.type = static_cast<uint16_t>(record.type);
+                out.ttl = record.ttl;
+                records.push_back(out);
+            }
+        },
+        steady_now);
+
+    if (failures) {
+        failures->for_each([&](const std::string& domain, DNSRecordType type, const DnsFailureTimes& times) {
+            Failure failure{};
+            intern(domain, failure.domain_offset, failure.domain_length);
+            failure.type = static_cast<uint16_t>(type);
+            failure.system_failed_ms = times.system_failed_ms;
+            failure.doh_failed_ms = times.doh_failed_ms;
+            failure_entries.push_back(failure);
+        });
+    }
+
+    // 组装文件内容，校验和覆盖头部之后的全部字节
+    std::string body;
+    body.reserve(entries.size() * sizeof(Entry) + records.size() * sizeof(Record) +
+                 failure_entries.size() * sizeof(Failure) + strings.size());
+    body.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    body.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    body.append(reinterpret_cast<const char*>(failure_entries.data()), failure_entries.size() * sizeof(Failure));
+    body += strings;
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.byte_order = kByteOrder;
+    h.saved_unix_ms = now_ms;
+    h.entry_count = static_cast<uint32_t>(entries.size());
+    h.record_count = static_cast<uint32_t>(records.size());
+    h.failure_count = static_cast<uint32_t>(failure_entries.size());
+    h.strings_size = strings.size();
+    h.checksum = checksum(body.data(), body.size());
+
+    std::filesystem::path target(path);
+    if (target.has_parent_path()) {
+        std::error_code ec;
+        std::filesystem::create_directories(target.parent_path(), ec);
+    }
+
+    // 写临时文件并落盘后再替换原文件
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw CacheException("Cannot create " + temp + ": " + std::strerror(errno), "save");
+    }
+    auto write_all = [fd](const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    };
+    bool ok = write_all(reinterpret_cast<const char*>(&h), sizeof(h)) && write_all(body.data(), body.size()) &&
+              fsync(fd) == 0;
+    int error = errno;
+    close(fd);
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        error = ok ? errno : error;
+        std::remove(temp.c_str());
+        throw CacheException("Cannot write " + path + ": " + std::strerror(error), "save");
+    }
+
+    // rename 只修改目录项，目录也落盘后替换才不会因掉电丢失
+    std::string directory = target.has_parent_path() ? target.parent_path().string() : ".";
+    int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    ok = dir_fd >= 0 && fsync(dir_fd) == 0;
+    error = errno;
+    if (dir_fd >= 0) {
+        close(dir_fd);
+    }
+    if (!ok) {
+        throw CacheException("Cannot sync directory " + directory + ": " + std::strerror(error), "save");
+    }
+}
+
+inline uint64_t DnsCacheFile::checksum(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#endif  // DNS_CACHE_FILE_HPP
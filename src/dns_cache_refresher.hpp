@@ -0,0 +1,80 @@
+#ifndef DNS_CACHE_REFRESHER_HPP
+#define DNS_CACHE_REFRESHER_HPP
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "dns_cache.hpp"
+#include "doh_async_client.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+/**
+ * @brief 缓存后台刷新器
+ * @details 构造时为缓存安装刷新函数，析构时卸载。缓存要求刷新（宽限期内的过期条目或即将过期的
+ *          热点条目）时，通过内部的 AsyncDoHClient 提交异步查询，成功后把结果写回缓存，
+ *          调用 get() 的线程不会因此阻塞。刷新失败时缓存在宽限期内继续返回旧记录。
+ */
+class CacheRefresher {
+public:
+    /**
+     * @brief 构造函数
+     * @param cache 需要刷新的缓存
+     * @param server 用于刷新的服务器配置
+     * @param method 刷新查询使用的DoH方法
+     * @param connect_timeout 连接超时（秒）
+     * @param pool 连接池，为nullptr时不接入；池的生命周期必须长于刷新器
+     */
+    CacheRefresher(std::shared_ptr<DnsCache> cache, const DoHServerConfig& server, DoHMethod method,
+                   int connect_timeout = 5, DoHConnectionPool* pool = &DoHConnectionPool::instance());
+
+    /**
+     * @brief 析构函数，卸载刷新函数；未完成的刷新随 AsyncDoHClient 一起结束
+     */
+    ~CacheRefresher();
+
+    CacheRefresher(const CacheRefresher&) = delete;
+    CacheRefresher& operator=(const CacheRefresher&) = delete;
+
+    /**
+     * @brief 正在进行的刷新查询数
+     */
+    size_t in_flight() const { return client_->in_flight(); }
+
+private:
+    std::shared_ptr<DnsCache> cache_;
+    std::shared_ptr<AsyncDoHClient> client_;
+};
+
+// 实现
+inline CacheRefresher::CacheRefresher(std::shared_ptr<DnsCache> cache, const DoHServerConfig& server,
+                                      DoHMethod method, int connect_timeout, DoHConnectionPool* pool)
+    : cache_(std::move(cache)), client_(std::make_shared<AsyncDoHClient>(server, connect_timeout, pool)) {
+    // 刷新函数由缓存持有，回调只持有缓存的弱引用，避免 缓存→刷新函数→客户端→回调→缓存 的循环引用
+    std::weak_ptr<DnsCache> weak_cache = cache_;
+    auto client = client_;
+    cache_->set_refresher([client, weak_cache, method](const std::string& domain, DNSRecordType type) {
+        DOH_LOG_DEBUG("Refreshing cached {} {}", domain, record_type_name(type));
+        client->query(domain, type, method,
+                      [weak_cache, domain, type](std::vector<DNSRecord> records, std::exception_ptr error) {
+                          if (error) {
+                              try {
+                                  std::rethrow_exception(error);
+                              } catch (const std::exception& e) {
+                                  DOH_LOG_DEBUG("Cache refresh for {} failed: {}", domain, e.what());
+                              }
+                              return;
+                          }
+                          if (auto cache = weak_cache.lock()) {
+                              cache->put(domain, type, records);
+                          }
+                      });
+    });
+}
+
+inline CacheRefresher::~CacheRefresher() { cache_->set_refresher(nullptr); }
+
+#endif  // DNS_CACHE_REFRESHER_HPP
@@ -0,0 +1,179 @@
+#ifndef DNS_ENCODER_HPP
+#define DNS_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "exceptions.hpp"
+
+// DNS查询报文的最大长度（RFC 1035 UDP报文上限），编码器不会写出更长的报文
+constexpr size_t kMaxDnsQuerySize = 512;
+
+// 域名编码后的最大长度和单个标签的最大长度（RFC 1035 2.3.4）
+constexpr size_t kMaxDnsNameLength = 255;
+constexpr size_t kMaxDnsLabelLength = 63;
+
+/**
+ * @brief EDNS0 OPT记录选项（RFC 6891）
+ */
+struct EdnsOptions {
+    bool enabled = false;
+    uint16_t udp_payload_size = 1232;  // 通告的UDP负载大小
+    bool dnssec_ok = false;            // DO 位
+    uint16_t padding_block = 0;        // 非0时按该块大小填充报文（RFC 7830 / RFC 8467），0表示不填充
+};
+
+/**
+ * @brief DNS查询报文编码选项
+ */
+struct DnsQueryOptions {
+    uint16_t id = 0;                // 事务ID
+    bool recursion_desired = true;  // RD 位
+    EdnsOptions edns;
+};
+
+/**
+ * @brief 生成随机事务ID
+ * @details 每个线程一个随机数引擎，生成过程不分配内存
+ */
+inline uint16_t random_dns_id() {
+    thread_local std::mt19937 engine(std::random_device{}());
+    return static_cast<uint16_t>(engine() & 0xFFFF);
+}
+
+/**
+ * @brief 将DNS查询报文编码到调用方提供的缓冲区
+ * @details 只写入调用方缓冲区，不分配内存。域名可以带结尾的点，空字符串或 "." 表示根域。
+ * @param out 输出缓冲区
+ * @param capacity 缓冲区大小，超过 kMaxDnsQuerySize 的部分不会被使用
+ * @param domain 域名
+ * @param domain_length 域名长度
+ * @param qtype 查询类型
+ * @param options 事务ID、RD位与EDNS0选项
+ * @return 写入的字节数
+ * @throws EncodingException 域名标签为空、标签超过63字节、域名超过255字节或缓冲区不足
+ */
+inline size_t encode_dns_query(uint8_t *out, size_t capacity, const char *domain, size_t domain_length,
+                               uint16_t qtype, const DnsQueryOptions &options = {}) {
+    if (capacity > kMaxDnsQuerySize) {
+        capacity = kMaxDnsQuerySize;
+    }
+
+    if (domain_length > 0 && domain[domain_length - 1] == '.') {
+        --domain_length;
+    }
+    size_t name_length = domain_length == 0 ? 1 : domain_length + 2;
+    if (name_length > kMaxDnsNameLength) {
+        throw EncodingException("Domain name exceeds 255 bytes", "dns");
+    }
+    // 报头12字节 + 问题部分（名称、QTYPE、QCLASS）；OPT记录固定11字节，填充选项另加4字节头
+    size_t size = 12 + name_length + 4;
+    size_t opt_size = options.edns.enabled ? 11 : 0;
+    size_t padding = 0;
+    if (options.edns.enabled && options.edns.padding_block > 0) {
+        size_t unpadded = size + opt_size + 4;
+        size_t block = options.edns.padding_block;
+        padding = (block - unpadded % block) % block;
+        opt_size += 4 + padding;
+    }
+    if (size + opt_size > capacity) {
+        throw EncodingException("DNS query does not fit in buffer", "dns");
+    }
+
+    // Header section (12 bytes)
+    uint8_t *p = out;
+    *p++ = static_cast<uint8_t>(options.id >> 8);
+    *p++ = static_cast<uint8_t>(options.id & 0xFF);
+    *p++ = options.recursion_desired ? 0x01 : 0x00;  // 标准查询，RD
+    *p++ = 0x00;
+    *p++ = 0x00;  // QDCOUNT = 1
+    *p++ = 0x01;
+    *p++ = 0x00;  // ANCOUNT = 0
+    *p++ = 0x00;
+    *p++ = 0x00;  // NSCOUNT = 0
+    *p++ = 0x00;
+    *p++ = 0x00;  // ARCOUNT = 0 或 1（OPT）
+    *p++ = options.edns.enabled ? 0x01 : 0x00;
+
+    // Question section - 域名按点拆分为标签逐个写入
+    size_t label_start = 0;
+    for (size_t i = 0; i <= domain_length && domain_length > 0; ++i) {
+        if (i == domain_length || domain[i] == '.') {
+            size_t label_length = i - label_start;
+            if (label_length == 0) {
+                throw EncodingException("Empty label in domain name", "dns");
+            }
+            if (label_length > kMaxDnsLabelLength) {
+                throw EncodingException("Domain label exceeds 63 bytes", "dns");
+            }
+            *p++ = static_cast<uint8_t>(label_length);
+            for (size_t j = label_start; j < i; ++j) {
+                *p++ = static_cast<uint8_t>(domain[j]);
+            }
+            label_start = i + 1;
+        }
+    }
+    *p++ = 0x00;  // 0长度表示域名结束
+
+    *p++ = static_cast<uint8_t>(qtype >> 8);  // QTYPE
+    *p++ = static_cast<uint8_t>(qtype & 0xFF);
+    *p++ = 0x00;  // QCLASS = 1 (IN - Internet)
+    *p++ = 0x01;
+
+    // Additional section - EDNS0 OPT伪记录
+    if (options.edns.enabled) {
+        uint16_t rdlength = static_cast<uint16_t>(opt_size - 11);
+        *p++ = 0x00;  // 根域名
+        *p++ = 0x00;  // TYPE = OPT (41)
+        *p++ = 41;
+        *p++ = static_cast<uint8_t>(options.edns.udp_payload_size >> 8);  // CLASS = UDP负载大小
+        *p++ = static_cast<uint8_t>(options.edns.udp_payload_size & 0xFF);
+        *p++ = 0x00;                                   // 扩展RCODE
+        *p++ = 0x00;                                   // 版本
+        *p++ = options.edns.dnssec_ok ? 0x80 : 0x00;  // DO位
+        *p++ = 0x00;
+        *p++ = static_cast<uint8_t>(rdlength >> 8);
+        *p++ = static_cast<uint8_t>(rdlength & 0xFF);
+        if (options.edns.padding_block > 0) {
+            *p++ = 0x00;  // OPTION-CODE = Padding (12)
+            *p++ = 12;
+            *p++ = static_cast<uint8_t>(padding >> 8);
+            *p++ = static_cast<uint8_t>(padding & 0xFF);
+            for (size_t i = 0; i < padding; ++i) {
+                *p++ = 0x00;
+            }
+        }
+    }
+
+    return static_cast<size_t>(p - out);
+}
+
+/**
+ * @brief 编码到调用方缓冲区（std::string 域名）
+ */
+inline size_t encode_dns_query(uint8_t *out, size_t capacity, const std::string &domain, uint16_t qtype,
+                               const DnsQueryOptions &options = {}) {
+    return encode_dns_query(out, capacity, domain.data(), domain.size(), qtype, options);
+}
+
+/**
+ * @brief 定长查询报文缓冲区，可放在栈上
+ */
+struct DnsQueryBuffer {
+    uint8_t data[kMaxDnsQuerySize];
+    size_t size = 0;
+
+    /**
+     * @brief 编码查询报文，覆盖之前的内容
+     */
+    size_t encode(const std::string &domain, uint16_t qtype, const DnsQueryOptions &options = {}) {
+        size = encode_dns_query(data, sizeof(data), domain, qtype, options);
+        return size;
+    }
+
+    const char *bytes() const { return reinterpret_cast<const char *>(data); }
+};
+
+#endif  // DNS_ENCODER_HPP
@@ -0,0 +1,146 @@
+#ifndef DNS_FAILURE_TRACKER_HPP
+#define DNS_FAILURE_TRACKER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "dns_types.hpp"
+
+/**
+ * @brief 某个 (domain, type) 最近一次解析失败的时间（Unix毫秒，0表示没有失败）
+ */
+struct DnsFailureTimes {
+    int64_t system_failed_ms = 0;  // 系统DNS解析失败时间
+    int64_t doh_failed_ms = 0;     // DoH解析失败时间
+};
+
+/**
+ * @brief 按域名记录系统DNS与DoH的失败时间
+ * @details 对应 STRATEGY_SUGGEST_v6 中的 _system_dns_parse_fail_timestamp_list 与
+ *          _doh_dns_parse_fail_timestamp_list：解析失败时记录当前时间，同一途径解析成功后清零，
+ *          两项都为0的键被移除。使用墙上时钟，因此可以随缓存文件一起持久化，重启后继续生效。
+ *          线程安全。
+ */
+class DnsFailureTracker {
+public:
+    using Clock = std::chrono::system_clock;
+
+    /**
+     * @brief 记录一次系统DNS解析结果
+     */
+    void record_system_result(const std::string& domain, DNSRecordType type, bool ok,
+                              Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 记录一次DoH解析结果
+     */
+    void record_doh_result(const std::string& domain, DNSRecordType type, bool ok,
+                           Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 查询失败时间，没有记录时两项均为0
+     */
+    DnsFailureTimes get(const std::string& domain, DNSRecordType type) const;
+
+    /**
+     * @brief 直接设置失败时间（用于从缓存文件恢复）
+     */
+    void set(const std::string& domain, DNSRecordType type, const DnsFailureTimes& times);
+
+    /**
+     * @brief 遍历所有记录，回调在锁内执行，不应再访问本对象
+     */
+    void for_each(
+        const std::function<void(const std::string& domain, DNSRecordType type, const DnsFailureTimes& times)>& fn)
+        const;
+
+    /**
+     * @brief 记录数
+     */
+    size_t size() const;
+
+private:
+    struct Key {
+        std::string domain;
+        DNSRecordType type;
+
+        bool operator==(const Key& other) const { return type == other.type && domain == other.domain; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<std::string>()(key.domain) ^ (static_cast<size_t>(key.type) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    static int64_t to_unix_ms(Clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    }
+
+    void update(const std::string& domain, DNSRecordType type, int64_t DnsFailureTimes::*field, int64_t value);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, DnsFailureTimes, KeyHash> failures_;
+};
+
+// 实现
+inline void DnsFailureTracker::record_system_result(const std::string& domain, DNSRecordType type, bool ok,
+                                                    Clock::time_point now) {
+    update(domain, type, &DnsFailureTimes::system_failed_ms, ok ? 0 : to_unix_ms(now));
+}
+
+inline void DnsFailureTracker::record_doh_result(const std::string& domain, DNSRecordType type, bool ok,
+                                                 Clock::time_point now) {
+    update(domain, type, &DnsFailureTimes::doh_failed_ms, ok ? 0 : to_unix_ms(now));
+}
+
+inline void DnsFailureTracker::update(const std::string& domain, DNSRecordType type,
+                                      int64_t DnsFailureTimes::*field, int64_t value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Key key{domain, type};
+    auto it = failures_.find(key);
+    if (it == failures_.end()) {
+        if (value != 0) {
+            failures_[std::move(key)].*field = value;
+        }
+        return;
+    }
+    it->second.*field = value;
+    if (it->second.system_failed_ms == 0 && it->second.doh_failed_ms == 0) {
+        failures_.erase(it);
+    }
+}
+
+inline DnsFailureTimes DnsFailureTracker::get(const std::string& domain, DNSRecordType type) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = failures_.find(Key{domain, type});
+    return it == failures_.end() ? DnsFailureTimes{} : it->second;
+}
+
+inline void DnsFailureTracker::set(const std::string& domain, DNSRecordType type, const DnsFailureTimes& times) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (times.system_failed_ms == 0 && times.doh_failed_ms == 0) {
+        failures_.erase(Key{domain, type});
+    } else {
+        failures_[Key{domain, type}] = times;
+    }
+}
+
+inline void DnsFailureTracker::for_each(
+    const std::function<void(const std::string& domain, DNSRecordType type, const DnsFailureTimes& times)>& fn) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : failures_) {
+        fn(entry.first.domain, entry.first.type, entry.second);
+    }
+}
+
+inline size_t DnsFailureTracker::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failures_.size();
+}
+
+#endif  // DNS_FAILURE_TRACKER_HPP
@@ -0,0 +1,570 @@
+#ifndef DNS_PARSER_HPP
+#define DNS_PARSER_HPP
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "dns_types.hpp"
+#include "exceptions.hpp"
+
+// 解压一个域名时最多跟随的压缩指针数
+constexpr int kMaxDnsCompressionPointers = 64;
+
+/**
+ * @brief 记录所在的报文部分
+ */
+enum class DnsSection { Answer, Authority, Additional };
+
+/**
+ * @brief DNS报头
+ */
+struct DnsHeader {
+    uint16_t id = 0;
+    uint16_t flags = 0;
+    uint16_t qdcount = 0;
+    uint16_t ancount = 0;
+    uint16_t nscount = 0;
+    uint16_t arcount = 0;
+
+    bool is_response() const { return (flags & 0x8000) != 0; }
+    bool truncated() const { return (flags & 0x0200) != 0; }
+    uint8_t rcode() const { return static_cast<uint8_t>(flags & 0x000F); }
+};
+
+/**
+ * @brief 报文中域名的视图
+ * @details 只保存报文和名称起始偏移，需要时才跟随压缩指针解压。
+ *          视图由 DnsMessageParser 创建，创建时名称已完成边界和指针环检查。
+ */
+class DnsNameView {
+public:
+    DnsNameView() = default;
+    DnsNameView(std::string_view message, size_t offset) : message_(message), offset_(offset) {}
+
+    /**
+     * @brief 解压为点分形式（不带结尾的点），根域返回 "."
+     */
+    std::string to_string() const {
+        std::string name;
+        append_to(name);
+        return name;
+    }
+
+    /**
+     * @brief 解压并追加到字符串末尾
+     */
+    void append_to(std::string &out) const {
+        size_t start = out.size();
+        for_each_label([&out, start](std::string_view label) {
+            if (out.size() > start) {
+                out.push_back('.');
+            }
+            out.append(label.data(), label.size());
+        });
+        if (out.size() == start) {
+            out.push_back('.');
+        }
+    }
+
+    /**
+     * @brief 与点分域名比较（不区分大小写，忽略结尾的点），不分配内存
+     */
+    bool equals(std::string_view name) const {
+        if (!name.empty() && name.back() == '.') {
+            name.remove_suffix(1);
+        }
+        size_t pos = 0;
+        bool match = true;
+        for_each_label([&](std::string_view label) {
+            if (!match) {
+                return;
+            }
+            if (pos > 0) {
+                match = pos < name.size() && name[pos] == '.';
+                ++pos;
+            }
+            if (!match || name.size() - pos < label.size()) {
+                match = false;
+                return;
+            }
+            for (char c : label) {
+                if (std::tolower(static_cast<unsigned char>(c)) !=
+                    std::tolower(static_cast<unsigned char>(name[pos++]))) {
+                    match = false;
+                    return;
+                }
+            }
+        });
+        return match && pos == name.size();
+    }
+
+    size_t offset() const { return offset_; }
+
+private:
+    template <typename F>
+    void for_each_label(F &&visit) const {
+        size_t pos = offset_;
+        int hops = 0;
+        while (pos < message_.size()) {
+            uint8_t length = static_cast<uint8_t>(message_[pos]);
+            if ((length & 0xC0) == 0xC0) {
+                if (pos + 1 >= message_.size() || ++hops > kMaxDnsCompressionPointers) {
+                    return;
+                }
+                pos = (static_cast<size_t>(length & 0x3F) << 8) | static_cast<uint8_t>(message_[pos + 1]);
+                continue;
+            }
+            if (length == 0 || pos + 1 + length > message_.size()) {
+                return;
+            }
+            visit(message_.substr(pos + 1, length));
+            pos += 1 + length;
+        }
+    }
+
+    std::string_view message_;
+    size_t offset_ = 0;
+};
+
+/**
+ * @brief 问题部分条目的视图
+ */
+struct DnsQuestionView {
+    DnsNameView name;
+    uint16_t type = 0;
+    uint16_t qclass = 0;
+};
+
+/**
+ * @brief 资源记录的视图，RDATA 指向原始报文
+ */
+struct DnsRecordView {
+    DnsSection section = DnsSection::Answer;
+    DnsNameView name;
+    uint16_t type = 0;
+    uint16_t rclass = 0;
+    uint32_t ttl = 0;
+    std::string_view message;  // 整个报文，RDATA 中的压缩名称需要它
+    size_t rdata_offset = 0;
+    uint16_t rdata_length = 0;
+
+    DNSRecordType record_type() const { return static_cast<DNSRecordType>(type); }
+    std::string_view rdata() const { return message.substr(rdata_offset, rdata_length); }
+
+    /**
+     * @brief RDATA 的展示格式（与 dig 输出一致，名称不带结尾的点）
+     */
+    std::string data_to_string() const;
+};
+
+/**
+ * @brief 零拷贝的 RFC 1035 报文解析器
+ * @details 按顺序遍历问题、回答、权威和附加四个部分，返回指向原始报文的视图，解析过程不分配内存。
+ *          所有读取都做边界检查；压缩指针只能指向当前名称片段之前的位置，并限制跟随次数，防止指针环。
+ *          报文在解析器和视图的生命周期内必须保持有效。
+ */
+class DnsMessageParser {
+public:
+    /**
+     * @brief 解析报头
+     * @throws ParseException 报文短于12字节
+     */
+    explicit DnsMessageParser(std::string_view message);
+
+    const DnsHeader &header() const { return header_; }
+
+    /**
+     * @brief 读取下一个问题
+     * @return 问题部分已读完时返回false
+     * @throws ParseException 报文格式错误
+     */
+    bool next_question(DnsQuestionView &question);
+
+    /**
+     * @brief 读取下一条资源记录（依次为回答、权威、附加部分），未读的问题会被跳过
+     * @return 所有记录已读完时返回false
+     * @throws ParseException 报文格式错误
+     */
+    bool next_record(DnsRecordView &record);
+
+    /**
+     * @brief 校验报文中 offset 处的域名并返回其在原位置占用的结束偏移
+     * @throws ParseException 越界、标签类型非法、名称超过255字节或压缩指针成环
+     */
+    static size_t skip_name(std::string_view message, size_t offset);
+
+private:
+    uint16_t read_u16(size_t offset) const;
+    uint32_t read_u32(size_t offset) const;
+    void validate_rdata(const DnsRecordView &record) const;
+
+    std::string_view message_;
+    DnsHeader header_;
+    size_t offset_ = 12;
+    uint16_t questions_read_ = 0;
+    uint32_t records_read_ = 0;
+};
+
+// 实现
+inline DnsMessageParser::DnsMessageParser(std::string_view message) : message_(message) {
+    if (message_.size() < 12) {
+        throw ParseException("DNS message too short", "dns");
+    }
+    header_.id = read_u16(0);
+    header_.flags = read_u16(2);
+    header_.qdcount = read_u16(4);
+    header_.ancount = read_u16(6);
+    header_.nscount = read_u16(8);
+    header_.arcount = read_u16(10);
+}
+
+inline uint16_t DnsMessageParser::read_u16(size_t offset) const {
+    if (offset + 2 > message_.size()) {
+        throw ParseException("DNS message truncated", "dns");
+    }
+    return static_cast<uint16_t>((static_cast<uint8_t>(message_[offset]) << 8) |
+                                 static_cast<uint8_t>(message_[offset + 1]));
+}
+
+inline uint32_t DnsMessageParser::read_u32(size_t offset) const {
+    return (static_cast<uint32_t>(read_u16(offset)) << 16) | read_u16(offset + 2);
+}
+
+inline size_t DnsMessageParser::skip_name(std::string_view message, size_t offset) {
+    size_t pos = offset;
+    size_t segment_start = offset;  // 当前名称片段的起点，指针必须指向它之前
+    size_t end = 0;
+    size_t name_length = 1;
+    int hops = 0;
+
+    while (true) {
+        if (pos >= message.size()) {
+            throw ParseException("DNS name truncated", "dns");
+        }
+        uint8_t length = static_cast<uint8_t>(message[pos]);
+
+        if ((length & 0xC0) == 0xC0) {
+            if (pos + 1 >= message.size()) {
+                throw ParseException("DNS compression pointer truncated", "dns");
+            }
+            size_t target = (static_cast<size_t>(length & 0x3F) << 8) | static_cast<uint8_t>(message[pos + 1]);
+            if (target >= segment_start || ++hops > kMaxDnsCompressionPointers) {
+                throw ParseException("DNS compression pointer loop", "dns");
+            }
+            if (end == 0) {
+                end = pos + 2;
+            }
+            pos = segment_start = target;
+            continue;
+        }
+        if (length & 0xC0) {
+            throw ParseException("Unsupported DNS label type", "dns");
+        }
+        if (length == 0) {
+            return end == 0 ? pos + 1 : end;
+        }
+
+        name_length += length + 1;
+        if (name_length > 255) {
+            throw ParseException("DNS name exceeds 255 bytes", "dns");
+        }
+        pos += 1 + length;
+    }
+}
+
+inline bool DnsMessageParser::next_question(DnsQuestionView &question) {
+    if (questions_read_ >= header_.qdcount) {
+        return false;
+    }
+    size_t name_end = skip_name(message_, offset_);
+    question.name = DnsNameView(message_, offset_);
+    question.type = read_u16(name_end);
+    question.qclass = read_u16(name_end + 2);
+    offset_ = name_end + 4;
+    ++questions_read_;
+    return true;
+}
+
+inline bool DnsMessageParser::next_record(DnsRecordView &record) {
+    DnsQuestionView question;
+    while (next_question(question)) {
+    }
+
+    uint32_t total = static_cast<uint32_t>(header_.ancount) + header_.nscount + header_.arcount;
+    if (records_read_ >= total) {
+        return false;
+    }
+
+    if (records_read_ < header_.ancount) {
+        record.section = DnsSection::Answer;
+    } else if (records_read_ < static_cast<uint32_t>(header_.ancount) + header_.nscount) {
+        record.section = DnsSection::Authority;
+    } else {
+        record.section = DnsSection::Additional;
+    }
+
+    size_t name_end = skip_name(message_, offset_);
+    record.name = DnsNameView(message_, offset_);
+    record.type = read_u16(name_end);
+    record.rclass = read_u16(name_end + 2);
+    record.ttl = read_u32(name_end + 4);
+    record.rdata_length = read_u16(name_end + 8);
+    record.rdata_offset = name_end + 10;
+    record.message = message_;
+    if (record.rdata_offset + record.rdata_length > message_.size()) {
+        throw ParseException("DNS record data truncated", "dns");
+    }
+    validate_rdata(record);
+
+    offset_ = record.rdata_offset + record.rdata_length;
+    ++records_read_;
+    return true;
+}
+
+inline void DnsMessageParser::validate_rdata(const DnsRecordView &record) const {
+    size_t begin = record.rdata_offset;
+    size_t end = begin + record.rdata_length;
+
+    // RDATA 中的名称不能越过 RDATA 的边界
+    auto name_at = [&](size_t offset) {
+        size_t name_end = offset < end ? skip_name(message_, offset) : end + 1;
+        if (name_end > end) {
+            throw ParseException("DNS record data malformed", "dns");
+        }
+        return name_end;
+    };
+    auto require = [&](bool ok) {
+        if (!ok) {
+            throw ParseException("DNS record data malformed", "dns");
+        }
+    };
+
+    switch (record.record_type()) {
+        case DNSRecordType::A:
+            require(record.rdata_length == 4);
+            break;
+        case DNSRecordType::AAAA:
+            require(record.rdata_length == 16);
+            break;
+        case DNSRecordType::CNAME:
+        case DNSRecordType::NS:
+        case DNSRecordType::PTR:
+        case DNSRecordType::DNAME:
+            require(name_at(begin) == end);
+            break;
+        case DNSRecordType::MX:
+            require(record.rdata_length > 2 && name_at(begin + 2) == end);
+            break;
+        case DNSRecordType::SRV:
+            require(record.rdata_length > 6 && name_at(begin + 6) == end);
+            break;
+        case DNSRecordType::SOA: {
+            size_t rname = name_at(begin);
+            require(name_at(rname) + 20 == end);
+            break;
+        }
+        case DNSRecordType::TXT: {
+            size_t pos = begin;
+            while (pos < end) {
+                pos += 1 + static_cast<uint8_t>(message_[pos]);
+            }
+            require(pos == end);
+            break;
+        }
+        case DNSRecordType::CAA:
+            require(record.rdata_length >= 2 &&
+                    begin + 2 + static_cast<uint8_t>(message_[begin + 1]) <= end);
+            break;
+        case DNSRecordType::SVCB:
+        case DNSRecordType::HTTPS: {
+            // SvcParams 中的键值长度逐个检查
+            require(record.rdata_length > 2);
+            size_t pos = name_at(begin + 2);
+            while (pos < end) {
+                require(pos + 4 <= end);
+                pos += 4 + read_u16(pos + 2);
+            }
+            require(pos == end);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+namespace dns_parser_detail {
+
+inline uint16_t u16_at(std::string_view data, size_t offset) {
+    return static_cast<uint16_t>((static_cast<uint8_t>(data[offset]) << 8) | static_cast<uint8_t>(data[offset + 1]));
+}
+
+inline uint32_t u32_at(std::string_view data, size_t offset) {
+    return (static_cast<uint32_t>(u16_at(data, offset)) << 16) | u16_at(data, offset + 2);
+}
+
+inline void append_hex(std::string &out, std::string_view bytes) {
+    static const char digits[] = "0123456789abcdef";
+    for (char c : bytes) {
+        out.push_back(digits[static_cast<uint8_t>(c) >> 4]);
+        out.push_back(digits[static_cast<uint8_t>(c) & 0x0F]);
+    }
+}
+
+inline void append_quoted(std::string &out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+inline void append_address(std::string &out, int family, const char *bytes) {
+    char text[INET6_ADDRSTRLEN];
+    if (inet_ntop(family, bytes, text, sizeof(text))) {
+        out.append(text);
+    }
+}
+
+// SVCB/HTTPS 的 SvcParams（RFC 9460）
+inline void append_svc_params(std::string &out, std::string_view params) {
+    size_t pos = 0;
+    while (pos + 4 <= params.size()) {
+        uint16_t key = u16_at(params, pos);
+        uint16_t length = u16_at(params, pos + 2);
+        std::string_view value = params.substr(pos + 4, length);
+        pos += 4 + length;
+
+        out.push_back(' ');
+        switch (key) {
+            case 1: {  // alpn
+                out.append("alpn=");
+                size_t i = 0;
+                while (i < value.size()) {
+                    uint8_t id_length = static_cast<uint8_t>(value[i]);
+                    std::string_view id = value.substr(i + 1, id_length);
+                    if (i > 0) {
+                        out.push_back(',');
+                    }
+                    out.append(id.data(), id.size());
+                    i += 1 + id_length;
+                }
+                break;
+            }
+            case 3:  // port
+                out.append("port=");
+                if (value.size() == 2) {
+                    out.append(std::to_string(u16_at(value, 0)));
+                }
+                break;
+            case 4:  // ipv4hint
+            case 6: {  // ipv6hint
+                out.append(key == 4 ? "ipv4hint=" : "ipv6hint=");
+                size_t width = key == 4 ? 4 : 16;
+                for (size_t i = 0; i + width <= value.size(); i += width) {
+                    if (i > 0) {
+                        out.push_back(',');
+                    }
+                    append_address(out, key == 4 ? AF_INET : AF_INET6, value.data() + i);
+                }
+                break;
+            }
+            default:
+                out.append("key" + std::to_string(key));
+                if (!value.empty()) {
+                    out.push_back('=');
+                    append_hex(out, value);
+                }
+                break;
+        }
+    }
+}
+
+}  // namespace dns_parser_detail
+
+inline std::string DnsRecordView::data_to_string() const {
+    using namespace dns_parser_detail;
+
+    std::string_view data = rdata();
+    std::string out;
+    switch (record_type()) {
+        case DNSRecordType::A:
+        case DNSRecordType::AAAA:
+            append_address(out, type == static_cast<uint16_t>(DNSRecordType::A) ? AF_INET : AF_INET6, data.data());
+            break;
+        case DNSRecordType::CNAME:
+        case DNSRecordType::NS:
+        case DNSRecordType::PTR:
+        case DNSRecordType::DNAME:
+            DnsNameView(message, rdata_offset).append_to(out);
+            break;
+        case DNSRecordType::MX:
+            out = std::to_string(u16_at(data, 0)) + " ";
+            DnsNameView(message, rdata_offset + 2).append_to(out);
+            break;
+        case DNSRecordType::SRV:
+            out = std::to_string(u16_at(data, 0)) + " " + std::to_string(u16_at(data, 2)) + " " +
+                  std::to_string(u16_at(data, 4)) + " ";
+            DnsNameView(message, rdata_offset + 6).append_to(out);
+            break;
+        case DNSRecordType::SOA: {
+            size_t rname = DnsMessageParser::skip_name(message, rdata_offset);
+            size_t numbers = DnsMessageParser::skip_name(message, rname);
+            DnsNameView(message, rdata_offset).append_to(out);
+            out.push_back(' ');
+            DnsNameView(message, rname).append_to(out);
+            for (size_t i = 0; i < 5; ++i) {
+                out.push_back(' ');
+                out.append(std::to_string(u32_at(message, numbers + i * 4)));
+            }
+            break;
+        }
+        case DNSRecordType::TXT: {
+            size_t pos = 0;
+            while (pos < data.size()) {
+                uint8_t length = static_cast<uint8_t>(data[pos]);
+                if (pos > 0) {
+                    out.push_back(' ');
+                }
+                append_quoted(out, data.substr(pos + 1, length));
+                pos += 1 + length;
+            }
+            break;
+        }
+        case DNSRecordType::CAA: {
+            uint8_t tag_length = static_cast<uint8_t>(data[1]);
+            out = std::to_string(static_cast<uint8_t>(data[0])) + " ";
+            out.append(data.substr(2, tag_length).data(), tag_length);
+            out.push_back(' ');
+            append_quoted(out, data.substr(2 + tag_length));
+            break;
+        }
+        case DNSRecordType::SVCB:
+        case DNSRecordType::HTTPS: {
+            size_t params = DnsMessageParser::skip_name(message, rdata_offset + 2);
+            out = std::to_string(u16_at(data, 0)) + " ";
+            DnsNameView(message, rdata_offset + 2).append_to(out);
+            append_svc_params(out, message.substr(params, rdata_offset + rdata_length - params));
+            break;
+        }
+        default:
+            // 未知类型使用 RFC 3597 通用格式
+            out = "\\# " + std::to_string(rdata_length);
+            if (rdata_length > 0) {
+                out.push_back(' ');
+                append_hex(out, data);
+            }
+            break;
+    }
+    return out;
+}
+
+#endif  // DNS_PARSER_HPP
@@ -0,0 +1,101 @@
+#ifndef DNS_TYPES_HPP
+#define DNS_TYPES_HPP
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// DNS记录类型枚举
+enum class DNSRecordType {
+    A = 1,
+    NS = 2,
+    CNAME = 5,
+    SOA = 6,
+    PTR = 12,
+    MX = 15,
+    TXT = 16,
+    AAAA = 28,
+    SRV = 33,
+    DNAME = 39,
+    OPT = 41,
+    SVCB = 64,
+    HTTPS = 65,
+    CAA = 257
+};
+
+// DNS查询结果结构
+struct DNSRecord {
+    std::string name;    // 域名
+    DNSRecordType type;  // 记录类型
+    uint32_t ttl;        // 生存时间
+    std::string data;    // 记录数据（展示格式）
+};
+
+// 一次DNS查询的结果：上游应答的RCODE与回答部分的记录
+// rcode 为-1表示没有得到可用的应答（传输失败或应答无法解析）；rcode 为0且没有记录即NODATA。
+// negative_ttl 为否定应答（NXDOMAIN或NODATA）可缓存的秒数，取权威部分SOA的TTL与MINIMUM中
+// 较小者（RFC 2308 5），应答中没有SOA时为0
+struct DnsAnswer {
+    int rcode = -1;
+    std::vector<DNSRecord> records;
+    uint32_t negative_ttl = 0;
+
+    // 上游明确答复名称不存在（NXDOMAIN）或不存在该类型的记录（NODATA）
+    bool negative() const { return records.empty() && (rcode == 0 || rcode == 3); }
+};
+
+// 记录类型名称，未知类型返回数值
+inline std::string record_type_name(DNSRecordType type) {
+    switch (type) {
+        case DNSRecordType::A:
+            return "A";
+        case DNSRecordType::NS:
+            return "NS";
+        case DNSRecordType::CNAME:
+            return "CNAME";
+        case DNSRecordType::SOA:
+            return "SOA";
+        case DNSRecordType::PTR:
+            return "PTR";
+        case DNSRecordType::MX:
+            return "MX";
+        case DNSRecordType::TXT:
+            return "TXT";
+        case DNSRecordType::AAAA:
+            return "AAAA";
+        case DNSRecordType::SRV:
+            return "SRV";
+        case DNSRecordType::DNAME:
+            return "DNAME";
+        case DNSRecordType::OPT:
+            return "OPT";
+        case DNSRecordType::SVCB:
+            return "SVCB";
+        case DNSRecordType::HTTPS:
+            return "HTTPS";
+        case DNSRecordType::CAA:
+            return "CAA";
+        default:
+            return std::to_string(static_cast<int>(type));
+    }
+}
+
+// 解析记录类型名称（不区分大小写），无法识别时返回false
+inline bool parse_record_type(std::string name, DNSRecordType &type) {
+    for (auto &c : name) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    for (DNSRecordType candidate :
+         {DNSRecordType::A, DNSRecordType::NS, DNSRecordType::CNAME, DNSRecordType::SOA, DNSRecordType::PTR,
+          DNSRecordType::MX, DNSRecordType::TXT, DNSRecordType::AAAA, DNSRecordType::SRV, DNSRecordType::DNAME,
+          DNSRecordType::SVCB, DNSRecordType::HTTPS, DNSRecordType::CAA}) {
+        if (name == record_type_name(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif  // DNS_TYPES_HPP
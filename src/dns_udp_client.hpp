@@ -0,0 +1,489 @@
+#ifndef DNS_UDP_CLIENT_HPP
+#define DNS_UDP_CLIENT_HPP
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "dns_encoder.hpp"
+#include "dns_parser.hpp"
+#include "dns_types.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include "tools.hpp"
+
+/**
+ * @brief 批量查询中的一个问题
+ */
+struct DnsUdpQuestion {
+    std::string domain;
+    DNSRecordType type = DNSRecordType::A;
+};
+
+/**
+ * @brief 一个问题的查询结果
+ */
+struct DnsUdpResult {
+    std::vector<DNSRecord> records;  // 回答部分的记录（不含OPT伪记录）
+    int rcode = -1;                  // 应答的RCODE，-1 表示截止时间前没有收到应答
+    bool via_tcp = false;            // UDP应答被截断（TC=1），经TCP重新查询
+};
+
+// 解析 "host[:port]" 形式的DNS服务器地址，IPv6地址带端口时写作 "[::1]:53"；未指定端口时保持 port 不变
+inline bool parse_dns_server(const std::string &text, std::string &host, uint16_t &port) {
+    std::string port_text;
+    if (!text.empty() && text[0] == '[') {
+        size_t close = text.find(']');
+        if (close == std::string::npos || (close + 1 < text.size() && text[close + 1] != ':')) {
+            return false;
+        }
+        host = text.substr(1, close - 1);
+        if (close + 1 < text.size()) {
+            port_text = text.substr(close + 2);
+        }
+    } else if (std::count(text.begin(), text.end(), ':') == 1) {
+        size_t colon = text.find(':');
+        host = text.substr(0, colon);
+        port_text = text.substr(colon + 1);
+    } else {
+        host = text;
+    }
+    if (host.empty() || text.back() == ':') {
+        return false;
+    }
+    if (port_text.empty()) {
+        return true;
+    }
+    if (port_text.size() > 5 || !std::all_of(port_text.begin(), port_text.end(), [](unsigned char c) {
+            return std::isdigit(c);
+        })) {
+        return false;
+    }
+    unsigned long number = std::stoul(port_text);
+    if (number == 0 || number > 65535) {
+        return false;
+    }
+    port = static_cast<uint16_t>(number);
+    return true;
+}
+
+/**
+ * @brief 明文DNS客户端（RFC 1035，UDP，截断时改用TCP）
+ * @details 与DoH并列的传输方式，适合本地可信的解析器或压测用的本地替身服务器：
+ *          查询报文与 RFC 8484 相同（DnsQueryBuffer 编码），直接经UDP发送，省去HTTP与TLS开销。
+ *          每个查询使用随机事务ID，应答的ID与问题部分（名称不区分大小写）都与查询一致才被接受，
+ *          其余报文计入 mismatched() 后丢弃。应答置TC位时用同一报文经TCP（2字节长度前缀）重新查询。
+ *          query_batch 在Linux上用 sendmmsg/recvmmsg 一次系统调用收发多个报文；
+ *          同时在途的查询不超过 kMaxInFlight，未应答的查询在每个重试间隔重发。
+ *          持有一个已connect的UDP套接字，不是线程安全的，每个线程使用自己的实例。
+ */
+class DnsUdpClient {
+public:
+    static constexpr size_t kBatchSize = 64;        // 每次 sendmmsg/recvmmsg 的最大报文数
+    static constexpr size_t kMaxInFlight = 256;     // 批量查询同时在途的最大查询数
+    static constexpr size_t kMaxDatagram = 4096;    // 接收缓冲区大小，更长的报文被丢弃
+
+    /**
+     * @brief 构造函数
+     * @param host 服务器IP地址（不解析域名）
+     * @param port 服务器端口
+     * @param timeout 每批查询的总超时（所有窗口共用一个截止时间），重试间隔为剩余时间 / attempts
+     * @param attempts UDP发送次数（含首次）
+     * @throws NetworkException 地址无效或无法创建套接字
+     */
+    explicit DnsUdpClient(const std::string &host, uint16_t port = 53,
+                          std::chrono::milliseconds timeout = std::chrono::milliseconds(2000), int attempts = 2);
+    ~DnsUdpClient();
+
+    DnsUdpClient(const DnsUdpClient &) = delete;
+    DnsUdpClient &operator=(const DnsUdpClient &) = delete;
+
+    /**
+     * @brief 查询单个域名
+     * @return 回答部分的记录；NXDOMAIN等错误应答返回空结果
+     * @throws TimeoutException 超时没有收到应答
+     * @throws EncodingException 域名格式错误
+     */
+    std::vector<DNSRecord> query(const std::string &domain, DNSRecordType type = DNSRecordType::A);
+
+    /**
+     * @brief 批量查询，结果与 questions 一一对应
+     * @throws EncodingException 某个域名格式错误
+     */
+    std::vector<DnsUdpResult> query_batch(const std::vector<DnsUdpQuestion> &questions);
+
+    /**
+     * @brief 因截断改用TCP的查询数
+     */
+    uint64_t tcp_fallbacks() const { return tcp_fallbacks_; }
+
+    /**
+     * @brief 因ID或问题不匹配、格式错误而丢弃的应答数
+     */
+    uint64_t mismatched() const { return mismatched_; }
+
+private:
+    struct InFlight {
+        DnsQueryBuffer query;
+        size_t index = 0;  // 在 questions 中的下标
+        bool done = false;
+    };
+
+    void run_window(const std::vector<DnsUdpQuestion> &questions, size_t begin, size_t end,
+                    std::chrono::steady_clock::time_point deadline, std::vector<DnsUdpResult> &results);
+    void send_pending(std::vector<InFlight> &flights);
+    size_t receive(std::vector<std::string_view> &datagrams);
+    std::string query_tcp(int &fd, const DnsQueryBuffer &query);
+    int connect_tcp();
+
+    // 应答的事务ID与问题部分是否与查询一致
+    static bool matches(const DnsQueryBuffer &query, std::string_view response);
+
+    sockaddr_storage server_{};
+    socklen_t server_length_ = 0;
+    std::string endpoint_;
+    std::chrono::milliseconds timeout_;
+    int attempts_;
+    int fd_ = -1;
+    std::vector<char> buffers_;
+    uint64_t tcp_fallbacks_ = 0;
+    uint64_t mismatched_ = 0;
+};
+
+// 实现
+inline DnsUdpClient::DnsUdpClient(const std::string &host, uint16_t port, std::chrono::milliseconds timeout,
+                                  int attempts)
+    : endpoint_(host + ":" + std::to_string(port)),
+      timeout_(timeout),
+      attempts_(std::max(attempts, 1)),
+      buffers_(kBatchSize * kMaxDatagram) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo *address = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &address) != 0 || !address) {
+        throw NetworkException("Invalid DNS server address: " + host);
+    }
+    std::memcpy(&server_, address->ai_addr, address->ai_addrlen);
+    server_length_ = address->ai_addrlen;
+    freeaddrinfo(address);
+
+    // connect 后内核只交付来自该服务器的报文，并且可以不带地址收发
+    fd_ = socket(server_.ss_family, SOCK_DGRAM, 0);
+    if (fd_ < 0 || connect(fd_, reinterpret_cast<sockaddr *>(&server_), server_length_) != 0) {
+        int error = errno;
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        throw NetworkException(std::string("Failed to open UDP socket: ") + std::strerror(error), error, endpoint_);
+    }
+}
+
+inline DnsUdpClient::~DnsUdpClient() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+inline std::vector<DNSRecord> DnsUdpClient::query(const std::string &domain, DNSRecordType type) {
+    auto results = query_batch({{domain, type}});
+    if (results[0].rcode < 0) {
+        throw TimeoutException("DNS query for " + domain + " to " + endpoint_ + " timed out",
+                               static_cast<int>(timeout_.count() / 1000));
+    }
+    return std::move(results[0].records);
+}
+
+inline std::vector<DnsUdpResult> DnsUdpClient::query_batch(const std::vector<DnsUdpQuestion> &questions) {
+    std::vector<DnsUdpResult> results(questions.size());
+    // 整批共用一个截止时间，超时后剩余窗口不再发送，结果保持未应答
+    const auto deadline = std::chrono::steady_clock::now() + timeout_;
+    for (size_t begin = 0; begin < questions.size(); begin += kMaxInFlight) {
+        run_window(questions, begin, std::min(questions.size(), begin + kMaxInFlight), deadline, results);
+    }
+    return results;
+}
+
+inline void DnsUdpClient::run_window(const std::vector<DnsUdpQuestion> &questions, size_t begin, size_t end,
+                                     std::chrono::steady_clock::time_point deadline,
+                                     std::vector<DnsUdpResult> &results) {
+    using Clock = std::chrono::steady_clock;
+
+    // 窗口内事务ID互不相同，应答按ID找到对应的查询
+    std::vector<InFlight> flights(end - begin);
+    std::unordered_map<uint16_t, size_t> by_id;
+    by_id.reserve(flights.size());
+    for (size_t i = 0; i < flights.size(); ++i) {
+        DnsQueryOptions options;
+        do {
+            options.id = random_dns_id();
+        } while (by_id.count(options.id));
+        by_id.emplace(options.id, i);
+        flights[i].index = begin + i;
+        flights[i].query.encode(questions[begin + i].domain, static_cast<uint16_t>(questions[begin + i].type),
+                                options);
+    }
+
+    std::vector<size_t> truncated;
+    std::vector<std::string_view> datagrams;
+    size_t remaining = flights.size();
+    const auto interval = (deadline - Clock::now()) / attempts_;
+    for (int attempt = 0; attempt < attempts_ && remaining > 0 && Clock::now() < deadline; ++attempt) {
+        send_pending(flights);
+        auto resend_at = attempt + 1 == attempts_ ? deadline : std::min(deadline, Clock::now() + interval);
+
+        while (remaining > 0) {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(resend_at - Clock::now());
+            if (wait.count() <= 0) {
+                break;
+            }
+            pollfd readable{fd_, POLLIN, 0};
+            if (poll(&readable, 1, static_cast<int>(wait.count())) <= 0) {
+                continue;
+            }
+
+            size_t count = receive(datagrams);
+            for (size_t d = 0; d < count; ++d) {
+                std::string_view response = datagrams[d];
+                auto it = response.size() >= 2
+                              ? by_id.find(static_cast<uint16_t>(static_cast<uint8_t>(response[0]) << 8 |
+                                                                 static_cast<uint8_t>(response[1])))
+                              : by_id.end();
+                if (it == by_id.end() || !matches(flights[it->second].query, response)) {
+                    ++mismatched_;
+                    continue;
+                }
+                InFlight &flight = flights[it->second];
+                if (flight.done) {
+                    continue;  // 重发造成的重复应答
+                }
+                try {
+                    DnsMessageParser parser(response);
+                    if (parser.header().truncated()) {
+                        truncated.push_back(it->second);
+                    } else {
+                        DnsUdpResult &result = results[flight.index];
+                        result.records = parse_dns_wireformat_response(std::string(response));
+                        result.rcode = parser.header().rcode();
+                    }
+                } catch (const ParseException &e) {
+                    ++mismatched_;
+                    DOH_LOG_DEBUG("Ignoring malformed DNS response from {}: {}", endpoint_, e.what());
+                    continue;
+                }
+                flight.done = true;
+                --remaining;
+            }
+        }
+    }
+
+    // 截断的应答经TCP重新查询，同一窗口共用一个连接
+    int tcp = -1;
+    for (size_t i : truncated) {
+        DnsUdpResult &result = results[flights[i].index];
+        try {
+            std::string response = query_tcp(tcp, flights[i].query);
+            result.records = parse_dns_wireformat_response(response);
+            result.rcode = DnsMessageParser(response).header().rcode();
+            result.via_tcp = true;
+            ++tcp_fallbacks_;
+        } catch (const DoHException &e) {
+            DOH_LOG_DEBUG("TCP retry for {} failed: {}", questions[flights[i].index].domain, e.what());
+            if (tcp >= 0) {
+                close(tcp);
+                tcp = -1;
+            }
+        }
+    }
+    if (tcp >= 0) {
+        close(tcp);
+    }
+}
+
+inline void DnsUdpClient::send_pending(std::vector<InFlight> &flights) {
+#ifdef __linux__
+    mmsghdr messages[kBatchSize];
+    iovec iov[kBatchSize];
+    size_t next = 0;
+    while (next < flights.size()) {
+        unsigned int count = 0;
+        for (; next < flights.size() && count < kBatchSize; ++next) {
+            if (flights[next].done) {
+                continue;
+            }
+            iov[count] = {flights[next].query.data, flights[next].query.size};
+            messages[count] = {};
+            messages[count].msg_hdr.msg_iov = &iov[count];
+            messages[count].msg_hdr.msg_iovlen = 1;
+            ++count;
+        }
+        for (unsigned int sent = 0; sent < count;) {
+            int n = sendmmsg(fd_, messages + sent, count - sent, 0);
+            if (n <= 0) {
+                // 发送失败的查询由下一次重发或超时处理
+                DOH_LOG_DEBUG("sendmmsg to {} failed: {}", endpoint_, std::strerror(errno));
+                break;
+            }
+            sent += static_cast<unsigned int>(n);
+        }
+    }
+#else
+    for (auto &flight : flights) {
+        if (!flight.done) {
+            send(fd_, flight.query.data, flight.query.size, 0);
+        }
+    }
+#endif
+}
+
+inline size_t DnsUdpClient::receive(std::vector<std::string_view> &datagrams) {
+    datagrams.clear();
+#ifdef __linux__
+    mmsghdr messages[kBatchSize];
+    iovec iov[kBatchSize];
+    for (size_t i = 0; i < kBatchSize; ++i) {
+        iov[i] = {buffers_.data() + i * kMaxDatagram, kMaxDatagram};
+        messages[i] = {};
+        messages[i].msg_hdr.msg_iov = &iov[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(fd_, messages, kBatchSize, MSG_DONTWAIT, nullptr);
+    for (int i = 0; i < n; ++i) {
+        if (!(messages[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+            datagrams.emplace_back(buffers_.data() + i * kMaxDatagram, messages[i].msg_len);
+        }
+    }
+#else
+    for (size_t i = 0; i < kBatchSize; ++i) {
+        ssize_t n = recv(fd_, buffers_.data() + i * kMaxDatagram, kMaxDatagram, MSG_DONTWAIT);
+        if (n < 0) {
+            break;
+        }
+        datagrams.emplace_back(buffers_.data() + i * kMaxDatagram, static_cast<size_t>(n));
+    }
+#endif
+    // ICMP端口不可达等错误在这里被读走，查询按超时处理
+    return datagrams.size();
+}
+
+inline bool DnsUdpClient::matches(const DnsQueryBuffer &query, std::string_view response) {
+    // 查询不带EDNS时，头部之后只有问题部分；应答的第一个名称不会被压缩，可以逐字节比较
+    size_t question = query.size - 12;
+    if (response.size() < query.size || std::memcmp(response.data(), query.data, 2) != 0 ||
+        !(static_cast<uint8_t>(response[2]) & 0x80) || response[4] != 0 || response[5] != 1) {
+        return false;
+    }
+    for (size_t i = 0; i < question; ++i) {
+        if (std::tolower(static_cast<unsigned char>(response[12 + i])) != std::tolower(static_cast<unsigned char>(query.data[12 + i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline int DnsUdpClient::connect_tcp() {
+    int fd = socket(server_.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw NetworkException(std::string("Failed to open TCP socket: ") + std::strerror(errno), errno, endpoint_);
+    }
+    // 非阻塞connect，最多等待 timeout
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    int status = connect(fd, reinterpret_cast<sockaddr *>(&server_), server_length_);
+    if (status != 0 && errno == EINPROGRESS) {
+        pollfd writable{fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&writable, 1, static_cast<int>(timeout_.count())) == 1 &&
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0) {
+            status = error == 0 ? 0 : -1;
+            errno = error;
+        } else {
+            errno = ETIMEDOUT;
+        }
+    }
+    if (status != 0) {
+        int error = errno;
+        close(fd);
+        throw NetworkException(std::string("TCP connect failed: ") + std::strerror(error), error, endpoint_);
+    }
+    fcntl(fd, F_SETFL, flags);
+
+    timeval limit{static_cast<time_t>(timeout_.count() / 1000),
+                  static_cast<suseconds_t>(timeout_.count() % 1000 * 1000)};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return fd;
+}
+
+inline std::string DnsUdpClient::query_tcp(int &fd, const DnsQueryBuffer &query) {
+    if (fd < 0) {
+        fd = connect_tcp();
+    }
+
+    // 2字节长度前缀（RFC 1035 4.2.2）
+    char out[2 + kMaxDnsQuerySize];
+    out[0] = static_cast<char>(query.size >> 8);
+    out[1] = static_cast<char>(query.size & 0xFF);
+    std::memcpy(out + 2, query.data, query.size);
+    size_t sent = 0;
+    while (sent < 2 + query.size) {
+        ssize_t n = send(fd, out + sent, 2 + query.size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            throw NetworkException("TCP send failed", errno, endpoint_);
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    auto read_exact = [&](char *data, size_t size) {
+        size_t received = 0;
+        while (received < size) {
+            ssize_t n = recv(fd, data + received, size - received, 0);
+            if (n == 0) {
+                throw NetworkException("TCP connection closed by server", 0, endpoint_);
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    throw TimeoutException("TCP DNS query to " + endpoint_ + " timed out",
+                                           static_cast<int>(timeout_.count() / 1000));
+                }
+                throw NetworkException("TCP receive failed", errno, endpoint_);
+            }
+            received += static_cast<size_t>(n);
+        }
+    };
+
+    // 同一连接上只有这一个查询在途，但仍跳过ID不符的应答
+    while (true) {
+        unsigned char prefix[2];
+        read_exact(reinterpret_cast<char *>(prefix), 2);
+        std::string response(static_cast<size_t>(prefix[0]) << 8 | prefix[1], '\0');
+        read_exact(&response[0], response.size());
+        if (matches(query, response)) {
+            return response;
+        }
+        ++mismatched_;
+    }
+}
+
+#endif  // DNS_UDP_CLIENT_HPP
@@ -0,0 +1,272 @@
+#ifndef DNS_WIRE_HPP
+#define DNS_WIRE_HPP
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dns_encoder.hpp"
+#include "dns_parser.hpp"
+#include "dns_types.hpp"
+#include "exceptions.hpp"
+
+/**
+ * @brief 线格式编码的资源记录
+ */
+struct DnsWireRecord {
+    std::string name;  // 小写，不带结尾的点
+    DNSRecordType type = DNSRecordType::A;
+    uint32_t ttl = 0;
+    std::string data;   // JSON API 中 data 字段的展示格式
+    std::string rdata;  // 线格式RDATA
+};
+
+
+namespace dns_wire_detail {
+
+inline std::string lower(std::string_view text) {
+    std::string out(text);
+    for (auto &c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// 追加非压缩的线格式域名
+inline void append_name(std::string &out, std::string_view name) {
+    if (!name.empty() && name.back() == '.') {
+        name.remove_suffix(1);
+    }
+    if (!name.empty() && name.size() + 2 > kMaxDnsNameLength) {
+        throw EncodingException("Domain name exceeds 255 bytes", "zone");
+    }
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t dot = name.find('.', start);
+        if (dot == std::string_view::npos) {
+            dot = name.size();
+        }
+        size_t length = dot - start;
+        if (length == 0 || length > kMaxDnsLabelLength) {
+            throw EncodingException("Invalid label in domain name: " + std::string(name), "zone");
+        }
+        out.push_back(static_cast<char>(length));
+        out.append(name.substr(start, length));
+        start = dot + 1;
+    }
+    out.push_back('\0');
+}
+
+inline void append_u16(std::string &out, uint16_t value) {
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+inline void append_u32(std::string &out, uint32_t value) {
+    append_u16(out, static_cast<uint16_t>(value >> 16));
+    append_u16(out, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+// 按空白拆分，双引号内的空白保留，支持 \" 与 \\ 转义；';' 之后为注释
+inline std::vector<std::string> tokenize(const std::string &line, std::vector<bool> *quoted = nullptr) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+        if (c == ';') {
+            break;
+        }
+        std::string token;
+        bool is_quoted = c == '"';
+        if (is_quoted) {
+            ++i;
+            while (i < line.size() && line[i] != '"') {
+                if (line[i] == '\\' && i + 1 < line.size()) {
+                    ++i;
+                }
+                token.push_back(line[i++]);
+            }
+            if (i >= line.size()) {
+                throw EncodingException("Unterminated quoted string", "zone");
+            }
+            ++i;
+        } else {
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i])) && line[i] != ';') {
+                token.push_back(line[i++]);
+            }
+        }
+        tokens.push_back(std::move(token));
+        if (quoted) {
+            quoted->push_back(is_quoted);
+        }
+    }
+    return tokens;
+}
+
+inline bool parse_number(const std::string &text, uint64_t max, uint64_t &value) {
+    if (text.empty() || text.size() > 10 ||
+        !std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+    value = std::stoull(text);
+    return value <= max;
+}
+
+}  // namespace dns_wire_detail
+
+/**
+ * @brief 名称规范化：小写，去掉结尾的点
+ */
+inline std::string normalize_dns_name(std::string_view name) {
+    if (!name.empty() && name.back() == '.') {
+        name.remove_suffix(1);
+    }
+    return dns_wire_detail::lower(name);
+}
+
+/**
+ * @brief 由展示格式构造记录（名称规范化并编码RDATA）
+ * @details 支持 A、AAAA、CNAME、NS、PTR、MX、TXT；TXT 的每个字符串可以用双引号括起。
+ *          可用于把解析得到的 DNSRecord 重新编码为线格式
+ * @param data 展示格式的RDATA，如 "192.0.2.1"、"10 mail.example.com."、"\"v=spf1 -all\""
+ * @throws EncodingException 名称或RDATA无效、类型不支持
+ */
+inline DnsWireRecord make_dns_wire_record(const std::string &name, DNSRecordType type, uint32_t ttl,
+                                          const std::string &data) {
+    using namespace dns_wire_detail;
+
+    DnsWireRecord record;
+    record.name = normalize_dns_name(name);
+    record.type = type;
+    record.ttl = ttl;
+    // 校验名称
+    std::string owner;
+    append_name(owner, record.name);
+
+    switch (type) {
+        case DNSRecordType::A:
+        case DNSRecordType::AAAA: {
+            unsigned char address[16];
+            int family = type == DNSRecordType::A ? AF_INET : AF_INET6;
+            if (inet_pton(family, data.c_str(), address) != 1) {
+                throw EncodingException("Invalid address: " + data, "zone");
+            }
+            record.rdata.assign(reinterpret_cast<const char *>(address), type == DNSRecordType::A ? 4 : 16);
+            record.data = data;
+            break;
+        }
+        case DNSRecordType::CNAME:
+        case DNSRecordType::NS:
+        case DNSRecordType::PTR: {
+            std::string target = normalize_dns_name(data);
+            append_name(record.rdata, target);
+            record.data = target + ".";
+            break;
+        }
+        case DNSRecordType::MX: {
+            auto tokens = tokenize(data);
+            uint64_t preference = 0;
+            if (tokens.size() != 2 || !parse_number(tokens[0], UINT16_MAX, preference)) {
+                throw EncodingException("MX record needs \"<preference> <exchange>\"", "zone");
+            }
+            std::string exchange = normalize_dns_name(tokens[1]);
+            append_u16(record.rdata, static_cast<uint16_t>(preference));
+            append_name(record.rdata, exchange);
+            record.data = tokens[0] + " " + exchange + ".";
+            break;
+        }
+        case DNSRecordType::TXT: {
+            auto tokens = tokenize(data);
+            if (tokens.empty()) {
+                throw EncodingException("TXT record needs at least one string", "zone");
+            }
+            for (const auto &text : tokens) {
+                if (text.size() > 255) {
+                    throw EncodingException("TXT string exceeds 255 bytes", "zone");
+                }
+                record.rdata.push_back(static_cast<char>(text.size()));
+                record.rdata.append(text);
+                if (!record.data.empty()) {
+                    record.data.push_back(' ');
+                }
+                record.data.push_back('"');
+                record.data.append(text);
+                record.data.push_back('"');
+            }
+            break;
+        }
+        default:
+            throw EncodingException("Unsupported record type: " + record_type_name(type), "zone");
+    }
+    return record;
+}
+
+
+/**
+ * @brief 为DNS查询报文生成应答报文
+ * @details 回显事务ID、RD位与问题部分，置QR与RA位；truncate 时置TC位并省略回答
+ * @param authoritative 是否置AA位
+ * @param max_age 输出回答中最小的TTL，没有回答时为-1
+ * @throws ParseException 查询报文格式错误或不是恰好一个问题的查询
+ */
+inline std::string build_dns_response(std::string_view query, int rcode,
+                                      const std::vector<const DnsWireRecord *> &records, bool truncate,
+                                      bool authoritative, int64_t &max_age) {
+    using namespace dns_wire_detail;
+
+    DnsMessageParser parser(query);
+    if (parser.header().is_response() || parser.header().qdcount != 1) {
+        throw ParseException("Expected a query with exactly one question", "dns");
+    }
+    size_t question_end = DnsMessageParser::skip_name(query, 12) + 4;
+    if (question_end > query.size()) {
+        throw ParseException("Truncated question section", "dns");
+    }
+    size_t answers = truncate ? 0 : records.size();
+
+    uint16_t flags = 0x8000 | 0x0080;          // QR、RA
+    flags |= parser.header().flags & 0x0100;  // 回显RD
+    if (authoritative) {
+        flags |= 0x0400;
+    }
+    if (truncate) {
+        flags |= 0x0200;
+    }
+    flags |= static_cast<uint16_t>(rcode & 0x0F);
+
+    std::string response;
+    response.reserve(question_end + answers * 64);
+    append_u16(response, parser.header().id);
+    append_u16(response, flags);
+    append_u16(response, 1);
+    append_u16(response, static_cast<uint16_t>(answers));
+    append_u16(response, 0);
+    append_u16(response, 0);
+    response.append(query.substr(12, question_end - 12));
+
+    max_age = -1;
+    for (size_t i = 0; i < answers; ++i) {
+        const DnsWireRecord *record = records[i];
+        append_name(response, record->name);
+        append_u16(response, static_cast<uint16_t>(record->type));
+        append_u16(response, 1);  // IN
+        append_u32(response, record->ttl);
+        append_u16(response, static_cast<uint16_t>(record->rdata.size()));
+        response.append(record->rdata);
+        max_age = max_age < 0 ? record->ttl : std::min<int64_t>(max_age, record->ttl);
+    }
+    return response;
+}
+
+
+#endif  // DNS_WIRE_HPP
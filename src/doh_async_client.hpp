@@ -0,0 +1,462 @@
+#ifndef DOH_ASYNC_CLIENT_HPP
+#define DOH_ASYNC_CLIENT_HPP
+
+#include <curl/curl.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hpp"
+#include "doh_client.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+/**
+ * @brief 异步DoH客户端
+ * @details 单个事件循环线程驱动一个 curl multi 句柄：curl 通过 socket/timer 回调告知需要关注的
+ *          套接字和超时，循环线程使用 epoll（非Linux平台使用poll）等待事件后调用
+ *          curl_multi_socket_action，因此在途请求数量不受线程数限制。
+ *          每个请求的总超时取自 DoHServerConfig::timeout。
+ *          完成回调在事件循环线程上执行，不应阻塞。
+ */
+class AsyncDoHClient {
+public:
+    /**
+     * @brief 完成回调，成功时 error 为空，失败时 records 为空且 error 持有 DoHException
+     */
+    using Callback = std::function<void(std::vector<DNSRecord> records, std::exception_ptr error)>;
+
+    /**
+     * @brief 构造函数，启动事件循环线程
+     * @param server 服务器配置（url 与 timeout）
+     * @param connect_timeout 连接超时（秒）
+     * @param pool 连接池，为nullptr时不接入；池的生命周期必须长于客户端
+     */
+    explicit AsyncDoHClient(const DoHServerConfig& server, int connect_timeout = 5,
+                            DoHConnectionPool* pool = &DoHConnectionPool::instance());
+
+    /**
+     * @brief 使用服务器URL构造，超时取 DoHServerConfig 默认值
+     */
+    explicit AsyncDoHClient(const std::string& server_url)
+        : AsyncDoHClient(DoHServerConfig{"", server_url, {"get", "post", "json"}}) {}
+
+    /**
+     * @brief 析构函数，停止事件循环，未完成的请求以异常结束
+     */
+    ~AsyncDoHClient();
+
+    AsyncDoHClient(const AsyncDoHClient&) = delete;
+    AsyncDoHClient& operator=(const AsyncDoHClient&) = delete;
+
+    /**
+     * @brief 提交查询，完成时调用回调（线程安全）
+     * @details 不抛出异常：域名无法编码（EncodingException）等提交阶段的错误同样经回调返回
+     */
+    void query(const std::string& domain, DNSRecordType type, DoHMethod method, Callback callback);
+
+    /**
+     * @brief 提交查询，返回future（线程安全）
+     * @details 失败时 future.get() 抛出 NetworkException / HttpException / EncodingException
+     */
+    std::future<std::vector<DNSRecord>> query(const std::string& domain, DNSRecordType type = DNSRecordType::A,
+                                              DoHMethod method = DoHMethod::JSON_GET);
+
+    /**
+     * @brief 已提交但尚未完成的请求数
+     */
+    size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 服务器配置
+     */
+    const DoHServerConfig& server() const { return server_; }
+
+private:
+    // 一个在途请求
+    struct Pending {
+        std::unique_ptr<DoHRequest> request;
+        Callback callback;
+        CURL* handle = nullptr;
+        std::exception_ptr error;  // 构造请求失败时的异常，由事件循环直接以该错误结束
+    };
+
+    static int socket_callback(CURL* easy, curl_socket_t fd, int what, void* userp, void* socketp);
+    static int timer_callback(CURLM* multi, long timeout_ms, void* userp);
+
+    void run();
+    void wake();
+    void start_submitted();
+    void socket_action(curl_socket_t fd, int events);
+    void check_completions();
+    void finish(Pending& pending, std::vector<DNSRecord> records, std::exception_ptr error);
+    void watch(curl_socket_t fd, int what);
+    void unwatch(curl_socket_t fd);
+    CURL* acquire_handle();
+    void release_handle(CURL* handle);
+
+    static constexpr size_t kMaxIdleHandles = 64;
+
+    DoHServerConfig server_;
+    int connect_timeout_;
+    DoHConnectionPool* pool_;
+    DoHProviderMetrics* provider_metrics_;  // 本服务器的查询计数
+    CURLM* multi_ = nullptr;
+    int wake_pipe_[2] = {-1, -1};
+#ifdef __linux__
+    int epoll_fd_ = -1;
+#else
+    std::unordered_map<curl_socket_t, short> poll_fds_;
+#endif
+    bool timer_armed_ = false;                             // curl 是否设置了超时
+    std::chrono::steady_clock::time_point timer_deadline_;  // curl 要求的下一次超时时间点
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> in_flight_{0};
+
+    std::mutex submit_mutex_;
+    std::vector<std::unique_ptr<Pending>> submitted_;  // 等待循环线程接收的请求
+
+    std::unordered_map<CURL*, std::unique_ptr<Pending>> active_;  // 仅循环线程访问
+    std::vector<CURL*> idle_handles_;                              // 仅循环线程访问
+    std::thread loop_thread_;
+};
+
+// 实现
+inline AsyncDoHClient::AsyncDoHClient(const DoHServerConfig& server, int connect_timeout, DoHConnectionPool* pool)
+    : server_(server),
+      connect_timeout_(connect_timeout),
+      pool_(pool),
+      provider_metrics_(DoHMetrics::instance().provider(server.url)) {
+    multi_ = curl_multi_init();
+    if (!multi_) {
+        throw NetworkException("Failed to initialize curl multi handle", 0, server_.url);
+    }
+    if (pipe(wake_pipe_) != 0) {
+        curl_multi_cleanup(multi_);
+        throw NetworkException("Failed to create wakeup pipe", errno, server_.url);
+    }
+    for (int fd : wake_pipe_) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+#ifdef __linux__
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        int error = errno;
+        close(wake_pipe_[0]);
+        close(wake_pipe_[1]);
+        curl_multi_cleanup(multi_);
+        throw NetworkException("Failed to create epoll instance", error, server_.url);
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_pipe_[0];
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_pipe_[0], &ev) != 0) {
+        int error = errno;
+        close(epoll_fd_);
+        close(wake_pipe_[0]);
+        close(wake_pipe_[1]);
+        curl_multi_cleanup(multi_);
+        throw NetworkException("Failed to register wakeup pipe with epoll", error, server_.url);
+    }
+#endif
+
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETFUNCTION, socket_callback);
+    curl_multi_setopt(multi_, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERFUNCTION, timer_callback);
+    curl_multi_setopt(multi_, CURLMOPT_TIMERDATA, this);
+    // 同一服务商的并发请求在一条 HTTP/2 连接上多路复用
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    loop_thread_ = std::thread(&AsyncDoHClient::run, this);
+}
+
+inline AsyncDoHClient::~AsyncDoHClient() {
+    stopping_ = true;
+    wake();
+    if (loop_thread_.joinable()) {
+        loop_thread_.join();
+    }
+
+    // 事件循环已退出，以异常结束所有未完成的请求
+    auto error = std::make_exception_ptr(NetworkException("Async client shut down", 0, server_.url));
+    for (auto& entry : active_) {
+        curl_multi_remove_handle(multi_, entry.first);
+        curl_easy_cleanup(entry.first);
+        entry.second->handle = nullptr;
+        finish(*entry.second, {}, error);
+    }
+    for (auto& pending : submitted_) {
+        finish(*pending, {}, error);
+    }
+    for (CURL* handle : idle_handles_) {
+        curl_easy_cleanup(handle);
+    }
+
+    curl_multi_cleanup(multi_);
+#ifdef __linux__
+    close(epoll_fd_);
+#endif
+    close(wake_pipe_[0]);
+    close(wake_pipe_[1]);
+}
+
+inline void AsyncDoHClient::query(const std::string& domain, DNSRecordType type, DoHMethod method,
+                                  Callback callback) {
+    auto pending = std::make_unique<Pending>();
+    try {
+        pending->request = std::make_unique<DoHRequest>(server_.url, domain, type, method, provider_metrics_);
+    } catch (...) {
+        pending->error = std::current_exception();
+    }
+    pending->callback = std::move(callback);
+
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        submitted_.push_back(std::move(pending));
+    }
+    wake();
+}
+
+inline std::future<std::vector<DNSRecord>> AsyncDoHClient::query(const std::string& domain, DNSRecordType type,
+                                                                 DoHMethod method) {
+    auto promise = std::make_shared<std::promise<std::vector<DNSRecord>>>();
+    auto future = promise->get_future();
+    query(domain, type, method, [promise](std::vector<DNSRecord> records, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(std::move(records));
+        }
+    });
+    return future;
+}
+
+inline int AsyncDoHClient::socket_callback(CURL*, curl_socket_t fd, int what, void* userp, void*) {
+    auto* self = static_cast<AsyncDoHClient*>(userp);
+    if (what == CURL_POLL_REMOVE) {
+        self->unwatch(fd);
+    } else {
+        self->watch(fd, what);
+    }
+    return 0;
+}
+
+inline int AsyncDoHClient::timer_callback(CURLM*, long timeout_ms, void* userp) {
+    auto* self = static_cast<AsyncDoHClient*>(userp);
+    self->timer_armed_ = timeout_ms >= 0;
+    if (self->timer_armed_) {
+        self->timer_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    }
+    return 0;
+}
+
+inline void AsyncDoHClient::watch(curl_socket_t fd, int what) {
+#ifdef __linux__
+    epoll_event ev{};
+    ev.events = ((what & CURL_POLL_IN) ? EPOLLIN : 0) | ((what & CURL_POLL_OUT) ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) != 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+#else
+    poll_fds_[fd] = static_cast<short>(((what & CURL_POLL_IN) ? POLLIN : 0) | ((what & CURL_POLL_OUT) ? POLLOUT : 0));
+#endif
+}
+
+inline void AsyncDoHClient::unwatch(curl_socket_t fd) {
+#ifdef __linux__
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+#else
+    poll_fds_.erase(fd);
+#endif
+}
+
+inline void AsyncDoHClient::wake() {
+    char byte = 1;
+    // 管道已满说明循环线程已有待处理的唤醒，忽略EAGAIN
+    [[maybe_unused]] auto written = write(wake_pipe_[1], &byte, 1);
+}
+
+inline void AsyncDoHClient::run() {
+    constexpr int kMaxEvents = 256;
+
+    while (!stopping_) {
+        int wait_ms = -1;
+        if (timer_armed_) {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(timer_deadline_ -
+                                                                          std::chrono::steady_clock::now());
+            wait_ms = static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+        }
+        bool woken = false;
+
+#ifdef __linux__
+        epoll_event events[kMaxEvents];
+        int n = epoll_wait(epoll_fd_, events, kMaxEvents, wait_ms);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == wake_pipe_[0]) {
+                woken = true;
+                continue;
+            }
+            int mask = 0;
+            if (events[i].events & EPOLLIN) mask |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) mask |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) mask |= CURL_CSELECT_ERR;
+            socket_action(events[i].data.fd, mask);
+        }
+#else
+        std::vector<pollfd> fds;
+        fds.reserve(poll_fds_.size() + 1);
+        fds.push_back({wake_pipe_[0], POLLIN, 0});
+        for (const auto& entry : poll_fds_) {
+            fds.push_back({entry.first, entry.second, 0});
+        }
+        int n = poll(fds.data(), fds.size(), wait_ms);
+        woken = n > 0 && (fds[0].revents & POLLIN);
+        for (size_t i = 1; n > 0 && i < fds.size(); ++i) {
+            int mask = 0;
+            if (fds[i].revents & POLLIN) mask |= CURL_CSELECT_IN;
+            if (fds[i].revents & POLLOUT) mask |= CURL_CSELECT_OUT;
+            if (fds[i].revents & (POLLERR | POLLHUP)) mask |= CURL_CSELECT_ERR;
+            if (mask) {
+                socket_action(fds[i].fd, mask);
+            }
+        }
+#endif
+
+        // 即使一直有套接字事件，也要保证curl的超时得到处理
+        if (timer_armed_ && std::chrono::steady_clock::now() >= timer_deadline_) {
+            timer_armed_ = false;
+            socket_action(CURL_SOCKET_TIMEOUT, 0);
+        }
+        if (woken) {
+            char buffer[64];
+            while (read(wake_pipe_[0], buffer, sizeof(buffer)) > 0) {
+            }
+            start_submitted();
+        }
+        check_completions();
+    }
+}
+
+inline void AsyncDoHClient::start_submitted() {
+    std::vector<std::unique_ptr<Pending>> batch;
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        batch.swap(submitted_);
+    }
+
+    for (auto& pending : batch) {
+        if (pending->error) {
+            finish(*pending, {}, pending->error);
+            continue;
+        }
+        CURL* handle = acquire_handle();
+        if (!handle) {
+            finish(*pending, {}, std::make_exception_ptr(NetworkException("Failed to initialize curl", 0, server_.url)));
+            continue;
+        }
+        pending->handle = handle;
+        pending->request->attach(handle);
+        active_.emplace(handle, std::move(pending));
+        curl_multi_add_handle(multi_, handle);
+    }
+}
+
+inline void AsyncDoHClient::socket_action(curl_socket_t fd, int events) {
+    int running = 0;
+    curl_multi_socket_action(multi_, fd, events, &running);
+}
+
+inline void AsyncDoHClient::check_completions() {
+    int queued = 0;
+    while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+        auto it = active_.find(msg->easy_handle);
+        if (it == active_.end()) {
+            continue;
+        }
+
+        std::unique_ptr<Pending> pending = std::move(it->second);
+        active_.erase(it);
+        CURLcode code = msg->data.result;
+        curl_multi_remove_handle(multi_, pending->handle);
+        if (pool_ && code == CURLE_OK) {
+            pool_->record(pending->handle, server_.url);
+        }
+
+        std::vector<DNSRecord> records;
+        std::exception_ptr error;
+        try {
+            records = pending->request->complete(pending->handle, code);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        release_handle(pending->handle);
+        pending->handle = nullptr;
+        finish(*pending, std::move(records), error);
+    }
+}
+
+inline void AsyncDoHClient::finish(Pending& pending, std::vector<DNSRecord> records, std::exception_ptr error) {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    if (!pending.callback) {
+        return;
+    }
+    try {
+        pending.callback(std::move(records), error);
+    } catch (const std::exception& e) {
+        Logger::error("Async DoH callback threw: {}", e.what());
+    } catch (...) {
+        Logger::error("Async DoH callback threw an unknown exception");
+    }
+}
+
+inline CURL* AsyncDoHClient::acquire_handle() {
+    if (!idle_handles_.empty()) {
+        CURL* handle = idle_handles_.back();
+        idle_handles_.pop_back();
+        return handle;
+    }
+    CURL* handle = curl_easy_init();
+    if (handle) {
+        configure_doh_handle(handle, server_.timeout, connect_timeout_);
+        // 异步请求不能依赖信号实现超时
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        if (pool_) {
+            pool_->attach(handle, server_.url);
+        }
+    }
+    return handle;
+}
+
+inline void AsyncDoHClient::release_handle(CURL* handle) {
+    if (idle_handles_.size() < kMaxIdleHandles) {
+        idle_handles_.push_back(handle);
+    } else {
+        curl_easy_cleanup(handle);
+    }
+}
+
+#endif  // DOH_ASYNC_CLIENT_HPP
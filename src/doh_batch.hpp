@@ -0,0 +1,335 @@
+#ifndef DOH_BATCH_HPP
+#define DOH_BATCH_HPP
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dns_cache.hpp"
+#include "doh_async_client.hpp"
+#include "logger.hpp"
+#include "tools.hpp"
+
+/**
+ * @brief 批量解析中的一个查询
+ */
+struct BatchQuery {
+    std::string domain;
+    DNSRecordType type = DNSRecordType::A;
+};
+
+/**
+ * @brief 单个查询的解析结果
+ */
+struct BatchResult {
+    BatchQuery query;
+    size_t index = 0;                       // 查询在输入中的序号
+    std::vector<DNSRecord> records;
+    std::string error;                      // 失败原因，成功时为空
+    bool cached = false;                    // 是否由缓存直接返回
+    std::chrono::microseconds latency{0};  // 从提交到完成的耗时
+
+    bool ok() const { return error.empty(); }
+};
+
+/**
+ * @brief 批量解析的吞吐量统计
+ */
+struct BatchSummary {
+    size_t total = 0;      // 处理的查询数
+    size_t succeeded = 0;  // 成功的查询数（包括无记录的应答）
+    size_t failed = 0;     // 失败的查询数
+    size_t cached = 0;     // 缓存命中数
+    size_t records = 0;    // 返回的记录总数
+    std::chrono::milliseconds elapsed{0};
+
+    /**
+     * @brief 每秒处理的查询数
+     */
+    double queries_per_second() const {
+        return elapsed.count() == 0 ? static_cast<double>(total) : total * 1000.0 / elapsed.count();
+    }
+};
+
+/**
+ * @brief 批量解析器
+ * @details 在 AsyncDoHClient 上以有界的在途窗口流水线式地发出查询：窗口满时等待任一查询完成后再提交下一个，
+ *          因此内存占用与输入规模无关。结果按完成顺序在调用线程上交给回调，缓存命中的查询不占用窗口。
+ */
+class BatchResolver {
+public:
+    /**
+     * @brief 结果回调，在调用 resolve_* 的线程上执行
+     */
+    using ResultCallback = std::function<void(BatchResult& result)>;
+
+    /**
+     * @brief 构造函数
+     * @param client 异步客户端，生命周期必须长于解析器
+     * @param max_in_flight 同时在途的最大查询数
+     * @param method DoH请求方法
+     */
+    explicit BatchResolver(AsyncDoHClient& client, size_t max_in_flight = 256,
+                           DoHMethod method = DoHMethod::JSON_GET);
+
+    /**
+     * @brief 设置解析结果缓存，传入nullptr则禁用缓存
+     */
+    void set_cache(std::shared_ptr<DnsCache> cache) { cache_ = std::move(cache); }
+
+    /**
+     * @brief 解析一组查询
+     * @return 与输入一一对应的结果
+     */
+    std::vector<BatchResult> resolve_batch(const std::vector<BatchQuery>& queries);
+
+    /**
+     * @brief 从输入流逐行读取查询并解析，每完成一个查询调用一次回调
+     * @param input 每行一个 "domain [type]"，空行和 # 开头的行被忽略
+     * @param on_result 结果回调
+     * @param default_type 行内未指定类型时使用的记录类型
+     * @return 吞吐量统计
+     */
+    BatchSummary resolve_stream(std::istream& input, const ResultCallback& on_result,
+                                DNSRecordType default_type = DNSRecordType::A);
+
+    /**
+     * @brief 解析一行输入
+     * @return 空行、注释行或类型无法识别时返回false
+     */
+    static bool parse_line(const std::string& line, BatchQuery& query,
+                           DNSRecordType default_type = DNSRecordType::A);
+
+    /**
+     * @brief 将结果序列化为一行JSON（不含换行符）
+     */
+    static std::string to_ndjson(const BatchResult& result);
+
+private:
+    using Source = std::function<bool(BatchQuery& query)>;
+
+    BatchSummary run(const Source& next, const ResultCallback& on_result);
+
+    AsyncDoHClient& client_;
+    size_t max_in_flight_;
+    DoHMethod method_;
+    std::shared_ptr<DnsCache> cache_;
+};
+
+// 实现
+inline BatchResolver::BatchResolver(AsyncDoHClient& client, size_t max_in_flight, DoHMethod method)
+    : client_(client), max_in_flight_(std::max<size_t>(max_in_flight, 1)), method_(method) {}
+
+inline std::vector<BatchResult> BatchResolver::resolve_batch(const std::vector<BatchQuery>& queries) {
+    std::vector<BatchResult> results(queries.size());
+
+    size_t next = 0;
+    run(
+        [&](BatchQuery& query) {
+            if (next >= queries.size()) {
+                return false;
+            }
+            query = queries[next++];
+            return true;
+        },
+        [&](BatchResult& result) { results[result.index] = std::move(result); });
+    return results;
+}
+
+inline BatchSummary BatchResolver::resolve_stream(std::istream& input, const ResultCallback& on_result,
+                                                  DNSRecordType default_type) {
+    std::string line;
+    return run(
+        [&](BatchQuery& query) {
+            while (std::getline(input, line)) {
+                if (parse_line(line, query, default_type)) {
+                    return true;
+                }
+                auto pos = line.find_first_not_of(" \t\r");
+                if (pos != std::string::npos && line[pos] != '#') {
+                    Logger::warn("Skipping invalid batch line: {}", line);
+                }
+            }
+            return false;
+        },
+        on_result);
+}
+
+inline bool BatchResolver::parse_line(const std::string& line, BatchQuery& query, DNSRecordType default_type) {
+    std::istringstream fields(line);
+    std::string domain;
+    if (!(fields >> domain) || domain[0] == '#') {
+        return false;
+    }
+
+    DNSRecordType type = default_type;
+    std::string type_name;
+    if (fields >> type_name && !parse_record_type(type_name, type)) {
+        return false;
+    }
+
+    query.domain = std::move(domain);
+    query.type = type;
+    return true;
+}
+
+inline std::string BatchResolver::to_ndjson(const BatchResult& result) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+    auto write_string = [&writer](const std::string& value) {
+        writer.String(value.c_str(), static_cast<rapidjson::SizeType>(value.size()));
+    };
+
+    writer.StartObject();
+    writer.Key("domain");
+    write_string(result.query.domain);
+    writer.Key("type");
+    write_string(record_type_name(result.query.type));
+    writer.Key("status");
+    writer.String(result.ok() ? "ok" : "error");
+    writer.Key("cached");
+    writer.Bool(result.cached);
+    writer.Key("latency_us");
+    writer.Uint64(static_cast<uint64_t>(result.latency.count()));
+    if (result.ok()) {
+        writer.Key("records");
+        writer.StartArray();
+        for (const auto& record : result.records) {
+            writer.StartObject();
+            writer.Key("name");
+            write_string(record.name);
+            writer.Key("type");
+            write_string(record_type_name(record.type));
+            writer.Key("ttl");
+            writer.Uint(record.ttl);
+            writer.Key("data");
+            write_string(record.data);
+            writer.EndObject();
+        }
+        writer.EndArray();
+    } else {
+        writer.Key("error");
+        write_string(result.error);
+    }
+    writer.EndObject();
+
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+inline BatchSummary BatchResolver::run(const Source& next, const ResultCallback& on_result) {
+    using Clock = std::chrono::steady_clock;
+
+    // 完成队列由事件循环线程写入、调用线程读取；共享所有权保证回调晚于本函数返回时也安全
+    struct Completions {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<BatchResult> done;
+    };
+    auto completions = std::make_shared<Completions>();
+
+    BatchSummary summary;
+    auto start = Clock::now();
+    size_t submitted_count = 0;
+    size_t in_flight = 0;
+    bool more = true;
+
+    auto deliver = [&](BatchResult& result) {
+        ++summary.total;
+        if (result.ok()) {
+            ++summary.succeeded;
+            summary.records += result.records.size();
+        } else {
+            ++summary.failed;
+        }
+        if (result.cached) {
+            ++summary.cached;
+        }
+        if (on_result) {
+            on_result(result);
+        }
+    };
+
+    while (more || in_flight > 0) {
+        // 填满在途窗口
+        BatchQuery query;
+        while (more && in_flight < max_in_flight_) {
+            if (!next(query)) {
+                more = false;
+                break;
+            }
+
+            size_t index = submitted_count++;
+            BatchResult cached;
+            if (cache_ && cache_->get(query.domain, query.type, cached.records)) {
+                cached.query = std::move(query);
+                cached.index = index;
+                cached.cached = true;
+                deliver(cached);
+                continue;
+            }
+
+            // 域名无法编码等提交阶段的错误也经回调作为该查询的失败结果返回
+            auto submitted = Clock::now();
+            client_.query(query.domain, query.type, method_,
+                          [completions, query, index, submitted](std::vector<DNSRecord> records,
+                                                                 std::exception_ptr error) {
+                              BatchResult result;
+                              result.query = query;
+                              result.index = index;
+                              result.records = std::move(records);
+                              result.latency =
+                                  std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - submitted);
+                              if (error) {
+                                  try {
+                                      std::rethrow_exception(error);
+                                  } catch (const std::exception& e) {
+                                      result.error = e.what();
+                                  }
+                              }
+                              std::lock_guard<std::mutex> lock(completions->mutex);
+                              completions->done.push_back(std::move(result));
+                              completions->ready.notify_one();
+                          });
+            ++in_flight;
+        }
+
+        if (in_flight == 0) {
+            continue;
+        }
+
+        // 等待至少一个查询完成
+        std::deque<BatchResult> done;
+        {
+            std::unique_lock<std::mutex> lock(completions->mutex);
+            completions->ready.wait(lock, [&]() { return !completions->done.empty(); });
+            done.swap(completions->done);
+        }
+        in_flight -= done.size();
+
+        for (auto& result : done) {
+            if (cache_ && result.ok()) {
+                cache_->put(result.query.domain, result.query.type, result.records);
+            }
+            deliver(result);
+        }
+    }
+
+    summary.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+    return summary;
+}
+
+#endif  // DOH_BATCH_HPP
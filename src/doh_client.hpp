@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <memory>
@@ -19,6 +20,15 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+#include "dns_cache.hpp"
+#include "dns_failure_tracker.hpp"
+#include "doh_connection_pool.hpp"
+#include "doh_method.hpp"
+#include "exceptions.hpp"
+#include "metrics.hpp"
+#include "provider_health.hpp"
+#include "single_flight.hpp"
+#include "system_resolver.hpp"
 #include "tools.hpp"
 
 // 创建 dns server list
@@ -50,277 +60,547 @@ inline size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::stri
     return newLength;
 }
 
-// DoH 查询方法枚举
-enum class DoHMethod {
-    GET,      // RFC 8484 GET - 使用二进制DNS消息，Base64URL编码
-    POST,     // RFC 8484 POST - 使用二进制DNS消息，直接POST
-    JSON_GET  // Google JSON API - 使用JSON格式，GET请求
-};
-
-template <typename T = void>
-class DoHClientImpl {
-   private:
-    std::string dohServer;  // DoH服务器URL
-    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> curl;
-
-   public:
-    // 构造函数，初始化curl和DoH服务器
-    explicit DoHClientImpl(const std::string &server = "https://cloudflare-dns.com/dns-query")
-        : dohServer(server), curl(curl_easy_init(), curl_easy_cleanup) {
-        if (!curl) {
-            throw std::runtime_error("Failed to initialize curl");
-        }
-        // 设置通用选项
-        curl_easy_setopt(curl.get(), CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl.get(), CURLOPT_SSL_VERIFYHOST, 2L);
-        curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
-
-        // 设置超时选项
-        curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, 10L);            // 总超时时间：10秒
-        curl_easy_setopt(curl.get(), CURLOPT_CONNECTTIMEOUT, 5L);      // 连接超时：5秒
-        curl_easy_setopt(curl.get(), CURLOPT_DNS_CACHE_TIMEOUT, 60L);  // DNS缓存：60秒
-
-        // 设置用户代理
-        curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, "DoH-Client/1.0");
-    }
+// 设置DoH请求easy句柄的通用选项（TLS校验、超时、用户代理）
+inline void configure_doh_handle(CURL *handle, long timeout_seconds = 10L, long connect_timeout_seconds = 5L) {
+    // 设置通用选项
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
 
-    // 执行DNS查询 - 根据指定的方法选择不同的查询方式，失败时自动fallback到系统DNS
-    std::vector<DNSRecord> query(const std::string &domain, DNSRecordType type = DNSRecordType::A,
-                                 DoHMethod method = DoHMethod::JSON_GET, bool enable_fallback = true) {
-        std::cout << "Using method: " << method_to_string(method) << std::endl;
+    // 设置超时选项
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT, timeout_seconds);                 // 总超时时间
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, connect_timeout_seconds);  // 连接超时
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 60L);                   // DNS缓存：60秒
 
-        std::vector<DNSRecord> results;
+    // 设置用户代理
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, "DoH-Client/1.0");
+}
 
-        // 尝试DoH查询
+// 单个DoH请求 - 负责构建URL/请求头/请求体、接收响应并按方法解析。
+// 同一份逻辑既用于 curl_easy_perform 阻塞查询，也用于 curl multi 并发查询。
+// 请求完成后 timing() 给出各阶段耗时；metrics 不为空时按服务商记录查询次数与阶段耗时，
+// 并记录总耗时、状态码与收发字节数
+class DoHRequest {
+   public:
+    DoHRequest(const std::string &server, const std::string &domain, DNSRecordType type, DoHMethod method,
+               DoHProviderMetrics *metrics = nullptr)
+        : method_(method), metrics_(metrics) {
+        auto started = std::chrono::steady_clock::now();
         switch (method) {
-            case DoHMethod::GET:
-                results = query_with_get(domain, type);
+            case DoHMethod::GET: {
+                // RFC 8484规范：?dns=参数，Base64URL编码的DNS消息；事务ID置0以便HTTP缓存命中（RFC 8484 4.1）
+                DnsQueryBuffer query;
+                query.encode(domain, static_cast<uint16_t>(type));
+                url_.reserve(server.size() + 5 + base64url_encoded_size(query.size));
+                url_.append(server).append("?dns=");
+                size_t prefix = url_.size();
+                url_.resize(prefix + base64url_encoded_size(query.size));
+                base64url_encode(query.data, query.size, &url_[prefix]);
+                headers_ = curl_slist_append(headers_, "Accept: application/dns-message");
                 break;
-            case DoHMethod::POST:
-                results = query_with_post(domain, type);
+            }
+            case DoHMethod::POST: {
+                DnsQueryOptions options;
+                options.id = random_dns_id();
+                DnsQueryBuffer query;
+                query.encode(domain, static_cast<uint16_t>(type), options);
+                url_ = server;
+                body_.assign(query.bytes(), query.size);
+                headers_ = curl_slist_append(headers_, "Accept: application/dns-message");
+                headers_ = curl_slist_append(headers_, "Content-Type: application/dns-message");
                 break;
+            }
             case DoHMethod::JSON_GET:
-                results = query_with_json_get(domain, type);
-                break;
             default:
-                std::cerr << "Unknown DoH method, falling back to JSON_GET" << std::endl;
-                results = query_with_json_get(domain, type);
+                // Google JSON API格式：?name=&type=
+                method_ = DoHMethod::JSON_GET;
+                url_ = server + "?name=" + domain + "&type=" + std::to_string(static_cast<int>(type));
+                headers_ = curl_slist_append(headers_, "Accept: application/dns-json");
                 break;
         }
-
-        // 如果DoH查询失败且启用了fallback，则使用系统DNS
-        if (results.empty() && enable_fallback) {
-            std::cout << "DoH query failed, trying system DNS fallback..." << std::endl;
-            results = query_with_system_dns(domain, type);
+        timing_.encode = elapsed_micros(started);
+        if (metrics_) {
+            metrics_->phases[static_cast<size_t>(DoHPhase::Encode)].record(timing_.encode);
         }
+    }
 
-        return results;
+    ~DoHRequest() { curl_slist_free_all(headers_); }
+
+    DoHRequest(const DoHRequest &) = delete;
+    DoHRequest &operator=(const DoHRequest &) = delete;
+
+    // 将请求参数绑定到easy句柄，句柄在请求完成前不能被其他请求使用
+    void attach(CURL *handle) {
+        response_.clear();
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers_);
+        curl_easy_setopt(handle, CURLOPT_URL, url_.c_str());
+        if (method_ == DoHMethod::POST) {
+            curl_easy_setopt(handle, CURLOPT_POST, 1L);
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, body_.data());
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(body_.size()));
+        } else {
+            curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+        }
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response_);
     }
 
-    // 1. RFC 8484 GET 方法 - 使用DNS wireformat，通过GET请求和Base64URL编码
-    std::vector<DNSRecord> query_with_get(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
-        // 创建DNS查询消息
-        std::string dns_message = create_dns_query_message(domain, static_cast<uint16_t>(type));
+    // 请求完成后检查传输结果和HTTP状态码并解析响应，返回回答部分的记录
+    // 失败时抛出 NetworkException / HttpException
+    std::vector<DNSRecord> complete(CURL *handle, CURLcode code) { return complete_answer(handle, code).records; }
 
-        // Base64URL编码
-        std::string encoded_dns = base64url_encode(dns_message);
+    // 同 complete()，同时返回上游应答的RCODE与否定应答的TTL
+    DnsAnswer complete_answer(CURL *handle, CURLcode code) {
+        read_timing(handle);
+        if (metrics_) {
+            record_metrics(handle, code);
+        }
+        if (code != CURLE_OK) {
+            throw ExceptionUtils::from_curl_error(code, url_);
+        }
 
-        // 构建URL - RFC 8484规范：?dns=参数
-        std::string url = dohServer + "?dns=" + encoded_dns;
-        std::cout << "GET Request URL: " << url << std::endl;
+        long response_code = 0;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+        if (response_code != 200) {
+            throw ExceptionUtils::from_http_error(static_cast<int>(response_code), url_);
+        }
 
-        // 设置请求头 - RFC 8484需要的Content-Type和Accept
-        struct curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, "Accept: application/dns-message");
+        auto started = std::chrono::steady_clock::now();
+        DnsAnswer answer;
+        if (method_ == DoHMethod::JSON_GET) {
+            // 应答不是JSON（例如服务商不支持JSON API）时抛出 ParseException，调用方据此判断方法不受支持
+            // JSON API 不解析 Authority，否定应答没有SOA给出的TTL
+            DOH_LOG_TRACE("Raw JSON response: {}", response_);
+            DnsJsonResponse json = parse_dns_json(response_.data(), response_.size());
+            answer.rcode = std::max(json.status, 0);
+            answer.records = std::move(json.answers);
+        } else {
+            answer = parse_dns_wireformat_answer(response_);
+        }
+        timing_.parse = elapsed_micros(started);
+        if (metrics_) {
+            metrics_->phases[static_cast<size_t>(DoHPhase::Parse)].record(timing_.parse);
+        }
+        return answer;
+    }
 
-        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    const std::string &url() const { return url_; }
+    DoHMethod method() const { return method_; }
+    const std::string &response() const { return response_; }
 
-        // 重置为GET请求（默认）
-        curl_easy_setopt(curl.get(), CURLOPT_HTTPGET, 1L);
+    // 各阶段耗时，complete() 之后有效
+    const DoHRequestTiming &timing() const { return timing_; }
 
-        // 存储响应
-        std::string response;
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
+   private:
+    static uint64_t elapsed_micros(std::chrono::steady_clock::time_point started) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count());
+    }
 
-        // 执行请求
-        CURLcode res = curl_easy_perform(curl.get());
-        curl_slist_free_all(headers);
+    // curl的计时是从请求开始的累计值（复用连接时前几个阶段为0），换算为各阶段自身的耗时
+    void read_timing(CURL *handle) {
+        curl_off_t namelookup = 0, connect = 0, appconnect = 0, pretransfer = 0, starttransfer = 0, total = 0;
+        curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &namelookup);
+        curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+        curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+        curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+        curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+        curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+
+        auto span = [](curl_off_t from, curl_off_t to) { return to > from ? static_cast<uint64_t>(to - from) : 0; };
+        timing_.dns = static_cast<uint64_t>(std::max<curl_off_t>(namelookup, 0));
+        timing_.connect = span(namelookup, connect);
+        timing_.tls = appconnect > 0 ? span(connect, appconnect) : 0;
+        timing_.first_byte = span(std::max({connect, appconnect, pretransfer}), starttransfer);
+        timing_.total = static_cast<uint64_t>(std::max<curl_off_t>(total, 0));
+    }
 
-        if (res != CURLE_OK) {
-            std::cerr << "GET request failed: " << curl_easy_strerror(res) << std::endl;
-            return {};
+    void record_metrics(CURL *handle, CURLcode code) {
+        auto &metrics = DoHMetrics::instance();
+        metrics_->queries[static_cast<int>(method_)].inc();
+        if (code != CURLE_OK) {
+            metrics.curl_errors.inc(code);
+        } else {
+            long response_code = 0;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response_code);
+            metrics.http_status.inc(response_code);
         }
 
-        // 检查HTTP状态码
-        long response_code;
-        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code != 200) {
-            std::cerr << "HTTP error: " << response_code << std::endl;
-            return {};
-        }
+        metrics.duration[static_cast<int>(method_)].record(timing_.total);
+        metrics_->record_transfer(timing_);
+
+        long request_size = 0;
+        long header_size = 0;
+        curl_off_t uploaded = 0;
+        curl_off_t downloaded = 0;
+        curl_easy_getinfo(handle, CURLINFO_REQUEST_SIZE, &request_size);
+        curl_easy_getinfo(handle, CURLINFO_HEADER_SIZE, &header_size);
+        curl_easy_getinfo(handle, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+        curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+        metrics.bytes_sent.inc(static_cast<uint64_t>(request_size + uploaded));
+        metrics.bytes_received.inc(static_cast<uint64_t>(header_size + downloaded));
+    }
 
-        // 因为我们在请求中明确指定了Accept: application/dns-message
-        // 所以期望服务器返回DNS wireformat格式的响应，直接使用DNS二进制格式解析
-        std::cout << "Expecting DNS wireformat response" << std::endl;
-        return parse_dns_wireformat_response(response);
+    DoHMethod method_;
+    DoHProviderMetrics *metrics_;
+    DoHRequestTiming timing_;
+    std::string url_;
+    std::string body_;
+    std::string response_;
+    struct curl_slist *headers_ = nullptr;
+};
+
+// 判断一次失败是否说明服务商不支持所用的方法：请求被拒绝（HTTP 400/404/405/406/415/501）或应答格式不符
+inline bool is_method_rejection(const DoHException &error) {
+    if (dynamic_cast<const ParseException *>(&error)) {
+        return true;
+    }
+    if (!dynamic_cast<const HttpException *>(&error)) {
+        return false;
     }
+    switch (error.code()) {
+        case 400:
+        case 404:
+        case 405:
+        case 406:
+        case 415:
+        case 501:
+            return true;
+        default:
+            return false;
+    }
+}
 
-    // 2. RFC 8484 POST 方法 - 使用DNS wireformat，通过POST请求
-    std::vector<DNSRecord> query_with_post(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
-        // 创建DNS查询消息
-        std::string dns_message = create_dns_query_message(domain, static_cast<uint16_t>(type));
+// 判断一次失败是否说明服务商本身不可用（计入熔断）：网络错误或5xx等服务端错误。
+// 方法被拒绝以及其他4xx是请求层面的问题，换用其他方法即可，不代表服务商不健康
+inline bool is_provider_failure(const DoHException &error) {
+    if (dynamic_cast<const NetworkException *>(&error)) {
+        return true;
+    }
+    if (!dynamic_cast<const HttpException *>(&error) || is_method_rejection(error)) {
+        return false;
+    }
+    return error.code() < 400 || error.code() >= 500;
+}
 
-        // 构建URL
-        std::string url = dohServer;
-        std::cout << "POST Request URL: " << url << std::endl;
+// 在途DoH查询合并组，结果为上游应答（RCODE与记录）
+using DoHSingleFlight = SingleFlight<DnsAnswer>;
 
-        // 设置请求头 - RFC 8484需要的Content-Type和Accept
-        struct curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, "Accept: application/dns-message");
-        headers = curl_slist_append(headers, "Content-Type: application/dns-message");
+template <typename T = void>
+class DoHClientImpl {
+   private:
+    std::string dohServer;  // DoH服务器URL
+    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> curl;
+    std::shared_ptr<DnsCache> cache;  // 可选的解析结果缓存，可在多个客户端间共享
+    std::shared_ptr<DnsFailureTracker> failures;  // 可选的失败时间记录，可随缓存文件持久化
+    DoHConnectionPool *pool;          // 连接池，为nullptr时不接入
+    DoHSingleFlight *flights = &DoHSingleFlight::instance();  // 相同在途查询的合并组，为nullptr时不合并
+    DoHMethodCache *methods = &DoHMethodCache::instance();    // 服务器方法支持情况缓存，为nullptr时只使用指定的方法
+    SystemDnsResolver *system_resolver = &SystemDnsResolver::instance();  // 为nullptr时在调用线程上阻塞解析
+    ProviderHealth *health = &ProviderHealth::instance();  // 服务商熔断与评分，为nullptr时不跟踪
+    std::chrono::milliseconds fallback_timeout{3500};  // 系统DNS回退的超时
+    bool race_system_dns = false;                      // 是否与DoH同时启动系统DNS解析
+    DoHProviderMetrics *provider_metrics;              // 本服务器的查询计数与阶段耗时
+    DoHRequestTiming timing;                           // 最近一次请求的各阶段耗时
 
-        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+   public:
+    // 构造函数，初始化curl和DoH服务器；默认接入进程内共享的连接池，池的生命周期必须长于客户端
+    explicit DoHClientImpl(const std::string &server = "https://cloudflare-dns.com/dns-query",
+                           DoHConnectionPool *connection_pool = &DoHConnectionPool::instance())
+        : dohServer(server),
+          curl(curl_easy_init(), curl_easy_cleanup),
+          pool(connection_pool),
+          provider_metrics(DoHMetrics::instance().provider(server)) {
+        if (!curl) {
+            throw std::runtime_error("Failed to initialize curl");
+        }
+        configure_doh_handle(curl.get());
+        if (pool) {
+            pool->attach(curl.get(), dohServer);
+        }
+    }
 
-        // 设置为POST请求并提供数据
-        curl_easy_setopt(curl.get(), CURLOPT_POST, 1L);
-        curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS, dns_message.c_str());
-        curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE, dns_message.length());
+    // 设置解析结果缓存，传入nullptr则禁用缓存
+    void set_cache(std::shared_ptr<DnsCache> dns_cache) { cache = std::move(dns_cache); }
 
-        // 存储响应
-        std::string response;
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
+    // 获取当前使用的缓存
+    const std::shared_ptr<DnsCache> &get_cache() const { return cache; }
 
-        // 执行请求
-        CURLcode res = curl_easy_perform(curl.get());
-        curl_slist_free_all(headers);
+    // 最近一次DoH请求的各阶段耗时（缓存命中与系统DNS回退不更新）
+    const DoHRequestTiming &last_timing() const { return timing; }
 
-        if (res != CURLE_OK) {
-            std::cerr << "POST request failed: " << curl_easy_strerror(res) << std::endl;
-            return {};
-        }
+    // 设置失败时间记录，传入nullptr则不记录
+    void set_failure_tracker(std::shared_ptr<DnsFailureTracker> tracker) { failures = std::move(tracker); }
 
-        // 检查HTTP状态码
-        long response_code;
-        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code != 200) {
-            std::cerr << "HTTP error: " << response_code << std::endl;
-            return {};
-        }
+    // 设置服务商健康跟踪（默认为进程内共享的实例）：熔断打开时不再发起DoH请求，直接走回退；传入nullptr则不跟踪
+    void set_provider_health(ProviderHealth *provider_health) { health = provider_health; }
 
-        // 因为我们在请求中明确指定了Accept: application/dns-message和Content-Type: application/dns-message
-        // 所以期望服务器返回DNS wireformat格式的响应，直接使用DNS二进制格式解析
-        std::cout << "Expecting DNS wireformat response" << std::endl;
-        return parse_dns_wireformat_response(response);
-    }
+    // 设置在途查询合并组（默认为进程内共享的实例），传入nullptr则每次调用都独立发起请求
+    void set_single_flight(DoHSingleFlight *group) { flights = group; }
 
-    // 3. Google JSON API GET 方法 - 使用JSON格式的请求和响应
-    std::vector<DNSRecord> query_with_json_get(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
-        // 构建URL - Google JSON API格式：?name=&type=
-        std::string url = dohServer + "?name=" + domain + "&type=" + std::to_string(static_cast<int>(type));
-        std::cout << "JSON GET Request URL: " << url << std::endl;
+    // 设置方法支持情况缓存（默认为进程内共享的实例），传入nullptr则只使用调用方指定的方法
+    void set_method_cache(DoHMethodCache *cache) { methods = cache; }
 
-        // 设置请求头 - JSON API需要的Accept
-        struct curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, "Accept: application/dns-json");
+    // 设置系统DNS解析器（默认为进程内共享的实例），传入nullptr则在调用线程上阻塞调用getaddrinfo且不受超时控制
+    void set_system_resolver(SystemDnsResolver *resolver) { system_resolver = resolver; }
 
-        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    // 设置系统DNS回退的超时，超时后回退结果为空
+    void set_fallback_timeout(std::chrono::milliseconds timeout) { fallback_timeout = timeout; }
 
-        // 重置为GET请求（默认）
-        curl_easy_setopt(curl.get(), CURLOPT_HTTPGET, 1L);
+    // 设置是否在发起DoH查询的同时启动系统DNS解析：DoH失败时直接使用已在进行的系统解析结果，
+    // 不必在DoH失败后再从头等待；DoH成功时系统解析的结果被丢弃
+    void set_race_system_dns(bool enabled) { race_system_dns = enabled; }
 
-        // 存储响应
-        std::string response;
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
+    // 执行DNS查询。未接入方法缓存时只使用 method；接入方法缓存（默认）后 method 只是提示：
+    // 已知可用的方法按代价优先（通常是GET），method 只在支持情况未知的方法中排在最前，
+    // 本次请求被服务器以方法不受支持拒绝时改用下一个方法。需要固定方法时先 set_method_cache(nullptr)。
+    // 全部失败时自动fallback到系统DNS
+    std::vector<DNSRecord> query(const std::string &domain, DNSRecordType type = DNSRecordType::A,
+                                 DoHMethod method = DoHMethod::JSON_GET, bool enable_fallback = true) {
+        return query_answer(domain, type, method, enable_fallback).records;
+    }
 
-        std::cout << "Expecting JSON response" << std::endl;
+    // 同 query()，同时返回上游应答的RCODE：没有记录时据此区分NXDOMAIN、NODATA与上游失败（rcode为-1）。
+    // NXDOMAIN与NODATA按SOA给出的TTL（没有时为缓存的默认TTL）写入否定缓存，命中时同样不发起请求
+    DnsAnswer query_answer(const std::string &domain, DNSRecordType type = DNSRecordType::A,
+                           DoHMethod method = DoHMethod::JSON_GET, bool enable_fallback = true) {
+        DnsAnswer answer;
 
-        // 执行请求
-        CURLcode res = curl_easy_perform(curl.get());
-        curl_slist_free_all(headers);
+        // 缓存命中时直接返回，不发起网络请求
+        if (cache && cache->get(domain, type, answer)) {
+            return answer;
+        }
 
-        if (res != CURLE_OK) {
-            std::cerr << "JSON GET request failed: " << curl_easy_strerror(res) << std::endl;
-            return {};
+        DOH_LOG_DEBUG("Using method: {}", doh_method_config_name(method));
+
+        // 提前启动的系统DNS解析，截止时间从发起查询时开始计算
+        auto started = std::chrono::steady_clock::now();
+        std::shared_ptr<SystemDnsResolver::Lookup> system_lookup;
+        if (enable_fallback && race_system_dns && system_resolver && is_address_type(type)) {
+            system_lookup = system_resolver->start(domain, address_family(type));
         }
 
-        // 检查HTTP状态码
-        long response_code;
-        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code != 200) {
-            std::cerr << "HTTP error: " << response_code << std::endl;
-            return {};
+        // 尝试DoH查询；其他线程（其他客户端实例）正在进行相同的查询时，直接共享其结果
+        auto resolve = [&]() {
+            DnsAnswer result = query_with_discovery(domain, type, method);
+            if (cache && !result.records.empty()) {
+                cache->put(domain, type, result.records);
+            } else if (cache && result.negative()) {
+                auto ttl = result.negative_ttl > 0 ? std::chrono::seconds(result.negative_ttl) : cache->default_ttl();
+                cache->put_negative(domain, type, result.rcode, ttl);
+            }
+            if (failures) {
+                failures->record_doh_result(domain, type, !result.records.empty());
+            }
+            return result;
+        };
+        answer = flights ? flights->run(flight_key(domain, type, method), resolve) : resolve();
+
+        if (!answer.records.empty()) {
+            if (system_lookup) {
+                system_lookup->cancel();
+            }
+            return answer;
         }
 
-        std::cout << "Response length: " << response.length() << " bytes" << std::endl;
+        // 如果DoH查询失败且启用了fallback，则使用系统DNS
+        if (enable_fallback) {
+            Logger::warn("DoH query for {} failed, trying system DNS fallback", domain);
+            DoHMetrics::instance().fallbacks.inc();
+            std::vector<DNSRecord> results;
+            if (system_lookup) {
+                if (!system_lookup->wait_until(started + fallback_timeout, results)) {
+                    system_resolver->record_timeout();
+                    Logger::warn("System DNS lookup for {} timed out", domain);
+                }
+            } else {
+                results = query_with_system_dns(domain, type);
+            }
+            if (failures) {
+                failures->record_system_result(domain, type, !results.empty());
+            }
+            // 系统DNS不返回TTL，使用配置的默认TTL缓存
+            if (cache) {
+                cache->put(domain, type, results, cache->default_ttl());
+            }
+            if (!results.empty()) {
+                answer.rcode = 0;
+                answer.records = std::move(results);
+            }
+        }
 
-        // 解析JSON响应
-        return parse_json_response(response);
+        return answer;
     }
 
-    // 4. 系统DNS fallback - 使用getaddrinfo作为备用方案
-    std::vector<DNSRecord> query_with_system_dns(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
-        std::cout << "Using system DNS fallback for: " << domain << std::endl;
+    // 1. RFC 8484 GET 方法 - 使用DNS wireformat，通过GET请求和Base64URL编码
+    // 域名无法编码为DNS报文时返回空结果，由 query() 照常走系统DNS回退
+    std::vector<DNSRecord> query_with_get(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
+        return answer_with_get(domain, type).records;
+    }
 
-        std::vector<DNSRecord> records;
+    // 2. RFC 8484 POST 方法 - 使用DNS wireformat，通过POST请求
+    // 域名无法编码为DNS报文时返回空结果，由 query() 照常走系统DNS回退
+    std::vector<DNSRecord> query_with_post(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
+        return answer_with_post(domain, type).records;
+    }
 
-        // 目前只支持A记录的系统DNS查询
-        if (type != DNSRecordType::A) {
-            std::cerr << "System DNS fallback only supports A records" << std::endl;
-            return records;
+    // 3. Google JSON API GET 方法 - 使用JSON格式的请求和响应
+    std::vector<DNSRecord> query_with_json_get(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
+        return answer_with_json_get(domain, type).records;
+    }
+
+    // 依次使用三种方法查询探测域名并刷新方法缓存，返回服务器可用的方法
+    std::vector<DoHMethod> probe_methods(const std::string &probe_domain = "example.com") {
+        std::vector<DoHMethod> supported;
+        if (!methods) {
+            return supported;
+        }
+        for (DoHMethod method : {DoHMethod::GET, DoHMethod::POST, DoHMethod::JSON_GET}) {
+            answer_with_method(probe_domain, DNSRecordType::A, method);
+            if (methods->get(dohServer, method) == MethodSupport::Supported) {
+                supported.push_back(method);
+            }
         }
+        return supported;
+    }
 
-        struct addrinfo hints, *result;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;  // IPv4
-        hints.ai_socktype = SOCK_STREAM;
+    // 4. 系统DNS fallback - 使用getaddrinfo作为备用方案，支持A与AAAA记录，最多等待 fallback_timeout
+    std::vector<DNSRecord> query_with_system_dns(const std::string &domain, DNSRecordType type = DNSRecordType::A) {
+        DOH_LOG_DEBUG("Using system DNS fallback for: {}", domain);
 
-        int status = getaddrinfo(domain.c_str(), nullptr, &hints, &result);
-        if (status != 0) {
-            std::cerr << "System DNS query failed: " << gai_strerror(status) << std::endl;
-            return records;
+        if (!is_address_type(type)) {
+            Logger::warn("System DNS fallback only supports A and AAAA records");
+            return {};
         }
 
-        // 遍历结果
-        for (struct addrinfo *p = result; p != nullptr; p = p->ai_next) {
-            if (p->ai_family == AF_INET) {
-                struct sockaddr_in *ipv4 = (struct sockaddr_in *)p->ai_addr;
-                char ip_str[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &(ipv4->sin_addr), ip_str, INET_ADDRSTRLEN);
-
-                DNSRecord record;
-                record.name = domain;
-                record.type = DNSRecordType::A;
-                record.data = ip_str;
-                record.ttl = 300;  // 默认TTL 5分钟
-
-                records.push_back(record);
-                std::cout << "System DNS result: " << domain << " -> " << ip_str << std::endl;
-            }
+        auto records = system_resolver ? system_resolver->resolve(domain, address_family(type), fallback_timeout)
+                                       : resolve_with_getaddrinfo(domain, address_family(type));
+        for (const auto &record : records) {
+            DOH_LOG_DEBUG("System DNS result: {} -> {}", domain, record.data);
         }
-
-        freeaddrinfo(result);
         return records;
     }
 
    private:
-    // 将方法枚举转换为字符串（用于日志）
-    std::string method_to_string(DoHMethod method) const {
+    static bool is_address_type(DNSRecordType type) { return type == DNSRecordType::A || type == DNSRecordType::AAAA; }
+
+    static int address_family(DNSRecordType type) { return type == DNSRecordType::A ? AF_INET : AF_INET6; }
+
+    // 构建请求；域名无法编码（空标签、标签超过63字节、名称超过255字节）时记录警告并返回nullptr
+    std::unique_ptr<DoHRequest> make_request(const std::string &domain, DNSRecordType type, DoHMethod method) {
+        try {
+            return std::make_unique<DoHRequest>(dohServer, domain, type, method, provider_metrics);
+        } catch (const EncodingException &e) {
+            Logger::warn("Cannot encode {} query for {}: {}", doh_method_config_name(method), domain, e.what());
+            return nullptr;
+        }
+    }
+
+    // 域名无法编码为DNS报文时返回空结果（rcode为-1），由 query() 照常走系统DNS回退
+    DnsAnswer answer_with_get(const std::string &domain, DNSRecordType type) {
+        std::unique_ptr<DoHRequest> request = make_request(domain, type, DoHMethod::GET);
+        if (!request) {
+            return {};
+        }
+        DOH_LOG_DEBUG("GET request URL: {}", request->url());
+
+        // 因为我们在请求中明确指定了Accept: application/dns-message
+        // 所以期望服务器返回DNS wireformat格式的响应，直接使用DNS二进制格式解析
+        return perform(*request, "GET");
+    }
+
+    DnsAnswer answer_with_post(const std::string &domain, DNSRecordType type) {
+        std::unique_ptr<DoHRequest> request = make_request(domain, type, DoHMethod::POST);
+        if (!request) {
+            return {};
+        }
+        DOH_LOG_DEBUG("POST request URL: {}", request->url());
+
+        // 因为我们在请求中明确指定了Accept: application/dns-message和Content-Type: application/dns-message
+        // 所以期望服务器返回DNS wireformat格式的响应，直接使用DNS二进制格式解析
+        return perform(*request, "POST");
+    }
+
+    DnsAnswer answer_with_json_get(const std::string &domain, DNSRecordType type) {
+        DoHRequest request(dohServer, domain, type, DoHMethod::JSON_GET, provider_metrics);
+        // 期望服务器返回JSON格式的响应
+        DOH_LOG_DEBUG("JSON GET request URL: {}", request.url());
+        return perform(request, "JSON GET");
+    }
+
+    // 按指定方法执行一次DoH查询
+    DnsAnswer answer_with_method(const std::string &domain, DNSRecordType type, DoHMethod method) {
         switch (method) {
             case DoHMethod::GET:
-                return "GET (RFC 8484)";
+                return answer_with_get(domain, type);
             case DoHMethod::POST:
-                return "POST (RFC 8484)";
+                return answer_with_post(domain, type);
             case DoHMethod::JSON_GET:
-                return "JSON GET (Google API)";
+                return answer_with_json_get(domain, type);
             default:
-                return "Unknown";
+                Logger::warn("Unknown DoH method, falling back to JSON_GET");
+                return answer_with_json_get(domain, type);
+        }
+    }
+
+    // 按方法缓存给出的顺序尝试，某个方法被判定为不受支持时立即改用下一个
+    DnsAnswer query_with_discovery(const std::string &domain, DNSRecordType type, DoHMethod method) {
+        if (!methods) {
+            return answer_with_method(domain, type, method);
+        }
+        // 查询报文大小：12字节头部 + 编码后的名称 + QTYPE/QCLASS
+        size_t query_size = 12 + domain.size() + 2 + 4;
+        for (DoHMethod candidate : methods->order(dohServer, method, query_size)) {
+            DnsAnswer answer = answer_with_method(domain, type, candidate);
+            if (methods->get(dohServer, candidate) != MethodSupport::Unsupported) {
+                return answer;
+            }
+            Logger::warn("{} is not supported by {}", doh_method_config_name(candidate), dohServer);
+        }
+        return {};
+    }
+
+    // 合并键：同一服务器上 (域名, 类型, 方法) 相同的查询视为同一请求
+    std::string flight_key(const std::string &domain, DNSRecordType type, DoHMethod method) const {
+        return dohServer + ' ' + std::to_string(static_cast<int>(type)) + ' ' +
+               std::to_string(static_cast<int>(method)) + ' ' + domain;
+    }
+
+    // 在客户端自己的easy句柄上阻塞执行请求，失败时返回空结果（rcode为-1）
+    // 熔断打开时不发起请求；请求结果回报给服务商健康跟踪，只有网络错误与服务端错误计入熔断
+    DnsAnswer perform(DoHRequest &request, const char *label) {
+        if (health && !health->allow(dohServer)) {
+            DOH_LOG_DEBUG("Skipping {} request to {}: circuit open", label, dohServer);
+            return {};
+        }
+        request.attach(curl.get());
+        CURLcode res = curl_easy_perform(curl.get());
+        if (pool && res == CURLE_OK) {
+            pool->record(curl.get(), dohServer);
+        }
+        DnsAnswer answer;
+        try {
+            answer = request.complete_answer(curl.get(), res);
+            if (methods) {
+                methods->record(dohServer, request.method(), true);
+            }
+            if (health) {
+                health->record_success(dohServer, std::chrono::microseconds(request.timing().total));
+            }
+        } catch (const DoHException &e) {
+            Logger::warn("{} request to {} failed: {}", label, dohServer, e.what());
+            if (methods && is_method_rejection(e)) {
+                methods->record(dohServer, request.method(), false);
+            }
+            if (health && is_provider_failure(e)) {
+                health->record_failure(dohServer);
+            } else if (health) {
+                health->record_abandoned(dohServer, std::chrono::microseconds(0));
+            }
         }
+        timing = request.timing();
+        DOH_LOG_DEBUG("{} request to {}: {}", label, dohServer, timing.to_string());
+        return answer;
     }
 };
 
@@ -0,0 +1,280 @@
+#ifndef DOH_CONNECTION_POOL_HPP
+#define DOH_CONNECTION_POOL_HPP
+
+#include <curl/curl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "exceptions.hpp"
+
+/**
+ * @brief 连接池统计信息
+ */
+struct PoolStats {
+    uint64_t transfers = 0;        // 已完成的请求数
+    uint64_t new_connections = 0;  // 新建连接数（每个都需要一次TCP+TLS握手）
+    uint64_t reused = 0;           // 复用已有连接完成的请求数，即避免的握手次数
+    int64_t open_connections = 0;  // 当前打开的连接数
+
+    /**
+     * @brief 连接复用率
+     */
+    double reuse_ratio() const { return transfers == 0 ? 0.0 : static_cast<double>(reused) / transfers; }
+
+    /**
+     * @brief 避免的握手次数
+     */
+    uint64_t handshakes_avoided() const { return reused; }
+};
+
+/**
+ * @brief 按DoH服务商共享的连接池
+ * @details 每个服务商（scheme://host:port）对应一个 curl share 句柄，共享TLS会话和DNS缓存，
+ *          新建连接时可以恢复TLS会话而不必完整握手。
+ *          HTTPS 请求优先协商 HTTP/2 并开启 PIPEWAIT，同一个 multi 句柄上的并发请求复用一条连接；
+ *          已建立的连接由 easy/multi 句柄自身的连接缓存保持。
+ *          curl 不支持在并发线程之间共享连接缓存，因此只有在所有使用者都位于同一线程时
+ *          才应开启 share_connections，让不同句柄之间直接复用连接。
+ *          打开/关闭的套接字通过 curl 的 opensocket/closesocket 回调计数。
+ */
+class DoHConnectionPool {
+public:
+    /**
+     * @brief 构造函数
+     * @param share_connections 是否在句柄之间共享连接缓存（仅限单线程使用）
+     */
+    explicit DoHConnectionPool(bool share_connections = false) : share_connections_(share_connections) {}
+
+    /**
+     * @brief 析构函数，释放所有 share 句柄（调用前必须先清理使用它们的easy句柄）
+     */
+    ~DoHConnectionPool();
+
+    DoHConnectionPool(const DoHConnectionPool&) = delete;
+    DoHConnectionPool& operator=(const DoHConnectionPool&) = delete;
+
+    /**
+     * @brief 进程内共享的连接池
+     * @details 有意不释放，避免静态析构晚于 curl_global_cleanup 时再清理 share 句柄
+     */
+    static DoHConnectionPool& instance() {
+        static DoHConnectionPool* pool = new DoHConnectionPool();
+        return *pool;
+    }
+
+    /**
+     * @brief 将easy句柄接入指定服务商的连接池
+     * @param handle easy句柄，在池析构前必须清理
+     * @param url 请求URL，用于确定服务商
+     */
+    void attach(CURL* handle, const std::string& url);
+
+    /**
+     * @brief 请求完成后记录连接使用情况
+     */
+    void record(CURL* handle, const std::string& url);
+
+    /**
+     * @brief 指定服务商的统计信息
+     */
+    PoolStats stats(const std::string& url) const;
+
+    /**
+     * @brief 所有服务商的统计信息汇总
+     */
+    PoolStats total() const;
+
+    /**
+     * @brief 按服务商列出统计信息
+     */
+    std::map<std::string, PoolStats> all_stats() const;
+
+    /**
+     * @brief 从URL中提取服务商键（scheme://host:port）
+     */
+    static std::string provider_key(const std::string& url);
+
+private:
+    struct Provider {
+        CURLSH* share = nullptr;
+        std::mutex locks[CURL_LOCK_DATA_LAST];
+        std::atomic<uint64_t> transfers{0};
+        std::atomic<uint64_t> new_connections{0};
+        std::atomic<uint64_t> reused{0};
+        std::atomic<int64_t> open_connections{0};
+
+        PoolStats snapshot() const {
+            PoolStats stats;
+            stats.transfers = transfers.load(std::memory_order_relaxed);
+            stats.new_connections = new_connections.load(std::memory_order_relaxed);
+            stats.reused = reused.load(std::memory_order_relaxed);
+            stats.open_connections = open_connections.load(std::memory_order_relaxed);
+            return stats;
+        }
+    };
+
+    static void lock_callback(CURL*, curl_lock_data data, curl_lock_access, void* userptr);
+    static void unlock_callback(CURL*, curl_lock_data data, void* userptr);
+    static curl_socket_t open_socket_callback(void* clientp, curlsocktype purpose, struct curl_sockaddr* address);
+    static int close_socket_callback(void* clientp, curl_socket_t fd);
+
+    Provider& provider_for(const std::string& url);
+    const Provider* find_provider(const std::string& url) const;
+
+    bool share_connections_;
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Provider>> providers_;
+};
+
+// 实现
+inline DoHConnectionPool::~DoHConnectionPool() {
+    for (auto& entry : providers_) {
+        curl_share_cleanup(entry.second->share);
+    }
+}
+
+inline std::string DoHConnectionPool::provider_key(const std::string& url) {
+    std::string scheme = "https";
+    size_t host_start = 0;
+    auto scheme_end = url.find("://");
+    if (scheme_end != std::string::npos) {
+        scheme = url.substr(0, scheme_end);
+        host_start = scheme_end + 3;
+    }
+
+    auto host_end = url.find_first_of("/?#", host_start);
+    std::string authority = url.substr(host_start, host_end == std::string::npos ? std::string::npos
+                                                                                  : host_end - host_start);
+
+    // 补全默认端口，保证 https://host 与 https://host:443 是同一个服务商
+    bool has_port = authority.rfind(':') != std::string::npos && authority.back() != ']';
+    if (!has_port) {
+        authority += scheme == "http" ? ":80" : ":443";
+    }
+    return scheme + "://" + authority;
+}
+
+inline void DoHConnectionPool::attach(CURL* handle, const std::string& url) {
+    Provider& provider = provider_for(url);
+
+    curl_easy_setopt(handle, CURLOPT_SHARE, provider.share);
+
+    // HTTPS 使用 HTTP/2，等待已有连接可复用而不是再建一条新连接；
+    // 明文HTTP/1.1 连接不能多路复用，等待只会让并发请求排队，因此只对 HTTPS 开启
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, provider_key(url).compare(0, 8, "https://") == 0 ? 1L : 0L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    curl_easy_setopt(handle, CURLOPT_OPENSOCKETFUNCTION, open_socket_callback);
+    curl_easy_setopt(handle, CURLOPT_OPENSOCKETDATA, &provider);
+    curl_easy_setopt(handle, CURLOPT_CLOSESOCKETFUNCTION, close_socket_callback);
+    curl_easy_setopt(handle, CURLOPT_CLOSESOCKETDATA, &provider);
+}
+
+inline void DoHConnectionPool::record(CURL* handle, const std::string& url) {
+    Provider& provider = provider_for(url);
+
+    long connects = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+
+    provider.transfers.fetch_add(1, std::memory_order_relaxed);
+    if (connects > 0) {
+        provider.new_connections.fetch_add(static_cast<uint64_t>(connects), std::memory_order_relaxed);
+    } else {
+        provider.reused.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline PoolStats DoHConnectionPool::stats(const std::string& url) const {
+    const Provider* provider = find_provider(url);
+    return provider ? provider->snapshot() : PoolStats{};
+}
+
+inline PoolStats DoHConnectionPool::total() const {
+    PoolStats total;
+    for (const auto& entry : all_stats()) {
+        total.transfers += entry.second.transfers;
+        total.new_connections += entry.second.new_connections;
+        total.reused += entry.second.reused;
+        total.open_connections += entry.second.open_connections;
+    }
+    return total;
+}
+
+inline std::map<std::string, PoolStats> DoHConnectionPool::all_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, PoolStats> result;
+    for (const auto& entry : providers_) {
+        result.emplace(entry.first, entry.second->snapshot());
+    }
+    return result;
+}
+
+inline DoHConnectionPool::Provider& DoHConnectionPool::provider_for(const std::string& url) {
+    std::string key = provider_key(url);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = providers_.find(key);
+    if (it != providers_.end()) {
+        return *it->second;
+    }
+
+    auto provider = std::make_unique<Provider>();
+    provider->share = curl_share_init();
+    if (!provider->share) {
+        throw NetworkException("Failed to initialize curl share handle", 0, url);
+    }
+    curl_share_setopt(provider->share, CURLSHOPT_LOCKFUNC, lock_callback);
+    curl_share_setopt(provider->share, CURLSHOPT_UNLOCKFUNC, unlock_callback);
+    curl_share_setopt(provider->share, CURLSHOPT_USERDATA, provider.get());
+    if (share_connections_) {
+        curl_share_setopt(provider->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+    curl_share_setopt(provider->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(provider->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+    Provider& result = *provider;
+    providers_.emplace(std::move(key), std::move(provider));
+    return result;
+}
+
+inline const DoHConnectionPool::Provider* DoHConnectionPool::find_provider(const std::string& url) const {
+    std::string key = provider_key(url);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = providers_.find(key);
+    return it == providers_.end() ? nullptr : it->second.get();
+}
+
+inline void DoHConnectionPool::lock_callback(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<Provider*>(userptr)->locks[data].lock();
+}
+
+inline void DoHConnectionPool::unlock_callback(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<Provider*>(userptr)->locks[data].unlock();
+}
+
+inline curl_socket_t DoHConnectionPool::open_socket_callback(void* clientp, curlsocktype purpose,
+                                                             struct curl_sockaddr* address) {
+    if (purpose != CURLSOCKTYPE_IPCXN) {
+        return CURL_SOCKET_BAD;
+    }
+    curl_socket_t fd = socket(address->family, address->socktype, address->protocol);
+    if (fd != CURL_SOCKET_BAD) {
+        static_cast<Provider*>(clientp)->open_connections.fetch_add(1, std::memory_order_relaxed);
+    }
+    return fd;
+}
+
+inline int DoHConnectionPool::close_socket_callback(void* clientp, curl_socket_t fd) {
+    static_cast<Provider*>(clientp)->open_connections.fetch_sub(1, std::memory_order_relaxed);
+    return close(fd);
+}
+
+#endif  // DOH_CONNECTION_POOL_HPP
@@ -0,0 +1,894 @@
+#ifndef DOH_FORWARDER_HPP
+#define DOH_FORWARDER_HPP
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hpp"
+#include "dns_cache.hpp"
+#include "dns_parser.hpp"
+#include "dns_wire.hpp"
+#include "exceptions.hpp"
+#include "http_message.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "resolver_service.hpp"
+#include "socket_util.hpp"
+
+/**
+ * @brief 转发服务计数器快照（各事件循环之和）
+ */
+struct ForwarderStats {
+    uint64_t udp_queries = 0;
+    uint64_t tcp_queries = 0;
+    uint64_t http_requests = 0;
+    uint64_t cache_hits = 0;    // 在事件循环上直接由缓存应答
+    uint64_t forwarded = 0;     // 转发到上游的查询
+    uint64_t negative = 0;      // 以NXDOMAIN或NODATA应答（含缓存的否定条目）
+    uint64_t servfail = 0;      // 上游请求失败、应答无法解析或上游应答SERVFAIL
+    uint64_t overloaded = 0;    // 在途查询达到上限，未转发直接以SERVFAIL应答
+    uint64_t bad_requests = 0;  // 格式错误的查询或HTTP请求
+    uint64_t connections = 0;   // 接受的TCP与HTTP连接
+};
+
+/**
+ * @brief 本地DoH转发服务（--serve）
+ * @details 让同一主机上的应用共享一个热缓存和一组到上游的复用连接：在 dns_port 上提供明文DNS
+ *          （UDP与TCP），在 http_port 上提供 RFC 8484 DoH 端点（/dns-query，GET与POST）。
+ *
+ *          每个事件循环一个线程（默认每核一个），各自持有一个epoll实例和一组以 SO_REUSEPORT
+ *          绑定到相同端口的UDP、TCP与HTTP套接字，由内核在循环之间分发报文与连接，循环之间不共享锁。
+ *          缓存命中在事件循环上直接应答；未命中的查询交给 ResolverService，在其工作线程上经
+ *          DoHClientImpl 的 GET/POST/JSON 路径转发（含方法发现与在途查询合并），结果写入共享缓存，
+ *          再经eventfd交回原事件循环发送，事件循环从不阻塞在上游请求上。
+ *
+ *          上游的NXDOMAIN与NODATA原样应答并写入否定缓存，只有上游请求失败或应答无法解析时应答SERVFAIL。
+ *          转发时不回退到系统DNS：本机的系统解析器可能正指向本服务。应答按 DnsZone 能编码的类型
+ *          （A、AAAA、CNAME、NS、PTR、MX、TXT）重新编码，其余类型的记录被省略。
+ *          UDP应答超过512字节时置TC位（不支持EDNS），客户端改用TCP。
+ *          每个事件循环等待上游结果的查询数不超过 max_in_flight，超过时不转发、直接应答SERVFAIL，
+ *          避免随机名称洪泛使上游队列无限增长。
+ *          HTTP端口上的 /metrics 以Prometheus文本格式导出 MetricsRegistry 与本服务的计数器。
+ *          仅支持Linux（epoll、eventfd）。stop() 之后不能再次 start()。
+ */
+class DoHForwarder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 构造函数
+     * @param config 监听地址、端口与线程数
+     * @param upstream 上游DoH服务器URL
+     * @param method 转发使用的DoH方法
+     * @param cache 共享缓存，为nullptr或未启用时每个查询都转发
+     * @param pool 上游连接池，为nullptr时不接入；池的生命周期必须长于服务
+     */
+    DoHForwarder(const ServeConfig &config, const std::string &upstream, DoHMethod method,
+                 std::shared_ptr<DnsCache> cache, DoHConnectionPool *pool = &DoHConnectionPool::instance());
+    ~DoHForwarder() { stop(); }
+
+    DoHForwarder(const DoHForwarder &) = delete;
+    DoHForwarder &operator=(const DoHForwarder &) = delete;
+
+    /**
+     * @brief 绑定端口并启动事件循环与上游工作线程
+     * @throws NetworkException 地址无效或端口绑定失败
+     */
+    void start();
+
+    /**
+     * @brief 停止事件循环，等待在途的上游查询结束后关闭所有连接，可重复调用
+     */
+    void stop();
+
+    /**
+     * @brief 实际的明文DNS端口（UDP与TCP）
+     */
+    uint16_t dns_port() const { return dns_port_; }
+
+    /**
+     * @brief 实际的DoH端口
+     */
+    uint16_t http_port() const { return http_port_; }
+
+    /**
+     * @brief DoH端点URL，如 http://127.0.0.1:8053/dns-query
+     */
+    std::string url() const;
+
+    /**
+     * @brief 事件循环数
+     */
+    size_t loops() const { return loops_.size(); }
+
+    ForwarderStats stats() const;
+
+    /**
+     * @brief Prometheus文本格式的服务计数器
+     */
+    std::string metrics_text() const;
+
+private:
+    enum class Protocol { Udp, Tcp, Http };
+
+    // epoll事件的标识：监听套接字使用固定值，连接从 kFirstConnection 开始编号，编号不复用
+    static constexpr uint64_t kWakeToken = 0;
+    static constexpr uint64_t kUdpToken = 1;
+    static constexpr uint64_t kTcpToken = 2;
+    static constexpr uint64_t kHttpToken = 3;
+    static constexpr uint64_t kFirstConnection = 16;
+
+    static constexpr size_t kBatchSize = 32;               // 每次 recvmmsg/sendmmsg 的最大报文数
+    static constexpr size_t kMaxDatagram = 4096;           // UDP接收缓冲区大小
+    static constexpr size_t kMaxUdpResponse = 512;         // UDP应答上限，超过时置TC位
+    static constexpr int kUdpReceiveBuffer = 4 << 20;      // 吸收突发查询，受 net.core.rmem_max 限制
+    static constexpr size_t kMaxHeaderSize = 16 * 1024;    // HTTP请求头上限
+    static constexpr size_t kMaxBodySize = 65535;          // HTTP请求体上限
+    static constexpr std::chrono::seconds kIdleTimeout{30};  // 没有在途查询的连接空闲多久后关闭
+
+    // 等待上游结果的查询
+    struct Pending {
+        Protocol protocol = Protocol::Udp;
+        uint64_t connection = 0;  // TCP/HTTP 连接编号
+        sockaddr_storage peer{};  // UDP 客户端地址
+        socklen_t peer_length = 0;
+        std::string query;        // 原始DNS查询报文
+        bool keep_alive = true;   // HTTP 应答后是否保持连接
+        DnsAnswer answer;
+    };
+
+    struct Connection {
+        int fd = -1;
+        Protocol protocol = Protocol::Tcp;
+        std::string input;
+        std::string output;
+        size_t in_flight = 0;    // 等待上游结果的请求数
+        bool closing = false;    // 对端已关闭，或发送完当前应答后关闭
+        uint32_t events = 0;     // 当前在epoll中注册的事件
+        Clock::time_point last_active;
+    };
+
+    // 计数器只由所属事件循环写入，避免多核争用同一缓存行
+    struct Counters {
+        std::atomic<uint64_t> udp_queries{0};
+        std::atomic<uint64_t> tcp_queries{0};
+        std::atomic<uint64_t> http_requests{0};
+        std::atomic<uint64_t> cache_hits{0};
+        std::atomic<uint64_t> forwarded{0};
+        std::atomic<uint64_t> negative{0};
+        std::atomic<uint64_t> servfail{0};
+        std::atomic<uint64_t> overloaded{0};
+        std::atomic<uint64_t> bad_requests{0};
+        std::atomic<uint64_t> connections{0};
+    };
+
+    struct Loop {
+        size_t index = 0;
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        int udp_fd = -1;
+        int tcp_fd = -1;
+        int http_fd = -1;
+        std::thread thread;
+
+        std::mutex mutex;                // 保护 completed
+        std::vector<Pending> completed;  // 上游工作线程交回的结果
+
+        std::unordered_map<uint64_t, Connection> connections;
+        uint64_t next_connection = kFirstConnection;
+        size_t in_flight = 0;  // 已提交上游、结果尚未发送的查询数
+
+        Counters counters;
+    };
+
+    enum class Outcome { Answered, Forwarded };
+
+    void bind_loop(Loop &loop, uint16_t dns_port, uint16_t http_port);
+    void run(Loop &loop);
+    void post(Loop &loop, Pending pending);
+    void drain_completed(Loop &loop);
+
+    // 处理一个DNS查询：缓存命中时写入 response 与其最小TTL，否则提交上游
+    // @throws ParseException 查询报文格式错误
+    Outcome answer(Loop &loop, Pending &pending, std::string &response, int64_t &max_age);
+    std::string encode(std::string_view query, const DnsAnswer &answer, Protocol protocol, int64_t &max_age,
+                       Counters &counters) const;
+
+    void handle_udp(Loop &loop);
+    void accept_connections(Loop &loop, int listen_fd, Protocol protocol);
+    void handle_connection(Loop &loop, uint64_t id, uint32_t events);
+    void process_tcp(Loop &loop, uint64_t id, Connection &connection);
+    void process_http(Loop &loop, uint64_t id, Connection &connection);
+    void queue_http(Connection &connection, const HttpResponse &response, bool keep_alive);
+    // 发送输出缓冲区并更新epoll事件；连接被关闭时返回false
+    bool flush(Loop &loop, uint64_t id, Connection &connection);
+    void close_connection(Loop &loop, uint64_t id);
+    void sweep_idle(Loop &loop, Clock::time_point now);
+
+    const ServeConfig config_;
+    const std::string upstream_;
+    const DoHMethod method_;
+    std::shared_ptr<DnsCache> cache_;
+    DoHConnectionPool *pool_;
+    uint16_t dns_port_ = 0;
+    uint16_t http_port_ = 0;
+    std::atomic<bool> running_{false};
+    bool stopped_ = false;
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::unique_ptr<ResolverService> service_;
+};
+
+// 实现
+inline DoHForwarder::DoHForwarder(const ServeConfig &config, const std::string &upstream, DoHMethod method,
+                                  std::shared_ptr<DnsCache> cache, DoHConnectionPool *pool)
+    : config_(config), upstream_(upstream), method_(method), cache_(std::move(cache)), pool_(pool) {
+    if (cache_ && !cache_->enabled()) {
+        cache_.reset();
+    }
+}
+
+inline void DoHForwarder::start() {
+    if (running_ || stopped_) {
+        return;
+    }
+    size_t count = config_.threads > 0 ? static_cast<size_t>(config_.threads) : WorkStealingPool::default_threads();
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            // 先加入 loops_ 再绑定，绑定中途失败时已创建的描述符由下面的 catch 关闭
+            loops_.push_back(std::make_unique<Loop>());
+            Loop &loop = *loops_.back();
+            loop.index = i;
+            // 第一个循环确定端口（可能由系统分配），其余循环以 SO_REUSEPORT 绑定到同一端口
+            bind_loop(loop, i == 0 ? static_cast<uint16_t>(config_.dns_port) : dns_port_,
+                      i == 0 ? static_cast<uint16_t>(config_.http_port) : http_port_);
+        }
+    } catch (...) {
+        for (auto &loop : loops_) {
+            for (int fd : {loop->epoll_fd, loop->wake_fd, loop->udp_fd, loop->tcp_fd, loop->http_fd}) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+        }
+        loops_.clear();
+        throw;
+    }
+
+    service_ = std::make_unique<ResolverService>(upstream_, static_cast<size_t>(config_.upstream_threads), method_,
+                                                 pool_);
+    if (cache_) {
+        service_->set_cache(cache_);
+    }
+
+    running_ = true;
+    for (auto &loop : loops_) {
+        Loop *raw = loop.get();
+        loop->thread = std::thread([this, raw]() { run(*raw); });
+    }
+    Logger::info("DoH forwarder serving DNS on {} port {} (UDP/TCP) and {}, {} loops, upstream {}",
+                 config_.bind_address, dns_port_, url(), loops_.size(), upstream_);
+}
+
+inline void DoHForwarder::bind_loop(Loop &loop, uint16_t dns_port, uint16_t http_port) {
+    auto fail = [&](const char *what, uint16_t port, int error) {
+        throw NetworkException(std::string(what) + std::strerror(error), error,
+                               config_.bind_address + ":" + std::to_string(port));
+    };
+
+    // UDP与TCP使用同一端口号：系统分配端口时先绑UDP，再在同一端口上监听TCP，被占用则重试
+    for (int attempt = 0;; ++attempt) {
+        loop.udp_fd = bind_socket(config_.bind_address, dns_port, SOCK_DGRAM, true);
+        if (loop.udp_fd < 0) {
+            fail("Failed to bind DNS port: ", dns_port, errno);
+        }
+        int receive_buffer = kUdpReceiveBuffer;
+        setsockopt(loop.udp_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+        uint16_t port = bound_port(loop.udp_fd);
+        loop.tcp_fd = bind_socket(config_.bind_address, port, SOCK_STREAM, true);
+        if (loop.tcp_fd >= 0) {
+            dns_port_ = port;
+            break;
+        }
+        int error = errno;
+        close(loop.udp_fd);
+        loop.udp_fd = -1;
+        if (dns_port != 0 || error != EADDRINUSE || attempt >= 16) {
+            fail("Failed to listen on DNS port: ", port, error);
+        }
+    }
+
+    loop.http_fd = bind_socket(config_.bind_address, http_port, SOCK_STREAM, true);
+    if (loop.http_fd < 0) {
+        fail("Failed to listen on HTTP port: ", http_port, errno);
+    }
+    http_port_ = bound_port(loop.http_fd);
+
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epoll_fd < 0) {
+        fail("Failed to create epoll instance: ", 0, errno);
+    }
+    loop.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop.wake_fd < 0) {
+        fail("Failed to create eventfd: ", 0, errno);
+    }
+    const std::pair<int, uint64_t> sources[] = {
+        {loop.wake_fd, kWakeToken}, {loop.udp_fd, kUdpToken}, {loop.tcp_fd, kTcpToken}, {loop.http_fd, kHttpToken}};
+    for (const auto &source : sources) {
+        fcntl(source.first, F_SETFL, fcntl(source.first, F_GETFL, 0) | O_NONBLOCK);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = source.second;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, source.first, &event) != 0) {
+            fail("Failed to register with epoll: ", 0, errno);
+        }
+    }
+}
+
+inline void DoHForwarder::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    stopped_ = true;
+    for (auto &loop : loops_) {
+        uint64_t one = 1;
+        ssize_t written = write(loop->wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+    for (auto &loop : loops_) {
+        loop->thread.join();
+    }
+    // 等待在途的上游查询结束；之后交回的结果只会进入已停止循环的队列
+    service_.reset();
+
+    for (auto &loop : loops_) {
+        for (auto &entry : loop->connections) {
+            close(entry.second.fd);
+        }
+        loop->connections.clear();
+        for (int fd : {loop->epoll_fd, loop->wake_fd, loop->udp_fd, loop->tcp_fd, loop->http_fd}) {
+            close(fd);
+        }
+    }
+    auto totals = stats();
+    Logger::info(
+        "DoH forwarder stopped: udp={}, tcp={}, http={}, cache_hits={}, forwarded={}, negative={}, servfail={}",
+        totals.udp_queries, totals.tcp_queries, totals.http_requests, totals.cache_hits, totals.forwarded,
+        totals.negative, totals.servfail);
+}
+
+inline std::string DoHForwarder::url() const {
+    std::string host = config_.bind_address;
+    if (host == "0.0.0.0") {
+        host = "127.0.0.1";
+    } else if (host == "::") {
+        host = "[::1]";
+    } else if (host.find(':') != std::string::npos) {
+        host = "[" + host + "]";
+    }
+    return "http://" + host + ":" + std::to_string(http_port_) + "/dns-query";
+}
+
+inline ForwarderStats DoHForwarder::stats() const {
+    ForwarderStats totals;
+    for (const auto &loop : loops_) {
+        const Counters &c = loop->counters;
+        totals.udp_queries += c.udp_queries.load(std::memory_order_relaxed);
+        totals.tcp_queries += c.tcp_queries.load(std::memory_order_relaxed);
+        totals.http_requests += c.http_requests.load(std::memory_order_relaxed);
+        totals.cache_hits += c.cache_hits.load(std::memory_order_relaxed);
+        totals.forwarded += c.forwarded.load(std::memory_order_relaxed);
+        totals.negative += c.negative.load(std::memory_order_relaxed);
+        totals.servfail += c.servfail.load(std::memory_order_relaxed);
+        totals.overloaded += c.overloaded.load(std::memory_order_relaxed);
+        totals.bad_requests += c.bad_requests.load(std::memory_order_relaxed);
+        totals.connections += c.connections.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+inline std::string DoHForwarder::metrics_text() const {
+    auto totals = stats();
+    const std::pair<const char *, uint64_t> queries[] = {
+        {"udp", totals.udp_queries}, {"tcp", totals.tcp_queries}, {"http", totals.http_requests}};
+    const std::pair<const char *, uint64_t> outcomes[] = {{"cache_hit", totals.cache_hits},
+                                                          {"forwarded", totals.forwarded},
+                                                          {"negative", totals.negative},
+                                                          {"servfail", totals.servfail},
+                                                          {"overloaded", totals.overloaded},
+                                                          {"bad_request", totals.bad_requests}};
+
+    std::string out = "# HELP doh_forwarder_queries_total Queries received by the forwarder\n"
+                      "# TYPE doh_forwarder_queries_total counter\n";
+    for (const auto &entry : queries) {
+        out += "doh_forwarder_queries_total{protocol=\"" + std::string(entry.first) + "\"} " +
+               std::to_string(entry.second) + "\n";
+    }
+    out += "# HELP doh_forwarder_outcomes_total How forwarder queries were answered\n"
+           "# TYPE doh_forwarder_outcomes_total counter\n";
+    for (const auto &entry : outcomes) {
+        out += "doh_forwarder_outcomes_total{outcome=\"" + std::string(entry.first) + "\"} " +
+               std::to_string(entry.second) + "\n";
+    }
+    out += "# HELP doh_forwarder_connections_total TCP and HTTP connections accepted\n"
+           "# TYPE doh_forwarder_connections_total counter\n"
+           "doh_forwarder_connections_total " +
+           std::to_string(totals.connections) + "\n";
+    return out;
+}
+
+inline void DoHForwarder::run(Loop &loop) {
+    epoll_event events[64];
+    auto next_sweep = Clock::now() + std::chrono::seconds(1);
+    while (running_) {
+        int count = epoll_wait(loop.epoll_fd, events, 64, 1000);
+        for (int i = 0; i < count && running_; ++i) {
+            uint64_t token = events[i].data.u64;
+            switch (token) {
+                case kWakeToken: {
+                    uint64_t value;
+                    ssize_t drained = read(loop.wake_fd, &value, sizeof(value));
+                    (void)drained;
+                    drain_completed(loop);
+                    break;
+                }
+                case kUdpToken:
+                    handle_udp(loop);
+                    break;
+                case kTcpToken:
+                    accept_connections(loop, loop.tcp_fd, Protocol::Tcp);
+                    break;
+                case kHttpToken:
+                    accept_connections(loop, loop.http_fd, Protocol::Http);
+                    break;
+                default:
+                    handle_connection(loop, token, events[i].events);
+                    break;
+            }
+        }
+        auto now = Clock::now();
+        if (now >= next_sweep) {
+            sweep_idle(loop, now);
+            next_sweep = now + std::chrono::seconds(1);
+        }
+    }
+}
+
+inline void DoHForwarder::post(Loop &loop, Pending pending) {
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        was_empty = loop.completed.empty();
+        loop.completed.push_back(std::move(pending));
+    }
+    // 队列非空时事件循环已被唤醒、尚未取走结果，不必再写eventfd
+    if (was_empty) {
+        uint64_t one = 1;
+        ssize_t written = write(loop.wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+inline DoHForwarder::Outcome DoHForwarder::answer(Loop &loop, Pending &pending, std::string &response,
+                                                  int64_t &max_age) {
+    DnsMessageParser parser(pending.query);
+    DnsQuestionView question;
+    if (parser.header().is_response() || parser.header().qdcount != 1 || !parser.next_question(question)) {
+        throw ParseException("Expected a query with exactly one question", "dns");
+    }
+    std::string domain = normalize_dns_name(question.name.to_string());
+    auto type = static_cast<DNSRecordType>(question.type);
+
+    DnsAnswer cached;
+    if (cache_ && cache_->get(domain, type, cached)) {
+        loop.counters.cache_hits.fetch_add(1, std::memory_order_relaxed);
+        response = encode(pending.query, cached, pending.protocol, max_age, loop.counters);
+        return Outcome::Answered;
+    }
+
+    if (loop.in_flight >= static_cast<size_t>(config_.max_in_flight)) {
+        loop.counters.overloaded.fetch_add(1, std::memory_order_relaxed);
+        response = build_dns_response(pending.query, 2, {}, false, false, max_age);  // SERVFAIL
+        return Outcome::Answered;
+    }
+
+    ++loop.in_flight;
+    loop.counters.forwarded.fetch_add(1, std::memory_order_relaxed);
+    Loop *target = &loop;
+    service_->resolve_answer(domain, type, [this, target, pending](DnsAnswer answer) mutable {
+        pending.answer = std::move(answer);
+        post(*target, std::move(pending));
+    });
+    return Outcome::Forwarded;
+}
+
+inline std::string DoHForwarder::encode(std::string_view query, const DnsAnswer &answer, Protocol protocol,
+                                        int64_t &max_age, Counters &counters) const {
+    std::vector<DnsWireRecord> encoded;
+    encoded.reserve(answer.records.size());
+    for (const auto &record : answer.records) {
+        try {
+            encoded.push_back(make_dns_wire_record(record.name, record.type, record.ttl, record.data));
+        } catch (const EncodingException &e) {
+            DOH_LOG_DEBUG("Omitting {} record for {}: {}", record_type_name(record.type), record.name, e.what());
+        }
+    }
+    std::vector<const DnsWireRecord *> answers;
+    answers.reserve(encoded.size());
+    for (const auto &record : encoded) {
+        answers.push_back(&record);
+    }
+
+    // 没有可用的上游应答时以SERVFAIL应答，其余RCODE（NXDOMAIN、REFUSED等）原样转发
+    int rcode = answer.rcode < 0 ? 2 : answer.rcode;
+    if (rcode == 2) {
+        counters.servfail.fetch_add(1, std::memory_order_relaxed);
+    } else if (answer.negative()) {
+        counters.negative.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::string response = build_dns_response(query, rcode, answers, false, false, max_age);
+    if (protocol == Protocol::Udp && response.size() > kMaxUdpResponse) {
+        response = build_dns_response(query, rcode, answers, true, false, max_age);
+    }
+    if (answer.negative() && answer.negative_ttl > 0) {
+        max_age = answer.negative_ttl;
+    }
+    return response;
+}
+
+inline void DoHForwarder::drain_completed(Loop &loop) {
+    std::vector<Pending> completed;
+    {
+        std::lock_guard<std::mutex> lock(loop.mutex);
+        completed.swap(loop.completed);
+    }
+    for (auto &pending : completed) {
+        --loop.in_flight;
+        int64_t max_age = -1;
+        std::string response = encode(pending.query, pending.answer, pending.protocol, max_age, loop.counters);
+        if (pending.protocol == Protocol::Udp) {
+            sendto(loop.udp_fd, response.data(), response.size(), 0, reinterpret_cast<sockaddr *>(&pending.peer),
+                   pending.peer_length);
+            continue;
+        }
+
+        // 等待期间连接可能已关闭，编号不复用，找不到时丢弃结果
+        auto it = loop.connections.find(pending.connection);
+        if (it == loop.connections.end()) {
+            continue;
+        }
+        Connection &connection = it->second;
+        --connection.in_flight;
+        if (pending.protocol == Protocol::Tcp) {
+            dns_wire_detail::append_u16(connection.output, static_cast<uint16_t>(response.size()));
+            connection.output.append(response);
+            flush(loop, pending.connection, connection);
+            continue;
+        }
+
+        HttpResponse http;
+        http.content_type = "application/dns-message";
+        http.body = std::move(response);
+        http.max_age = max_age;
+        queue_http(connection, http, pending.keep_alive);
+        // 继续处理已缓冲的流水线请求，由 process_http 发送应答
+        process_http(loop, pending.connection, connection);
+    }
+}
+
+inline void DoHForwarder::handle_udp(Loop &loop) {
+    // 每次事件最多处理4批，避免UDP洪泛饿死同一循环上的连接
+    for (int round = 0; round < 4; ++round) {
+        char buffers[kBatchSize][kMaxDatagram];
+        sockaddr_storage peers[kBatchSize];
+        iovec iov[kBatchSize];
+        mmsghdr messages[kBatchSize];
+        for (size_t i = 0; i < kBatchSize; ++i) {
+            iov[i] = {buffers[i], kMaxDatagram};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_name = &peers[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+            messages[i].msg_hdr.msg_iov = &iov[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int received = recvmmsg(loop.udp_fd, messages, kBatchSize, MSG_DONTWAIT, nullptr);
+        if (received <= 0) {
+            return;
+        }
+
+        std::string responses[kBatchSize];
+        iovec out_iov[kBatchSize];
+        mmsghdr out[kBatchSize];
+        unsigned int answered = 0;
+        for (int i = 0; i < received; ++i) {
+            loop.counters.udp_queries.fetch_add(1, std::memory_order_relaxed);
+            Pending pending;
+            pending.protocol = Protocol::Udp;
+            pending.query.assign(buffers[i], messages[i].msg_len);
+            std::memcpy(&pending.peer, &peers[i], messages[i].msg_hdr.msg_namelen);
+            pending.peer_length = messages[i].msg_hdr.msg_namelen;
+            int64_t max_age = -1;
+            try {
+                if ((messages[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+                    answer(loop, pending, responses[answered], max_age) != Outcome::Answered) {
+                    continue;
+                }
+            } catch (const DoHException &) {
+                // 格式错误的报文不应答
+                loop.counters.bad_requests.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            out_iov[answered] = {responses[answered].data(), responses[answered].size()};
+            out[answered] = {};
+            out[answered].msg_hdr.msg_name = &peers[i];
+            out[answered].msg_hdr.msg_namelen = messages[i].msg_hdr.msg_namelen;
+            out[answered].msg_hdr.msg_iov = &out_iov[answered];
+            out[answered].msg_hdr.msg_iovlen = 1;
+            ++answered;
+        }
+        // UDP不保证送达，发送失败的应答直接丢弃
+        for (unsigned int sent = 0; sent < answered;) {
+            int n = sendmmsg(loop.udp_fd, out + sent, answered - sent, MSG_DONTWAIT);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<unsigned int>(n);
+        }
+        if (static_cast<size_t>(received) < kBatchSize) {
+            return;
+        }
+    }
+}
+
+inline void DoHForwarder::accept_connections(Loop &loop, int listen_fd, Protocol protocol) {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        uint64_t id = loop.next_connection++;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = id;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        Connection &connection = loop.connections[id];
+        connection.fd = fd;
+        connection.protocol = protocol;
+        connection.events = event.events;
+        connection.last_active = Clock::now();
+        loop.counters.connections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline void DoHForwarder::handle_connection(Loop &loop, uint64_t id, uint32_t events) {
+    auto it = loop.connections.find(id);
+    if (it == loop.connections.end()) {
+        return;
+    }
+    Connection &connection = it->second;
+    if (events & EPOLLERR) {
+        close_connection(loop, id);
+        return;
+    }
+    connection.last_active = Clock::now();
+
+    if (events & EPOLLOUT) {
+        if (!flush(loop, id, connection)) {
+            return;
+        }
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+        char chunk[16 * 1024];
+        while (true) {
+            ssize_t n = recv(connection.fd, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                connection.input.append(chunk, static_cast<size_t>(n));
+                continue;
+            }
+            if (n == 0) {
+                connection.closing = true;  // 对端关闭写方向，答完已收到的请求后关闭
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                close_connection(loop, id);
+                return;
+            }
+            break;
+        }
+        if (connection.protocol == Protocol::Tcp) {
+            process_tcp(loop, id, connection);
+        } else {
+            process_http(loop, id, connection);
+        }
+    }
+}
+
+inline void DoHForwarder::process_tcp(Loop &loop, uint64_t id, Connection &connection) {
+    // 每个报文前有2字节长度；RFC 7766 允许乱序应答，未命中的查询不阻塞后续查询
+    size_t offset = 0;
+    while (connection.input.size() - offset >= 2) {
+        size_t length = static_cast<size_t>(static_cast<uint8_t>(connection.input[offset])) << 8 |
+                        static_cast<uint8_t>(connection.input[offset + 1]);
+        if (connection.input.size() - offset - 2 < length) {
+            break;
+        }
+        loop.counters.tcp_queries.fetch_add(1, std::memory_order_relaxed);
+        Pending pending;
+        pending.protocol = Protocol::Tcp;
+        pending.connection = id;
+        pending.query = connection.input.substr(offset + 2, length);
+        offset += 2 + length;
+
+        std::string response;
+        int64_t max_age = -1;
+        try {
+            if (answer(loop, pending, response, max_age) == Outcome::Forwarded) {
+                ++connection.in_flight;
+                continue;
+            }
+        } catch (const DoHException &) {
+            loop.counters.bad_requests.fetch_add(1, std::memory_order_relaxed);
+            connection.closing = true;
+            connection.input.clear();
+            offset = 0;
+            break;
+        }
+        dns_wire_detail::append_u16(connection.output, static_cast<uint16_t>(response.size()));
+        connection.output.append(response);
+    }
+    connection.input.erase(0, offset);
+    flush(loop, id, connection);
+}
+
+inline void DoHForwarder::process_http(Loop &loop, uint64_t id, Connection &connection) {
+    // HTTP/1.1 应答必须按请求顺序发出：当前请求等待上游时不处理后续的流水线请求。
+    // 对端半关闭后不再读取新数据，但已缓冲的完整请求仍逐个应答；不保持连接的应答会清空缓冲区
+    while (connection.in_flight == 0) {
+        size_t header_end = connection.input.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            if (connection.input.size() > kMaxHeaderSize) {
+                loop.counters.bad_requests.fetch_add(1, std::memory_order_relaxed);
+                queue_http(connection, plain_http_response(431, "Request header too large"), false);
+            }
+            break;
+        }
+
+        HttpRequest request;
+        size_t content_length = 0;
+        bool keep_alive = false;
+        if (!parse_http_request_head(connection.input.substr(0, header_end), request, content_length, keep_alive)) {
+            loop.counters.bad_requests.fetch_add(1, std::memory_order_relaxed);
+            queue_http(connection, plain_http_response(400, "Malformed request"), false);
+            break;
+        }
+        if (content_length > kMaxBodySize) {
+            loop.counters.bad_requests.fetch_add(1, std::memory_order_relaxed);
+            queue_http(connection, plain_http_response(413, "Request body too large"), false);
+            break;
+        }
+        size_t body_start = header_end + 4;
+        if (connection.input.size() < body_start + content_length) {
+            break;
+        }
+        request.body = connection.input.substr(body_start, content_length);
+        connection.input.erase(0, body_start + content_length);
+        loop.counters.http_requests.fetch_add(1, std::memory_order_relaxed);
+
+        HttpResponse response;
+        Pending pending;
+        pending.protocol = Protocol::Http;
+        pending.connection = id;
+        pending.keep_alive = keep_alive;
+        if (request.path == "/metrics") {
+            response.content_type = "text/plain; version=0.0.4";
+            response.body = MetricsRegistry::instance().prometheus_text() + metrics_text();
+        } else if (request.path != "/dns-query") {
+            response = plain_http_response(404, "Not found");
+        } else if (dns_message_from_request(request, pending.query, response)) {
+            try {
+                std::string message;
+                int64_t max_age = -1;
+                if (answer(loop, pending, message, max_age) == Outcome::Forwarded) {
+                    ++connection.in_flight;
+                    break;
+                }
+                // 命中缓存的应答，max-age 为记录的剩余TTL
+                response.content_type = "application/dns-message";
+                response.body = std::move(message);
+                response.max_age = max_age;
+            } catch (const DoHException &e) {
+                response = plain_http_response(400, e.what());
+            }
+        }
+        if (response.status == 400) {
+            loop.counters.bad_requests.fetch_add(1, std::memory_order_relaxed);
+        }
+        queue_http(connection, response, keep_alive);
+    }
+    flush(loop, id, connection);
+}
+
+inline void DoHForwarder::queue_http(Connection &connection, const HttpResponse &response, bool keep_alive) {
+    connection.output.append(format_http_response(response, keep_alive));
+    if (!keep_alive) {
+        connection.closing = true;
+        connection.input.clear();
+    }
+}
+
+inline bool DoHForwarder::flush(Loop &loop, uint64_t id, Connection &connection) {
+    while (!connection.output.empty()) {
+        ssize_t n = send(connection.fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            connection.output.erase(0, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        }
+        close_connection(loop, id);
+        return false;
+    }
+    if (connection.closing && connection.output.empty() && connection.in_flight == 0) {
+        close_connection(loop, id);
+        return false;
+    }
+
+    // 有待发送数据时等待可写；对端已关闭时不再关注可读，避免水平触发下反复报告EOF
+    uint32_t events = (connection.closing ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) |
+                      (connection.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = id;
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+    return true;
+}
+
+inline void DoHForwarder::close_connection(Loop &loop, uint64_t id) {
+    auto it = loop.connections.find(id);
+    if (it == loop.connections.end()) {
+        return;
+    }
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    loop.connections.erase(it);
+}
+
+inline void DoHForwarder::sweep_idle(Loop &loop, Clock::time_point now) {
+    std::vector<uint64_t> idle;
+    for (const auto &entry : loop.connections) {
+        if (entry.second.in_flight == 0 && now - entry.second.last_active > kIdleTimeout) {
+            idle.push_back(entry.first);
+        }
+    }
+    for (uint64_t id : idle) {
+        close_connection(loop, id);
+    }
+}
+
+#endif  // DOH_FORWARDER_HPP
@@ -0,0 +1,206 @@
+#ifndef DOH_METHOD_HPP
+#define DOH_METHOD_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// DoH 查询方法枚举
+enum class DoHMethod {
+    GET,      // RFC 8484 GET - 使用二进制DNS消息，Base64URL编码
+    POST,     // RFC 8484 POST - 使用二进制DNS消息，直接POST
+    JSON_GET  // Google JSON API - 使用JSON格式，GET请求
+};
+
+// 将方法枚举转换为配置文件中使用的名称（DoHServerConfig::methods）
+inline const char *doh_method_config_name(DoHMethod method) {
+    switch (method) {
+        case DoHMethod::GET:
+            return "get";
+        case DoHMethod::POST:
+            return "post";
+        case DoHMethod::JSON_GET:
+            return "json";
+        default:
+            return "unknown";
+    }
+}
+
+// 从字符串解析DoH方法（get/post/json/json_get，不区分大小写）
+inline bool parse_doh_method(std::string name, DoHMethod &method) {
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (name == "get") {
+        method = DoHMethod::GET;
+    } else if (name == "post") {
+        method = DoHMethod::POST;
+    } else if (name == "json" || name == "json_get") {
+        method = DoHMethod::JSON_GET;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 服务商对某个DoH方法的支持情况
+ */
+enum class MethodSupport {
+    Unknown,      // 没有探测结果或结果已过期
+    Supported,    // 最近一次使用该方法得到了可解析的应答
+    Unsupported,  // 最近一次使用该方法被服务商拒绝（4xx/501）或应答格式不符
+};
+
+/**
+ * @brief 按服务商URL缓存各DoH方法的支持情况
+ * @details 查询结果（成功，或被判定为方法不受支持的失败）写入缓存，在 ttl 内有效。
+ *          order() 据此给出尝试顺序：已知可用的方法在前，未知的次之，已知不可用的不再尝试。
+ *          已知可用的方法按代价排序：二进制GET可被HTTP缓存，优先使用；DNS报文超过 kLargeQuerySize
+ *          时GET的URL过长，改为优先POST；JSON API需要额外的文本解析，排在最后。
+ *          线程安全。
+ */
+class DoHMethodCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kLargeQuerySize = 256;  // 超过该大小（字节）的DNS报文优先使用POST
+
+    explicit DoHMethodCache(std::chrono::seconds ttl = std::chrono::seconds(3600)) : ttl_(ttl) {}
+
+    DoHMethodCache(const DoHMethodCache &) = delete;
+    DoHMethodCache &operator=(const DoHMethodCache &) = delete;
+
+    /**
+     * @brief 进程内共享的实例
+     */
+    static DoHMethodCache &instance() {
+        static DoHMethodCache cache;
+        return cache;
+    }
+
+    /**
+     * @brief 设置探测结果的有效期，已缓存的结果按新的有效期重新计算
+     */
+    void set_ttl(std::chrono::seconds ttl);
+
+    /**
+     * @brief 记录一次探测或查询的结果
+     */
+    void record(const std::string &server, DoHMethod method, bool supported, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 查询方法支持情况，过期结果视为未知
+     */
+    MethodSupport get(const std::string &server, DoHMethod method, Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief 给出向服务商尝试各方法的顺序
+     * @param server 服务商URL
+     * @param requested 调用方指定的方法，在未知的方法中排在最前
+     * @param query_size DNS查询报文大小（字节）
+     * @return 不含已知不可用方法的尝试顺序；三种方法都已知不可用时只返回 requested（缓存可能已过时）
+     */
+    std::vector<DoHMethod> order(const std::string &server, DoHMethod requested, size_t query_size,
+                                 Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief 清空缓存
+     */
+    void clear();
+
+private:
+    static constexpr int kMethodCount = 3;
+
+    struct Entry {
+        MethodSupport support[kMethodCount] = {MethodSupport::Unknown, MethodSupport::Unknown, MethodSupport::Unknown};
+        Clock::time_point recorded[kMethodCount];
+    };
+
+    MethodSupport get_locked(const Entry &entry, DoHMethod method, Clock::time_point now) const;
+
+    mutable std::mutex mutex_;
+    std::chrono::seconds ttl_;
+    std::unordered_map<std::string, Entry> servers_;
+};
+
+// 实现
+inline void DoHMethodCache::set_ttl(std::chrono::seconds ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ttl_ = ttl;
+}
+
+inline void DoHMethodCache::record(const std::string &server, DoHMethod method, bool supported,
+                                   Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry &entry = servers_[server];
+    int index = static_cast<int>(method);
+    entry.support[index] = supported ? MethodSupport::Supported : MethodSupport::Unsupported;
+    entry.recorded[index] = now;
+}
+
+inline MethodSupport DoHMethodCache::get(const std::string &server, DoHMethod method, Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = servers_.find(server);
+    return it == servers_.end() ? MethodSupport::Unknown : get_locked(it->second, method, now);
+}
+
+inline MethodSupport DoHMethodCache::get_locked(const Entry &entry, DoHMethod method, Clock::time_point now) const {
+    int index = static_cast<int>(method);
+    if (entry.support[index] == MethodSupport::Unknown || now - entry.recorded[index] >= ttl_) {
+        return MethodSupport::Unknown;
+    }
+    return entry.support[index];
+}
+
+inline std::vector<DoHMethod> DoHMethodCache::order(const std::string &server, DoHMethod requested,
+                                                    size_t query_size, Clock::time_point now) const {
+    // 按代价排列的全部方法
+    const DoHMethod by_cost[kMethodCount] = {
+        query_size > kLargeQuerySize ? DoHMethod::POST : DoHMethod::GET,
+        query_size > kLargeQuerySize ? DoHMethod::GET : DoHMethod::POST,
+        DoHMethod::JSON_GET,
+    };
+
+    MethodSupport support[kMethodCount] = {MethodSupport::Unknown, MethodSupport::Unknown, MethodSupport::Unknown};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = servers_.find(server);
+        if (it != servers_.end()) {
+            for (DoHMethod method : by_cost) {
+                support[static_cast<int>(method)] = get_locked(it->second, method, now);
+            }
+        }
+    }
+
+    std::vector<DoHMethod> methods;
+    methods.reserve(kMethodCount);
+    // 已知可用的方法按代价排序；未知的方法中调用方指定的优先，避免无谓地试探其他方法
+    for (DoHMethod method : by_cost) {
+        if (support[static_cast<int>(method)] == MethodSupport::Supported) {
+            methods.push_back(method);
+        }
+    }
+    if (support[static_cast<int>(requested)] == MethodSupport::Unknown) {
+        methods.push_back(requested);
+    }
+    for (DoHMethod method : by_cost) {
+        if (method != requested && support[static_cast<int>(method)] == MethodSupport::Unknown) {
+            methods.push_back(method);
+        }
+    }
+    if (methods.empty()) {
+        methods.push_back(requested);
+    }
+    return methods;
+}
+
+inline void DoHMethodCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    servers_.clear();
+}
+
+#endif  // DOH_METHOD_HPP
@@ -0,0 +1,344 @@
+#ifndef DOH_RACER_HPP
+#define DOH_RACER_HPP
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "dns_encoder.hpp"
+#include "doh_client.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include "provider_health.hpp"
+
+/**
+ * @brief 竞速解析结果
+ */
+struct RaceResult {
+    std::vector<DNSRecord> records;         // 获胜服务商返回的记录，全部失败时为空
+    std::string winner;                     // 获胜服务商名称
+    DoHMethod method = DoHMethod::GET;      // 获胜请求使用的方法
+    int launched = 0;                       // 实际发起的请求数
+    int failed = 0;                         // 失败（或无结果）的请求数
+    std::chrono::milliseconds elapsed{0};   // 总耗时
+};
+
+/**
+ * @brief 多服务商竞速解析器（DoH版 "happy eyeballs"）
+ * @details 每次竞速按 ProviderHealth 的实时评分（延迟、失败率与静态优先级）排序服务商，
+ *          跳过熔断器打开的服务商后取前N个，基于 curl multi 依次错开启动请求：
+ *          第一个请求立即发出，之后每隔 stagger_ms 追加一个，
+ *          若当前所有请求都已失败则立即启动下一个。
+ *          第一个返回有效记录的请求获胜，其余请求被取消。
+ *          每个请求的延迟、网络/HTTP失败以及被取消时已等待的时间都会回报给 ProviderHealth。
+ *          multi 句柄在多次竞速之间保留，已建立的连接可被后续竞速复用，因此 race() 不是线程安全的。
+ */
+class DoHRacer {
+public:
+    /**
+     * @brief 构造函数
+     * @param servers 候选服务商（已按优先级排序）
+     * @param config 竞速配置
+     * @param connect_timeout 连接超时（秒）
+     * @param pool 连接池，为nullptr时不接入；池的生命周期必须长于竞速器
+     * @param health 服务商健康跟踪，为nullptr时按静态优先级选择；生命周期必须长于竞速器
+     */
+    DoHRacer(std::vector<DoHServerConfig> servers, const RaceConfig& config, int connect_timeout = 5,
+             DoHConnectionPool* pool = &DoHConnectionPool::instance(),
+             ProviderHealth* health = &ProviderHealth::instance());
+
+    /**
+     * @brief 使用全局配置构造（服务商取 Config::get_servers_by_priority()）
+     */
+    explicit DoHRacer(const Config& config, DoHConnectionPool* pool = &DoHConnectionPool::instance(),
+                      ProviderHealth* health = &ProviderHealth::instance());
+
+    /**
+     * @brief 执行竞速解析
+     * @param domain 域名
+     * @param type 记录类型
+     * @param preferred 优先使用的方法，服务商不支持时使用其支持的第一个方法
+     * @return 竞速结果
+     */
+    RaceResult race(const std::string& domain, DNSRecordType type = DNSRecordType::A,
+                    DoHMethod preferred = DoHMethod::GET);
+
+    /**
+     * @brief 执行竞速解析，只返回记录
+     */
+    std::vector<DNSRecord> resolve(const std::string& domain, DNSRecordType type = DNSRecordType::A,
+                                   DoHMethod preferred = DoHMethod::GET) {
+        return race(domain, type, preferred).records;
+    }
+
+    /**
+     * @brief 按当前评分下一次竞速会优先选用的服务商（至多 max_providers 个）
+     */
+    std::vector<DoHServerConfig> candidates() const;
+
+    /**
+     * @brief 为服务商选择请求方法
+     * @return 服务商没有可用方法时返回false
+     */
+    static bool select_method(const DoHServerConfig& server, DoHMethod preferred, DoHMethod& method);
+
+private:
+    // 单个参赛请求
+    struct Attempt {
+        const DoHServerConfig* server = nullptr;
+        std::unique_ptr<DoHRequest> request;
+        CURL* handle = nullptr;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    struct MultiDeleter {
+        void operator()(CURLM* multi) const { curl_multi_cleanup(multi); }
+    };
+
+    // 析构时取消所有仍在进行中的请求，保证 race() 异常退出时不在 multi 句柄中留下悬空的请求
+    struct AttemptGuard {
+        DoHRacer* racer;
+        CURLM* multi;
+        std::vector<Attempt>& attempts;
+
+        ~AttemptGuard() { cancel_all(); }
+        void cancel_all() {
+            for (auto& attempt : attempts) {
+                racer->cancel(multi, attempt);
+            }
+        }
+    };
+
+    void launch(CURLM* multi, Attempt& attempt, const DoHServerConfig& server, const std::string& domain,
+                DNSRecordType type, DoHMethod preferred, std::chrono::steady_clock::time_point now);
+    void cancel(CURLM* multi, Attempt& attempt);
+    std::vector<DoHServerConfig> ranked() const;
+
+    std::vector<DoHServerConfig> candidates_;  // 所有启用且有可用方法的服务商，按优先级排序
+    RaceConfig config_;
+    int connect_timeout_;
+    DoHConnectionPool* pool_;
+    ProviderHealth* health_;
+    std::unique_ptr<CURLM, MultiDeleter> multi_;
+};
+
+// 实现
+inline DoHRacer::DoHRacer(std::vector<DoHServerConfig> servers, const RaceConfig& config, int connect_timeout,
+                          DoHConnectionPool* pool, ProviderHealth* health)
+    : config_(config), connect_timeout_(connect_timeout), pool_(pool), health_(health), multi_(curl_multi_init()) {
+    if (!multi_) {
+        throw NetworkException("Failed to initialize curl multi handle");
+    }
+    curl_multi_setopt(multi_.get(), CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    DoHMethod method;
+    for (auto& server : servers) {
+        if (server.enabled && select_method(server, DoHMethod::GET, method)) {
+            candidates_.push_back(std::move(server));
+        }
+    }
+}
+
+inline DoHRacer::DoHRacer(const Config& config, DoHConnectionPool* pool, ProviderHealth* health)
+    : DoHRacer(config.get_servers_by_priority(), config.race, config.connect_timeout, pool, health) {}
+
+inline std::vector<DoHServerConfig> DoHRacer::ranked() const {
+    return health_ ? health_->rank(candidates_) : candidates_;
+}
+
+inline std::vector<DoHServerConfig> DoHRacer::candidates() const {
+    auto servers = ranked();
+    servers.resize(std::min(servers.size(), static_cast<size_t>(std::max(config_.max_providers, 1))));
+    return servers;
+}
+
+inline bool DoHRacer::select_method(const DoHServerConfig& server, DoHMethod preferred, DoHMethod& method) {
+    const auto& methods = server.methods;
+    if (std::find(methods.begin(), methods.end(), doh_method_config_name(preferred)) != methods.end()) {
+        method = preferred;
+        return true;
+    }
+    for (const auto& name : methods) {
+        if (parse_doh_method(name, method)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline RaceResult DoHRacer::race(const std::string& domain, DNSRecordType type, DoHMethod preferred) {
+    using Clock = std::chrono::steady_clock;
+
+    RaceResult result;
+    auto start = Clock::now();
+
+    // 先校验域名能否编码为DNS报文，避免某个服务商的请求在启动途中失败
+    try {
+        DnsQueryBuffer query;
+        query.encode(domain, static_cast<uint16_t>(type));
+    } catch (const EncodingException& e) {
+        Logger::warn("Race for {} not started: {}", domain, e.what());
+        return result;
+    }
+
+    CURLM* multi = multi_.get();
+    const auto order = ranked();
+    std::vector<Attempt> attempts(std::min(order.size(), static_cast<size_t>(std::max(config_.max_providers, 1))));
+    // 无论正常结束还是异常退出，都把仍在进行中的请求从 multi 句柄移除并释放
+    AttemptGuard guard{this, multi, attempts};
+    size_t next = 0;            // 下一个要启动的 attempts 下标
+    size_t next_candidate = 0;  // order 中下一个待检查的服务商
+    int active = 0;
+    auto stagger = std::chrono::milliseconds(std::max(config_.stagger_ms, 0));
+    auto next_launch = start;
+
+    while (true) {
+        // 到达错开时间，或者在途请求已全部失败时，启动下一个服务商；熔断器打开的服务商被跳过
+        auto now = Clock::now();
+        while (next < attempts.size() && next_candidate < order.size() && (now >= next_launch || active == 0)) {
+            const auto& server = order[next_candidate++];
+            if (health_ && !health_->allow(server.url, now)) {
+                DOH_LOG_DEBUG("Race skips {}: circuit open", server.name);
+                continue;
+            }
+            try {
+                launch(multi, attempts[next], server, domain, type, preferred, now);
+            } catch (...) {
+                // 请求未能启动：释放 allow() 分配的探测资格，不计入熔断
+                if (health_) {
+                    health_->record_abandoned(server.url, std::chrono::microseconds(0));
+                }
+                throw;
+            }
+            ++next;
+            ++active;
+            ++result.launched;
+            next_launch = now + stagger;
+        }
+
+        if (active == 0) {
+            break;  // 所有服务商都已失败
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        // 处理已完成的请求
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            auto it = std::find_if(attempts.begin(), attempts.end(),
+                                   [&](const Attempt& a) { return a.handle == msg->easy_handle; });
+            if (it == attempts.end()) {
+                continue;
+            }
+
+            --active;
+            if (pool_ && msg->data.result == CURLE_OK) {
+                pool_->record(it->handle, it->server->url);
+            }
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - it->started);
+            try {
+                auto records = it->request->complete(it->handle, msg->data.result);
+                if (health_) {
+                    health_->record_success(it->server->url, latency);
+                }
+                if (!records.empty() && result.records.empty()) {
+                    result.records = std::move(records);
+                    result.winner = it->server->name;
+                    result.method = it->request->method();
+                } else if (records.empty()) {
+                    ++result.failed;
+                }
+            } catch (const DoHException& e) {
+                ++result.failed;
+                DOH_LOG_DEBUG("Race attempt {} failed: {}", it->server->name, e.what());
+                // 只有网络错误与服务端错误计入熔断；方法被拒绝、其他4xx或响应无法解析只释放探测资格
+                if (health_ && is_provider_failure(e)) {
+                    health_->record_failure(it->server->url);
+                } else if (health_) {
+                    health_->record_abandoned(it->server->url, std::chrono::microseconds(0));
+                }
+            }
+            it->request.reset();
+            cancel(multi, *it);
+        }
+
+        if (!result.records.empty()) {
+            break;
+        }
+        if (active == 0) {
+            continue;  // 在途请求全部失败，立即启动下一个服务商
+        }
+
+        // 等待网络事件，最长等到下一个服务商的启动时间
+        int wait_ms = 1000;
+        if (next < attempts.size() && next_candidate < order.size()) {
+            auto until_next = std::chrono::duration_cast<std::chrono::milliseconds>(next_launch - Clock::now());
+            wait_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(until_next.count(), wait_ms)));
+        }
+        curl_multi_poll(multi, nullptr, 0, wait_ms, nullptr);
+    }
+
+    // 取消仍在进行中的落败请求
+    guard.cancel_all();
+
+    result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+    if (result.records.empty()) {
+        Logger::warn("Race for {} failed on all {} providers", domain, result.launched);
+    } else {
+        DOH_LOG_DEBUG("Race for {} won by {} in {}ms ({} launched)", domain, result.winner, result.elapsed.count(),
+                      result.launched);
+    }
+    return result;
+}
+
+inline void DoHRacer::launch(CURLM* multi, Attempt& attempt, const DoHServerConfig& server,
+                             const std::string& domain, DNSRecordType type, DoHMethod preferred,
+                             std::chrono::steady_clock::time_point now) {
+    DoHMethod method = preferred;
+    select_method(server, preferred, method);
+
+    // 请求与句柄都创建成功后才写入 attempt，失败时 attempt 保持未启动状态
+    auto request =
+        std::make_unique<DoHRequest>(server.url, domain, type, method, DoHMetrics::instance().provider(server.url));
+    CURL* handle = curl_easy_init();
+    if (!handle) {
+        throw NetworkException("Failed to initialize curl", 0, server.url);
+    }
+
+    configure_doh_handle(handle, server.timeout, connect_timeout_);
+    if (pool_) {
+        pool_->attach(handle, server.url);
+    }
+    request->attach(handle);
+    attempt.server = &server;
+    attempt.request = std::move(request);
+    attempt.handle = handle;
+    attempt.started = now;
+    curl_multi_add_handle(multi, handle);
+    DOH_LOG_DEBUG("Race attempt started: {} ({})", server.name, attempt.request->url());
+}
+
+inline void DoHRacer::cancel(CURLM* multi, Attempt& attempt) {
+    // 请求仍未完成即被取消：已等待的时间作为延迟下限回报
+    if (attempt.request && health_) {
+        health_->record_abandoned(attempt.server->url, std::chrono::duration_cast<std::chrono::microseconds>(
+                                                           std::chrono::steady_clock::now() - attempt.started));
+    }
+    if (attempt.handle) {
+        curl_multi_remove_handle(multi, attempt.handle);
+        curl_easy_cleanup(attempt.handle);
+        attempt.handle = nullptr;
+    }
+    attempt.request.reset();
+}
+
+#endif  // DOH_RACER_HPP
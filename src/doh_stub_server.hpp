@@ -0,0 +1,852 @@
+#ifndef DOH_STUB_SERVER_HPP
+#define DOH_STUB_SERVER_HPP
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base64url.hpp"
+#include "dns_encoder.hpp"
+#include "dns_parser.hpp"
+#include "dns_types.hpp"
+#include "dns_wire.hpp"
+#include "exceptions.hpp"
+#include "http_message.hpp"
+#include "logger.hpp"
+#include "socket_util.hpp"
+
+/**
+ * @brief 本地DoH测试服务器使用的只读区域数据
+ * @details 区域文件每行一条记录：`<name> [ttl] [IN] <type> <rdata...>`，名称必须是完整域名，
+ *          `;` 之后为注释，`$TTL <秒>` 设置后续记录的默认TTL（初始为300）。
+ *          支持 A、AAAA、CNAME、NS、PTR、MX、TXT；TXT 的每个字符串可以用双引号括起。
+ */
+class DnsZone {
+public:
+    /**
+     * @brief 查询结果
+     */
+    struct Answer {
+        int rcode = 0;                                // 0 = NOERROR，3 = NXDOMAIN
+        std::vector<const DnsWireRecord *> records;  // 含CNAME链上的记录
+    };
+
+    /**
+     * @brief 从文件加载
+     * @throws ConfigException 文件无法打开或内容格式错误
+     */
+    static DnsZone load_file(const std::string &path);
+
+    /**
+     * @brief 从流加载，追加到现有记录
+     * @throws ConfigException 格式错误，消息中包含行号
+     */
+    void load(std::istream &input, const std::string &source = "zone");
+
+    /**
+     * @brief 添加一条记录
+     * @param data 展示格式的RDATA，如 "192.0.2.1"、"10 mail.example.com."、"\"v=spf1 -all\""
+     * @throws EncodingException 名称或RDATA无效、类型不支持
+     */
+    void add(const std::string &name, DNSRecordType type, uint32_t ttl, const std::string &data);
+
+    /**
+     * @brief 按名称和类型查询，非CNAME查询会跟随CNAME链（最多8跳）
+     */
+    Answer lookup(const std::string &name, DNSRecordType type) const;
+
+    size_t size() const { return size_; }
+
+private:
+    std::unordered_map<std::string, std::vector<DnsWireRecord>> names_;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief 故障注入和监听选项
+ */
+struct StubServerOptions {
+    std::string bind_address = "127.0.0.1";
+    uint16_t port = 0;            // 0 表示由系统分配
+    int latency_ms = 0;           // 每个响应的固定延迟
+    int latency_jitter_ms = 0;    // 在固定延迟上叠加 [0, jitter] 的随机延迟
+    double error_rate = 0.0;      // 以该概率返回 error_status
+    int error_status = 503;
+    double truncate_rate = 0.0;   // 以该概率返回不含回答的截断响应（线格式置TC位，JSON置 "TC": true）
+    int max_body_size = 65535;    // POST 请求体上限
+    bool serve_dns = false;       // 同时提供明文DNS（UDP与TCP，RFC 1035 / RFC 7766）
+    uint16_t dns_port = 0;        // 明文DNS端口，UDP与TCP使用同一端口号；0 表示由系统分配
+};
+
+/**
+ * @brief 服务器计数器快照
+ */
+struct StubServerStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t injected_errors = 0;
+    uint64_t truncated = 0;
+    uint64_t bad_requests = 0;
+    uint64_t dns_queries = 0;  // 明文DNS查询数（UDP与TCP）
+};
+
+/**
+ * @brief 本地DoH测试服务器
+ * @details 在 /dns-query 上响应 RFC 8484 GET（?dns=）和 POST 请求，在 /resolve 上响应
+ *          JSON API（?name=&type=），数据来自 DnsZone。只支持明文HTTP/1.1（含keep-alive），
+ *          每个连接一个线程。延迟、错误和截断按 StubServerOptions 注入，用于离线集成测试与压测。
+ *          serve_dns 为true时另在 dns_port() 上提供明文DNS：UDP由单个线程用 recvmmsg/sendmmsg
+ *          成批收发，不注入延迟；截断只作用于UDP，超过512字节的UDP应答也置TC位（应答不回显EDNS），
+ *          客户端应改用TCP。注入的错误在明文DNS上表现为SERVFAIL。
+ */
+class DoHStubServer {
+public:
+    DoHStubServer(DnsZone zone, StubServerOptions options = {});
+    ~DoHStubServer() { stop(); }
+
+    DoHStubServer(const DoHStubServer &) = delete;
+    DoHStubServer &operator=(const DoHStubServer &) = delete;
+
+    /**
+     * @brief 绑定端口并开始接受连接
+     * @return 实际监听的端口
+     * @throws NetworkException 地址无效或绑定失败
+     */
+    uint16_t start();
+
+    /**
+     * @brief 停止接受连接并关闭所有现有连接，可重复调用
+     */
+    void stop();
+
+    uint16_t port() const { return port_; }
+
+    /**
+     * @brief 明文DNS端口（UDP与TCP），未启用 serve_dns 时为0
+     */
+    uint16_t dns_port() const { return dns_port_; }
+
+    /**
+     * @brief 指定路径的完整URL，如 http://127.0.0.1:8053/dns-query
+     */
+    std::string url(const std::string &path = "/dns-query") const;
+
+    StubServerStats stats() const;
+
+    /**
+     * @brief 处理一个请求（不注入故障），不经过套接字
+     * @param truncate 是否返回截断响应
+     */
+    HttpResponse respond(const HttpRequest &request, bool truncate = false) const;
+
+    /**
+     * @brief 根据DNS查询报文生成线格式响应
+     * @throws ParseException 查询报文格式错误
+     */
+    std::string answer_wire(std::string_view query, bool truncate, int64_t &max_age) const;
+
+    /**
+     * @brief 生成JSON API响应
+     */
+    std::string answer_json(const std::string &name, DNSRecordType type, bool truncate, int64_t &max_age) const;
+
+private:
+    void start_dns();
+    void accept_loop(int listen_fd, void (DoHStubServer::*serve)(int fd));
+    void serve_connection(int fd);
+    bool send_response(int fd, const HttpResponse &response, bool keep_alive);
+    void udp_loop();
+    void serve_dns_connection(int fd);
+    bool answer_dns(std::string_view query, bool udp, std::mt19937 &rng, std::string &response);
+
+    const DnsZone zone_;
+    const StubServerOptions options_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+
+    int dns_udp_fd_ = -1;
+    int dns_tcp_fd_ = -1;
+    uint16_t dns_port_ = 0;
+    std::thread udp_thread_;
+    std::thread dns_accept_thread_;
+
+    std::mutex mutex_;
+    std::condition_variable drained_;
+    std::unordered_set<int> connections_;
+
+    std::atomic<uint64_t> connections_total_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> injected_errors_{0};
+    std::atomic<uint64_t> truncated_{0};
+    std::atomic<uint64_t> bad_requests_{0};
+    std::atomic<uint64_t> dns_queries_{0};
+};
+
+// 实现
+namespace doh_stub_detail {
+
+// 请求头上限，超过时返回431
+constexpr size_t kMaxHeaderSize = 16 * 1024;
+
+// 跟随CNAME的最大跳数
+constexpr int kMaxCnameChain = 8;
+
+// 明文DNS：每次 recvmmsg/sendmmsg 收发的最大报文数、接收缓冲区大小、UDP应答上限（不支持EDNS时）
+constexpr size_t kDnsBatchSize = 32;
+constexpr size_t kMaxDnsDatagram = 4096;
+constexpr size_t kMaxUdpResponse = 512;
+
+}  // namespace doh_stub_detail
+
+inline DnsZone DnsZone::load_file(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw ConfigException("Cannot open zone file", path);
+    }
+    DnsZone zone;
+    zone.load(file, path);
+    return zone;
+}
+
+inline void DnsZone::load(std::istream &input, const std::string &source) {
+    using namespace dns_wire_detail;
+
+    uint32_t default_ttl = 300;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(input, line)) {
+        ++line_number;
+        try {
+            std::vector<bool> quoted;
+            std::vector<std::string> tokens = tokenize(line, &quoted);
+            if (tokens.empty()) {
+                continue;
+            }
+
+            uint64_t number = 0;
+            if (tokens[0] == "$TTL") {
+                if (tokens.size() != 2 || !parse_number(tokens[1], UINT32_MAX, number)) {
+                    throw EncodingException("Invalid $TTL directive", "zone");
+                }
+                default_ttl = static_cast<uint32_t>(number);
+                continue;
+            }
+
+            size_t pos = 1;
+            uint32_t ttl = default_ttl;
+            if (pos < tokens.size() && parse_number(tokens[pos], UINT32_MAX, number)) {
+                ttl = static_cast<uint32_t>(number);
+                ++pos;
+            }
+            if (pos < tokens.size() && lower(tokens[pos]) == "in") {
+                ++pos;
+            }
+            DNSRecordType type;
+            if (pos >= tokens.size() || !parse_record_type(tokens[pos], type)) {
+                throw EncodingException("Missing or unknown record type", "zone");
+            }
+            ++pos;
+            if (pos >= tokens.size()) {
+                throw EncodingException("Missing record data", "zone");
+            }
+
+            // 重新拼接RDATA，TXT字符串保留引号以便 add() 区分边界
+            std::string data;
+            for (size_t i = pos; i < tokens.size(); ++i) {
+                if (!data.empty()) {
+                    data.push_back(' ');
+                }
+                if (type == DNSRecordType::TXT) {
+                    data.push_back('"');
+                    for (char c : tokens[i]) {
+                        if (c == '"' || c == '\\') {
+                            data.push_back('\\');
+                        }
+                        data.push_back(c);
+                    }
+                    data.push_back('"');
+                } else {
+                    data.append(tokens[i]);
+                }
+            }
+            add(tokens[0], type, ttl, data);
+        } catch (const DoHException &e) {
+            throw ConfigException("Line " + std::to_string(line_number) + ": " + e.what(), source);
+        }
+    }
+}
+
+inline void DnsZone::add(const std::string &name, DNSRecordType type, uint32_t ttl, const std::string &data) {
+    DnsWireRecord record = make_dns_wire_record(name, type, ttl, data);
+    names_[record.name].push_back(std::move(record));
+    ++size_;
+}
+
+inline DnsZone::Answer DnsZone::lookup(const std::string &name, DNSRecordType type) const {
+    Answer answer;
+    std::string current = normalize_dns_name(name);
+    for (int hop = 0; hop <= doh_stub_detail::kMaxCnameChain; ++hop) {
+        auto it = names_.find(current);
+        if (it == names_.end()) {
+            // 只有查询名本身不存在才是NXDOMAIN，CNAME目标不在区域内时返回已有的链
+            if (hop == 0) {
+                answer.rcode = 3;
+            }
+            return answer;
+        }
+
+        const DnsWireRecord *cname = nullptr;
+        bool matched = false;
+        for (const auto &record : it->second) {
+            if (record.type == type) {
+                answer.records.push_back(&record);
+                matched = true;
+            } else if (record.type == DNSRecordType::CNAME) {
+                cname = &record;
+            }
+        }
+        if (matched || !cname) {
+            return answer;
+        }
+        answer.records.push_back(cname);
+        current = cname->data.substr(0, cname->data.size() - 1);
+    }
+    return answer;
+}
+
+inline DoHStubServer::DoHStubServer(DnsZone zone, StubServerOptions options)
+    : zone_(std::move(zone)), options_(std::move(options)) {}
+
+inline uint16_t DoHStubServer::start() {
+    if (running_) {
+        return port_;
+    }
+
+    int fd = bind_socket(options_.bind_address, options_.port, SOCK_STREAM);
+    if (fd < 0) {
+        int error = errno;
+        throw NetworkException(std::string("Failed to listen: ") + std::strerror(error), error,
+                               options_.bind_address + ":" + std::to_string(options_.port));
+    }
+    listen_fd_ = fd;
+    port_ = bound_port(fd);
+    if (options_.serve_dns) {
+        try {
+            start_dns();
+        } catch (...) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+            throw;
+        }
+    }
+
+    running_ = true;
+    accept_thread_ = std::thread(&DoHStubServer::accept_loop, this, listen_fd_, &DoHStubServer::serve_connection);
+    if (options_.serve_dns) {
+        udp_thread_ = std::thread(&DoHStubServer::udp_loop, this);
+        dns_accept_thread_ =
+            std::thread(&DoHStubServer::accept_loop, this, dns_tcp_fd_, &DoHStubServer::serve_dns_connection);
+        Logger::info("DoH stub server serving plain DNS on {} port {} (UDP/TCP)", options_.bind_address, dns_port_);
+    }
+    Logger::info("DoH stub server listening on {} ({} records)", url(""), zone_.size());
+    return port_;
+}
+
+inline void DoHStubServer::start_dns() {
+    // UDP与TCP需要同一端口号：系统分配端口时先绑UDP，再在同一端口上监听TCP，被占用则重试
+    int error = 0;
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        int udp = bind_socket(options_.bind_address, options_.dns_port, SOCK_DGRAM);
+        if (udp < 0) {
+            error = errno;
+            break;
+        }
+        uint16_t port = bound_port(udp);
+        int tcp = bind_socket(options_.bind_address, port, SOCK_STREAM);
+        if (tcp >= 0) {
+            // 接收超时使UDP线程定期检查 running_
+            timeval tick{0, 100 * 1000};
+            setsockopt(udp, SOL_SOCKET, SO_RCVTIMEO, &tick, sizeof(tick));
+            dns_udp_fd_ = udp;
+            dns_tcp_fd_ = tcp;
+            dns_port_ = port;
+            return;
+        }
+        error = errno;
+        close(udp);
+        if (options_.dns_port != 0 || error != EADDRINUSE) {
+            break;
+        }
+    }
+    throw NetworkException(std::string("Failed to bind DNS port: ") + std::strerror(error), error,
+                           options_.bind_address + ":" + std::to_string(options_.dns_port));
+}
+
+inline void DoHStubServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    // shutdown 使阻塞的 accept 返回
+    shutdown(listen_fd_, SHUT_RDWR);
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    close(listen_fd_);
+    listen_fd_ = -1;
+
+    if (dns_tcp_fd_ >= 0) {
+        shutdown(dns_tcp_fd_, SHUT_RDWR);
+        shutdown(dns_udp_fd_, SHUT_RDWR);
+        dns_accept_thread_.join();
+        udp_thread_.join();
+        close(dns_tcp_fd_);
+        close(dns_udp_fd_);
+        dns_tcp_fd_ = -1;
+        dns_udp_fd_ = -1;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int fd : connections_) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    drained_.wait(lock, [this] { return connections_.empty(); });
+}
+
+inline std::string DoHStubServer::url(const std::string &path) const {
+    std::string host = options_.bind_address;
+    if (host == "0.0.0.0") {
+        host = "127.0.0.1";
+    } else if (host == "::") {
+        host = "[::1]";
+    } else if (host.find(':') != std::string::npos) {
+        host = "[" + host + "]";
+    }
+    return "http://" + host + ":" + std::to_string(port_) + path;
+}
+
+inline StubServerStats DoHStubServer::stats() const {
+    StubServerStats stats;
+    stats.connections = connections_total_.load();
+    stats.requests = requests_.load();
+    stats.injected_errors = injected_errors_.load();
+    stats.truncated = truncated_.load();
+    stats.bad_requests = bad_requests_.load();
+    stats.dns_queries = dns_queries_.load();
+    return stats;
+}
+
+inline std::string DoHStubServer::answer_wire(std::string_view query, bool truncate, int64_t &max_age) const {
+    DnsMessageParser parser(query);
+    DnsQuestionView question;
+    if (parser.header().is_response() || parser.header().qdcount != 1 || !parser.next_question(question)) {
+        throw ParseException("Expected a query with exactly one question", "dns");
+    }
+
+    DnsZone::Answer answer;
+    if (!truncate) {
+        answer = zone_.lookup(question.name.to_string(), static_cast<DNSRecordType>(question.type));
+    }
+    return build_dns_response(query, answer.rcode, answer.records, truncate, true, max_age);
+}
+
+inline std::string DoHStubServer::answer_json(const std::string &name, DNSRecordType type, bool truncate,
+                                              int64_t &max_age) const {
+    DnsZone::Answer answer;
+    if (!truncate) {
+        answer = zone_.lookup(name, type);
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    auto write_name = [&writer](const std::string &value) {
+        std::string fqdn = value + ".";
+        writer.String(fqdn.c_str(), static_cast<rapidjson::SizeType>(fqdn.size()));
+    };
+
+    writer.StartObject();
+    writer.Key("Status");
+    writer.Int(answer.rcode);
+    writer.Key("TC");
+    writer.Bool(truncate);
+    writer.Key("RD");
+    writer.Bool(true);
+    writer.Key("RA");
+    writer.Bool(true);
+    writer.Key("AD");
+    writer.Bool(false);
+    writer.Key("CD");
+    writer.Bool(false);
+    writer.Key("Question");
+    writer.StartArray();
+    writer.StartObject();
+    writer.Key("name");
+    write_name(normalize_dns_name(name));
+    writer.Key("type");
+    writer.Int(static_cast<int>(type));
+    writer.EndObject();
+    writer.EndArray();
+
+    max_age = -1;
+    if (!answer.records.empty()) {
+        writer.Key("Answer");
+        writer.StartArray();
+        for (const DnsWireRecord *record : answer.records) {
+            writer.StartObject();
+            writer.Key("name");
+            write_name(record->name);
+            writer.Key("type");
+            writer.Int(static_cast<int>(record->type));
+            writer.Key("TTL");
+            writer.Uint(record->ttl);
+            writer.Key("data");
+            writer.String(record->data.c_str(), static_cast<rapidjson::SizeType>(record->data.size()));
+            writer.EndObject();
+            max_age = max_age < 0 ? record->ttl : std::min<int64_t>(max_age, record->ttl);
+        }
+        writer.EndArray();
+    }
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+inline HttpResponse DoHStubServer::respond(const HttpRequest &request, bool truncate) const {
+    using dns_wire_detail::parse_number;
+    using http_detail::query_param;
+
+    HttpResponse response;
+    try {
+        if (request.path == "/dns-query") {
+            std::string message;
+            if (!dns_message_from_request(request, message, response)) {
+                return response;
+            }
+            response.content_type = "application/dns-message";
+            response.body = answer_wire(message, truncate, response.max_age);
+            return response;
+        }
+
+        if (request.path == "/resolve") {
+            if (request.method != "GET") {
+                return plain_http_response(405, "Method not allowed");
+            }
+            std::string name;
+            std::string type_text = "1";
+            if (!query_param(request.query, "name", name) || name.empty()) {
+                return plain_http_response(400, "Missing name parameter");
+            }
+            query_param(request.query, "type", type_text);
+            DNSRecordType type;
+            uint64_t number = 0;
+            if (parse_number(type_text, UINT16_MAX, number)) {
+                type = static_cast<DNSRecordType>(number);
+            } else if (!parse_record_type(type_text, type)) {
+                return plain_http_response(400, "Invalid type parameter");
+            }
+            response.content_type = "application/dns-json";
+            response.body = answer_json(name, type, truncate, response.max_age);
+            return response;
+        }
+    } catch (const DoHException &e) {
+        return plain_http_response(400, e.what());
+    }
+    return plain_http_response(404, "Not found");
+}
+
+inline void DoHStubServer::accept_loop(int listen_fd, void (DoHStubServer::*serve)(int fd)) {
+    while (running_) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            close(fd);
+            break;
+        }
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        connections_.insert(fd);
+        ++connections_total_;
+        std::thread([this, fd, serve] {
+            (this->*serve)(fd);
+            close(fd);
+            std::lock_guard<std::mutex> guard(mutex_);
+            connections_.erase(fd);
+            drained_.notify_all();
+        }).detach();
+    }
+}
+
+inline void DoHStubServer::serve_connection(int fd) {
+    using namespace doh_stub_detail;
+
+    // 空闲连接30秒后关闭
+    timeval idle{30, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+
+    std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::string buffer;
+    char chunk[4096];
+
+    auto fill = [&]() {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+        return true;
+    };
+
+    while (running_) {
+        size_t header_end;
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (buffer.size() > kMaxHeaderSize) {
+                ++bad_requests_;
+                send_response(fd, plain_http_response(431, "Request header too large"), false);
+                return;
+            }
+            if (!fill()) {
+                return;
+            }
+        }
+
+        // 请求行与请求头
+        HttpRequest request;
+        size_t content_length = 0;
+        bool keep_alive = false;
+        if (!parse_http_request_head(buffer.substr(0, header_end), request, content_length, keep_alive)) {
+            ++bad_requests_;
+            send_response(fd, plain_http_response(400, "Malformed request"), false);
+            return;
+        }
+        if (content_length > static_cast<size_t>(options_.max_body_size)) {
+            ++bad_requests_;
+            send_response(fd, plain_http_response(413, "Request body too large"), false);
+            return;
+        }
+
+        size_t body_start = header_end + 4;
+        while (buffer.size() < body_start + content_length) {
+            if (!fill()) {
+                return;
+            }
+        }
+        request.body = buffer.substr(body_start, content_length);
+        buffer.erase(0, body_start + content_length);
+        ++requests_;
+
+        // 故障注入：先延迟，再按概率返回错误或截断
+        int delay = options_.latency_ms;
+        if (options_.latency_jitter_ms > 0) {
+            delay += std::uniform_int_distribution<int>(0, options_.latency_jitter_ms)(rng);
+        }
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+
+        HttpResponse response;
+        if (options_.error_rate > 0 && chance(rng) < options_.error_rate) {
+            ++injected_errors_;
+            response = plain_http_response(options_.error_status, "Injected error");
+        } else {
+            bool truncate = options_.truncate_rate > 0 && chance(rng) < options_.truncate_rate;
+            if (truncate) {
+                ++truncated_;
+            }
+            response = respond(request, truncate);
+            if (response.status == 400) {
+                ++bad_requests_;
+            }
+        }
+        DOH_LOG_TRACE("Stub {} {} -> {}", request.method, request.path, response.status);
+
+        if (!send_response(fd, response, keep_alive) || !keep_alive) {
+            return;
+        }
+    }
+}
+
+inline bool DoHStubServer::send_response(int fd, const HttpResponse &response, bool keep_alive) {
+    std::string out = format_http_response(response, keep_alive);
+    return send_all(fd, out.data(), out.size());
+}
+
+inline bool DoHStubServer::answer_dns(std::string_view query, bool udp, std::mt19937 &rng, std::string &response) {
+    using namespace doh_stub_detail;
+
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    ++dns_queries_;
+    try {
+        int64_t max_age = 0;
+        if (options_.error_rate > 0 && chance(rng) < options_.error_rate) {
+            // 以不含回答的应答为基础，清除TC位并置 RCODE=SERVFAIL
+            ++injected_errors_;
+            response = answer_wire(query, true, max_age);
+            response[2] = static_cast<char>(response[2] & ~0x02);
+            response[3] = static_cast<char>((response[3] & 0xF0) | 2);
+            return true;
+        }
+        bool truncate = udp && options_.truncate_rate > 0 && chance(rng) < options_.truncate_rate;
+        response = answer_wire(query, truncate, max_age);
+        if (udp && !truncate && response.size() > kMaxUdpResponse) {
+            truncate = true;
+            response = answer_wire(query, true, max_age);
+        }
+        if (truncate) {
+            ++truncated_;
+        }
+        return true;
+    } catch (const DoHException &e) {
+        // 格式错误的查询不应答
+        ++bad_requests_;
+        DOH_LOG_TRACE("Stub dropped malformed DNS query: {}", e.what());
+        return false;
+    }
+}
+
+inline void DoHStubServer::udp_loop() {
+    using namespace doh_stub_detail;
+
+    std::mt19937 rng(std::random_device{}());
+    std::vector<char> buffers(kDnsBatchSize * kMaxDnsDatagram);
+    std::vector<std::string> responses(kDnsBatchSize);
+    sockaddr_storage peers[kDnsBatchSize];
+#ifdef __linux__
+    // 一次系统调用收取多个查询、发出多个应答，避免逐个报文的系统调用开销
+    mmsghdr in[kDnsBatchSize];
+    mmsghdr out[kDnsBatchSize];
+    iovec in_iov[kDnsBatchSize];
+    iovec out_iov[kDnsBatchSize];
+    while (running_) {
+        for (size_t i = 0; i < kDnsBatchSize; ++i) {
+            in_iov[i] = {buffers.data() + i * kMaxDnsDatagram, kMaxDnsDatagram};
+            in[i] = {};
+            in[i].msg_hdr.msg_name = &peers[i];
+            in[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+            in[i].msg_hdr.msg_iov = &in_iov[i];
+            in[i].msg_hdr.msg_iovlen = 1;
+        }
+        // MSG_WAITFORONE：阻塞到第一个报文，之后只取已到达的
+        int received = recvmmsg(dns_udp_fd_, in, kDnsBatchSize, MSG_WAITFORONE, nullptr);
+        if (received <= 0) {
+            continue;
+        }
+
+        unsigned int count = 0;
+        for (int i = 0; i < received; ++i) {
+            if (in[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                ++bad_requests_;
+                continue;
+            }
+            std::string_view query(buffers.data() + i * kMaxDnsDatagram, in[i].msg_len);
+            if (!answer_dns(query, true, rng, responses[count])) {
+                continue;
+            }
+            out_iov[count] = {responses[count].data(), responses[count].size()};
+            out[count] = {};
+            out[count].msg_hdr.msg_name = &peers[i];
+            out[count].msg_hdr.msg_namelen = in[i].msg_hdr.msg_namelen;
+            out[count].msg_hdr.msg_iov = &out_iov[count];
+            out[count].msg_hdr.msg_iovlen = 1;
+            ++count;
+        }
+        // UDP不保证送达，发送失败的应答直接丢弃
+        for (unsigned int sent = 0; sent < count;) {
+            int n = sendmmsg(dns_udp_fd_, out + sent, count - sent, 0);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<unsigned int>(n);
+        }
+    }
+#else
+    while (running_) {
+        socklen_t peer_length = sizeof(peers[0]);
+        ssize_t n = recvfrom(dns_udp_fd_, buffers.data(), kMaxDnsDatagram, 0, reinterpret_cast<sockaddr *>(&peers[0]),
+                             &peer_length);
+        if (n <= 0) {
+            continue;
+        }
+        if (answer_dns(std::string_view(buffers.data(), static_cast<size_t>(n)), true, rng, responses[0])) {
+            sendto(dns_udp_fd_, responses[0].data(), responses[0].size(), 0,
+                   reinterpret_cast<sockaddr *>(&peers[0]), peer_length);
+        }
+    }
+#endif
+}
+
+inline void DoHStubServer::serve_dns_connection(int fd) {
+    // 空闲连接30秒后关闭
+    timeval idle{30, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+
+    std::mt19937 rng(std::random_device{}());
+    std::string query;
+    std::string response;
+    // 每个报文前有2字节长度（RFC 1035 4.2.2），同一连接上可以连续查询
+    while (running_) {
+        unsigned char prefix[2];
+        if (!recv_exact(fd, reinterpret_cast<char *>(prefix), 2)) {
+            return;
+        }
+        query.resize(static_cast<size_t>(prefix[0]) << 8 | prefix[1]);
+        if (!recv_exact(fd, &query[0], query.size())) {
+            return;
+        }
+
+        int delay = options_.latency_ms;
+        if (options_.latency_jitter_ms > 0) {
+            delay += std::uniform_int_distribution<int>(0, options_.latency_jitter_ms)(rng);
+        }
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+
+        if (!answer_dns(query, false, rng, response)) {
+            return;
+        }
+        std::string out;
+        out.reserve(2 + response.size());
+        dns_wire_detail::append_u16(out, static_cast<uint16_t>(response.size()));
+        out.append(response);
+        if (!send_all(fd, out.data(), out.size())) {
+            return;
+        }
+    }
+}
+
+#endif  // DOH_STUB_SERVER_HPP
@@ -0,0 +1,208 @@
+#ifndef DUAL_STACK_HPP
+#define DUAL_STACK_HPP
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dns_cache.hpp"
+#include "doh_async_client.hpp"
+#include "doh_client.hpp"
+#include "logger.hpp"
+#include "system_resolver.hpp"
+
+/**
+ * @brief 地址记录在 RFC 6724 默认策略表中的优先级（越大越优先）
+ * @details IPv4 地址按 ::ffff:0:0/96 计为35；非 A/AAAA 记录或无法解析的地址返回-1
+ */
+inline int address_precedence(const DNSRecord &record) {
+    if (record.type == DNSRecordType::A) {
+        in_addr addr;
+        return inet_pton(AF_INET, record.data.c_str(), &addr) == 1 ? 35 : -1;
+    }
+    if (record.type != DNSRecordType::AAAA) {
+        return -1;
+    }
+    in6_addr addr;
+    if (inet_pton(AF_INET6, record.data.c_str(), &addr) != 1) {
+        return -1;
+    }
+    const uint8_t *b = addr.s6_addr;
+    static const uint8_t kLoopback[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    static const uint8_t kMappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    static const uint8_t kZero[12] = {};
+
+    if (std::memcmp(b, kLoopback, 16) == 0) {
+        return 50;  // ::1/128
+    }
+    if (std::memcmp(b, kMappedPrefix, 12) == 0) {
+        return 35;  // ::ffff:0:0/96
+    }
+    if (b[0] == 0x20 && b[1] == 0x02) {
+        return 30;  // 2002::/16 6to4
+    }
+    if (b[0] == 0x20 && b[1] == 0x01 && b[2] == 0 && b[3] == 0) {
+        return 5;  // 2001::/32 Teredo
+    }
+    if ((b[0] & 0xfe) == 0xfc) {
+        return 3;  // fc00::/7 ULA
+    }
+    if (std::memcmp(b, kZero, 12) == 0 || (b[0] == 0xfe && (b[1] & 0xc0) == 0xc0) ||
+        (b[0] == 0x3f && b[1] == 0xfe)) {
+        return 1;  // ::/96、fec0::/10、3ffe::/16（已废弃）
+    }
+    return 40;  // ::/0
+}
+
+/**
+ * @brief 合并A与AAAA应答，按 RFC 6724 规则6（策略表优先级）排序
+ * @details 只保留地址记录并去重；优先级相同的地址保持应答中的原始顺序。
+ *          没有本地源地址信息，因此不应用依赖源地址的规则（1~5、7、8）
+ */
+inline std::vector<DNSRecord> merge_dual_stack(const std::vector<DNSRecord> &ipv4,
+                                               const std::vector<DNSRecord> &ipv6) {
+    std::vector<DNSRecord> merged;
+    merged.reserve(ipv4.size() + ipv6.size());
+    for (const auto *records : {&ipv6, &ipv4}) {
+        for (const auto &record : *records) {
+            if (address_precedence(record) < 0) {
+                continue;
+            }
+            bool duplicate = std::any_of(merged.begin(), merged.end(), [&](const DNSRecord &existing) {
+                return existing.type == record.type && existing.data == record.data;
+            });
+            if (!duplicate) {
+                merged.push_back(record);
+            }
+        }
+    }
+    std::stable_sort(merged.begin(), merged.end(), [](const DNSRecord &a, const DNSRecord &b) {
+        return address_precedence(a) > address_precedence(b);
+    });
+    return merged;
+}
+
+/**
+ * @brief 双栈地址解析
+ * @details A 与 AAAA 查询同时提交到 AsyncDoHClient，耗时约等于较慢的单个查询而不是两者之和。
+ *          某一族查询失败时仍返回另一族的结果；两族都没有结果且启用回退时，
+ *          用一次 getaddrinfo(AF_UNSPEC) 同时解析两族地址，最多等待 fallback_timeout。结果按 merge_dual_stack 排序。
+ */
+class DualStackResolver {
+public:
+    /**
+     * @brief 构造函数
+     * @param client 异步客户端，生命周期必须长于解析器
+     * @param method 查询使用的DoH方法
+     * @param enable_fallback DoH没有结果时是否回退到系统DNS
+     */
+    explicit DualStackResolver(AsyncDoHClient &client, DoHMethod method = DoHMethod::GET,
+                               bool enable_fallback = true)
+        : client_(client), method_(method), enable_fallback_(enable_fallback) {}
+
+    /**
+     * @brief 设置解析结果缓存，两族分别按 (domain, A) 与 (domain, AAAA) 缓存
+     */
+    void set_cache(std::shared_ptr<DnsCache> cache) { cache_ = std::move(cache); }
+
+    /**
+     * @brief 设置系统DNS回退的超时
+     */
+    void set_fallback_timeout(std::chrono::milliseconds timeout) { fallback_timeout_ = timeout; }
+
+    /**
+     * @brief 解析域名的全部地址（阻塞）
+     */
+    std::vector<DNSRecord> resolve(const std::string &domain);
+
+    /**
+     * @brief 只使用系统解析器的双栈解析
+     * @details 在 SystemDnsResolver 的工作线程上执行，最多等待 timeout，超时返回空结果
+     */
+    static std::vector<DNSRecord> resolve_system(const std::string &domain,
+                                                 std::chrono::milliseconds timeout = std::chrono::milliseconds(3500)) {
+        auto records = SystemDnsResolver::instance().resolve(domain, AF_UNSPEC, timeout);
+        return merge_dual_stack(records, {});
+    }
+
+private:
+    // 一族地址的查询：缓存命中时不发起请求
+    struct Lookup {
+        DNSRecordType type;
+        std::vector<DNSRecord> records;
+        std::future<std::vector<DNSRecord>> pending;
+        bool cached = false;
+    };
+
+    void start(const std::string &domain, Lookup &lookup);
+    void collect(const std::string &domain, Lookup &lookup);
+
+    AsyncDoHClient &client_;
+    DoHMethod method_;
+    bool enable_fallback_;
+    std::chrono::milliseconds fallback_timeout_{3500};
+    std::shared_ptr<DnsCache> cache_;
+};
+
+// 实现
+inline std::vector<DNSRecord> DualStackResolver::resolve(const std::string &domain) {
+    Lookup ipv4{DNSRecordType::A, {}, {}, false};
+    Lookup ipv6{DNSRecordType::AAAA, {}, {}, false};
+    // 两个查询都提交后再等待，使它们在事件循环中并发进行
+    start(domain, ipv4);
+    start(domain, ipv6);
+    collect(domain, ipv4);
+    collect(domain, ipv6);
+
+    if (ipv4.records.empty() && ipv6.records.empty() && enable_fallback_) {
+        DOH_LOG_DEBUG("DoH returned no addresses for {}, trying system DNS", domain);
+        DoHMetrics::instance().fallbacks.inc();
+        auto records = SystemDnsResolver::instance().resolve(domain, AF_UNSPEC, fallback_timeout_);
+        if (cache_) {
+            for (auto *lookup : {&ipv4, &ipv6}) {
+                std::vector<DNSRecord> family;
+                std::copy_if(records.begin(), records.end(), std::back_inserter(family),
+                             [&](const DNSRecord &record) { return record.type == lookup->type; });
+                if (!family.empty()) {
+                    cache_->put(domain, lookup->type, family, cache_->default_ttl());
+                }
+            }
+        }
+        return merge_dual_stack(records, {});
+    }
+    return merge_dual_stack(ipv4.records, ipv6.records);
+}
+
+inline void DualStackResolver::start(const std::string &domain, Lookup &lookup) {
+    if (cache_ && cache_->get(domain, lookup.type, lookup.records)) {
+        lookup.cached = true;
+        return;
+    }
+    lookup.pending = client_.query(domain, lookup.type, method_);
+}
+
+inline void DualStackResolver::collect(const std::string &domain, Lookup &lookup) {
+    if (lookup.cached) {
+        return;
+    }
+    try {
+        lookup.records = lookup.pending.get();
+    } catch (const std::exception &e) {
+        DOH_LOG_DEBUG("{} query for {} failed: {}", record_type_name(lookup.type), domain, e.what());
+        return;
+    }
+    if (cache_ && !lookup.records.empty()) {
+        cache_->put(domain, lookup.type, lookup.records);
+    }
+}
+
+#endif  // DUAL_STACK_HPP
@@ -0,0 +1,222 @@
+#ifndef HTTP_MESSAGE_HPP
+#define HTTP_MESSAGE_HPP
+
+#include <cctype>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "base64url.hpp"
+#include "dns_wire.hpp"
+
+/**
+ * @brief 解析后的HTTP请求
+ */
+struct HttpRequest {
+    std::string method;  // GET / POST
+    std::string path;    // 不含查询串
+    std::string query;   // '?' 之后的部分
+    std::string body;
+};
+
+/**
+ * @brief 待发送的HTTP响应
+ */
+struct HttpResponse {
+    int status = 200;
+    std::string content_type = "text/plain";
+    std::string body;
+    int64_t max_age = -1;  // Cache-Control: max-age，负数表示不发送
+};
+
+/**
+ * @brief 解析HTTP请求行与请求头（不含结尾的空行）
+ * @param content_length 输出 Content-Length，未指定时为0
+ * @param keep_alive 输出连接是否保持（HTTP/1.1默认保持，按 Connection 头调整）
+ * @return 请求行或 Content-Length 格式错误时返回false
+ */
+inline bool parse_http_request_head(const std::string &head, HttpRequest &request, size_t &content_length,
+                                    bool &keep_alive);
+
+/**
+ * @brief 格式化HTTP/1.1响应（状态行、响应头与响应体）
+ */
+inline std::string format_http_response(const HttpResponse &response, bool keep_alive);
+
+/**
+ * @brief 从 RFC 8484 请求中取出DNS查询报文：GET 取 ?dns= 参数（Base64URL），POST 取请求体
+ * @param error 失败时写入应返回的 400/405 响应
+ */
+inline bool dns_message_from_request(const HttpRequest &request, std::string &message,
+                                     HttpResponse &error);
+
+
+// 实现
+namespace http_detail {
+
+// 百分号解码查询参数
+inline std::string url_decode(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out.push_back(static_cast<char>(std::stoi(std::string(text.substr(i + 1, 2)), nullptr, 16)));
+            i += 2;
+        } else if (text[i] == '+') {
+            out.push_back(' ');
+        } else {
+            out.push_back(text[i]);
+        }
+    }
+    return out;
+}
+
+// 查询串中 key 对应的值，不存在时返回false
+inline bool query_param(std::string_view query, std::string_view key, std::string &value) {
+    while (!query.empty()) {
+        size_t amp = query.find('&');
+        std::string_view pair = query.substr(0, amp);
+        size_t eq = pair.find('=');
+        if (pair.substr(0, eq) == key) {
+            value = eq == std::string_view::npos ? std::string() : url_decode(pair.substr(eq + 1));
+            return true;
+        }
+        if (amp == std::string_view::npos) {
+            break;
+        }
+        query.remove_prefix(amp + 1);
+    }
+    return false;
+}
+
+inline const char *status_text(int status) {
+    switch (status) {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 413:
+            return "Payload Too Large";
+        case 415:
+            return "Unsupported Media Type";
+        case 429:
+            return "Too Many Requests";
+        case 431:
+            return "Request Header Fields Too Large";
+        case 500:
+            return "Internal Server Error";
+        case 502:
+            return "Bad Gateway";
+        case 503:
+            return "Service Unavailable";
+        case 504:
+            return "Gateway Timeout";
+        default:
+            return "Unknown";
+    }
+}
+
+}  // namespace http_detail
+
+/**
+ * @brief 纯文本响应，正文为 message 加换行
+ */
+inline HttpResponse plain_http_response(int status, const std::string &message) {
+    HttpResponse response;
+    response.status = status;
+    response.body = message + "\n";
+    return response;
+}
+
+inline bool parse_http_request_head(const std::string &head, HttpRequest &request, size_t &content_length,
+                                    bool &keep_alive) {
+    using dns_wire_detail::lower;
+    using dns_wire_detail::parse_number;
+
+    std::istringstream input(head);
+    std::string line;
+    std::getline(input, line);
+    std::istringstream request_line(line);
+    std::string target;
+    std::string version;
+    request_line >> request.method >> target >> version;
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    if (question != std::string::npos) {
+        request.query = target.substr(question + 1);
+    }
+
+    keep_alive = version == "HTTP/1.1";
+    content_length = 0;
+    bool bad_length = false;
+    while (std::getline(input, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = lower(line.substr(0, colon));
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        if (key == "content-length") {
+            uint64_t number = 0;
+            bad_length = !parse_number(value, UINT32_MAX, number);
+            content_length = static_cast<size_t>(number);
+        } else if (key == "connection") {
+            std::string token = lower(value);
+            if (token == "close") {
+                keep_alive = false;
+            } else if (token == "keep-alive") {
+                keep_alive = true;
+            }
+        }
+    }
+    return !request.method.empty() && version.rfind("HTTP/1.", 0) == 0 && !bad_length;
+}
+
+inline std::string format_http_response(const HttpResponse &response, bool keep_alive) {
+    std::string out;
+    out.reserve(160 + response.body.size());
+    out.append("HTTP/1.1 ")
+        .append(std::to_string(response.status))
+        .append(" ")
+        .append(http_detail::status_text(response.status))
+        .append("\r\nContent-Type: ")
+        .append(response.content_type)
+        .append("\r\nContent-Length: ")
+        .append(std::to_string(response.body.size()));
+    if (response.max_age >= 0) {
+        out.append("\r\nCache-Control: max-age=").append(std::to_string(response.max_age));
+    }
+    out.append(keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+    out.append(response.body);
+    return out;
+}
+
+inline bool dns_message_from_request(const HttpRequest &request, std::string &message, HttpResponse &error) {
+    if (request.method == "GET") {
+        std::string encoded;
+        if (!http_detail::query_param(request.query, "dns", encoded) || !base64url_decode(encoded, message)) {
+            error = plain_http_response(400, "Missing or invalid dns parameter");
+            return false;
+        }
+        return true;
+    }
+    if (request.method == "POST") {
+        message = request.body;
+        return true;
+    }
+    error = plain_http_response(405, "Method not allowed");
+    return false;
+}
+
+
+#endif  // HTTP_MESSAGE_HPP
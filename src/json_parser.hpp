@@ -0,0 +1,194 @@
+#ifndef JSON_PARSER_HPP
+#define JSON_PARSER_HPP
+
+#include <rapidjson/error/en.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dns_types.hpp"
+#include "exceptions.hpp"
+
+/**
+ * @brief JSON API（application/dns-json）响应中关心的部分
+ */
+struct DnsJsonResponse {
+    int status = -1;                 // Status 字段（DNS RCODE），缺失时为-1
+    std::vector<DNSRecord> answers;  // Answer 数组
+};
+
+/**
+ * @brief 提取 Status 和 Answer 的 RapidJSON SAX 处理器
+ * @details 不构建DOM，只在根对象的 Status 与 Answer 数组元素的 name/type/TTL/data 上取值，
+ *          其余字段（Question、Authority、Comment 等）只做语法校验后丢弃。
+ *          data 的展示格式在记录对象结束时确定，因为 type 可能出现在 data 之后。
+ */
+class DnsJsonHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, DnsJsonHandler> {
+public:
+    explicit DnsJsonHandler(DnsJsonResponse &response) : response_(response) {}
+
+    // 未关心的值；根必须是对象，根上出现其他值时终止解析
+    bool Default() {
+        pending_ = Field::None;
+        return depth_ > 0;
+    }
+
+    bool Int(int value) {
+        if (pending_ == Field::Status) {
+            response_.status = value;
+        } else if (pending_ == Field::Type) {
+            record_.type = static_cast<DNSRecordType>(value);
+        }
+        return Default();
+    }
+
+    bool Uint(unsigned value) {
+        if (pending_ == Field::Status || pending_ == Field::Type) {
+            return value <= static_cast<unsigned>(INT_MAX) ? Int(static_cast<int>(value)) : Default();
+        }
+        if (pending_ == Field::Ttl) {
+            record_.ttl = value;
+        }
+        return Default();
+    }
+
+    bool String(const char *str, rapidjson::SizeType length, bool) {
+        if (pending_ == Field::Name) {
+            record_.name.assign(str, length);
+        } else if (pending_ == Field::Data) {
+            record_.data.assign(str, length);
+            has_data_ = true;
+        }
+        return Default();
+    }
+
+    bool StartObject() {
+        if (in_answer_ && depth_ == 2) {
+            record_ = DNSRecord{};
+            has_data_ = false;
+        }
+        ++depth_;
+        return Default();
+    }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool) {
+        pending_ = Field::None;
+        if (depth_ == 1) {
+            if (equals(str, length, "Status")) {
+                pending_ = Field::Status;
+            } else if (equals(str, length, "Answer")) {
+                pending_ = Field::Answer;
+            }
+        } else if (in_answer_ && depth_ == 3) {
+            if (equals(str, length, "name")) {
+                pending_ = Field::Name;
+            } else if (equals(str, length, "type")) {
+                pending_ = Field::Type;
+            } else if (equals(str, length, "TTL")) {
+                pending_ = Field::Ttl;
+            } else if (equals(str, length, "data")) {
+                pending_ = Field::Data;
+            }
+        }
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        --depth_;
+        if (in_answer_ && depth_ == 2) {
+            finish_record();
+        }
+        return true;
+    }
+
+    bool StartArray() {
+        if (depth_ == 0) {
+            return false;
+        }
+        if (depth_ == 1 && pending_ == Field::Answer) {
+            in_answer_ = true;
+        }
+        ++depth_;
+        return Default();
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        --depth_;
+        if (in_answer_ && depth_ == 1) {
+            in_answer_ = false;
+        }
+        return true;
+    }
+
+private:
+    enum class Field { None, Status, Answer, Name, Type, Ttl, Data };
+
+    static bool equals(const char *str, rapidjson::SizeType length, const char *literal) {
+        return length == std::strlen(literal) && std::memcmp(str, literal, length) == 0;
+    }
+
+    void finish_record() {
+        if (has_data_) {
+            switch (record_.type) {
+                case DNSRecordType::A:
+                case DNSRecordType::AAAA:
+                    break;
+                case DNSRecordType::CNAME:
+                case DNSRecordType::NS:
+                    // 移除末尾的点号(如果有)
+                    if (!record_.data.empty() && record_.data.back() == '.') {
+                        record_.data.pop_back();
+                    }
+                    break;
+                default: {
+                    // 其他类型保留JSON字符串形式（带引号和转义）
+                    rapidjson::StringBuffer buffer;
+                    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                    writer.String(record_.data.data(), static_cast<rapidjson::SizeType>(record_.data.size()));
+                    record_.data.assign(buffer.GetString(), buffer.GetSize());
+                    break;
+                }
+            }
+        }
+        response_.answers.push_back(std::move(record_));
+    }
+
+    DnsJsonResponse &response_;
+    DNSRecord record_{};
+    Field pending_ = Field::None;
+    int depth_ = 0;
+    bool in_answer_ = false;
+    bool has_data_ = false;
+};
+
+/**
+ * @brief 流式解析JSON API响应
+ * @param data 响应正文，不要求以'\0'结尾
+ * @param length 正文长度
+ * @details JSON语法错误或根不是对象时抛出 ParseException
+ */
+inline DnsJsonResponse parse_dns_json(const char *data, size_t length) {
+    DnsJsonResponse response;
+    DnsJsonHandler handler(response);
+    rapidjson::MemoryStream stream(data, length);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse(stream, handler);
+    if (result.Code() == rapidjson::kParseErrorTermination) {
+        throw ParseException("JSON response is not an object", "json");
+    }
+    if (result.IsError()) {
+        throw ParseException(std::string("Invalid JSON response: ") + rapidjson::GetParseError_En(result.Code()) +
+                                 " at offset " + std::to_string(result.Offset()),
+                             "json");
+    }
+    return response;
+}
+
+#endif  // JSON_PARSER_HPP
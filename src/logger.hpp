@@ -2,22 +2,48 @@
 #define LOGGER_HPP
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
+#include <spdlog/details/thread_pool.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <atomic>
+#include <iostream>
 #include <memory>
 #include <string>
 #include <filesystem>
 
+/**
+ * @brief 编译期最低日志级别（取值为 SPDLOG_LEVEL_TRACE ... SPDLOG_LEVEL_OFF）
+ * @details 低于该级别的 DOH_LOG_* 调用在预处理阶段即被删除，Logger 的对应方法也不再格式化。
+ *          未指定时Release构建（定义了NDEBUG）保留info及以上，其余构建保留全部级别；
+ *          同一程序的所有翻译单元必须使用相同的值
+ */
+#ifndef DOH_LOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define DOH_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#else
+#define DOH_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+#endif
+
 /**
  * @brief 日志管理器类
- * @details 提供结构化日志功能，支持控制台和文件输出
+ * @details 提供结构化日志功能，支持控制台和文件输出。格式串在编译期检查；调用前先比较级别，
+ *          未启用的级别直接返回，不做任何格式化。启用异步模式时，调用线程只把格式化好的消息
+ *          放入有界队列（不超过250字节的消息不分配内存），由后台线程写入控制台和文件
  */
 class Logger {
 private:
-    static std::shared_ptr<spdlog::logger> console_logger_;
-    static std::shared_ptr<spdlog::logger> file_logger_;
-    static bool initialized_;
+    static inline std::shared_ptr<spdlog::logger> console_logger_ = nullptr;
+    static inline std::shared_ptr<spdlog::logger> file_logger_ = nullptr;
+    static inline std::shared_ptr<spdlog::details::thread_pool> thread_pool_ = nullptr;
+    static inline bool block_on_overflow_ = false;
+    static inline bool initialized_ = false;
+    // 当前生效的最低级别，未初始化时为off，所有级别都被跳过
+    static inline std::atomic<int> level_{spdlog::level::off};
+    // 运行时级别低于编译期最低级别的提示，每次初始化后只输出一次
+    static inline std::atomic<bool> below_compiled_reported_{false};
 
 public:
     /**
@@ -25,93 +51,201 @@ public:
      * @param log_level 日志级别 (trace, debug, info, warn, error, critical)
      * @param enable_file_logging 是否启用文件日志
      * @param log_file_path 日志文件路径
+     * @param console_to_stderr 控制台日志输出到stderr（标准输出用于数据时使用）
+     * @param async_queue_size 异步队列容量（条），为0时在调用线程上同步写入
+     * @param block_on_overflow 队列满时阻塞调用线程；为false时覆盖最旧的消息
      */
     static void init(const std::string& log_level = "info", 
                     bool enable_file_logging = true,
-                    const std::string& log_file_path = "logs/doh_client.log");
+                    const std::string& log_file_path = "logs/doh_client.log",
+                    bool console_to_stderr = false,
+                    size_t async_queue_size = 0,
+                    bool block_on_overflow = false);
+
+    /**
+     * @brief 使用给定的sink初始化日志系统（测试与基准使用），不创建控制台和文件日志
+     */
+    static void init_with_sink(spdlog::sink_ptr sink, const std::string& log_level = "info",
+                               size_t async_queue_size = 0, bool block_on_overflow = false);
 
     /**
      * @brief 设置日志级别
+     * @details 级别低于编译期最低级别 DOH_LOG_ACTIVE_LEVEL 时，低出的部分不会输出，首次出现时记录一条警告
      * @param level 日志级别字符串
      */
     static void set_level(const std::string& level);
 
+    /**
+     * @brief 指定级别是否被编译进程序（不低于 DOH_LOG_ACTIVE_LEVEL）
+     */
+    static constexpr bool compiled(spdlog::level::level_enum level) { return level >= DOH_LOG_ACTIVE_LEVEL; }
+
+    /**
+     * @brief 指定级别当前是否会被记录
+     * @details 先做编译期判断，再读一个原子变量，供日志宏在求值参数之前判断
+     */
+    static bool enabled(spdlog::level::level_enum level) {
+        return compiled(level) && level >= level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 异步队列满时被覆盖丢弃的消息数
+     */
+    static size_t dropped_messages() { return thread_pool_ ? thread_pool_->overrun_counter() : 0; }
+
+    /**
+     * @brief 记录跟踪信息（原始报文等大量输出）
+     */
+    template<typename... Args>
+    static void trace(spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        log(spdlog::level::trace, fmt, std::forward<Args>(args)...);
+    }
+
     /**
      * @brief 记录调试信息
      */
     template<typename... Args>
-    static void debug(const std::string& fmt, Args&&... args) {
-        if (console_logger_) console_logger_->debug(fmt, std::forward<Args>(args)...);
-        if (file_logger_) file_logger_->debug(fmt, std::forward<Args>(args)...);
+    static void debug(spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        log(spdlog::level::debug, fmt, std::forward<Args>(args)...);
     }
 
     /**
      * @brief 记录一般信息
      */
     template<typename... Args>
-    static void info(const std::string& fmt, Args&&... args) {
-        if (console_logger_) console_logger_->info(fmt, std::forward<Args>(args)...);
-        if (file_logger_) file_logger_->info(fmt, std::forward<Args>(args)...);
+    static void info(spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        log(spdlog::level::info, fmt, std::forward<Args>(args)...);
     }
 
     /**
      * @brief 记录警告信息
      */
     template<typename... Args>
-    static void warn(const std::string& fmt, Args&&... args) {
-        if (console_logger_) console_logger_->warn(fmt, std::forward<Args>(args)...);
-        if (file_logger_) file_logger_->warn(fmt, std::forward<Args>(args)...);
+    static void warn(spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        log(spdlog::level::warn, fmt, std::forward<Args>(args)...);
     }
 
     /**
      * @brief 记录错误信息
      */
     template<typename... Args>
-    static void error(const std::string& fmt, Args&&... args) {
-        if (console_logger_) console_logger_->error(fmt, std::forward<Args>(args)...);
-        if (file_logger_) file_logger_->error(fmt, std::forward<Args>(args)...);
+    static void error(spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        log(spdlog::level::err, fmt, std::forward<Args>(args)...);
     }
 
     /**
      * @brief 记录严重错误信息
      */
     template<typename... Args>
-    static void critical(const std::string& fmt, Args&&... args) {
-        if (console_logger_) console_logger_->critical(fmt, std::forward<Args>(args)...);
-        if (file_logger_) file_logger_->critical(fmt, std::forward<Args>(args)...);
+    static void critical(spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        log(spdlog::level::critical, fmt, std::forward<Args>(args)...);
     }
 
     /**
      * @brief 刷新日志缓冲区
+     * @details 异步模式下只是通知后台线程刷新；需要确保消息全部写出时调用 shutdown()
      */
     static void flush();
 
     /**
      * @brief 关闭日志系统
+     * @details 异步模式下等待队列中的消息全部写出后返回
      */
     static void shutdown();
 
 private:
+    template<typename... Args>
+    static void log(spdlog::level::level_enum level, spdlog::format_string_t<Args...> fmt, Args&&... args) {
+        if (!enabled(level)) {
+            return;
+        }
+        if (console_logger_) console_logger_->log(level, fmt, std::forward<Args>(args)...);
+        if (file_logger_) file_logger_->log(level, fmt, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief 创建写入给定sink的日志器；已创建线程池时为异步日志器
+     */
+    static std::shared_ptr<spdlog::logger> make_logger(const std::string& name, spdlog::sink_ptr sink);
+
+    /**
+     * @brief 按需创建异步日志使用的线程池（单个后台线程）
+     */
+    static void start_thread_pool(size_t async_queue_size, bool block_on_overflow);
+
     /**
      * @brief 字符串转换为spdlog日志级别
      */
     static spdlog::level::level_enum string_to_level(const std::string& level);
 };
 
-// 静态成员初始化
-std::shared_ptr<spdlog::logger> Logger::console_logger_ = nullptr;
-std::shared_ptr<spdlog::logger> Logger::file_logger_ = nullptr;
-bool Logger::initialized_ = false;
+/**
+ * @brief 日志宏：先判断级别再求值参数，级别未启用时参数表达式不会被执行
+ * @details 热路径上参数需要构造字符串（URL、耗时明细等）时使用。低于 DOH_LOG_ACTIVE_LEVEL 的级别
+ *          展开为永不执行的分支：格式串与参数仍做编译期检查，但不生成任何代码
+ */
+#define DOH_LOG_AT(level, method, ...)          \
+    do {                                        \
+        if (Logger::enabled(level)) {           \
+            Logger::method(__VA_ARGS__);        \
+        }                                       \
+    } while (0)
+
+#define DOH_LOG_ELIDED(method, ...)             \
+    do {                                        \
+        if constexpr (false) {                  \
+            Logger::method(__VA_ARGS__);        \
+        }                                       \
+    } while (0)
+
+#if DOH_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define DOH_LOG_TRACE(...) DOH_LOG_AT(spdlog::level::trace, trace, __VA_ARGS__)
+#else
+#define DOH_LOG_TRACE(...) DOH_LOG_ELIDED(trace, __VA_ARGS__)
+#endif
+
+#if DOH_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define DOH_LOG_DEBUG(...) DOH_LOG_AT(spdlog::level::debug, debug, __VA_ARGS__)
+#else
+#define DOH_LOG_DEBUG(...) DOH_LOG_ELIDED(debug, __VA_ARGS__)
+#endif
+
+#if DOH_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#define DOH_LOG_INFO(...) DOH_LOG_AT(spdlog::level::info, info, __VA_ARGS__)
+#else
+#define DOH_LOG_INFO(...) DOH_LOG_ELIDED(info, __VA_ARGS__)
+#endif
+
+#if DOH_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define DOH_LOG_WARN(...) DOH_LOG_AT(spdlog::level::warn, warn, __VA_ARGS__)
+#else
+#define DOH_LOG_WARN(...) DOH_LOG_ELIDED(warn, __VA_ARGS__)
+#endif
+
+#if DOH_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+#define DOH_LOG_ERROR(...) DOH_LOG_AT(spdlog::level::err, error, __VA_ARGS__)
+#else
+#define DOH_LOG_ERROR(...) DOH_LOG_ELIDED(error, __VA_ARGS__)
+#endif
 
 // 实现
-void Logger::init(const std::string& log_level, bool enable_file_logging, const std::string& log_file_path) {
+inline void Logger::init(const std::string& log_level, bool enable_file_logging, const std::string& log_file_path,
+                         bool console_to_stderr, size_t async_queue_size, bool block_on_overflow) {
     if (initialized_) {
         return;
     }
 
     try {
+        start_thread_pool(async_queue_size, block_on_overflow);
+
         // 创建控制台日志器
-        console_logger_ = spdlog::stdout_color_mt("console");
+        spdlog::sink_ptr console_sink;
+        if (console_to_stderr) {
+            console_sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+        } else {
+            console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+        }
+        console_logger_ = make_logger("console", console_sink);
         console_logger_->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] [%t] %v");
         
         // 创建文件日志器（如果启用）
@@ -124,7 +258,7 @@ void Logger::init(const std::string& log_level, bool enable_file_logging, const
             
             auto file_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
                 log_file_path, 1024 * 1024 * 5, 3); // 5MB per file, 3 files max
-            file_logger_ = std::make_shared<spdlog::logger>("file", file_sink);
+            file_logger_ = make_logger("file", file_sink);
             file_logger_->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] [%t] %v");
         }
 
@@ -139,32 +273,80 @@ void Logger::init(const std::string& log_level, bool enable_file_logging, const
     }
 }
 
-void Logger::set_level(const std::string& level) {
+inline void Logger::init_with_sink(spdlog::sink_ptr sink, const std::string& log_level, size_t async_queue_size,
+                                   bool block_on_overflow) {
+    if (initialized_) {
+        return;
+    }
+    start_thread_pool(async_queue_size, block_on_overflow);
+    console_logger_ = make_logger("console", std::move(sink));
+    set_level(log_level);
+    initialized_ = true;
+}
+
+inline std::shared_ptr<spdlog::logger> Logger::make_logger(const std::string& name, spdlog::sink_ptr sink) {
+    if (!thread_pool_) {
+        return std::make_shared<spdlog::logger>(name, std::move(sink));
+    }
+    auto policy = block_on_overflow_ ? spdlog::async_overflow_policy::block
+                                     : spdlog::async_overflow_policy::overrun_oldest;
+    return std::make_shared<spdlog::async_logger>(name, std::move(sink), thread_pool_, policy);
+}
+
+inline void Logger::start_thread_pool(size_t async_queue_size, bool block_on_overflow) {
+    block_on_overflow_ = block_on_overflow;
+    if (async_queue_size > 0) {
+        thread_pool_ = std::make_shared<spdlog::details::thread_pool>(async_queue_size, 1);
+    }
+}
+
+inline void Logger::set_level(const std::string& level) {
     auto spdlog_level = string_to_level(level);
     if (console_logger_) console_logger_->set_level(spdlog_level);
     if (file_logger_) file_logger_->set_level(spdlog_level);
+    level_.store(spdlog_level, std::memory_order_relaxed);
+
+    // 直接写入日志器，不经过编译期级别检查，即使warn级别也被编译删除时提示仍然可见
+    if (!compiled(spdlog_level) && !below_compiled_reported_.exchange(true)) {
+        auto minimum = spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(DOH_LOG_ACTIVE_LEVEL));
+        for (const auto& logger : {console_logger_, file_logger_}) {
+            if (logger) {
+                logger->log(spdlog::level::warn,
+                            "Log level {} is below the compiled minimum {}; messages below {} are not built "
+                            "into this binary (rebuild with DOH_LOG_ACTIVE_LEVEL to enable them)",
+                            level, minimum, minimum);
+            }
+        }
+    }
 }
 
-void Logger::flush() {
+inline void Logger::flush() {
     if (console_logger_) console_logger_->flush();
     if (file_logger_) file_logger_->flush();
 }
 
-void Logger::shutdown() {
-    if (console_logger_) {
-        console_logger_->flush();
-        spdlog::drop("console");
-        console_logger_ = nullptr;
-    }
-    if (file_logger_) {
-        file_logger_->flush();
-        spdlog::drop("file");
-        file_logger_ = nullptr;
+inline void Logger::shutdown() {
+    level_.store(spdlog::level::off, std::memory_order_relaxed);
+    auto console_logger = std::move(console_logger_);
+    auto file_logger = std::move(file_logger_);
+    spdlog::drop("console");
+    spdlog::drop("file");
+
+    // 线程池析构时先写完队列中剩余的消息，再结束后台线程。之后直接刷新sink：
+    // 通过异步日志器刷新要向队列投递消息，覆盖模式下队列满时会挤掉一条尚未写出的日志
+    thread_pool_ = nullptr;
+    for (const auto& logger : {console_logger, file_logger}) {
+        if (logger) {
+            for (const auto& sink : logger->sinks()) {
+                sink->flush();
+            }
+        }
     }
+    below_compiled_reported_ = false;
     initialized_ = false;
 }
 
-spdlog::level::level_enum Logger::string_to_level(const std::string& level) {
+inline spdlog::level::level_enum Logger::string_to_level(const std::string& level) {
     if (level == "trace") return spdlog::level::trace;
     if (level == "debug") return spdlog::level::debug;
     if (level == "info") return spdlog::level::info;
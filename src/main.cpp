@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <cctype>
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -7,8 +9,140 @@
 #include "tools.hpp"
 #include "logger.hpp"
 #include "config.hpp"
+#include "dns_cache.hpp"
+#include "doh_racer.hpp"
+#include "doh_batch.hpp"
+#include "dns_cache_refresher.hpp"
+#include "dns_cache_file.hpp"
+#include "dns_udp_client.hpp"
+#include "doh_forwarder.hpp"
+#include "dual_stack.hpp"
 #include "exceptions.hpp"
 
+// 从缓存文件恢复上次运行的解析结果和失败时间，文件损坏时忽略并在退出时覆盖
+static void load_cache_file(const std::string &path, DnsCache &cache, DnsFailureTracker &failures) {
+    try {
+        auto file = DnsCacheFile::open(path);
+        if (!file) {
+            DOH_LOG_DEBUG("No cache file at {}", path);
+            return;
+        }
+        size_t restored = file->restore(cache, &failures);
+        Logger::info("Restored {} of {} cached entries from {}", restored, file->entry_count(), path);
+    } catch (const CacheException &e) {
+        Logger::warn("Ignoring cache file: {}", e.what());
+    }
+}
+
+// 把缓存写回文件，失败不影响退出状态
+static void save_cache_file(const std::string &path, const DnsCache &cache, const DnsFailureTracker &failures) {
+    try {
+        DnsCacheFile::save(path, cache, &failures);
+        DOH_LOG_DEBUG("Saved {} cached entries to {}", cache.size(), path);
+    } catch (const CacheException &e) {
+        Logger::warn("Failed to save cache file: {}", e.what());
+    }
+}
+
+// 批量解析：逐行读取域名，以NDJSON输出结果，最后在stderr打印吞吐量统计
+static int run_batch(const Config &config, const std::string &path, DoHMethod method,
+                     const std::shared_ptr<DnsCache> &cache) {
+    std::ifstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            Logger::error("Cannot open batch file: {}", path);
+            return 1;
+        }
+    }
+    std::istream &input = path == "-" ? std::cin : file;
+
+    DoHServerConfig server{"default", config.default_server, {"get", "post", "json"}, 1, config.timeout, true};
+    AsyncDoHClient client(server, config.connect_timeout);
+    BatchResolver resolver(client, static_cast<size_t>(config.batch.max_in_flight), method);
+    // 输入中重复出现的域名在TTL边界上由后台刷新，不再阻塞在一次完整的DoH往返上
+    std::unique_ptr<CacheRefresher> refresher;
+    if (cache->enabled()) {
+        resolver.set_cache(cache);
+        refresher = std::make_unique<CacheRefresher>(cache, server, method, config.connect_timeout);
+    }
+
+    Logger::info("Batch resolving from {} via {} (window: {})", path == "-" ? "stdin" : path, config.default_server,
+                 config.batch.max_in_flight);
+    auto summary = resolver.resolve_stream(input, [](BatchResult &result) {
+        std::cout << BatchResolver::to_ndjson(result) << '\n';
+    });
+    std::cout.flush();
+
+    std::cerr << "Resolved " << summary.total << " queries in " << summary.elapsed.count() << " ms ("
+              << static_cast<uint64_t>(summary.queries_per_second()) << " qps): " << summary.succeeded << " ok, "
+              << summary.failed << " failed, " << summary.cached << " cached, " << summary.records << " records"
+              << std::endl;
+    return summary.failed == 0 ? 0 : 2;
+}
+
+// --stats：按服务商输出DoH请求各阶段耗时的汇总，写到stderr以免混入批量模式的结果
+static void print_phase_stats() {
+    std::string report = DoHMetrics::instance().phase_report();
+    std::cerr << (report.empty() ? std::string("No DoH requests were made\n") : report) << std::flush;
+}
+
+// 探测配置中每个启用的服务器支持哪些DoH方法
+static int run_probe(const Config &config) {
+    for (const auto &server : config.servers) {
+        if (!server.enabled) {
+            continue;
+        }
+        DoHClient client(server.url);
+        auto supported = client.probe_methods();
+        std::cout << server.name << " (" << server.url << "):";
+        for (DoHMethod method : supported) {
+            std::cout << ' ' << doh_method_config_name(method);
+        }
+        std::cout << (supported.empty() ? " none" : "") << std::endl;
+    }
+    return 0;
+}
+
+// 转发服务模式由主线程 sigwait 同步等待的信号：
+// SIGUSR1 把当前指标以Prometheus文本格式写到stderr，SIGINT/SIGTERM 停止服务
+static sigset_t serve_signals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    return signals;
+}
+
+// 转发服务模式：在本地提供明文DNS与DoH，未命中的查询经DoH转发到默认服务器，直到收到SIGINT/SIGTERM
+// 调用前 serve_signals() 必须已在所有线程中屏蔽（main 在创建日志线程之前屏蔽）
+static int run_serve(const Config &config, DoHMethod method, const std::shared_ptr<DnsCache> &cache) {
+    sigset_t signals = serve_signals();
+
+    DoHServerConfig server{"default", config.default_server, {"get", "post", "json"}, 1, config.timeout, true};
+    std::unique_ptr<CacheRefresher> refresher;
+    if (cache->enabled()) {
+        refresher = std::make_unique<CacheRefresher>(cache, server, method, config.connect_timeout);
+    }
+
+    DoHForwarder forwarder(config.serve, config.default_server, method, cache);
+    try {
+        forwarder.start();
+    } catch (const NetworkException &e) {
+        Logger::error("Cannot start forwarder: {}", e.what());
+        return 1;
+    }
+
+    int signal = 0;
+    while (sigwait(&signals, &signal) == 0 && signal == SIGUSR1) {
+        std::cerr << MetricsRegistry::instance().prometheus_text() << forwarder.metrics_text() << std::flush;
+    }
+    Logger::info("Received signal {}, shutting down", signal);
+    forwarder.stop();
+    return 0;
+}
+
 // 使用示例
 int main(int argc, char *argv[]) {
     try {
@@ -19,29 +153,134 @@ int main(int argc, char *argv[]) {
         if (!config.load()) {
             std::cerr << "Warning: Failed to load config, using defaults" << std::endl;
         }
+        // 命令行参数优先于配置文件
+        config.update_from_args(argc, argv);
+
+        // 批量模式的输入文件，"-" 表示标准输入
+        std::string batch_path;
+        for (int i = 1; i < argc - 1; ++i) {
+            if (std::string(argv[i]) == "--batch") {
+                batch_path = argv[i + 1];
+                break;
+            }
+        }
+        bool show_stats = false;
+        bool serve = false;
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--stats") {
+                show_stats = true;
+            } else if (std::string(argv[i]) == "--serve") {
+                serve = true;
+            }
+        }
 
-        // 初始化日志系统
-        Logger::init(config.log.level, config.log.enable_file_logging, config.log.log_file_path);
+        // 转发服务模式在创建任何线程（包括异步日志的后台线程）之前屏蔽信号，新线程继承屏蔽字，
+        // 信号只会由主线程的 sigwait 取走，不会以默认动作终止进程
+        if (serve) {
+            sigset_t signals = serve_signals();
+            pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        }
+
+        // 初始化日志系统，批量模式下标准输出只用于结果，日志写到stderr
+        Logger::init(config.log.level, config.log.enable_file_logging, config.log.log_file_path,
+                     !batch_path.empty(), static_cast<size_t>(std::max(0, config.log.async_queue_size)),
+                     config.log.block_on_overflow);
         Logger::info("DoH Client starting...");
 
         // 验证配置
         if (!config.validate()) {
             Logger::error("Invalid configuration");
+            Logger::shutdown();
             return 1;
         }
-        config.print();
+        if (batch_path.empty()) {
+            config.print();
+        }
 
-        // 初始化libcurl(全局初始化)
+        // 初始化libcurl(全局初始化)；离开 try 块时（包括异常退出）在之后创建的客户端析构后清理
         curl_global_init(CURL_GLOBAL_DEFAULT);
-        Logger::debug("CURL initialized");
+        struct CurlGlobalCleanup {
+            ~CurlGlobalCleanup() { curl_global_cleanup(); }
+        } curl_cleanup;
+        DOH_LOG_DEBUG("CURL initialized");
+        // 此后的所有正常退出路径都经过这里，异步日志队列中的消息在退出前写出；异常退出由下面的 catch 关闭日志
+        auto finish = [](int status) {
+            Logger::shutdown();
+            return status;
+        };
+        DoHMethodCache::instance().set_ttl(std::chrono::seconds(config.method_cache_ttl));
+        // 所有DoH路径（单次查询、竞速、转发服务的上游）共用同一份服务商健康状态
+        ProviderHealth::instance().configure(config.health);
+
+        // 探测模式：只输出各服务器支持的方法
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--probe-methods") {
+                return finish(run_probe(config));
+            }
+        }
 
         // 检查帮助请求
         for (int i = 1; i < argc; ++i) {
             std::string arg = argv[i];
             if (arg == "-h" || arg == "--help") {
                 print_usage(argv[0]);
-                return 0;
+                return finish(0);
+            }
+        }
+
+        // 创建DoH客户端实例，使用配置中的默认服务器；其熔断打开时按优先级改用第一个可用的服务器
+        DoHClient client(ProviderHealth::instance().select(config.default_server, config.get_servers_by_priority()));
+
+        // 根据配置启用解析结果缓存
+        auto cache = std::make_shared<DnsCache>(config.cache);
+        auto failures = std::make_shared<DnsFailureTracker>();
+        bool persist = cache->enabled() && !config.cache.persist_path.empty();
+        if (cache->enabled()) {
+            client.set_cache(cache);
+        }
+        client.set_failure_tracker(failures);
+        client.set_fallback_timeout(std::chrono::milliseconds(config.fallback_timeout_ms));
+        client.set_race_system_dns(config.race_system_dns);
+        if (persist) {
+            load_cache_file(config.cache.persist_path, *cache, *failures);
+        }
+
+        // 确定查询方法
+        DoHMethod method = DoHMethod::JSON_GET;  // 默认使用JSON GET
+        
+        // 查找方法参数
+        for (int i = 1; i < argc - 1; ++i) {
+            if (std::string(argv[i]) == "--method" && i + 1 < argc) {
+                std::string methodStr = argv[i + 1];
+                if (!parse_doh_method(methodStr, method)) {
+                    Logger::warn("Unknown method: {}. Using default JSON_GET.", methodStr);
+                }
+                break;
+            }
+        }
+
+        // 转发服务模式
+        if (serve) {
+            int status = run_serve(config, method, cache);
+            if (show_stats) {
+                print_phase_stats();
+            }
+            if (persist) {
+                save_cache_file(config.cache.persist_path, *cache, *failures);
+            }
+            return finish(status);
+        }
+
+        // 批量模式：结果以NDJSON写到标准输出
+        if (!batch_path.empty()) {
+            int status = run_batch(config, batch_path, method, cache);
+            if (show_stats) {
+                print_phase_stats();
+            }
+            if (persist) {
+                save_cache_file(config.cache.persist_path, *cache, *failures);
             }
+            return finish(status);
         }
 
         // 查询域名 - 统一使用命名参数
@@ -62,36 +301,67 @@ int main(int argc, char *argv[]) {
         }
         Logger::info("Querying domain: {}", domain);
 
-        // 创建DoH客户端实例，使用配置中的默认服务器
-        DoHClient client(config.default_server);
+        bool dual_stack = false;
+        std::string dns_server;
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(argv[i]) == "--dual-stack") {
+                dual_stack = true;
+            } else if (std::string(argv[i]) == "--dns-server" && i + 1 < argc) {
+                dns_server = argv[++i];
+            }
+        }
 
-        // 确定查询方法
-        DoHMethod method = DoHMethod::JSON_GET;  // 默认使用JSON GET
-        
-        // 查找方法参数
-        for (int i = 1; i < argc - 1; ++i) {
-            if (std::string(argv[i]) == "--method" && i + 1 < argc) {
-                std::string methodStr = argv[i + 1];
-                std::transform(methodStr.begin(), methodStr.end(), methodStr.begin(),
-                               [](unsigned char c) { return std::tolower(c); });
-
-                if (methodStr == "get") {
-                    method = DoHMethod::GET;
-                } else if (methodStr == "post") {
-                    method = DoHMethod::POST;
-                } else if (methodStr == "json" || methodStr == "json_get") {
-                    method = DoHMethod::JSON_GET;
-                } else {
-                    Logger::warn("Unknown method: {}. Using default JSON_GET.", methodStr);
+        // 执行A记录查询（--dual-stack 时并行查询A与AAAA）
+        DOH_LOG_DEBUG("Starting DNS query with method: {}", static_cast<int>(method));
+        std::vector<DNSRecord> records;
+        if (!dns_server.empty()) {
+            // 明文DNS，不经过DoH；超时按配置的请求超时
+            std::string host;
+            uint16_t port = 53;
+            if (!parse_dns_server(dns_server, host, port)) {
+                Logger::error("Invalid --dns-server address: {}", dns_server);
+                return finish(1);
+            }
+            if (!cache->get(domain, DNSRecordType::A, records)) {
+                DnsUdpClient udp_client(host, port, std::chrono::seconds(config.timeout));
+                records = udp_client.query(domain, DNSRecordType::A);
+                cache->put(domain, DNSRecordType::A, records);
+                DOH_LOG_DEBUG("Plain DNS via {}: tcp_fallbacks={}, mismatched={}", dns_server,
+                              udp_client.tcp_fallbacks(), udp_client.mismatched());
+            }
+        } else if (dual_stack) {
+            DoHServerConfig server{"default", config.default_server, {"get", "post", "json"}, 1, config.timeout,
+                                   true};
+            AsyncDoHClient async_client(server, config.connect_timeout);
+            DualStackResolver resolver(async_client, method, config.enable_fallback);
+            resolver.set_fallback_timeout(std::chrono::milliseconds(config.fallback_timeout_ms));
+            if (cache->enabled()) {
+                resolver.set_cache(cache);
+            }
+            records = resolver.resolve(domain);
+        } else if (config.race.enabled) {
+            // 多服务商竞速解析，全部失败时按配置回退到系统DNS
+            if (!cache->get(domain, DNSRecordType::A, records)) {
+                ProviderHealth &health = ProviderHealth::instance();
+                DoHRacer racer(config, &DoHConnectionPool::instance(), &health);
+                records = racer.resolve(domain, DNSRecordType::A, method);
+                cache->put(domain, DNSRecordType::A, records);
+                for (const auto& server : config.servers) {
+                    auto stats = health.stats(server.url);
+                    if (stats.successes + stats.failures > 0) {
+                        DOH_LOG_DEBUG("Provider {}: {:.1f}ms EWMA, {} ok, {} failed", server.name,
+                                      stats.latency_ewma_ms, stats.successes, stats.failures);
+                    }
                 }
-                break;
             }
+            if (records.empty() && config.enable_fallback) {
+                DoHMetrics::instance().fallbacks.inc();
+                records = client.query_with_system_dns(domain, DNSRecordType::A);
+            }
+        } else {
+            records = client.query(domain, DNSRecordType::A, method, config.enable_fallback);
         }
 
-        // 执行A记录查询
-        Logger::debug("Starting DNS query with method: {}", static_cast<int>(method));
-        auto records = client.query(domain, DNSRecordType::A, method, config.enable_fallback);
-
         // 输出结果
         if (records.empty()) {
             Logger::warn("No records found for domain: {}", domain);
@@ -101,46 +371,41 @@ int main(int argc, char *argv[]) {
             std::cout << "DNS records for " << domain << ":" << std::endl;
             for (const auto &record : records) {
                 std::cout << "Name: " << record.name << std::endl;
-                std::cout << "Type: ";
-
-                switch (record.type) {
-                    case DNSRecordType::A:
-                        std::cout << "A";
-                        break;
-                    case DNSRecordType::AAAA:
-                        std::cout << "AAAA";
-                        break;
-                    case DNSRecordType::CNAME:
-                        std::cout << "CNAME";
-                        break;
-                    case DNSRecordType::MX:
-                        std::cout << "MX";
-                        break;
-                    case DNSRecordType::NS:
-                        std::cout << "NS";
-                        break;
-                    case DNSRecordType::TXT:
-                        std::cout << "TXT";
-                        break;
-                    default:
-                        std::cout << static_cast<int>(record.type);
-                        break;
-                }
-
-                std::cout << std::endl;
+                std::cout << "Type: " << record_type_name(record.type) << std::endl;
                 std::cout << "TTL: " << record.ttl << " seconds" << std::endl;
                 std::cout << "Data: " << record.data << std::endl;
                 std::cout << "------------------------" << std::endl;
             }
         }
 
-        // 清理libcurl资源
-        curl_global_cleanup();
-        Logger::debug("CURL cleaned up");
-        
+        if (persist) {
+            save_cache_file(config.cache.persist_path, *cache, *failures);
+        }
+
+        if (show_stats) {
+            print_phase_stats();
+        }
+
+        if (cache->enabled()) {
+            auto stats = cache->stats();
+            DOH_LOG_DEBUG("Cache stats: hits={}, stale_hits={}, misses={}, evictions={}, expirations={}, "
+                          "prefetches={}, size={}",
+                          stats.hits, stats.stale_hits, stats.misses, stats.evictions, stats.expirations,
+                          stats.prefetches, stats.size);
+        }
+
+        DOH_LOG_DEBUG("Single-flight: {} upstream requests saved", DoHSingleFlight::instance().saved_requests());
+
+        for (const auto& entry : DoHConnectionPool::instance().all_stats()) {
+            const auto& pool_stats = entry.second;
+            DOH_LOG_DEBUG("Connection pool {}: open={}, transfers={}, new_connections={}, reuse_ratio={:.2f}, "
+                          "handshakes_avoided={}",
+                          entry.first, pool_stats.open_connections, pool_stats.transfers, pool_stats.new_connections,
+                          pool_stats.reuse_ratio(), pool_stats.handshakes_avoided());
+        }
+
         Logger::info("DoH Client finished successfully");
-        Logger::shutdown();
-        return 0;
+        return finish(0);
         
     } catch (const DoHException &e) {
         Logger::error("DoH Error [{}]: {} (Context: {})", e.code(), e.what(), e.context());
@@ -0,0 +1,690 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "doh_method.hpp"
+#include "logger.hpp"
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief 直方图快照（各线程之和）
+ */
+struct HistogramSnapshot {
+    std::vector<uint64_t> buckets;  // 按 Histogram::bucket_index 排列
+    uint64_t count = 0;
+    uint64_t sum = 0;  // 所有记录值之和（微秒）
+
+    /**
+     * @brief 分位数的近似值：第 q 分位所在桶的上界（微秒），没有记录时为0
+     */
+    uint64_t percentile(double q) const;
+};
+
+/**
+ * @brief 计数器句柄，可按值复制；记录只写当前线程自己的分片，不加锁也不做原子读改写
+ */
+class Counter {
+public:
+    Counter() = default;
+
+    void inc(uint64_t n = 1) const;
+
+    /**
+     * @brief 当前值（所有线程之和，含已退出的线程）
+     */
+    uint64_t value() const;
+
+private:
+    friend class MetricsRegistry;
+    explicit Counter(size_t slot) : slot_(slot) {}
+
+    size_t slot_ = 0;
+};
+
+/**
+ * @brief 以整数为标签值的一组计数器，例如HTTP状态码或curl错误码
+ * @details 标签值位于 [first, first + size) 之外的记录计入溢出槽，不导出
+ */
+class CounterArray {
+public:
+    CounterArray() = default;
+
+    void inc(long label, uint64_t n = 1) const;
+    uint64_t value(long label) const;
+
+private:
+    friend class MetricsRegistry;
+    CounterArray(size_t slot, long first, size_t size) : slot_(slot), first_(first), size_(size) {}
+
+    size_t slot_ = 0;
+    long first_ = 0;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief 延迟直方图句柄（微秒）
+ * @details HDR风格的对数-线性分桶：[0, 8) 每个值一个桶，此后每个2的幂区间分为8个线性子桶，
+ *          相对误差不超过12.5%；2^27微秒（约134秒）及以上计入最后一个桶。
+ *          记录只写当前线程自己的分片。
+ */
+class Histogram {
+public:
+    static constexpr size_t kSubBuckets = 8;
+    static constexpr unsigned kMaxExponent = 27;
+    static constexpr size_t kBuckets = kSubBuckets + (kMaxExponent - 3) * kSubBuckets + 1;
+
+    Histogram() = default;
+
+    void record(uint64_t micros) const;
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucket_index(uint64_t micros);
+
+    /**
+     * @brief 桶的下界（含），最后一个桶的上界视为无穷大
+     */
+    static uint64_t bucket_lower_bound(size_t index);
+
+private:
+    friend class MetricsRegistry;
+    explicit Histogram(size_t slot) : slot_(slot) {}
+
+    size_t slot_ = 0;  // kBuckets 个桶之后是记录值之和
+};
+
+/**
+ * @brief 进程内指标注册表
+ * @details 每个线程第一次记录时分配一个私有分片（kMaxSlots 个64位槽），之后的记录只对自己的分片做
+ *          普通的加法写入（relaxed 原子读写，没有锁前缀指令，也没有跨核缓存行争用），开销约为一次TLS访问加一次加法。
+ *          读取时在锁内汇总所有分片；线程退出时分片的值并入已退出线程的总和。
+ *          注册（counter/histogram/counter_array）需要加锁，应在初始化时完成并保存句柄；
+ *          相同名称与标签重复注册返回同一句柄。槽用尽后新的指标写入不导出的溢出槽。
+ */
+class MetricsRegistry {
+public:
+    static constexpr size_t kMaxSlots = 16384;  // 每个线程的分片128KB
+
+    /**
+     * @brief 进程内共享的实例
+     * @details 有意不释放：线程退出时的分片回收可能晚于静态对象析构
+     */
+    static MetricsRegistry &instance() {
+        static MetricsRegistry *registry = new MetricsRegistry();
+        return *registry;
+    }
+
+    Counter counter(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+    Histogram histogram(const std::string &name, const std::string &help, const MetricLabels &labels = {});
+
+    /**
+     * @param label 标签名，标签值为 [first, first + size) 中的整数；值为0的序列不导出
+     */
+    CounterArray counter_array(const std::string &name, const std::string &help, const std::string &label,
+                               long first, size_t size);
+
+    /**
+     * @brief Prometheus 文本格式（0.0.4）的全部指标
+     * @details 直方图以微秒记录，按秒导出；导出的桶边界为 2^7 到 2^26 微秒的各个2的幂
+     *          （记录值恰好等于边界时计入上一个边界，误差在分桶精度之内）
+     */
+    std::string prometheus_text() const;
+
+    /**
+     * @brief 当前线程的分片
+     */
+    static std::atomic<uint64_t> *local_slots();
+
+    uint64_t sum(size_t slot) const;
+
+private:
+    enum class Type { Counter, Histogram };
+
+    struct Series {
+        std::string labels;  // 已格式化的 k="v",...
+        size_t slot = 0;
+        long first = 0;       // counter_array 的第一个标签值
+        size_t size = 0;      // counter_array 的标签值个数，普通序列为0
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type = Type::Counter;
+        std::string array_label;
+        std::vector<Series> series;
+        bool overflow_logged = false;  // 槽位耗尽的警告每个指标族只记录一次
+    };
+
+    struct Shard {
+        std::atomic<uint64_t> slots[kMaxSlots]{};
+    };
+
+    // 线程退出时回收分片
+    struct LocalShard {
+        LocalShard() : shard(MetricsRegistry::instance().attach()) {}
+        ~LocalShard() { MetricsRegistry::instance().retire(shard); }
+        Shard *shard;
+    };
+
+    MetricsRegistry() = default;
+
+    Shard *attach();
+    void retire(Shard *shard);
+    size_t allocate(Family &family, const MetricLabels &labels, size_t slots, long first, size_t size);
+    Family &family(const std::string &name, const std::string &help, Type type);
+    std::vector<uint64_t> totals() const;
+
+    static std::string format_labels(const MetricLabels &labels);
+    static std::string join_labels(const std::string &labels, const std::string &extra);
+    static std::string format_seconds(uint64_t micros);
+
+    mutable std::mutex mutex_;
+    std::vector<Shard *> shards_;
+    std::vector<uint64_t> retired_ = std::vector<uint64_t>(kMaxSlots, 0);
+    std::vector<std::unique_ptr<Family>> families_;
+    size_t next_slot_ = Histogram::kBuckets + 1;  // 开头的槽作为溢出槽，足以容纳一个直方图
+};
+
+/**
+ * @brief 一次DoH请求各阶段的耗时（微秒）
+ * @details curl的计时是从请求开始的累计值，这里换算为各阶段自身的耗时：
+ *          dns 为解析DoH服务器域名，connect 为TCP握手，tls 为TLS握手（明文或复用连接时为0），
+ *          first_byte 为请求发出后到收到第一个响应字节（服务器处理与网络往返），total 为curl的总耗时；
+ *          encode 与 parse 是本程序构建请求与解析应答的耗时，不含在 total 中
+ */
+struct DoHRequestTiming {
+    uint64_t dns = 0;
+    uint64_t connect = 0;
+    uint64_t tls = 0;
+    uint64_t first_byte = 0;
+    uint64_t total = 0;
+    uint64_t encode = 0;
+    uint64_t parse = 0;
+
+    std::string to_string() const;
+};
+
+/**
+ * @brief 请求阶段，与 DoHRequestTiming 的字段一一对应
+ */
+enum class DoHPhase { Dns, Connect, Tls, FirstByte, Total, Encode, Parse };
+
+constexpr size_t kDoHPhaseCount = 7;
+
+inline const char *doh_phase_name(DoHPhase phase) {
+    switch (phase) {
+        case DoHPhase::Dns:
+            return "dns";
+        case DoHPhase::Connect:
+            return "connect";
+        case DoHPhase::Tls:
+            return "tls";
+        case DoHPhase::FirstByte:
+            return "first_byte";
+        case DoHPhase::Total:
+            return "total";
+        case DoHPhase::Encode:
+            return "encode";
+        case DoHPhase::Parse:
+            return "parse";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief 单个DoH服务商的指标：按 DoHMethod 索引的查询计数，按 DoHPhase 索引的阶段耗时
+ */
+struct DoHProviderMetrics {
+    Counter queries[3];
+    Histogram phases[kDoHPhaseCount];
+
+    /**
+     * @brief 记录一次请求的网络阶段耗时（encode 与 parse 在发生时单独记录）
+     */
+    void record_transfer(const DoHRequestTiming &timing) const;
+};
+
+/**
+ * @brief 单个服务商各阶段耗时的汇总
+ */
+struct DoHPhaseSummary {
+    std::string provider;
+    HistogramSnapshot phases[kDoHPhaseCount];
+};
+
+/**
+ * @brief DoH客户端的指标
+ * @details 查询次数、耗时、HTTP状态码、curl错误码与收发字节数在 DoHRequest::complete 中记录，
+ *          数值取自curl的传输信息；缓存命中在 DnsCache::get 中记录；系统DNS回退在触发回退的解析路径中记录。
+ */
+class DoHMetrics {
+public:
+    static constexpr size_t kMaxProviders = 8;  // 超出后的服务商合并为 provider="other"
+
+    static DoHMetrics &instance() {
+        static DoHMetrics *metrics = new DoHMetrics();
+        return *metrics;
+    }
+
+    /**
+     * @brief 服务商的查询计数，客户端应在构造时取得并保存
+     */
+    DoHProviderMetrics *provider(const std::string &url);
+
+    /**
+     * @brief 各服务商的阶段耗时汇总，按服务商名称排序
+     */
+    std::vector<DoHPhaseSummary> phase_summaries();
+
+    /**
+     * @brief 阶段耗时的文本报表（--stats）：每个服务商每个阶段的次数、平均值与 p50/p90/p99，单位毫秒
+     */
+    std::string phase_report();
+
+    Histogram duration[3];  // 按 DoHMethod 索引
+    CounterArray http_status;
+    CounterArray curl_errors;
+    Counter bytes_sent;
+    Counter bytes_received;
+    Counter cache_hits;
+    Counter cache_misses;
+    Counter fallbacks;
+
+private:
+    DoHMetrics();
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<DoHProviderMetrics>> providers_;
+};
+
+// 实现
+inline std::string DoHRequestTiming::to_string() const {
+    return "dns=" + std::to_string(dns) + "us connect=" + std::to_string(connect) + "us tls=" + std::to_string(tls) +
+           "us first_byte=" + std::to_string(first_byte) + "us total=" + std::to_string(total) +
+           "us encode=" + std::to_string(encode) + "us parse=" + std::to_string(parse) + "us";
+}
+
+inline void DoHProviderMetrics::record_transfer(const DoHRequestTiming &timing) const {
+    phases[static_cast<size_t>(DoHPhase::Dns)].record(timing.dns);
+    phases[static_cast<size_t>(DoHPhase::Connect)].record(timing.connect);
+    phases[static_cast<size_t>(DoHPhase::Tls)].record(timing.tls);
+    phases[static_cast<size_t>(DoHPhase::FirstByte)].record(timing.first_byte);
+    phases[static_cast<size_t>(DoHPhase::Total)].record(timing.total);
+}
+
+inline uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return i + 1 < buckets.size() ? Histogram::bucket_lower_bound(i + 1) - 1
+                                          : Histogram::bucket_lower_bound(i);
+        }
+    }
+    return Histogram::bucket_lower_bound(buckets.size() - 1);
+}
+
+inline void Counter::inc(uint64_t n) const {
+    std::atomic<uint64_t> &slot = MetricsRegistry::local_slots()[slot_];
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline uint64_t Counter::value() const { return MetricsRegistry::instance().sum(slot_); }
+
+inline void CounterArray::inc(long label, uint64_t n) const {
+    size_t offset = static_cast<size_t>(label - first_);
+    std::atomic<uint64_t> &slot = MetricsRegistry::local_slots()[offset < size_ ? slot_ + offset : 0];
+    slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline uint64_t CounterArray::value(long label) const {
+    size_t offset = static_cast<size_t>(label - first_);
+    return offset < size_ ? MetricsRegistry::instance().sum(slot_ + offset) : 0;
+}
+
+inline size_t Histogram::bucket_index(uint64_t micros) {
+    if (micros < kSubBuckets) {
+        return static_cast<size_t>(micros);
+    }
+    unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(micros));
+    if (exponent >= kMaxExponent) {
+        return kBuckets - 1;
+    }
+    return kSubBuckets + (exponent - 3) * kSubBuckets + ((micros >> (exponent - 3)) & (kSubBuckets - 1));
+}
+
+inline uint64_t Histogram::bucket_lower_bound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    if (index >= kBuckets - 1) {
+        return uint64_t{1} << kMaxExponent;
+    }
+    size_t exponent = 3 + (index - kSubBuckets) / kSubBuckets;
+    uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+    return (kSubBuckets + sub) << (exponent - 3);
+}
+
+inline void Histogram::record(uint64_t micros) const {
+    std::atomic<uint64_t> *slots = MetricsRegistry::local_slots() + slot_;
+    std::atomic<uint64_t> &bucket = slots[bucket_index(micros)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic<uint64_t> &sum = slots[kBuckets];
+    sum.store(sum.load(std::memory_order_relaxed) + micros, std::memory_order_relaxed);
+}
+
+inline HistogramSnapshot Histogram::snapshot() const {
+    auto &registry = MetricsRegistry::instance();
+    HistogramSnapshot snapshot;
+    snapshot.buckets.resize(kBuckets);
+    for (size_t i = 0; i < kBuckets; ++i) {
+        snapshot.buckets[i] = registry.sum(slot_ + i);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = registry.sum(slot_ + kBuckets);
+    return snapshot;
+}
+
+inline std::atomic<uint64_t> *MetricsRegistry::local_slots() {
+    thread_local LocalShard local;
+    return local.shard->slots;
+}
+
+inline MetricsRegistry::Shard *MetricsRegistry::attach() {
+    auto *shard = new Shard();
+    std::lock_guard<std::mutex> lock(mutex_);
+    shards_.push_back(shard);
+    return shard;
+}
+
+inline void MetricsRegistry::retire(Shard *shard) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < next_slot_; ++i) {
+            retired_[i] += shard->slots[i].load(std::memory_order_relaxed);
+        }
+        shards_.erase(std::remove(shards_.begin(), shards_.end(), shard), shards_.end());
+    }
+    delete shard;
+}
+
+inline uint64_t MetricsRegistry::sum(size_t slot) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = retired_[slot];
+    for (const Shard *shard : shards_) {
+        total += shard->slots[slot].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+inline std::vector<uint64_t> MetricsRegistry::totals() const {
+    std::vector<uint64_t> values(retired_.begin(), retired_.begin() + static_cast<std::ptrdiff_t>(next_slot_));
+    for (const Shard *shard : shards_) {
+        for (size_t i = 0; i < next_slot_; ++i) {
+            values[i] += shard->slots[i].load(std::memory_order_relaxed);
+        }
+    }
+    return values;
+}
+
+inline MetricsRegistry::Family &MetricsRegistry::family(const std::string &name, const std::string &help, Type type) {
+    for (auto &family : families_) {
+        if (family->name == name) {
+            return *family;
+        }
+    }
+    auto family = std::make_unique<Family>();
+    family->name = name;
+    family->help = help;
+    family->type = type;
+    families_.push_back(std::move(family));
+    return *families_.back();
+}
+
+inline size_t MetricsRegistry::allocate(Family &family, const MetricLabels &labels, size_t slots, long first,
+                                        size_t size) {
+    std::string formatted = format_labels(labels);
+    for (const auto &series : family.series) {
+        if (series.labels == formatted) {
+            return series.slot;
+        }
+    }
+    if (next_slot_ + slots > kMaxSlots) {
+        if (!family.overflow_logged) {
+            family.overflow_logged = true;
+            Logger::warn("Metrics registry full, {}{{{}}} and later series of this family are not exported",
+                         family.name, formatted);
+        }
+        return 0;
+    }
+    family.series.push_back({formatted, next_slot_, first, size});
+    next_slot_ += slots;
+    return family.series.back().slot;
+}
+
+inline Counter MetricsRegistry::counter(const std::string &name, const std::string &help,
+                                        const MetricLabels &labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return Counter(allocate(family(name, help, Type::Counter), labels, 1, 0, 0));
+}
+
+inline Histogram MetricsRegistry::histogram(const std::string &name, const std::string &help,
+                                            const MetricLabels &labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return Histogram(allocate(family(name, help, Type::Histogram), labels, Histogram::kBuckets + 1, 0, 0));
+}
+
+inline CounterArray MetricsRegistry::counter_array(const std::string &name, const std::string &help,
+                                                   const std::string &label, long first, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Family &target = family(name, help, Type::Counter);
+    target.array_label = label;
+    size_t slot = allocate(target, {}, size, first, size);
+    // 溢出槽只有一个可写位置，所有标签值都映射到它
+    return slot == 0 ? CounterArray(0, first, 0) : CounterArray(slot, first, size);
+}
+
+inline std::string MetricsRegistry::format_labels(const MetricLabels &labels) {
+    std::string out;
+    for (const auto &label : labels) {
+        if (!out.empty()) {
+            out.push_back(',');
+        }
+        out.append(label.first).append("=\"");
+        for (char c : label.second) {
+            if (c == '\\' || c == '"') {
+                out.push_back('\\');
+                out.push_back(c);
+            } else if (c == '\n') {
+                out.append("\\n");
+            } else {
+                out.push_back(c);
+            }
+        }
+        out.push_back('"');
+    }
+    return out;
+}
+
+inline std::string MetricsRegistry::join_labels(const std::string &labels, const std::string &extra) {
+    if (labels.empty()) {
+        return extra.empty() ? std::string() : "{" + extra + "}";
+    }
+    return "{" + labels + (extra.empty() ? "" : "," + extra) + "}";
+}
+
+inline std::string MetricsRegistry::format_seconds(uint64_t micros) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6f", static_cast<double>(micros) / 1e6);
+    return buffer;
+}
+
+inline std::string MetricsRegistry::prometheus_text() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint64_t> values = totals();
+
+    std::string out;
+    for (const auto &family : families_) {
+        out.append("# HELP ").append(family->name).append(" ").append(family->help).append("\n");
+        out.append("# TYPE ").append(family->name).append(family->type == Type::Counter ? " counter\n" : " histogram\n");
+        for (const auto &series : family->series) {
+            if (series.slot == 0) {
+                continue;
+            }
+            if (family->type == Type::Counter && series.size == 0) {
+                out.append(family->name).append(join_labels(series.labels, ""));
+                out.append(" ").append(std::to_string(values[series.slot])).append("\n");
+            } else if (family->type == Type::Counter) {
+                for (size_t i = 0; i < series.size; ++i) {
+                    if (values[series.slot + i] == 0) {
+                        continue;
+                    }
+                    std::string label = family->array_label + "=\"" +
+                                        std::to_string(series.first + static_cast<long>(i)) + "\"";
+                    out.append(family->name).append(join_labels(series.labels, label));
+                    out.append(" ").append(std::to_string(values[series.slot + i])).append("\n");
+                }
+            } else {
+                // 累积计数：le=2^k 微秒的桶包含下界小于 2^k 的所有细分桶
+                uint64_t cumulative = 0;
+                size_t bucket = 0;
+                for (unsigned exponent = 7; exponent < Histogram::kMaxExponent; ++exponent) {
+                    uint64_t bound = uint64_t{1} << exponent;
+                    size_t end = Histogram::bucket_index(bound);
+                    for (; bucket < end; ++bucket) {
+                        cumulative += values[series.slot + bucket];
+                    }
+                    out.append(family->name).append("_bucket");
+                    out.append(join_labels(series.labels, "le=\"" + format_seconds(bound) + "\""));
+                    out.append(" ").append(std::to_string(cumulative)).append("\n");
+                }
+                for (; bucket < Histogram::kBuckets; ++bucket) {
+                    cumulative += values[series.slot + bucket];
+                }
+                out.append(family->name).append("_bucket").append(join_labels(series.labels, "le=\"+Inf\""));
+                out.append(" ").append(std::to_string(cumulative)).append("\n");
+                out.append(family->name).append("_sum").append(join_labels(series.labels, ""));
+                out.append(" ").append(format_seconds(values[series.slot + Histogram::kBuckets])).append("\n");
+                out.append(family->name).append("_count").append(join_labels(series.labels, ""));
+                out.append(" ").append(std::to_string(cumulative)).append("\n");
+            }
+        }
+    }
+    return out;
+}
+
+inline DoHMetrics::DoHMetrics() {
+    auto &registry = MetricsRegistry::instance();
+    for (DoHMethod method : {DoHMethod::GET, DoHMethod::POST, DoHMethod::JSON_GET}) {
+        duration[static_cast<int>(method)] =
+            registry.histogram("doh_query_duration_seconds", "DoH request latency including connection setup",
+                               {{"method", doh_method_config_name(method)}});
+    }
+    http_status = registry.counter_array("doh_http_responses_total", "DoH responses by HTTP status code", "status",
+                                         100, 500);
+    curl_errors = registry.counter_array("doh_curl_errors_total", "DoH transfers failed by curl error code", "code",
+                                         0, 128);
+    bytes_sent = registry.counter("doh_bytes_total", "Bytes on the wire for DoH requests, headers included",
+                                  {{"direction", "sent"}});
+    bytes_received = registry.counter("doh_bytes_total", "Bytes on the wire for DoH requests, headers included",
+                                      {{"direction", "received"}});
+    cache_hits = registry.counter("dns_cache_lookups_total", "Resolver cache lookups", {{"result", "hit"}});
+    cache_misses = registry.counter("dns_cache_lookups_total", "Resolver cache lookups", {{"result", "miss"}});
+    fallbacks = registry.counter("dns_system_fallbacks_total", "Queries answered through the system DNS fallback");
+}
+
+inline DoHProviderMetrics *DoHMetrics::provider(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = providers_.find(url);
+    if (it != providers_.end()) {
+        return it->second.get();
+    }
+    std::string label = providers_.size() < kMaxProviders ? url : "other";
+    if (label == "other") {
+        it = providers_.find(label);
+        if (it != providers_.end()) {
+            return it->second.get();
+        }
+    }
+    auto metrics = std::make_unique<DoHProviderMetrics>();
+    auto &registry = MetricsRegistry::instance();
+    for (DoHMethod method : {DoHMethod::GET, DoHMethod::POST, DoHMethod::JSON_GET}) {
+        metrics->queries[static_cast<int>(method)] =
+            registry.counter("doh_queries_total", "DoH queries by method and provider",
+                             {{"method", doh_method_config_name(method)}, {"provider", label}});
+    }
+    for (size_t i = 0; i < kDoHPhaseCount; ++i) {
+        metrics->phases[i] = registry.histogram("doh_phase_duration_seconds", "DoH request time spent per phase",
+                                                {{"phase", doh_phase_name(static_cast<DoHPhase>(i))},
+                                                 {"provider", label}});
+    }
+    return providers_.emplace(label, std::move(metrics)).first->second.get();
+}
+
+inline std::vector<DoHPhaseSummary> DoHMetrics::phase_summaries() {
+    std::vector<std::pair<std::string, const DoHProviderMetrics *>> providers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &entry : providers_) {
+            providers.emplace_back(entry.first, entry.second.get());
+        }
+    }
+    std::sort(providers.begin(), providers.end());
+
+    std::vector<DoHPhaseSummary> summaries;
+    for (const auto &provider : providers) {
+        DoHPhaseSummary summary;
+        summary.provider = provider.first;
+        for (size_t i = 0; i < kDoHPhaseCount; ++i) {
+            summary.phases[i] = provider.second->phases[i].snapshot();
+        }
+        if (summary.phases[static_cast<size_t>(DoHPhase::Total)].count > 0) {
+            summaries.push_back(std::move(summary));
+        }
+    }
+    return summaries;
+}
+
+inline std::string DoHMetrics::phase_report() {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    for (const auto &summary : phase_summaries()) {
+        out << summary.provider << '\n';
+        out << "  " << std::left << std::setw(12) << "phase" << std::right << std::setw(8) << "count" << std::setw(12)
+            << "mean ms" << std::setw(12) << "p50 ms" << std::setw(12) << "p90 ms" << std::setw(12) << "p99 ms" << '\n';
+        for (size_t i = 0; i < kDoHPhaseCount; ++i) {
+            const HistogramSnapshot &phase = summary.phases[i];
+            if (phase.count == 0) {
+                continue;
+            }
+            out << "  " << std::left << std::setw(12) << doh_phase_name(static_cast<DoHPhase>(i)) << std::right
+                << std::setw(8) << phase.count << std::setw(12)
+                << static_cast<double>(phase.sum) / static_cast<double>(phase.count) / 1000.0 << std::setw(12)
+                << static_cast<double>(phase.percentile(0.5)) / 1000.0 << std::setw(12)
+                << static_cast<double>(phase.percentile(0.9)) / 1000.0 << std::setw(12)
+                << static_cast<double>(phase.percentile(0.99)) / 1000.0 << '\n';
+        }
+    }
+    return out.str();
+}
+
+#endif  // METRICS_HPP
@@ -0,0 +1,349 @@
+#ifndef PROVIDER_HEALTH_HPP
+#define PROVIDER_HEALTH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "config.hpp"
+
+/**
+ * @brief 熔断器状态
+ */
+enum class CircuitState {
+    Closed,    // 正常放行
+    Open,      // 连续失败后暂停使用，冷却期内不放行
+    HalfOpen,  // 冷却期结束，放行一个探测请求
+};
+
+/**
+ * @brief 单个服务商的健康统计
+ */
+struct ProviderStats {
+    double latency_ewma_ms = 0;  // 成功请求延迟的指数加权平均
+    double latency_p50_ms = 0;   // 最近成功请求延迟的中位数
+    double latency_p95_ms = 0;   // 最近成功请求延迟的95分位
+    double error_rate = 0;       // 失败率的指数加权平均（0~1）
+    uint64_t successes = 0;
+    uint64_t failures = 0;
+    CircuitState state = CircuitState::Closed;
+};
+
+/**
+ * @brief 服务商健康跟踪与评分
+ * @details 以服务商URL为键，记录成功请求的延迟（EWMA与最近样本的分位数）和失败率。
+ *          连续 failure_threshold 次网络/HTTP失败后熔断器打开，open_ms 内不再放行；
+ *          冷却结束后进入半开状态，只放行一个探测请求：探测成功则关闭，失败则重新打开且冷却时间翻倍
+ *          （不超过 max_open_ms）。
+ *          rank() 按实时评分排序服务商：评分 = 延迟EWMA × (1 + 4 × 失败率) + 25ms × (priority - 1)，
+ *          越小越好；没有样本的服务商按 kInitialLatencyMs 计算，静态优先级仍作为同等延迟下的次序。
+ *          线程安全。
+ */
+class ProviderHealth {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr double kInitialLatencyMs = 100.0;
+
+    explicit ProviderHealth(const HealthConfig& config = HealthConfig{}) : config_(config) {}
+
+    ProviderHealth(const ProviderHealth&) = delete;
+    ProviderHealth& operator=(const ProviderHealth&) = delete;
+
+    /**
+     * @brief 进程内共享的实例，启动时由 configure() 按配置文件设置阈值
+     */
+    static ProviderHealth& instance() {
+        static ProviderHealth health;
+        return health;
+    }
+
+    /**
+     * @brief 更新熔断阈值与冷却时间，已有的统计与熔断状态保留
+     */
+    void configure(const HealthConfig& config);
+
+    /**
+     * @brief 服务商当前是否可用（熔断关闭，或冷却结束且探测资格未被占用）
+     */
+    bool available(const std::string& provider, Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief 选择要使用的服务商URL
+     * @details preferred 可用时直接返回；否则按 servers 的顺序返回第一个启用且可用的服务商，
+     *          全部不可用时仍返回 preferred
+     */
+    std::string select(const std::string& preferred, const std::vector<DoHServerConfig>& servers,
+                       Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief 是否可以向服务商发起请求
+     * @details 半开状态下第一个调用者取得探测资格并返回true，探测结束前其余调用返回false
+     */
+    bool allow(const std::string& provider, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 记录一次成功请求及其延迟
+     */
+    void record_success(const std::string& provider, std::chrono::microseconds latency);
+
+    /**
+     * @brief 记录一次网络或HTTP失败
+     */
+    void record_failure(const std::string& provider, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief 请求在完成前被放弃（例如竞速落败被取消）
+     * @details 不计为失败；已等待的时间是延迟的下限，超过当前EWMA时把EWMA向它拉近。
+     *          若该请求是半开探测，则释放探测资格
+     */
+    void record_abandoned(const std::string& provider, std::chrono::microseconds waited);
+
+    /**
+     * @brief 服务商当前评分（越小越好）
+     */
+    double score(const DoHServerConfig& server) const;
+
+    /**
+     * @brief 按评分排序服务商，熔断打开的服务商排在最后
+     */
+    std::vector<DoHServerConfig> rank(std::vector<DoHServerConfig> servers,
+                                      Clock::time_point now = Clock::now()) const;
+
+    /**
+     * @brief 服务商的统计信息，没有记录时返回默认值
+     */
+    ProviderStats stats(const std::string& provider) const;
+
+    /**
+     * @brief 熔断器状态（打开状态在冷却结束后报告为半开）
+     */
+    CircuitState state(const std::string& provider, Clock::time_point now = Clock::now()) const;
+
+private:
+    static constexpr double kLatencyAlpha = 0.2;
+    static constexpr double kErrorAlpha = 0.1;
+    static constexpr size_t kSamples = 128;  // 分位数使用的最近样本数
+
+    struct Provider {
+        double latency_ewma_ms = kInitialLatencyMs;
+        bool has_latency = false;
+        double error_rate = 0;
+        uint64_t successes = 0;
+        uint64_t failures = 0;
+        std::vector<double> samples;  // 环形缓冲
+        size_t next_sample = 0;
+
+        CircuitState state = CircuitState::Closed;
+        int consecutive_failures = 0;
+        std::chrono::milliseconds open_duration{0};
+        Clock::time_point open_until;
+        bool probing = false;
+    };
+
+    void open(Provider& provider, Clock::time_point now);
+    double score_locked(const DoHServerConfig& server) const;
+    bool available_locked(const std::string& url, Clock::time_point now) const;
+
+    HealthConfig config_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Provider> providers_;
+};
+
+// 实现
+inline bool ProviderHealth::allow(const std::string& provider, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = providers_.find(provider);
+    if (it == providers_.end()) {
+        return true;
+    }
+    Provider& p = it->second;
+    switch (p.state) {
+        case CircuitState::Closed:
+            return true;
+        case CircuitState::Open:
+            if (now < p.open_until) {
+                return false;
+            }
+            p.state = CircuitState::HalfOpen;
+            p.probing = true;
+            return true;
+        case CircuitState::HalfOpen:
+            if (p.probing) {
+                return false;
+            }
+            p.probing = true;
+            return true;
+    }
+    return true;
+}
+
+inline void ProviderHealth::record_success(const std::string& provider, std::chrono::microseconds latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Provider& p = providers_[provider];
+    double ms = latency.count() / 1000.0;
+
+    p.latency_ewma_ms = p.has_latency ? p.latency_ewma_ms + kLatencyAlpha * (ms - p.latency_ewma_ms) : ms;
+    p.has_latency = true;
+    p.error_rate -= kErrorAlpha * p.error_rate;
+    ++p.successes;
+
+    if (p.samples.size() < kSamples) {
+        p.samples.push_back(ms);
+    } else {
+        p.samples[p.next_sample] = ms;
+    }
+    p.next_sample = (p.next_sample + 1) % kSamples;
+
+    // 成功即关闭熔断器，冷却时间恢复初始值
+    p.state = CircuitState::Closed;
+    p.consecutive_failures = 0;
+    p.open_duration = std::chrono::milliseconds(0);
+    p.probing = false;
+}
+
+inline void ProviderHealth::record_failure(const std::string& provider, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Provider& p = providers_[provider];
+    p.error_rate += kErrorAlpha * (1.0 - p.error_rate);
+    ++p.failures;
+    ++p.consecutive_failures;
+
+    // 打开期间到达的失败（熔断前已发出的请求）不重置冷却时间
+    if (p.state == CircuitState::HalfOpen ||
+        (p.state == CircuitState::Closed && p.consecutive_failures >= std::max(config_.failure_threshold, 1))) {
+        open(p, now);
+    }
+}
+
+inline void ProviderHealth::record_abandoned(const std::string& provider, std::chrono::microseconds waited) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = providers_.find(provider);
+    if (it == providers_.end()) {
+        return;
+    }
+    Provider& p = it->second;
+    double ms = waited.count() / 1000.0;
+    if (p.has_latency && ms > p.latency_ewma_ms) {
+        p.latency_ewma_ms += kLatencyAlpha * (ms - p.latency_ewma_ms);
+    }
+    p.probing = false;
+}
+
+inline void ProviderHealth::open(Provider& p, Clock::time_point now) {
+    auto base = std::chrono::milliseconds(std::max(config_.open_ms, 0));
+    auto limit = std::chrono::milliseconds(std::max(config_.max_open_ms, config_.open_ms));
+    p.open_duration = p.state == CircuitState::HalfOpen ? std::min(p.open_duration * 2, limit) : base;
+    p.open_until = now + p.open_duration;
+    p.state = CircuitState::Open;
+    p.probing = false;
+}
+
+inline double ProviderHealth::score(const DoHServerConfig& server) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return score_locked(server);
+}
+
+inline double ProviderHealth::score_locked(const DoHServerConfig& server) const {
+    double latency = kInitialLatencyMs;
+    double error_rate = 0;
+    auto it = providers_.find(server.url);
+    if (it != providers_.end()) {
+        latency = it->second.latency_ewma_ms;
+        error_rate = it->second.error_rate;
+    }
+    return latency * (1.0 + 4.0 * error_rate) + 25.0 * (server.priority - 1);
+}
+
+inline bool ProviderHealth::available_locked(const std::string& url, Clock::time_point now) const {
+    auto it = providers_.find(url);
+    if (it == providers_.end()) {
+        return true;
+    }
+    const Provider& p = it->second;
+    return p.state == CircuitState::Closed || (p.state == CircuitState::Open && now >= p.open_until) ||
+           (p.state == CircuitState::HalfOpen && !p.probing);
+}
+
+inline void ProviderHealth::configure(const HealthConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+inline bool ProviderHealth::available(const std::string& provider, Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return available_locked(provider, now);
+}
+
+inline std::string ProviderHealth::select(const std::string& preferred, const std::vector<DoHServerConfig>& servers,
+                                          Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (available_locked(preferred, now)) {
+        return preferred;
+    }
+    for (const auto& server : servers) {
+        if (server.enabled && available_locked(server.url, now)) {
+            return server.url;
+        }
+    }
+    return preferred;
+}
+
+inline std::vector<DoHServerConfig> ProviderHealth::rank(std::vector<DoHServerConfig> servers,
+                                                         Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<std::pair<bool, double>, size_t>> keys;
+    keys.reserve(servers.size());
+    for (size_t i = 0; i < servers.size(); ++i) {
+        keys.push_back({{!available_locked(servers[i].url, now), score_locked(servers[i])}, i});
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<DoHServerConfig> ranked;
+    ranked.reserve(servers.size());
+    for (const auto& key : keys) {
+        ranked.push_back(std::move(servers[key.second]));
+    }
+    return ranked;
+}
+
+inline ProviderStats ProviderHealth::stats(const std::string& provider) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProviderStats stats;
+    auto it = providers_.find(provider);
+    if (it == providers_.end()) {
+        return stats;
+    }
+    const Provider& p = it->second;
+    stats.latency_ewma_ms = p.has_latency ? p.latency_ewma_ms : 0;
+    stats.error_rate = p.error_rate;
+    stats.successes = p.successes;
+    stats.failures = p.failures;
+    stats.state = p.state;
+
+    if (!p.samples.empty()) {
+        auto sorted = p.samples;
+        std::sort(sorted.begin(), sorted.end());
+        stats.latency_p50_ms = sorted[(sorted.size() - 1) / 2];
+        stats.latency_p95_ms = sorted[(sorted.size() - 1) * 95 / 100];
+    }
+    return stats;
+}
+
+inline CircuitState ProviderHealth::state(const std::string& provider, Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = providers_.find(provider);
+    if (it == providers_.end()) {
+        return CircuitState::Closed;
+    }
+    if (it->second.state == CircuitState::Open && now >= it->second.open_until) {
+        return CircuitState::HalfOpen;
+    }
+    return it->second.state;
+}
+
+#endif  // PROVIDER_HEALTH_HPP
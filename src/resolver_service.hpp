@@ -0,0 +1,168 @@
+#ifndef RESOLVER_SERVICE_HPP
+#define RESOLVER_SERVICE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dns_cache.hpp"
+#include "doh_client.hpp"
+#include "logger.hpp"
+#include "work_stealing_pool.hpp"
+
+/**
+ * @brief 多线程DoH解析服务
+ * @details DoHClientImpl 只有一个curl句柄，不能在线程间共享；本服务为每个工作线程创建一个客户端，
+ *          解析任务经 WorkStealingPool 分发，在执行它的工作线程自己的客户端上阻塞完成。
+ *          各客户端接入同一个连接池（共享TLS会话），并可共享同一个缓存与在途查询合并组。
+ *          解析只走DoH，不回退到系统DNS；失败（包括查询抛出异常）时结果为空（RCODE为-1），回调总会被调用。
+ */
+class ResolverService {
+public:
+    using Callback = std::function<void(std::vector<DNSRecord> records)>;
+    using AnswerCallback = std::function<void(DnsAnswer answer)>;
+
+    /**
+     * @brief 构造函数
+     * @param server DoH服务器URL
+     * @param threads 工作线程数，0表示使用硬件并发数
+     * @param method 查询使用的DoH方法
+     * @param pool 连接池，为nullptr时不接入；池的生命周期必须长于服务
+     */
+    explicit ResolverService(const std::string& server, size_t threads = 0, DoHMethod method = DoHMethod::GET,
+                             DoHConnectionPool* pool = &DoHConnectionPool::instance());
+
+    ResolverService(const ResolverService&) = delete;
+    ResolverService& operator=(const ResolverService&) = delete;
+
+    /**
+     * @brief 为所有工作线程的客户端设置共享缓存，应在提交查询前调用
+     */
+    void set_cache(std::shared_ptr<DnsCache> cache);
+
+    /**
+     * @brief 设置在途查询合并组，应在提交查询前调用；nullptr表示不合并
+     */
+    void set_single_flight(DoHSingleFlight* group);
+
+    /**
+     * @brief 设置方法支持情况缓存，应在提交查询前调用；nullptr表示始终使用构造时指定的方法
+     */
+    void set_method_cache(DoHMethodCache* cache);
+
+    /**
+     * @brief 提交解析任务，完成后在工作线程上调用回调
+     */
+    void resolve(const std::string& domain, DNSRecordType type, Callback callback);
+
+    /**
+     * @brief 提交解析任务，回调同时得到上游应答的RCODE，可据此区分NXDOMAIN、NODATA与失败
+     */
+    void resolve_answer(const std::string& domain, DNSRecordType type, AnswerCallback callback);
+
+    /**
+     * @brief 提交解析任务，通过future获取结果
+     */
+    std::future<std::vector<DNSRecord>> resolve(const std::string& domain, DNSRecordType type = DNSRecordType::A);
+
+    /**
+     * @brief 工作线程数
+     */
+    size_t threads() const { return scheduler_.size(); }
+
+    /**
+     * @brief 被空闲线程窃取执行的任务数
+     */
+    uint64_t steals() const { return scheduler_.steals(); }
+
+    /**
+     * @brief 每个工作线程已完成的解析数
+     */
+    std::vector<uint64_t> completed_per_thread() const;
+
+private:
+    struct Worker {
+        std::unique_ptr<DoHClient> client;
+        std::atomic<uint64_t> completed{0};
+    };
+
+    DoHMethod method_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    WorkStealingPool scheduler_;  // 最后声明：最先析构，等待任务全部完成后客户端才被释放
+};
+
+// 实现
+inline ResolverService::ResolverService(const std::string& server, size_t threads, DoHMethod method,
+                                        DoHConnectionPool* pool)
+    : method_(method), scheduler_(threads == 0 ? WorkStealingPool::default_threads() : threads) {
+    // 构造完成前不会有任务提交，工作线程此时不会访问 workers_
+    workers_.reserve(scheduler_.size());
+    for (size_t i = 0; i < scheduler_.size(); ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->client = std::make_unique<DoHClient>(server, pool);
+        workers_.push_back(std::move(worker));
+    }
+}
+
+inline void ResolverService::set_cache(std::shared_ptr<DnsCache> cache) {
+    for (auto& worker : workers_) {
+        worker->client->set_cache(cache);
+    }
+}
+
+inline void ResolverService::set_single_flight(DoHSingleFlight* group) {
+    for (auto& worker : workers_) {
+        worker->client->set_single_flight(group);
+    }
+}
+
+inline void ResolverService::set_method_cache(DoHMethodCache* cache) {
+    for (auto& worker : workers_) {
+        worker->client->set_method_cache(cache);
+    }
+}
+
+inline void ResolverService::resolve(const std::string& domain, DNSRecordType type, Callback callback) {
+    resolve_answer(domain, type,
+                   [callback = std::move(callback)](DnsAnswer answer) { callback(std::move(answer.records)); });
+}
+
+inline void ResolverService::resolve_answer(const std::string& domain, DNSRecordType type, AnswerCallback callback) {
+    scheduler_.submit([this, domain, type, callback = std::move(callback)](size_t index) {
+        Worker& worker = *workers_[index];
+        // 查询抛出的异常在这里吞掉并以空结果回调，否则任务被线程池丢弃、回调永远不会执行
+        DnsAnswer answer;
+        try {
+            answer = worker.client->query_answer(domain, type, method_, false);
+        } catch (const std::exception& e) {
+            Logger::warn("Resolving {} failed: {}", domain, e.what());
+        } catch (...) {
+            Logger::warn("Resolving {} failed with unknown exception", domain);
+        }
+        worker.completed.fetch_add(1, std::memory_order_relaxed);
+        callback(std::move(answer));
+    });
+}
+
+inline std::future<std::vector<DNSRecord>> ResolverService::resolve(const std::string& domain, DNSRecordType type) {
+    auto promise = std::make_shared<std::promise<std::vector<DNSRecord>>>();
+    auto future = promise->get_future();
+    resolve(domain, type, [promise](std::vector<DNSRecord> records) { promise->set_value(std::move(records)); });
+    return future;
+}
+
+inline std::vector<uint64_t> ResolverService::completed_per_thread() const {
+    std::vector<uint64_t> completed;
+    completed.reserve(workers_.size());
+    for (const auto& worker : workers_) {
+        completed.push_back(worker->completed.load(std::memory_order_relaxed));
+    }
+    return completed;
+}
+
+#endif  // RESOLVER_SERVICE_HPP
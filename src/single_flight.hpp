@@ -0,0 +1,115 @@
+#ifndef SINGLE_FLIGHT_HPP
+#define SINGLE_FLIGHT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief 相同请求合并（single-flight）
+ * @details 以字符串为键：某个键没有在途请求时，调用者成为发起者并执行请求；
+ *          请求完成前以同一个键到达的调用者不再执行请求，而是等待并共享发起者的结果
+ *          （包括异常）。请求完成后键即被移除，之后的调用重新发起请求。
+ * @tparam Value 请求结果类型，需可拷贝
+ */
+template <typename Value>
+class SingleFlight {
+public:
+    SingleFlight() = default;
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    /**
+     * @brief 进程内共享的实例
+     */
+    static SingleFlight& instance() {
+        static SingleFlight group;
+        return group;
+    }
+
+    /**
+     * @brief 执行请求，或等待同键的在途请求
+     * @param key 请求键
+     * @param fn 无参函数，返回 Value；只有发起者会调用
+     * @param shared 非空时写入本次调用是否共享了其他调用者的结果
+     * @return 请求结果；请求抛出的异常会在所有等待者上重新抛出
+     */
+    template <typename Fn>
+    Value run(const std::string& key, Fn&& fn, bool* shared = nullptr);
+
+    /**
+     * @brief 因合并而节省的上游请求数（即共享结果的调用次数）
+     */
+    uint64_t saved_requests() const { return saved_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 当前在途的请求数（不同键）
+     */
+    size_t in_flight() const;
+
+private:
+    struct Flight {
+        std::promise<Value> promise;
+        std::shared_future<Value> result;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+    std::atomic<uint64_t> saved_{0};
+};
+
+// 实现
+template <typename Value>
+template <typename Fn>
+Value SingleFlight<Value>::run(const std::string& key, Fn&& fn, bool* shared) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = flights_.find(key);
+    if (it != flights_.end()) {
+        // 已有在途请求，释放锁后等待其结果
+        auto result = it->second->result;
+        lock.unlock();
+        saved_.fetch_add(1, std::memory_order_relaxed);
+        if (shared) {
+            *shared = true;
+        }
+        return result.get();
+    }
+
+    auto flight = std::make_shared<Flight>();
+    flight->result = flight->promise.get_future().share();
+    flights_.emplace(key, flight);
+    lock.unlock();
+    if (shared) {
+        *shared = false;
+    }
+
+    // 先移除键再发布结果，使完成之后到达的调用者重新发起请求
+    auto finish = [&]() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        flights_.erase(key);
+    };
+    try {
+        Value value = fn();
+        finish();
+        flight->promise.set_value(value);
+        return value;
+    } catch (...) {
+        finish();
+        flight->promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+template <typename Value>
+size_t SingleFlight<Value>::in_flight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flights_.size();
+}
+
+#endif  // SINGLE_FLIGHT_HPP
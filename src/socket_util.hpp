@@ -0,0 +1,82 @@
+#ifndef SOCKET_UTIL_HPP
+#define SOCKET_UTIL_HPP
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "exceptions.hpp"
+
+// 在地址上创建并绑定套接字，SOCK_STREAM 同时开始监听；reuse_port 时设置 SO_REUSEPORT，
+// 多个套接字可绑定同一端口，由内核在它们之间分发报文与连接。失败返回-1并保留errno
+// 地址无效时抛出 NetworkException
+inline int bind_socket(const std::string &bind_address, uint16_t port, int socktype, bool reuse_port = false) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo *address = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(bind_address.c_str(), service.c_str(), &hints, &address) != 0 || !address) {
+        throw NetworkException("Invalid bind address: " + bind_address);
+    }
+
+    int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    int reuse = 1;
+    bool ok = fd >= 0 && setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0 &&
+              (!reuse_port || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == 0) &&
+              bind(fd, address->ai_addr, address->ai_addrlen) == 0 &&
+              (socktype != SOCK_STREAM || listen(fd, SOMAXCONN) == 0);
+    freeaddrinfo(address);
+    if (!ok) {
+        int error = errno;
+        if (fd >= 0) {
+            close(fd);
+        }
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+inline uint16_t bound_port(int fd) {
+    sockaddr_storage bound{};
+    socklen_t length = sizeof(bound);
+    getsockname(fd, reinterpret_cast<sockaddr *>(&bound), &length);
+    return ntohs(bound.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6 *>(&bound)->sin6_port
+                                             : reinterpret_cast<sockaddr_in *>(&bound)->sin_port);
+}
+
+// 读满 size 字节，连接关闭或出错时返回false
+inline bool recv_exact(int fd, char *out, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, out + received, size - received, 0);
+        if (n <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline bool send_all(int fd, const char *data, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = send(fd, data + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#endif  // SOCKET_UTIL_HPP
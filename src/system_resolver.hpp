@@ -0,0 +1,281 @@
+#ifndef SYSTEM_RESOLVER_HPP
+#define SYSTEM_RESOLVER_HPP
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dns_types.hpp"
+#include "logger.hpp"
+
+// 使用getaddrinfo解析地址 - family 为 AF_INET / AF_INET6 / AF_UNSPEC（同时查询A与AAAA）
+// 系统解析器不返回TTL，记录使用默认TTL 5分钟；同一地址只保留一条，失败时返回空结果
+inline std::vector<DNSRecord> resolve_with_getaddrinfo(const std::string &domain, int family) {
+    std::vector<DNSRecord> records;
+
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int status = getaddrinfo(domain.c_str(), nullptr, &hints, &result);
+    if (status != 0) {
+        Logger::warn("System DNS query for {} failed: {}", domain, gai_strerror(status));
+        return records;
+    }
+
+    // 遍历结果
+    for (struct addrinfo *p = result; p != nullptr; p = p->ai_next) {
+        char ip_str[INET6_ADDRSTRLEN];
+        DNSRecord record;
+        if (p->ai_family == AF_INET) {
+            inet_ntop(AF_INET, &reinterpret_cast<struct sockaddr_in *>(p->ai_addr)->sin_addr, ip_str, sizeof(ip_str));
+            record.type = DNSRecordType::A;
+        } else if (p->ai_family == AF_INET6) {
+            inet_ntop(AF_INET6, &reinterpret_cast<struct sockaddr_in6 *>(p->ai_addr)->sin6_addr, ip_str,
+                      sizeof(ip_str));
+            record.type = DNSRecordType::AAAA;
+        } else {
+            continue;
+        }
+        record.name = domain;
+        record.data = ip_str;
+        record.ttl = 300;  // 默认TTL 5分钟
+
+        bool duplicate = std::any_of(records.begin(), records.end(), [&](const DNSRecord &existing) {
+            return existing.type == record.type && existing.data == record.data;
+        });
+        if (!duplicate) {
+            records.push_back(std::move(record));
+        }
+    }
+
+    freeaddrinfo(result);
+    return records;
+}
+
+/**
+ * @brief 带超时的系统DNS解析
+ * @details getaddrinfo 是阻塞调用，且不受调用方超时控制（解析器自身的重试可能持续数十秒）。
+ *          本类在固定数量的后台线程上执行 getaddrinfo，调用方只等待到自己的截止时间：
+ *          超时的查询若尚未开始则直接丢弃，已经在执行的查询结果被忽略。
+ *          排队的查询数有上限，系统解析器整体卡住时新的查询立即失败而不是无限堆积。
+ *          没有使用 getaddrinfo_a，它只在glibc上可用。
+ */
+class SystemDnsResolver {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief 执行一次阻塞解析的函数，参数为域名与地址族
+     */
+    using LookupFunction = std::function<std::vector<DNSRecord>(const std::string& domain, int family)>;
+
+    /**
+     * @brief 一次在途的系统DNS查询
+     */
+    class Lookup {
+    public:
+        /**
+         * @brief 等待结果直到截止时间
+         * @return 是否在截止时间前完成；超时时查询被取消，records 不变
+         */
+        bool wait_until(Clock::time_point deadline, std::vector<DNSRecord>& records);
+
+        /**
+         * @brief 取消查询：尚未开始执行的查询不再执行
+         */
+        void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+        bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class SystemDnsResolver;
+
+        Lookup(std::string domain, int family) : domain_(std::move(domain)), family_(family) {}
+        void complete(std::vector<DNSRecord> records);
+
+        std::string domain_;
+        int family_;
+        std::atomic<bool> cancelled_{false};
+        std::mutex mutex_;
+        std::condition_variable done_cv_;
+        bool done_ = false;
+        std::vector<DNSRecord> records_;
+    };
+
+    /**
+     * @brief 构造函数，立即启动后台线程
+     * @param threads 执行 getaddrinfo 的线程数
+     * @param max_pending 排队等待执行的查询上限
+     * @param lookup 阻塞解析函数，默认为 resolve_with_getaddrinfo
+     */
+    explicit SystemDnsResolver(size_t threads = 4, size_t max_pending = 256,
+                               LookupFunction lookup = resolve_with_getaddrinfo);
+
+    /**
+     * @brief 析构函数，丢弃排队的查询并等待正在执行的 getaddrinfo 返回
+     */
+    ~SystemDnsResolver();
+
+    SystemDnsResolver(const SystemDnsResolver&) = delete;
+    SystemDnsResolver& operator=(const SystemDnsResolver&) = delete;
+
+    /**
+     * @brief 进程内共享的实例
+     * @details 有意不释放：退出时不必等待可能卡住的 getaddrinfo
+     */
+    static SystemDnsResolver& instance() {
+        static SystemDnsResolver* resolver = new SystemDnsResolver();
+        return *resolver;
+    }
+
+    /**
+     * @brief 提交查询，立即返回
+     * @param family AF_INET / AF_INET6 / AF_UNSPEC
+     * @return 查询句柄；队列已满时返回的句柄已以空结果完成
+     */
+    std::shared_ptr<Lookup> start(const std::string& domain, int family);
+
+    /**
+     * @brief 解析并最多等待 timeout，超时返回空结果
+     */
+    std::vector<DNSRecord> resolve(const std::string& domain, int family, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief 因超时被放弃的查询数
+     */
+    uint64_t timeouts() const { return timeouts_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 因队列已满被拒绝的查询数
+     */
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 记录一次超时（供 Lookup::wait_until 调用方统计）
+     */
+    void record_timeout() { timeouts_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    size_t max_pending_;
+    LookupFunction lookup_;
+    std::mutex mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<std::shared_ptr<Lookup>> queue_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::vector<std::thread> threads_;
+};
+
+// 实现
+inline bool SystemDnsResolver::Lookup::wait_until(Clock::time_point deadline, std::vector<DNSRecord>& records) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!done_cv_.wait_until(lock, deadline, [this]() { return done_; })) {
+        cancel();
+        return false;
+    }
+    records = records_;
+    return true;
+}
+
+inline void SystemDnsResolver::Lookup::complete(std::vector<DNSRecord> records) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_ = std::move(records);
+        done_ = true;
+    }
+    done_cv_.notify_all();
+}
+
+inline SystemDnsResolver::SystemDnsResolver(size_t threads, size_t max_pending, LookupFunction lookup)
+    : max_pending_(max_pending), lookup_(std::move(lookup)) {
+    size_t count = std::max<size_t>(threads, 1);
+    threads_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        threads_.emplace_back(&SystemDnsResolver::run, this);
+    }
+}
+
+inline SystemDnsResolver::~SystemDnsResolver() {
+    std::deque<std::shared_ptr<Lookup>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        abandoned.swap(queue_);
+    }
+    queue_cv_.notify_all();
+    for (auto& lookup : abandoned) {
+        lookup->complete({});
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+inline std::shared_ptr<SystemDnsResolver::Lookup> SystemDnsResolver::start(const std::string& domain, int family) {
+    std::shared_ptr<Lookup> lookup(new Lookup(domain, family));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_ && queue_.size() < max_pending_) {
+            queue_.push_back(lookup);
+            queue_cv_.notify_one();
+            return lookup;
+        }
+    }
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    lookup->complete({});
+    return lookup;
+}
+
+inline std::vector<DNSRecord> SystemDnsResolver::resolve(const std::string& domain, int family,
+                                                         std::chrono::milliseconds timeout) {
+    std::vector<DNSRecord> records;
+    if (!start(domain, family)->wait_until(Clock::now() + timeout, records)) {
+        record_timeout();
+        DOH_LOG_DEBUG("System DNS lookup for {} timed out after {} ms", domain, timeout.count());
+    }
+    return records;
+}
+
+inline void SystemDnsResolver::run() {
+    while (true) {
+        std::shared_ptr<Lookup> lookup;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            lookup = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        // 调用方已放弃的查询不再执行
+        if (lookup->cancelled()) {
+            lookup->complete({});
+            continue;
+        }
+        lookup->complete(lookup_(lookup->domain_, lookup->family_));
+    }
+}
+
+#endif  // SYSTEM_RESOLVER_HPP
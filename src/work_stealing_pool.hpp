@@ -0,0 +1,191 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+
+/**
+ * @brief 固定大小的工作窃取线程池
+ * @details 每个工作线程有自己的任务队列：工作线程内提交的任务放入本线程队列，
+ *          外部提交的任务轮流分配到各队列。工作线程优先从自己队列的尾部取任务（后进先出，
+ *          子任务趁数据还在缓存中时执行），本队列为空时从其他队列的头部窃取最早的任务，
+ *          因此某个线程被慢任务阻塞时，排在它后面的任务会被空闲线程接走。
+ *          任务以工作线程编号为参数，便于使用按线程分配的资源（如各自的curl句柄）。
+ *          析构时执行完所有已提交的任务再退出。
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void(size_t worker)>;
+
+    /**
+     * @brief 构造函数，立即启动工作线程
+     * @param threads 工作线程数，0表示使用硬件并发数
+     */
+    explicit WorkStealingPool(size_t threads = 0);
+
+    /**
+     * @brief 析构函数，等待已提交的任务全部完成后回收线程
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief 提交任务；任务抛出的异常被记录后忽略
+     */
+    void submit(Task task);
+
+    /**
+     * @brief 工作线程数
+     */
+    size_t size() const { return queues_.size(); }
+
+    /**
+     * @brief 从其他线程队列窃取的任务数
+     */
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 尚未开始执行的任务数
+     */
+    size_t pending() const { return pending_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 默认线程数：硬件并发数，无法获取时为1
+     */
+    static size_t default_threads() { return std::max<size_t>(std::thread::hardware_concurrency(), 1); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // 当前线程所属的线程池与工作线程编号
+    struct WorkerSlot {
+        const WorkStealingPool* pool = nullptr;
+        size_t index = 0;
+    };
+
+    static WorkerSlot& current_worker() {
+        static thread_local WorkerSlot slot;
+        return slot;
+    }
+
+    void run(size_t index);
+    bool pop_local(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<uint64_t> steals_{0};
+    bool stopping_ = false;  // 由 wake_mutex_ 保护
+};
+
+// 实现
+inline WorkStealingPool::WorkStealingPool(size_t threads) {
+    size_t count = threads == 0 ? default_threads() : threads;
+    queues_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        threads_.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+inline WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+inline void WorkStealingPool::submit(Task task) {
+    const WorkerSlot& slot = current_worker();
+    size_t index = slot.pool == this ? slot.index
+                                     : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    // 计数先于入队增加，取到任务的线程递减时计数不会下溢；在 wake_mutex_ 内修改，避免丢失唤醒
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        pending_.fetch_add(1, std::memory_order_release);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+inline bool WorkStealingPool::pop_local(size_t index, Task& task) {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+inline bool WorkStealingPool::steal(size_t thief, Task& task) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        Queue& queue = *queues_[(thief + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void WorkStealingPool::run(size_t index) {
+    current_worker() = WorkerSlot{this, index};
+    while (true) {
+        Task task;
+        if (pop_local(index, task) || steal(index, task)) {
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            try {
+                task(index);
+            } catch (const std::exception& e) {
+                Logger::warn("Worker {} task failed: {}", index, e.what());
+            } catch (...) {
+                Logger::warn("Worker {} task failed with unknown exception", index);
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || pending_.load(std::memory_order_acquire) > 0; });
+        if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+#endif  // WORK_STEALING_POOL_HPP
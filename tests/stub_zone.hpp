@@ -0,0 +1,35 @@
+#ifndef STUB_ZONE_HPP
+#define STUB_ZONE_HPP
+
+#include <sstream>
+#include <string>
+
+#include "doh_stub_server.hpp"
+
+/**
+ * @brief 测试与基准共用的 DoHStubServer 区域
+ * @details example.com 有 A（TTL 120）、AAAA（TTL 30）、MX 与两段字符串的TXT；
+ *          www.example.com（TTL 60）与 alias.example.com 组成指向它的CNAME链；
+ *          big.example.com 有40条A记录，应答超过512字节，UDP上必然被截断。
+ *          其余名称返回NXDOMAIN，已有名称上没有的类型返回NODATA。
+ */
+inline DnsZone make_stub_zone() {
+    std::istringstream input(R"(
+; 测试区域
+$TTL 120
+example.com.            IN  A      192.0.2.1
+example.com.        30      AAAA   2001:db8::1
+example.com.            IN  MX     10 mail.example.com.
+example.com.            IN  TXT    "v=spf1 -all" "second string"
+www.example.com.    60  IN  CNAME  Example.COM.
+alias.example.com.      IN  CNAME  www.example.com.
+)");
+    DnsZone zone;
+    zone.load(input);
+    for (int i = 1; i <= 40; ++i) {
+        zone.add("big.example.com", DNSRecordType::A, 60, "198.51.100." + std::to_string(i));
+    }
+    return zone;
+}
+
+#endif  // STUB_ZONE_HPP
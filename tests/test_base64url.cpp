@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base64url.hpp"
+
+namespace {
+
+struct Kernel {
+    const char *name;
+    base64url_detail::EncodeKernel encode;
+    base64url_detail::DecodeKernel decode;
+};
+
+// 当前CPU可用的全部实现，逐一与标量实现对照
+std::vector<Kernel> available_kernels() {
+    std::vector<Kernel> kernels = {{"scalar", base64url_detail::encode_scalar, base64url_detail::decode_scalar}};
+#ifdef BASE64URL_HAVE_X86_KERNELS
+    if (__builtin_cpu_supports("ssse3")) {
+        kernels.push_back({"ssse3", base64url_detail::encode_ssse3, base64url_detail::decode_ssse3});
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({"avx2", base64url_detail::encode_avx2, base64url_detail::decode_avx2});
+    }
+#endif
+    return kernels;
+}
+
+std::string random_bytes(std::mt19937 &rng, size_t length) {
+    std::string bytes(length, '\0');
+    for (auto &c : bytes) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    return bytes;
+}
+
+}  // namespace
+
+TEST(Base64UrlTest, Rfc4648Vectors) {
+    const std::pair<const char *, const char *> vectors[] = {
+        {"", ""},           {"f", "Zg"},           {"fo", "Zm8"},         {"foo", "Zm9v"},
+        {"foob", "Zm9vYg"}, {"fooba", "Zm9vYmE"}, {"foobar", "Zm9vYmFy"},
+    };
+    for (const auto &[plain, encoded] : vectors) {
+        EXPECT_EQ(base64url_encode(std::string(plain)), encoded);
+        std::string decoded;
+        ASSERT_TRUE(base64url_decode(encoded, decoded)) << encoded;
+        EXPECT_EQ(decoded, plain);
+    }
+}
+
+TEST(Base64UrlTest, UsesUrlSafeAlphabet) {
+    const std::string bytes("\xfb\xff\xbf", 3);
+    EXPECT_EQ(base64url_encode(bytes), "-_-_");
+
+    // RFC 8484 附录A 的查询示例
+    const std::string query("\x00\x00\x01\x00\x00\x01\x00\x00\x00\x00\x00\x00\x03www\x07"
+                            "example\x03"
+                            "com\x00\x00\x01\x00\x01",
+                            33);
+    EXPECT_EQ(base64url_encode(query), "AAABAAABAAAAAAAAA3d3dwdleGFtcGxlA2NvbQAAAQAB");
+}
+
+TEST(Base64UrlTest, AcceptsOptionalPadding) {
+    std::string decoded;
+    ASSERT_TRUE(base64url_decode("Zg==", decoded));
+    EXPECT_EQ(decoded, "f");
+    ASSERT_TRUE(base64url_decode("Zm8=", decoded));
+    EXPECT_EQ(decoded, "fo");
+}
+
+TEST(Base64UrlTest, RejectsInvalidInput) {
+    std::string decoded;
+    EXPECT_FALSE(base64url_decode("Z", decoded));      // 长度余1
+    EXPECT_FALSE(base64url_decode("Zm9v+g", decoded));  // 标准Base64字符
+    EXPECT_FALSE(base64url_decode("Zm9v/g", decoded));
+    EXPECT_FALSE(base64url_decode("Zm 9v", decoded));
+    EXPECT_FALSE(base64url_decode("Zh", decoded));  // 末尾多余位非0
+    EXPECT_FALSE(base64url_decode("Zm9=", decoded));
+    EXPECT_FALSE(base64url_decode("Zg=", decoded));  // 填充后长度不是4的倍数
+    EXPECT_FALSE(base64url_decode(std::string("Zm9v\0Zm9v", 9), decoded));
+}
+
+TEST(Base64UrlTest, KernelsAgreeWithScalar) {
+    std::mt19937 rng(20240101);
+    auto kernels = available_kernels();
+    for (size_t length = 0; length <= 200; ++length) {
+        std::string bytes = random_bytes(rng, length);
+        const auto *data = reinterpret_cast<const uint8_t *>(bytes.data());
+
+        std::string expected(base64url_encoded_size(length), '\0');
+        ASSERT_EQ(base64url_detail::encode_scalar(data, length, &expected[0]), expected.size());
+
+        for (const auto &kernel : kernels) {
+            std::string encoded(expected.size(), '\0');
+            ASSERT_EQ(kernel.encode(data, length, &encoded[0]), expected.size()) << kernel.name << " " << length;
+            EXPECT_EQ(encoded, expected) << kernel.name << " " << length;
+
+            std::vector<uint8_t> decoded(base64url_decoded_max_size(encoded.size()));
+            ASSERT_EQ(kernel.decode(encoded.data(), encoded.size(), decoded.data()), length)
+                << kernel.name << " " << length;
+            EXPECT_EQ(std::string(decoded.begin(), decoded.end()).substr(0, length), bytes) << kernel.name;
+        }
+    }
+}
+
+TEST(Base64UrlTest, KernelsRejectInvalidCharacterAtAnyPosition) {
+    std::mt19937 rng(42);
+    std::string encoded = base64url_encode(random_bytes(rng, 96));
+    std::vector<uint8_t> out(base64url_decoded_max_size(encoded.size()));
+    for (const auto &kernel : available_kernels()) {
+        for (size_t pos = 0; pos < encoded.size(); ++pos) {
+            for (char bad : {'+', '/', '=', '.', '\x80', '\xff', '`', '{', '@', '['}) {
+                std::string corrupt = encoded;
+                corrupt[pos] = bad;
+                EXPECT_EQ(kernel.decode(corrupt.data(), corrupt.size(), out.data()), SIZE_MAX)
+                    << kernel.name << " pos=" << pos << " char=" << static_cast<int>(bad);
+            }
+        }
+    }
+}
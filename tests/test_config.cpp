@@ -33,15 +33,37 @@ TEST_F(ConfigTest, DefaultConfiguration) {
     EXPECT_EQ(config.connect_timeout, 5);
     EXPECT_EQ(config.retry_count, 3);
     EXPECT_TRUE(config.enable_fallback);
+    EXPECT_EQ(config.method_cache_ttl, 3600);
+    EXPECT_EQ(config.fallback_timeout_ms, 3500);
+    EXPECT_FALSE(config.race_system_dns);
     
     // 测试缓存配置
     EXPECT_TRUE(config.cache.enabled);
     EXPECT_EQ(config.cache.max_size, 1000);
     EXPECT_EQ(config.cache.default_ttl, 300);
+    EXPECT_EQ(config.cache.stale_ttl, 30);
+    EXPECT_EQ(config.cache.prefetch_percent, 90);
+    EXPECT_EQ(config.cache.prefetch_min_hits, 3);
+    EXPECT_TRUE(config.cache.persist_path.empty());
+
+    // 测试服务商健康配置
+    EXPECT_EQ(config.health.failure_threshold, 3);
+    EXPECT_EQ(config.health.open_ms, 30000);
+    EXPECT_EQ(config.health.max_open_ms, 300000);
+
+    // 测试本地转发服务配置
+    EXPECT_EQ(config.serve.bind_address, "127.0.0.1");
+    EXPECT_EQ(config.serve.dns_port, 53);
+    EXPECT_EQ(config.serve.http_port, 8053);
+    EXPECT_EQ(config.serve.threads, 0);
+    EXPECT_EQ(config.serve.upstream_threads, 8);
+    EXPECT_EQ(config.serve.max_in_flight, 4096);
     
     // 测试日志配置
     EXPECT_EQ(config.log.level, "info");
     EXPECT_TRUE(config.log.enable_file_logging);
+    EXPECT_EQ(config.log.async_queue_size, 8192);
+    EXPECT_FALSE(config.log.block_on_overflow);
     
     // 测试服务器列表
     EXPECT_FALSE(config.servers.empty());
@@ -98,6 +120,21 @@ TEST_F(ConfigTest, ValidationFailure) {
     EXPECT_FALSE(config.validate());
 }
 
+TEST_F(ConfigTest, RaceValidation) {
+    // 竞速至少需要一个服务商，启动间隔不能为负
+    Config no_providers(test_config_file_);
+    no_providers.race.max_providers = 0;
+    EXPECT_FALSE(no_providers.validate());
+    
+    Config negative_stagger(test_config_file_);
+    negative_stagger.race.stagger_ms = -1;
+    EXPECT_FALSE(negative_stagger.validate());
+    
+    Config no_stagger(test_config_file_);
+    no_stagger.race.stagger_ms = 0;
+    EXPECT_TRUE(no_stagger.validate());
+}
+
 TEST_F(ConfigTest, GetServerConfig) {
     Config config(test_config_file_);
     
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <functional>
+#include <string>
+#include "count_min_sketch.hpp"
+
+static uint64_t hash_of(const std::string& key) { return std::hash<std::string>()(key); }
+
+TEST(CountMinSketchTest, CountsAreNeverUnderestimated) {
+    CountMinSketch sketch(1000);
+    EXPECT_EQ(sketch.width(), 1024u);
+
+    for (int i = 0; i < 200; ++i) {
+        std::string key = "host" + std::to_string(i) + ".example";
+        for (int n = 0; n <= i % 5; ++n) {
+            sketch.increment(hash_of(key));
+        }
+    }
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_GE(sketch.estimate(hash_of("host" + std::to_string(i) + ".example")), static_cast<uint32_t>(i % 5 + 1));
+    }
+    EXPECT_EQ(sketch.estimate(hash_of("hot.example")), 0u);
+
+    sketch.clear();
+    EXPECT_EQ(sketch.estimate(hash_of("host4.example")), 0u);
+}
+
+TEST(CountMinSketchTest, AgingHalvesCounters) {
+    CountMinSketch sketch(64);
+    for (int i = 0; i < 100; ++i) {
+        sketch.increment(hash_of("hot.example"));
+    }
+    EXPECT_EQ(sketch.estimate(hash_of("hot.example")), 100u);
+
+    // 累计写入达到 10 * width 时所有计数器减半
+    for (int i = 0; i < 540; ++i) {
+        sketch.increment(hash_of("other" + std::to_string(i % 20)));
+    }
+    EXPECT_EQ(sketch.estimate(hash_of("hot.example")), 50u);
+}
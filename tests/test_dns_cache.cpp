@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "dns_cache.hpp"
+
+class DnsCacheTest : public ::testing::Test {
+protected:
+    static std::vector<DNSRecord> make_records(const std::string& domain, uint32_t ttl) {
+        return {
+            {domain, DNSRecordType::A, ttl, "1.2.3.4"},
+            {domain, DNSRecordType::A, ttl + 10, "5.6.7.8"},
+        };
+    }
+
+    static CacheConfig make_config(int max_size, bool enabled = true) {
+        CacheConfig config;
+        config.enabled = enabled;
+        config.max_size = max_size;
+        config.default_ttl = 300;
+        return config;
+    }
+
+    DnsCache::Clock::time_point now_ = DnsCache::Clock::now();
+};
+
+TEST_F(DnsCacheTest, MissThenHit) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+
+    EXPECT_FALSE(cache.get("example.com", DNSRecordType::A, records, now_));
+
+    cache.put("example.com", DNSRecordType::A, make_records("example.com", 60), now_);
+    ASSERT_TRUE(cache.get("example.com", DNSRecordType::A, records, now_));
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].data, "1.2.3.4");
+    EXPECT_EQ(records[1].data, "5.6.7.8");
+
+    // 不同记录类型是不同的键
+    EXPECT_FALSE(cache.get("example.com", DNSRecordType::AAAA, records, now_));
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.insertions, 1u);
+    EXPECT_EQ(stats.size, 1u);
+}
+
+TEST_F(DnsCacheTest, HonorsMinimumTtl) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+
+    cache.put("example.com", DNSRecordType::A, make_records("example.com", 60), now_);
+
+    // 剩余TTL随时间递减，且不超过记录原始TTL
+    ASSERT_TRUE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(20)));
+    EXPECT_EQ(records[0].ttl, 40u);
+    EXPECT_EQ(records[1].ttl, 40u);
+
+    // 到达最小TTL后过期
+    EXPECT_FALSE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(60)));
+    EXPECT_EQ(cache.stats().expirations, 1u);
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(DnsCacheTest, ZeroTtlAndEmptyResultsAreNotCached) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+
+    cache.put("zero.example", DNSRecordType::A, make_records("zero.example", 0), now_);
+    cache.put("empty.example", DNSRecordType::A, {}, now_);
+
+    EXPECT_FALSE(cache.get("zero.example", DNSRecordType::A, records, now_));
+    EXPECT_FALSE(cache.get("empty.example", DNSRecordType::A, records, now_));
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(DnsCacheTest, ExplicitTtlOverride) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+
+    cache.put("sys.example", DNSRecordType::A, make_records("sys.example", 0), cache.default_ttl(), now_);
+    EXPECT_TRUE(cache.get("sys.example", DNSRecordType::A, records, now_ + std::chrono::seconds(299)));
+    EXPECT_FALSE(cache.get("sys.example", DNSRecordType::A, records, now_ + std::chrono::seconds(300)));
+}
+
+TEST_F(DnsCacheTest, NegativeEntriesKeepRcodeAndExpire) {
+    DnsCache cache(make_config(100));
+    DnsAnswer answer;
+
+    cache.put_negative("missing.example", DNSRecordType::A, 3, std::chrono::seconds(30), now_);
+    cache.put_negative("v4only.example", DNSRecordType::AAAA, 0, std::chrono::seconds(30), now_);
+    cache.put_negative("zero.example", DNSRecordType::A, 3, std::chrono::seconds(0), now_);
+
+    ASSERT_TRUE(cache.get("missing.example", DNSRecordType::A, answer, now_ + std::chrono::seconds(10)));
+    EXPECT_EQ(answer.rcode, 3);
+    EXPECT_TRUE(answer.records.empty());
+    EXPECT_EQ(answer.negative_ttl, 20u);
+    EXPECT_TRUE(answer.negative());
+
+    ASSERT_TRUE(cache.get("v4only.example", DNSRecordType::AAAA, answer, now_));
+    EXPECT_EQ(answer.rcode, 0);
+    EXPECT_TRUE(answer.negative());
+    EXPECT_FALSE(cache.get("zero.example", DNSRecordType::A, answer, now_));
+    EXPECT_FALSE(cache.get("missing.example", DNSRecordType::A, answer, now_ + std::chrono::seconds(30)));
+
+    // 肯定结果覆盖否定条目；否定条目不参与持久化遍历
+    cache.put("v4only.example", DNSRecordType::AAAA, {{"v4only.example", DNSRecordType::AAAA, 60, "2001:db8::1"}},
+              now_);
+    ASSERT_TRUE(cache.get("v4only.example", DNSRecordType::AAAA, answer, now_));
+    EXPECT_EQ(answer.rcode, 0);
+    EXPECT_EQ(answer.records.size(), 1u);
+    cache.put_negative("missing.example", DNSRecordType::A, 3, std::chrono::seconds(30), now_);
+    size_t visited = 0;
+    cache.for_each([&](const std::string&, DNSRecordType, const std::vector<DNSRecord>&,
+                       DnsCache::Clock::time_point) { ++visited; },
+                   now_);
+    EXPECT_EQ(visited, 1u);
+}
+
+TEST_F(DnsCacheTest, EvictsLeastRecentlyUsedAtMaxSize) {
+    // max_size 为1时只有一个分片，LRU顺序完全确定
+    DnsCache cache(make_config(1));
+    std::vector<DNSRecord> records;
+
+    cache.put("a.example", DNSRecordType::A, make_records("a.example", 60), now_);
+    cache.put("b.example", DNSRecordType::A, make_records("b.example", 60), now_);
+
+    EXPECT_FALSE(cache.get("a.example", DNSRecordType::A, records, now_));
+    EXPECT_TRUE(cache.get("b.example", DNSRecordType::A, records, now_));
+    EXPECT_EQ(cache.stats().evictions, 1u);
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST_F(DnsCacheTest, GetRefreshesRecency) {
+    // 每个分片容量为2：A在每次写入前都被 get() 移到LRU头部，同分片的新条目只会淘汰其他条目；
+    // 从未再访问的B在同分片写入两个新条目后被淘汰。不依赖键落在哪个分片
+    DnsCache cache(make_config(32));
+    std::vector<DNSRecord> records;
+
+    cache.put("a.example", DNSRecordType::A, make_records("a.example", 60), now_);
+    cache.put("b.example", DNSRecordType::A, make_records("b.example", 60), now_);
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(cache.get("a.example", DNSRecordType::A, records, now_)) << "evicted after " << i << " puts";
+        std::string domain = "host" + std::to_string(i) + ".example";
+        cache.put(domain, DNSRecordType::A, make_records(domain, 60), now_);
+    }
+
+    EXPECT_TRUE(cache.get("a.example", DNSRecordType::A, records, now_));
+    EXPECT_FALSE(cache.get("b.example", DNSRecordType::A, records, now_));
+    EXPECT_GT(cache.stats().evictions, 0u);
+}
+
+TEST_F(DnsCacheTest, SizeNeverExceedsMaxSize) {
+    DnsCache cache(make_config(50));
+
+    for (int i = 0; i < 500; ++i) {
+        std::string domain = "host" + std::to_string(i) + ".example";
+        cache.put(domain, DNSRecordType::A, make_records(domain, 60), now_);
+    }
+
+    auto stats = cache.stats();
+    EXPECT_LE(stats.size, 50u);
+    EXPECT_EQ(stats.size + stats.evictions, 500u);
+}
+
+TEST_F(DnsCacheTest, PutReplacesExistingEntry) {
+    DnsCache cache(make_config(2));
+    std::vector<DNSRecord> records;
+
+    // 再次写入同一键时替换原条目：使用新的TTL，条目数不增加
+    cache.put("a.example", DNSRecordType::A, make_records("a.example", 60), now_);
+    cache.put("a.example", DNSRecordType::A, make_records("a.example", 120), now_);
+    ASSERT_TRUE(cache.get("a.example", DNSRecordType::A, records, now_ + std::chrono::seconds(90)));
+    EXPECT_EQ(cache.stats().insertions, 2u);
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST_F(DnsCacheTest, DisabledCacheNeverHits) {
+    DnsCache cache(make_config(100, false));
+    std::vector<DNSRecord> records;
+
+    EXPECT_FALSE(cache.enabled());
+    cache.put("example.com", DNSRecordType::A, make_records("example.com", 60), now_);
+    EXPECT_FALSE(cache.get("example.com", DNSRecordType::A, records, now_));
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(DnsCacheTest, EraseAndClear) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+
+    cache.put("a.example", DNSRecordType::A, make_records("a.example", 60), now_);
+    cache.put("b.example", DNSRecordType::A, make_records("b.example", 60), now_);
+
+    cache.erase("a.example", DNSRecordType::A);
+    EXPECT_FALSE(cache.get("a.example", DNSRecordType::A, records, now_));
+    EXPECT_EQ(cache.size(), 1u);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(DnsCacheTest, ConcurrentAccess) {
+    DnsCache cache(make_config(1000));
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, t]() {
+            std::vector<DNSRecord> records;
+            for (int i = 0; i < 1000; ++i) {
+                std::string domain = "host" + std::to_string((i + t) % 200) + ".example";
+                if (!cache.get(domain, DNSRecordType::A, records)) {
+                    cache.put(domain, DNSRecordType::A, make_records(domain, 60));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits + stats.misses, 8000u);
+    EXPECT_EQ(stats.size, 200u);
+}
+
+TEST_F(DnsCacheTest, ServesStaleWhileRefreshing) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+    std::vector<std::string> refreshed;
+    cache.set_refresher([&](const std::string& domain, DNSRecordType) { refreshed.push_back(domain); });
+
+    cache.put("example.com", DNSRecordType::A, make_records("example.com", 60), now_);
+
+    // 过期后宽限期内返回旧记录，TTL为0，并只触发一次刷新
+    ASSERT_TRUE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(61)));
+    EXPECT_EQ(records[0].ttl, 0u);
+    EXPECT_TRUE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(62)));
+    ASSERT_EQ(refreshed.size(), 1u);
+    EXPECT_EQ(refreshed[0], "example.com");
+
+    // 刷新迟迟没有写回时按重试间隔再次触发
+    EXPECT_TRUE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(66)));
+    EXPECT_EQ(refreshed.size(), 2u);
+
+    // 写回后恢复为正常命中
+    cache.put("example.com", DNSRecordType::A, make_records("example.com", 60), now_ + std::chrono::seconds(66));
+    ASSERT_TRUE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(70)));
+    EXPECT_EQ(records[0].ttl, 56u);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.stale_hits, 3u);
+    EXPECT_EQ(stats.refreshes, 2u);
+    EXPECT_EQ(stats.hits, 4u);
+
+    // 超出宽限期（stale_ttl 默认30秒）后视为未命中
+    EXPECT_FALSE(cache.get("example.com", DNSRecordType::A, records, now_ + std::chrono::seconds(156)));
+    EXPECT_EQ(cache.stats().expirations, 1u);
+}
+
+TEST_F(DnsCacheTest, PrefetchesOnlyPopularEntries) {
+    DnsCache cache(make_config(100));
+    std::vector<DNSRecord> records;
+    std::vector<std::string> refreshed;
+    cache.set_refresher([&](const std::string& domain, DNSRecordType) { refreshed.push_back(domain); });
+
+    cache.put("hot.example", DNSRecordType::A, make_records("hot.example", 100), now_);
+    cache.put("cold.example", DNSRecordType::A, make_records("cold.example", 100), now_);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(cache.get("hot.example", DNSRecordType::A, records, now_ + std::chrono::seconds(10)));
+    }
+    EXPECT_TRUE(refreshed.empty());
+
+    // TTL过去90%后，热点条目提前刷新，冷门条目不刷新
+    EXPECT_TRUE(cache.get("hot.example", DNSRecordType::A, records, now_ + std::chrono::seconds(91)));
+    EXPECT_EQ(records[0].ttl, 9u);
+    EXPECT_TRUE(cache.get("cold.example", DNSRecordType::A, records, now_ + std::chrono::seconds(91)));
+    ASSERT_EQ(refreshed.size(), 1u);
+    EXPECT_EQ(refreshed[0], "hot.example");
+    EXPECT_EQ(cache.stats().prefetches, 1u);
+
+    // 卸载刷新函数后恢复为普通TTL缓存
+    cache.set_refresher(nullptr);
+    EXPECT_FALSE(cache.get("hot.example", DNSRecordType::A, records, now_ + std::chrono::seconds(101)));
+    EXPECT_EQ(refreshed.size(), 1u);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "dns_cache_file.hpp"
+
+class DnsCacheFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() /
+               ("dns_cache_file_test_" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir_);
+        path_ = (dir_ / "nested" / "cache.bin").string();
+    }
+
+    void TearDown() override { std::filesystem::remove_all(dir_); }
+
+    static CacheConfig make_config() {
+        CacheConfig config;
+        config.max_size = 100;
+        return config;
+    }
+
+    std::filesystem::path dir_;
+    std::string path_;
+};
+
+TEST_F(DnsCacheFileTest, MissingFileIsNotAnError) {
+    EXPECT_EQ(DnsCacheFile::open(path_), nullptr);
+}
+
+TEST_F(DnsCacheFileTest, RoundTripsEntriesAndFailures) {
+    auto now = DnsCache::Clock::now();
+    DnsCache cache(make_config());
+    cache.put("example.com", DNSRecordType::A,
+              {{"example.com", DNSRecordType::CNAME, 600, "edge.example.net"},
+               {"edge.example.net", DNSRecordType::A, 300, "192.0.2.1"}},
+              now);
+    cache.put("example.com", DNSRecordType::TXT, {{"example.com", DNSRecordType::TXT, 120, "\"v=spf1 -all\""}}, now);
+    cache.put("short.example", DNSRecordType::A, {{"short.example", DNSRecordType::A, 1, "192.0.2.9"}},
+              now - std::chrono::seconds(5));
+
+    DnsFailureTracker failures;
+    failures.record_system_result("blocked.example", DNSRecordType::A, false);
+    failures.record_doh_result("blocked.example", DNSRecordType::A, false);
+    failures.record_doh_result("flaky.example", DNSRecordType::AAAA, false);
+
+    DnsCacheFile::save(path_, cache, &failures);
+    EXPECT_FALSE(std::filesystem::exists(path_ + ".tmp." + std::to_string(getpid())));
+
+    auto file = DnsCacheFile::open(path_);
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(file->entry_count(), 2u);  // 已过期的条目不写入
+    EXPECT_EQ(file->failure_count(), 2u);
+    EXPECT_LE(std::chrono::system_clock::now() - file->saved_at(), std::chrono::seconds(5));
+
+    DnsCache restored(make_config());
+    DnsFailureTracker restored_failures;
+    EXPECT_EQ(file->restore(restored, &restored_failures), 2u);
+
+    std::vector<DNSRecord> records;
+    ASSERT_TRUE(restored.get("example.com", DNSRecordType::A, records));
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].type, DNSRecordType::CNAME);
+    EXPECT_EQ(records[0].data, "edge.example.net");
+    EXPECT_EQ(records[1].name, "edge.example.net");
+    EXPECT_EQ(records[1].data, "192.0.2.1");
+    EXPECT_GE(records[1].ttl, 298u);
+    EXPECT_LE(records[1].ttl, 300u);
+
+    ASSERT_TRUE(restored.get("example.com", DNSRecordType::TXT, records));
+    EXPECT_EQ(records[0].data, "\"v=spf1 -all\"");
+
+    auto blocked = restored_failures.get("blocked.example", DNSRecordType::A);
+    EXPECT_EQ(blocked.system_failed_ms, failures.get("blocked.example", DNSRecordType::A).system_failed_ms);
+    EXPECT_NE(blocked.doh_failed_ms, 0);
+    EXPECT_EQ(restored_failures.get("flaky.example", DNSRecordType::AAAA).system_failed_ms, 0);
+}
+
+TEST_F(DnsCacheFileTest, SaveReplacesPreviousFile) {
+    DnsCache cache(make_config());
+    cache.put("a.example", DNSRecordType::A, {{"a.example", DNSRecordType::A, 60, "192.0.2.1"}});
+    DnsCacheFile::save(path_, cache);
+
+    cache.clear();
+    DnsCacheFile::save(path_, cache);
+    auto file = DnsCacheFile::open(path_);
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(file->entry_count(), 0u);
+    EXPECT_EQ(file->failure_count(), 0u);
+}
+
+TEST_F(DnsCacheFileTest, RejectsCorruptFiles) {
+    DnsCache cache(make_config());
+    cache.put("a.example", DNSRecordType::A, {{"a.example", DNSRecordType::A, 60, "192.0.2.1"}});
+    DnsCacheFile::save(path_, cache);
+    auto size = std::filesystem::file_size(path_);
+
+    // 翻转最后一个字节（字符串区），校验和不匹配
+    {
+        std::fstream file(path_, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(size - 1));
+        char last = static_cast<char>(file.get());
+        file.seekp(static_cast<std::streamoff>(size - 1));
+        file.put(static_cast<char>(last ^ 0x20));
+    }
+    EXPECT_THROW(DnsCacheFile::open(path_), CacheException);
+
+    std::filesystem::resize_file(path_, size - 4);
+    EXPECT_THROW(DnsCacheFile::open(path_), CacheException);
+
+    std::ofstream(path_, std::ios::binary | std::ios::trunc) << "not a cache file at all, just some text padding";
+    EXPECT_THROW(DnsCacheFile::open(path_), CacheException);
+}
+
+TEST(DnsFailureTrackerTest, SuccessClearsFailure) {
+    DnsFailureTracker tracker;
+    auto now = DnsFailureTracker::Clock::now();
+    tracker.record_system_result("example.com", DNSRecordType::A, false, now);
+    tracker.record_doh_result("example.com", DNSRecordType::A, true, now);
+    EXPECT_GT(tracker.get("example.com", DNSRecordType::A).system_failed_ms, 0);
+    EXPECT_EQ(tracker.size(), 1u);
+
+    tracker.record_system_result("example.com", DNSRecordType::A, true, now);
+    EXPECT_EQ(tracker.get("example.com", DNSRecordType::A).system_failed_ms, 0);
+    EXPECT_EQ(tracker.size(), 0u);
+}
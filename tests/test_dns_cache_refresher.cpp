@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "dns_cache_refresher.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+
+// 过期条目在宽限期内立即返回旧记录，同时由后台刷新写回新记录
+TEST(CacheRefresherTest, RefreshesStaleEntryInBackground) {
+    DoHStubServer server(make_stub_zone());
+    server.start();
+
+    auto cache = std::make_shared<DnsCache>(CacheConfig{});
+    CacheRefresher refresher(cache, DoHServerConfig{"stub", server.url("/dns-query"), {"get", "post"}},
+                             DoHMethod::POST);
+
+    // 写入一条已过期2秒的旧记录
+    cache->put("example.com", DNSRecordType::A, {{"example.com", DNSRecordType::A, 60, "198.51.100.1"}},
+               DnsCache::Clock::now() - std::chrono::seconds(62));
+
+    std::vector<DNSRecord> records;
+    ASSERT_TRUE(cache->get("example.com", DNSRecordType::A, records));
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "198.51.100.1");
+    EXPECT_EQ(records[0].ttl, 0u);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        ASSERT_TRUE(cache->get("example.com", DNSRecordType::A, records));
+        if (records[0].ttl > 0) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(records[0].data, "192.0.2.1");
+    EXPECT_GT(records[0].ttl, 60u);
+    EXPECT_EQ(cache->stats().refreshes, 1u);
+    EXPECT_EQ(server.stats().requests, 1u);
+}
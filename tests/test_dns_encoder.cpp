@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "tools.hpp"
+
+class DnsEncoderTest : public ::testing::Test {
+protected:
+    static std::string encode(const std::string& domain, uint16_t qtype, const DnsQueryOptions& options = {}) {
+        DnsQueryBuffer buffer;
+        buffer.encode(domain, qtype, options);
+        return std::string(buffer.bytes(), buffer.size);
+    }
+};
+
+TEST_F(DnsEncoderTest, EncodesQuestion) {
+    DnsQueryOptions options;
+    options.id = 0xBEEF;
+    std::string message = encode("www.example.com", 28, options);
+
+    const std::string expected("\xBE\xEF\x01\x00\x00\x01\x00\x00\x00\x00\x00\x00"
+                               "\x03www\x07" "example\x03" "com\x00"
+                               "\x00\x1C\x00\x01",
+                               12 + 17 + 4);
+    EXPECT_EQ(message, expected);
+}
+
+TEST_F(DnsEncoderTest, TrailingDotAndRoot) {
+    EXPECT_EQ(encode("example.com.", 1), encode("example.com", 1));
+
+    std::string root = encode(".", 2);
+    ASSERT_EQ(root.size(), 12u + 1 + 4);
+    EXPECT_EQ(root[12], '\0');
+    EXPECT_EQ(encode("", 2), root);
+}
+
+TEST_F(DnsEncoderTest, ValidatesLabelAndNameLength) {
+    std::string label63(63, 'a');
+    EXPECT_NO_THROW(encode(label63 + ".example", 1));
+    EXPECT_THROW(encode(std::string(64, 'a') + ".example", 1), EncodingException);
+
+    EXPECT_THROW(encode("a..example", 1), EncodingException);
+    EXPECT_THROW(encode(".example", 1), EncodingException);
+
+    // 4个63字节标签编码后为 4*64+1 = 257 字节，超过255字节上限
+    std::string too_long = label63 + "." + label63 + "." + label63 + "." + label63;
+    EXPECT_THROW(encode(too_long, 1), EncodingException);
+    // 3个63字节标签 + 1个61字节标签正好255字节
+    std::string longest = label63 + "." + label63 + "." + label63 + "." + std::string(61, 'b');
+    EXPECT_NO_THROW(encode(longest, 1));
+}
+
+TEST_F(DnsEncoderTest, RejectsSmallBuffer) {
+    uint8_t buffer[20];
+    EXPECT_THROW(encode_dns_query(buffer, sizeof(buffer), std::string("example.com"), 1), EncodingException);
+}
+
+TEST_F(DnsEncoderTest, EdnsOptRecord) {
+    DnsQueryOptions options;
+    options.edns.enabled = true;
+    options.edns.udp_payload_size = 4096;
+    options.edns.dnssec_ok = true;
+    std::string message = encode("example.com", 1, options);
+
+    ASSERT_EQ(message.size(), 12u + 13 + 4 + 11);
+    EXPECT_EQ(message[11], '\x01');  // ARCOUNT = 1
+    const std::string opt("\x00\x00\x29\x10\x00\x00\x00\x80\x00\x00\x00", 11);
+    EXPECT_EQ(message.substr(message.size() - 11), opt);
+}
+
+TEST_F(DnsEncoderTest, EdnsPaddingToBlockSize) {
+    DnsQueryOptions options;
+    options.edns.enabled = true;
+    options.edns.padding_block = 128;
+
+    for (const std::string domain : {"a.io", "example.com", "a.very.long.subdomain.name.example.org"}) {
+        std::string message = encode(domain, 1, options);
+        EXPECT_EQ(message.size() % 128, 0u) << domain;
+    }
+}
+
+TEST_F(DnsEncoderTest, CreateQueryMessageUsesRandomId) {
+    std::string first = create_dns_query_message("example.com", 1);
+    ASSERT_EQ(first.size(), 12u + 13 + 4);
+
+    // 16位随机ID连续多次相同的概率可以忽略
+    bool differs = false;
+    for (int i = 0; i < 8 && !differs; ++i) {
+        std::string next = create_dns_query_message("example.com", 1);
+        differs = next.substr(0, 2) != first.substr(0, 2);
+        EXPECT_EQ(next.substr(2), first.substr(2));
+    }
+    EXPECT_TRUE(differs);
+}
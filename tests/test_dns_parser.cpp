@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "tools.hpp"
+
+// 按字节拼装测试用的DNS报文
+class DnsParserTest : public ::testing::Test {
+protected:
+    std::string msg_;
+
+    void u8(uint8_t v) { msg_.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v) {
+        u8(static_cast<uint8_t>(v >> 8));
+        u8(static_cast<uint8_t>(v & 0xFF));
+    }
+    void u32(uint32_t v) {
+        u16(static_cast<uint16_t>(v >> 16));
+        u16(static_cast<uint16_t>(v & 0xFFFF));
+    }
+    void name(const std::string& dotted) {
+        size_t start = 0;
+        while (start < dotted.size()) {
+            size_t dot = dotted.find('.', start);
+            if (dot == std::string::npos) {
+                dot = dotted.size();
+            }
+            u8(static_cast<uint8_t>(dot - start));
+            msg_.append(dotted, start, dot - start);
+            start = dot + 1;
+        }
+        u8(0);
+    }
+    void pointer(uint16_t offset) { u16(static_cast<uint16_t>(0xC000 | offset)); }
+
+    void header(uint16_t an, uint16_t ns = 0, uint16_t ar = 0, uint16_t flags = 0x8180) {
+        u16(0xABCD);
+        u16(flags);
+        u16(1);
+        u16(an);
+        u16(ns);
+        u16(ar);
+    }
+
+    // 问题部分的名称总是从偏移12开始，后续记录用指针 0xC00C 引用
+    void question(const std::string& qname, uint16_t qtype) {
+        name(qname);
+        u16(qtype);
+        u16(1);
+    }
+
+    // 写入记录头并返回 RDLENGTH 的位置，RDATA 写完后调用 finish_rdata 回填
+    size_t record(uint16_t type, uint32_t ttl) {
+        pointer(12);
+        u16(type);
+        u16(1);
+        u32(ttl);
+        size_t at = msg_.size();
+        u16(0);
+        return at;
+    }
+    void finish_rdata(size_t at) {
+        size_t length = msg_.size() - at - 2;
+        msg_[at] = static_cast<char>(length >> 8);
+        msg_[at + 1] = static_cast<char>(length & 0xFF);
+    }
+};
+
+TEST_F(DnsParserTest, DecompressesNamesAcrossSections) {
+    header(2, 1, 1);
+    question("www.example.com", 1);
+
+    // CNAME 目标指向问题名称的后缀 example.com（偏移16）
+    size_t at = record(5, 300);
+    u8(3);
+    msg_.append("cdn");
+    pointer(16);
+    finish_rdata(at);
+    size_t cdn_offset = at + 2;
+
+    // A 记录的所有者名称指向 CNAME 目标
+    u16(static_cast<uint16_t>(0xC000 | cdn_offset));
+    u16(1);
+    u16(1);
+    u32(60);
+    u16(4);
+    u8(93), u8(184), u8(216), u8(34);
+
+    at = record(2, 3600);  // 权威部分 NS
+    name("ns1.example.net");
+    finish_rdata(at);
+
+    u8(0);  // 附加部分 OPT
+    u16(41);
+    u16(1232);
+    u32(0);
+    u16(0);
+
+    DnsMessageParser parser(msg_);
+    EXPECT_EQ(parser.header().id, 0xABCD);
+    EXPECT_TRUE(parser.header().is_response());
+
+    DnsQuestionView question_view;
+    ASSERT_TRUE(parser.next_question(question_view));
+    EXPECT_EQ(question_view.name.to_string(), "www.example.com");
+    EXPECT_TRUE(question_view.name.equals("WWW.Example.com."));
+    EXPECT_FALSE(question_view.name.equals("www.example.co"));
+    EXPECT_FALSE(parser.next_question(question_view));
+
+    DnsRecordView rr;
+    ASSERT_TRUE(parser.next_record(rr));
+    EXPECT_EQ(rr.section, DnsSection::Answer);
+    EXPECT_EQ(rr.record_type(), DNSRecordType::CNAME);
+    EXPECT_EQ(rr.data_to_string(), "cdn.example.com");
+
+    ASSERT_TRUE(parser.next_record(rr));
+    EXPECT_EQ(rr.name.to_string(), "cdn.example.com");
+    EXPECT_EQ(rr.ttl, 60u);
+    EXPECT_EQ(rr.data_to_string(), "93.184.216.34");
+
+    ASSERT_TRUE(parser.next_record(rr));
+    EXPECT_EQ(rr.section, DnsSection::Authority);
+    EXPECT_EQ(rr.data_to_string(), "ns1.example.net");
+
+    ASSERT_TRUE(parser.next_record(rr));
+    EXPECT_EQ(rr.section, DnsSection::Additional);
+    EXPECT_EQ(rr.record_type(), DNSRecordType::OPT);
+    EXPECT_EQ(rr.name.to_string(), ".");
+    EXPECT_FALSE(parser.next_record(rr));
+
+    // 兼容接口只返回回答部分
+    auto records = parse_dns_wireformat_response(msg_);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].name, "www.example.com");
+    EXPECT_EQ(records[1].data, "93.184.216.34");
+}
+
+TEST_F(DnsParserTest, FormatsCommonTypes) {
+    header(7);
+    question("example.com", 255);
+
+    size_t at = record(28, 60);
+    const uint8_t v6[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    msg_.append(reinterpret_cast<const char*>(v6), 16);
+    finish_rdata(at);
+
+    at = record(15, 60);
+    u16(10);
+    u8(4);
+    msg_.append("mail");
+    pointer(12);
+    finish_rdata(at);
+
+    at = record(16, 60);
+    u8(11);
+    msg_.append("v=spf1 -all");
+    u8(5);
+    msg_.append("a\"b\\c");
+    finish_rdata(at);
+
+    at = record(6, 60);
+    name("ns1.example.com");
+    u8(10);
+    msg_.append("hostmaster");
+    pointer(12);
+    u32(2024010101), u32(7200), u32(3600), u32(1209600), u32(300);
+    finish_rdata(at);
+
+    at = record(33, 60);
+    u16(10), u16(5), u16(5060);
+    u8(3);
+    msg_.append("sip");
+    pointer(12);
+    finish_rdata(at);
+
+    at = record(257, 60);
+    u8(0);
+    u8(5);
+    msg_.append("issue");
+    msg_.append("letsencrypt.org");
+    finish_rdata(at);
+
+    at = record(65, 60);
+    u16(1);
+    u8(0);
+    u16(1), u16(3), u8(2);
+    msg_.append("h2");
+    u16(4), u16(4), u8(1), u8(2), u8(3), u8(4);
+    finish_rdata(at);
+
+    auto records = parse_dns_wireformat_response(msg_);
+    ASSERT_EQ(records.size(), 7u);
+    EXPECT_EQ(records[0].data, "2001:db8::1");
+    EXPECT_EQ(records[1].data, "10 mail.example.com");
+    EXPECT_EQ(records[2].data, R"("v=spf1 -all" "a\"b\\c")");
+    EXPECT_EQ(records[3].data, "ns1.example.com hostmaster.example.com 2024010101 7200 3600 1209600 300");
+    EXPECT_EQ(records[4].data, "10 5 5060 sip.example.com");
+    EXPECT_EQ(records[5].data, R"(0 issue "letsencrypt.org")");
+    EXPECT_EQ(records[6].data, "1 . alpn=h2 ipv4hint=1.2.3.4");
+    EXPECT_EQ(records[6].type, DNSRecordType::HTTPS);
+}
+
+TEST_F(DnsParserTest, UnknownTypeUsesGenericFormat) {
+    header(1);
+    question("example.com", 99);
+    size_t at = record(99, 60);
+    u8(0xDE), u8(0xAD);
+    finish_rdata(at);
+
+    auto records = parse_dns_wireformat_response(msg_);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "\\# 2 dead");
+}
+
+// 否定应答的TTL取权威部分SOA的TTL与MINIMUM中较小者
+TEST_F(DnsParserTest, NegativeAnswerTakesTtlFromSoa) {
+    header(0, 1, 0, 0x8183);  // NXDOMAIN
+    question("missing.example.com", 1);
+    size_t at = record(6, 900);
+    name("ns.example.com");
+    name("hostmaster.example.com");
+    u32(2024010101), u32(7200), u32(900), u32(1209600), u32(300);
+    finish_rdata(at);
+
+    DnsAnswer answer = parse_dns_wireformat_answer(msg_);
+    EXPECT_EQ(answer.rcode, 3);
+    EXPECT_TRUE(answer.records.empty());
+    EXPECT_EQ(answer.negative_ttl, 300u);
+    EXPECT_TRUE(answer.negative());
+
+    // 没有SOA时为0
+    msg_.clear();
+    header(0);
+    question("example.com", 28);
+    answer = parse_dns_wireformat_answer(msg_);
+    EXPECT_EQ(answer.rcode, 0);
+    EXPECT_EQ(answer.negative_ttl, 0u);
+    EXPECT_TRUE(answer.negative());
+}
+
+TEST_F(DnsParserTest, RejectsCompressionLoops) {
+    header(1);
+    question("example.com", 1);
+    // 所有者名称是一个指向自身的指针
+    size_t self = msg_.size();
+    pointer(static_cast<uint16_t>(self));
+    u16(1), u16(1), u32(60), u16(4), u32(0x01020304);
+    EXPECT_THROW(parse_dns_wireformat_response(msg_), ParseException);
+
+    // 标签后接回指该标签的指针：a -> ptr(a) -> a ...
+    msg_.clear();
+    header(1);
+    question("example.com", 1);
+    size_t label = msg_.size();
+    u8(1);
+    msg_.append("a");
+    pointer(static_cast<uint16_t>(label));
+    u16(1), u16(1), u32(60), u16(4), u32(0x01020304);
+    EXPECT_THROW(parse_dns_wireformat_response(msg_), ParseException);
+}
+
+TEST_F(DnsParserTest, RejectsTruncatedMessages) {
+    header(1);
+    question("example.com", 1);
+    size_t at = record(1, 60);
+    u8(1), u8(2), u8(3), u8(4);
+    finish_rdata(at);
+    EXPECT_EQ(parse_dns_wireformat_response(msg_).size(), 1u);
+
+    // 任何截断位置都必须抛出异常而不是越界读取
+    for (size_t size = 0; size < msg_.size(); ++size) {
+        EXPECT_THROW(parse_dns_wireformat_response(msg_.substr(0, size)), ParseException) << size;
+    }
+
+    // RDATA 长度与类型不符
+    std::string bad = msg_;
+    bad[at + 1] = 3;
+    EXPECT_THROW(parse_dns_wireformat_response(bad.substr(0, bad.size() - 1)), ParseException);
+}
+
+TEST_F(DnsParserTest, RejectsQueries) {
+    header(0, 0, 0, 0x0100);
+    question("example.com", 1);
+    EXPECT_THROW(parse_dns_wireformat_response(msg_), ParseException);
+}
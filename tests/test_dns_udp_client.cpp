@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dns_udp_client.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+
+class DnsUdpClientTest : public ::testing::Test {
+protected:
+    static StubServerOptions dns_options() {
+        StubServerOptions options;
+        options.serve_dns = true;
+        return options;
+    }
+
+    // 绑定在回环地址上的UDP套接字，用于模拟异常的服务器
+    static int bind_udp(uint16_t &port) {
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+        port = ntohs(address.sin_port);
+        return fd;
+    }
+};
+
+TEST_F(DnsUdpClientTest, ParsesServerAddress) {
+    std::string host;
+    uint16_t port = 53;
+    ASSERT_TRUE(parse_dns_server("127.0.0.1", host, port));
+    EXPECT_EQ(host, "127.0.0.1");
+    EXPECT_EQ(port, 53);
+    ASSERT_TRUE(parse_dns_server("127.0.0.1:5353", host, port));
+    EXPECT_EQ(port, 5353);
+    ASSERT_TRUE(parse_dns_server("[::1]:8053", host, port));
+    EXPECT_EQ(host, "::1");
+    EXPECT_EQ(port, 8053);
+    ASSERT_TRUE(parse_dns_server("2001:db8::53", host, port));
+    EXPECT_EQ(host, "2001:db8::53");
+
+    EXPECT_FALSE(parse_dns_server("", host, port));
+    EXPECT_FALSE(parse_dns_server("127.0.0.1:", host, port));
+    EXPECT_FALSE(parse_dns_server("127.0.0.1:70000", host, port));
+    EXPECT_FALSE(parse_dns_server("[::1", host, port));
+    EXPECT_THROW(DnsUdpClient("not-an-address"), NetworkException);
+}
+
+TEST_F(DnsUdpClientTest, QueriesStubServerOverUdp) {
+    DoHStubServer server(make_stub_zone(), dns_options());
+    server.start();
+    ASSERT_NE(server.dns_port(), 0);
+
+    DnsUdpClient client("127.0.0.1", server.dns_port());
+    auto records = client.query("www.example.com", DNSRecordType::A);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].type, DNSRecordType::CNAME);
+    EXPECT_EQ(records[1].data, "192.0.2.1");
+
+    auto ipv6 = client.query("EXAMPLE.com", DNSRecordType::AAAA);
+    ASSERT_EQ(ipv6.size(), 1u);
+    EXPECT_EQ(ipv6[0].data, "2001:db8::1");
+
+    EXPECT_EQ(client.tcp_fallbacks(), 0u);
+    EXPECT_EQ(server.stats().dns_queries, 2u);
+    EXPECT_EQ(server.stats().requests, 0u);
+}
+
+TEST_F(DnsUdpClientTest, RetriesTruncatedAnswersOverTcp) {
+    StubServerOptions truncating = dns_options();
+    truncating.truncate_rate = 1.0;
+    DoHStubServer server(make_stub_zone(), truncating);
+    server.start();
+
+    DnsUdpClient client("127.0.0.1", server.dns_port());
+    auto results = client.query_batch({{"example.com", DNSRecordType::A}});
+    ASSERT_EQ(results[0].records.size(), 1u);
+    EXPECT_EQ(results[0].records[0].data, "192.0.2.1");
+    EXPECT_TRUE(results[0].via_tcp);
+    EXPECT_EQ(client.tcp_fallbacks(), 1u);
+    EXPECT_EQ(server.stats().truncated, 1u);
+
+    // 超过512字节的应答即使不注入截断也只能经TCP取得
+    DoHStubServer plain(make_stub_zone(), dns_options());
+    plain.start();
+    DnsUdpClient plain_client("127.0.0.1", plain.dns_port());
+    EXPECT_EQ(plain_client.query("big.example.com").size(), 40u);
+    EXPECT_EQ(plain_client.tcp_fallbacks(), 1u);
+}
+
+TEST_F(DnsUdpClientTest, BatchMatchesAnswersToQuestions) {
+    DoHStubServer server(make_stub_zone(), dns_options());
+    server.start();
+
+    // 超过 kMaxInFlight，分多个窗口发送
+    std::vector<DnsUdpQuestion> questions;
+    for (size_t i = 0; i < DnsUdpClient::kMaxInFlight + 50; ++i) {
+        if (i % 3 == 0) {
+            questions.push_back({"example.com", DNSRecordType::A});
+        } else if (i % 3 == 1) {
+            questions.push_back({"example.com", DNSRecordType::AAAA});
+        } else {
+            questions.push_back({"missing" + std::to_string(i) + ".example.com", DNSRecordType::A});
+        }
+    }
+
+    DnsUdpClient client("127.0.0.1", server.dns_port());
+    auto results = client.query_batch(questions);
+    ASSERT_EQ(results.size(), questions.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i % 3 == 2) {
+            EXPECT_EQ(results[i].rcode, 3) << i;
+            EXPECT_TRUE(results[i].records.empty()) << i;
+        } else {
+            ASSERT_EQ(results[i].rcode, 0) << i;
+            ASSERT_EQ(results[i].records.size(), 1u) << i;
+            EXPECT_EQ(results[i].records[0].data, i % 3 == 0 ? "192.0.2.1" : "2001:db8::1") << i;
+        }
+    }
+    EXPECT_EQ(client.mismatched(), 0u);
+    EXPECT_EQ(server.stats().dns_queries, questions.size());
+}
+
+// ID不符或问题不符的应答被丢弃，之后到达的正确应答仍被接受
+TEST_F(DnsUdpClientTest, IgnoresMismatchedResponses) {
+    uint16_t port = 0;
+    int fd = bind_udp(port);
+    std::thread fake([fd]() {
+        char buffer[512];
+        sockaddr_storage peer{};
+        socklen_t peer_length = sizeof(peer);
+        ssize_t n = recvfrom(fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr *>(&peer), &peer_length);
+        ASSERT_GT(n, 12);
+        std::string query(buffer, static_cast<size_t>(n));
+
+            DoHStubServer responder(make_stub_zone());
+        int64_t max_age = 0;
+        std::string answer = responder.answer_wire(query, false, max_age);
+
+        std::string wrong_id = answer;
+        wrong_id[1] = static_cast<char>(wrong_id[1] ^ 0x5A);
+        std::string other_query = query;
+        other_query[13] = 'x';  // 改动问题中的名称
+        std::string wrong_question = responder.answer_wire(other_query, false, max_age);
+        for (const std::string *reply : {&wrong_id, &wrong_question, &answer}) {
+            sendto(fd, reply->data(), reply->size(), 0, reinterpret_cast<sockaddr *>(&peer), peer_length);
+        }
+    });
+
+    DnsUdpClient client("127.0.0.1", port, std::chrono::milliseconds(1000), 1);
+    auto records = client.query("example.com", DNSRecordType::A);
+    fake.join();
+    close(fd);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "192.0.2.1");
+    EXPECT_EQ(client.mismatched(), 2u);
+}
+
+TEST_F(DnsUdpClientTest, ResendsAndTimesOutWhenServerIsSilent) {
+    uint16_t port = 0;
+    int fd = bind_udp(port);
+
+    DnsUdpClient client("127.0.0.1", port, std::chrono::milliseconds(200), 2);
+    auto started = std::chrono::steady_clock::now();
+    EXPECT_THROW(client.query("example.com"), TimeoutException);
+    EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(200));
+
+    // 首次发送与一次重发都到达了服务器
+    char buffer[512];
+    int received = 0;
+    while (recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        ++received;
+    }
+    close(fd);
+    EXPECT_EQ(received, 2);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include "doh_async_client.hpp"
+
+class AsyncDoHClientTest : public ::testing::Test {
+protected:
+    // 本地未监听的端口，连接会被立即拒绝
+    static DoHServerConfig unreachable_server() {
+        return {"unreachable", "http://127.0.0.1:1/dns-query", {"get", "post", "json"}, 1, 2, true};
+    }
+};
+
+TEST_F(AsyncDoHClientTest, FutureReportsNetworkError) {
+    AsyncDoHClient client(unreachable_server());
+
+    auto future = client.query("example.com", DNSRecordType::A, DoHMethod::GET);
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_THROW(future.get(), NetworkException);
+    EXPECT_EQ(client.in_flight(), 0u);
+}
+
+// 域名无法编码时不在调用线程上抛出，错误同样经future返回
+TEST_F(AsyncDoHClientTest, FutureReportsEncodingError) {
+    AsyncDoHClient client(unreachable_server());
+
+    std::future<std::vector<DNSRecord>> future;
+    ASSERT_NO_THROW(future = client.query(std::string(64, 'a') + ".example", DNSRecordType::A, DoHMethod::POST));
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_THROW(future.get(), EncodingException);
+    EXPECT_EQ(client.in_flight(), 0u);
+}
+
+TEST_F(AsyncDoHClientTest, ManyConcurrentQueriesAllComplete) {
+    AsyncDoHClient client(unreachable_server());
+    constexpr int kQueries = 200;
+
+    std::atomic<int> completed{0};
+    std::atomic<int> errors{0};
+    std::promise<void> all_done;
+    for (int i = 0; i < kQueries; ++i) {
+        DoHMethod method = static_cast<DoHMethod>(i % 3);
+        client.query("host" + std::to_string(i) + ".example", DNSRecordType::A, method,
+                     [&](std::vector<DNSRecord> records, std::exception_ptr error) {
+                         EXPECT_TRUE(records.empty());
+                         if (error) {
+                             ++errors;
+                         }
+                         if (++completed == kQueries) {
+                             all_done.set_value();
+                         }
+                     });
+    }
+
+    ASSERT_EQ(all_done.get_future().wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_EQ(errors.load(), kQueries);
+    EXPECT_EQ(client.in_flight(), 0u);
+}
+
+TEST_F(AsyncDoHClientTest, DestructorFailsPendingQueries) {
+    std::future<std::vector<DNSRecord>> future;
+    {
+        // 不可路由地址，连接会一直挂起直到客户端销毁
+        AsyncDoHClient client(DoHServerConfig{"blackhole", "http://10.255.255.1/dns-query", {"get"}, 1, 30, true});
+        future = client.query("example.com", DNSRecordType::A, DoHMethod::GET);
+    }
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    EXPECT_THROW(future.get(), NetworkException);
+}
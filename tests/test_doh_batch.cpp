@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "doh_batch.hpp"
+
+class BatchResolverTest : public ::testing::Test {
+protected:
+    // 连接会被立即拒绝的服务器，所有查询都很快失败
+    DoHServerConfig unreachable_{"unreachable", "http://127.0.0.1:1/resolve", {"json"}, 1, 2, true};
+};
+
+TEST_F(BatchResolverTest, ParseLine) {
+    BatchQuery query;
+
+    ASSERT_TRUE(BatchResolver::parse_line("example.com", query));
+    EXPECT_EQ(query.domain, "example.com");
+    EXPECT_EQ(query.type, DNSRecordType::A);
+
+    ASSERT_TRUE(BatchResolver::parse_line("  ipv6.example  aaaa\r", query));
+    EXPECT_EQ(query.domain, "ipv6.example");
+    EXPECT_EQ(query.type, DNSRecordType::AAAA);
+
+    ASSERT_TRUE(BatchResolver::parse_line("mail.example", query, DNSRecordType::MX));
+    EXPECT_EQ(query.type, DNSRecordType::MX);
+
+    EXPECT_FALSE(BatchResolver::parse_line("", query));
+    EXPECT_FALSE(BatchResolver::parse_line("   ", query));
+    EXPECT_FALSE(BatchResolver::parse_line("# comment", query));
+    EXPECT_FALSE(BatchResolver::parse_line("example.com BOGUS", query));
+}
+
+TEST_F(BatchResolverTest, ToNdjson) {
+    BatchResult ok;
+    ok.query = {"example.com", DNSRecordType::A};
+    ok.records = {{"example.com", DNSRecordType::A, 60, "1.2.3.4"}};
+    ok.latency = std::chrono::microseconds(1500);
+    EXPECT_EQ(BatchResolver::to_ndjson(ok),
+              R"({"domain":"example.com","type":"A","status":"ok","cached":false,"latency_us":1500,)"
+              R"("records":[{"name":"example.com","type":"A","ttl":60,"data":"1.2.3.4"}]})");
+
+    BatchResult failed;
+    failed.query = {"bad\"name", DNSRecordType::TXT};
+    failed.error = "timeout";
+    EXPECT_EQ(BatchResolver::to_ndjson(failed),
+              R"({"domain":"bad\"name","type":"TXT","status":"error","cached":false,"latency_us":0,)"
+              R"("error":"timeout"})");
+}
+
+TEST_F(BatchResolverTest, StreamRespectsWindowAndReportsFailures) {
+    AsyncDoHClient client(unreachable_);
+    BatchResolver resolver(client, 4);
+
+    std::stringstream input;
+    for (int i = 0; i < 50; ++i) {
+        input << "host" << i << ".example\n";
+    }
+    input << "# trailing comment\n";
+
+    size_t max_in_flight = 0;
+    size_t results = 0;
+    auto summary = resolver.resolve_stream(input, [&](BatchResult& result) {
+        max_in_flight = std::max(max_in_flight, client.in_flight());
+        EXPECT_FALSE(result.ok());
+        ++results;
+    });
+
+    EXPECT_EQ(results, 50u);
+    EXPECT_LE(max_in_flight, 4u);
+    EXPECT_EQ(summary.total, 50u);
+    EXPECT_EQ(summary.failed, 50u);
+    EXPECT_EQ(summary.succeeded, 0u);
+}
+
+TEST_F(BatchResolverTest, BatchPreservesInputOrderAndUsesCache) {
+    AsyncDoHClient client(unreachable_);
+    BatchResolver resolver(client, 8);
+
+    CacheConfig cache_config;
+    auto cache = std::make_shared<DnsCache>(cache_config);
+    cache->put("cached.example", DNSRecordType::A, {{"cached.example", DNSRecordType::A, 60, "9.9.9.9"}});
+    resolver.set_cache(cache);
+
+    std::vector<BatchQuery> queries = {
+        {"a.example", DNSRecordType::A},
+        {"cached.example", DNSRecordType::A},
+        {"b.example", DNSRecordType::AAAA},
+    };
+    auto results = resolver.resolve_batch(queries);
+
+    ASSERT_EQ(results.size(), 3u);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        EXPECT_EQ(results[i].index, i);
+        EXPECT_EQ(results[i].query.domain, queries[i].domain);
+        EXPECT_EQ(results[i].query.type, queries[i].type);
+    }
+    EXPECT_TRUE(results[1].ok());
+    EXPECT_TRUE(results[1].cached);
+    ASSERT_EQ(results[1].records.size(), 1u);
+    EXPECT_EQ(results[1].records[0].data, "9.9.9.9");
+    EXPECT_FALSE(results[0].ok());
+    EXPECT_FALSE(results[2].ok());
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "doh_client.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+#include "system_resolver.hpp"
+
+namespace {
+// 记录被查询的域名，并返回一条固定记录的解析函数
+SystemDnsResolver::LookupFunction recording_lookup(std::vector<std::string>* domains) {
+    return [domains](const std::string& domain, int) {
+        domains->push_back(domain);
+        return std::vector<DNSRecord>{{domain, DNSRecordType::A, 300, "198.51.100.9"}};
+    };
+}
+}  // namespace
+
+// 无法编码的域名不抛出异常，也不发出请求，直接走系统DNS回退
+TEST(DoHClientTest, MalformedNameFallsBackToSystemDns) {
+    DoHStubServer server(make_stub_zone());
+    server.start();
+
+    std::vector<std::string> looked_up;
+    SystemDnsResolver resolver(1, 8, recording_lookup(&looked_up));
+    DoHClient client(server.url());
+    client.set_single_flight(nullptr);
+    client.set_method_cache(nullptr);
+    client.set_system_resolver(&resolver);
+
+    std::vector<DNSRecord> records;
+    EXPECT_NO_THROW(records = client.query("a..example", DNSRecordType::A, DoHMethod::GET, true));
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "198.51.100.9");
+
+    const std::string long_label = std::string(64, 'a') + ".example";
+    EXPECT_NO_THROW(records = client.query(long_label, DNSRecordType::A, DoHMethod::POST, true));
+    ASSERT_EQ(records.size(), 1u);
+
+    EXPECT_EQ(looked_up, (std::vector<std::string>{"a..example", long_label}));
+    EXPECT_EQ(server.stats().requests, 0u);
+}
+
+TEST(DoHClientTest, MalformedNameWithoutFallbackReturnsEmpty) {
+    DoHClient client("https://dns.example/dns-query", nullptr);
+    client.set_provider_health(nullptr);
+    EXPECT_TRUE(client.query_with_get("a..example").empty());
+    EXPECT_TRUE(client.query_with_post(std::string(64, 'a') + ".example").empty());
+    EXPECT_TRUE(client.query("a..example", DNSRecordType::A, DoHMethod::GET, false).empty());
+}
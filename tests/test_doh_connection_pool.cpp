@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "doh_client.hpp"
+#include "doh_connection_pool.hpp"
+
+// 本地 HTTP/1.1 keep-alive 服务器，对每个请求返回固定的 JSON 应答
+class KeepAliveJsonServer {
+public:
+    KeepAliveJsonServer() {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(listen_fd_, 16);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this]() { serve(); });
+    }
+
+    ~KeepAliveJsonServer() {
+        stopping_ = true;
+        thread_.join();
+        close(listen_fd_);
+    }
+
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port_) + "/resolve"; }
+    int accepted() const { return accepted_.load(); }
+
+private:
+    bool wait_readable(int fd) {
+        pollfd pfd{fd, POLLIN, 0};
+        while (!stopping_) {
+            if (poll(&pfd, 1, 50) > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void serve() {
+        while (wait_readable(listen_fd_)) {
+            int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            ++accepted_;
+            std::string buffer;
+            char chunk[4096];
+            while (wait_readable(fd)) {
+                ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    break;
+                }
+                buffer.append(chunk, static_cast<size_t>(n));
+                size_t end;
+                while ((end = buffer.find("\r\n\r\n")) != std::string::npos) {
+                    buffer.erase(0, end + 4);
+                    std::string body =
+                        R"({"Status":0,"Answer":[{"name":"example.com","type":1,"TTL":60,"data":"1.2.3.4"}]})";
+                    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/dns-json\r\n"
+                                           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+                    send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+                }
+            }
+            close(fd);
+        }
+    }
+
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> accepted_{0};
+    std::thread thread_;
+};
+
+TEST(DoHConnectionPoolTest, ProviderKeyNormalizesDefaultPorts) {
+    EXPECT_EQ(DoHConnectionPool::provider_key("https://dns.google/resolve"), "https://dns.google:443");
+    EXPECT_EQ(DoHConnectionPool::provider_key("https://dns.google:443/dns-query?dns=AAAB"), "https://dns.google:443");
+    EXPECT_EQ(DoHConnectionPool::provider_key("http://127.0.0.1:8053/resolve"), "http://127.0.0.1:8053");
+    EXPECT_EQ(DoHConnectionPool::provider_key("http://[::1]/dns-query"), "http://[::1]:80");
+}
+
+TEST(DoHConnectionPoolTest, ClientReusesConnectionAcrossQueries) {
+    KeepAliveJsonServer server;
+    DoHConnectionPool pool;
+    {
+        DoHClient client(server.url(), &pool);
+        for (int i = 0; i < 3; ++i) {
+            auto records = client.query("example.com", DNSRecordType::A, DoHMethod::JSON_GET, false);
+            ASSERT_EQ(records.size(), 1u);
+        }
+        auto stats = pool.stats(server.url());
+        EXPECT_EQ(stats.transfers, 3u);
+        EXPECT_EQ(stats.new_connections, 1u);
+        EXPECT_EQ(stats.handshakes_avoided(), 2u);
+        EXPECT_EQ(stats.open_connections, 1);
+    }
+
+    // 客户端析构后连接关闭
+    EXPECT_EQ(pool.stats(server.url()).open_connections, 0);
+    EXPECT_EQ(server.accepted(), 1);
+}
+
+TEST(DoHConnectionPoolTest, SharedConnectionsAcrossClients) {
+    KeepAliveJsonServer server;
+    DoHConnectionPool pool(true);
+    {
+        DoHClient first(server.url(), &pool);
+        DoHClient second(server.url(), &pool);
+        ASSERT_EQ(first.query("example.com", DNSRecordType::A, DoHMethod::JSON_GET, false).size(), 1u);
+        ASSERT_EQ(second.query("example.com", DNSRecordType::A, DoHMethod::JSON_GET, false).size(), 1u);
+    }
+
+    auto stats = pool.total();
+    EXPECT_EQ(stats.transfers, 2u);
+    EXPECT_EQ(stats.new_connections, 1u);
+    EXPECT_DOUBLE_EQ(stats.reuse_ratio(), 0.5);
+    EXPECT_EQ(server.accepted(), 1);
+}
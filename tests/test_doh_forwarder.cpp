@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "base64url.hpp"
+#include "dns_encoder.hpp"
+#include "dns_udp_client.hpp"
+#include "doh_forwarder.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+
+class DoHForwarderTest : public ::testing::Test {
+protected:
+    static ServeConfig serve_config(int threads = 2) {
+        ServeConfig config;
+        config.dns_port = 0;
+        config.http_port = 0;
+        config.threads = threads;
+        config.upstream_threads = 2;
+        return config;
+    }
+
+    static std::shared_ptr<DnsCache> make_cache() { return std::make_shared<DnsCache>(CacheConfig()); }
+
+    // 通过原始TCP连接发送HTTP请求，返回完整响应（服务端在应答后关闭连接）；half_close 时发送后关闭写方向
+    static std::string raw_http(uint16_t port, const std::string &request, bool half_close = false) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return "";
+        }
+        send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        if (half_close) {
+            shutdown(fd, SHUT_WR);
+        }
+        std::string response;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<size_t>(n));
+        }
+        close(fd);
+        return response;
+    }
+
+    // RFC 8484 GET 请求的 ?dns= 参数
+    static std::string dns_param(const std::string &domain, DNSRecordType type) {
+        DnsQueryBuffer query;
+        query.encode(domain, static_cast<uint16_t>(type));
+        return base64url_encode(std::string_view(query.bytes(), query.size));
+    }
+
+    static size_t count(const std::string &text, const std::string &needle) {
+        size_t found = 0;
+        for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+            ++found;
+        }
+        return found;
+    }
+};
+
+TEST_F(DoHForwarderTest, ForwardsMissAndAnswersRepeatFromCache) {
+    DoHStubServer upstream(make_stub_zone());
+    upstream.start();
+    DoHForwarder forwarder(serve_config(), upstream.url(), DoHMethod::POST, make_cache());
+    forwarder.start();
+    ASSERT_NE(forwarder.dns_port(), 0);
+    EXPECT_EQ(forwarder.loops(), 2u);
+
+    DnsUdpClient client("127.0.0.1", forwarder.dns_port());
+    auto records = client.query("WWW.Example.com", DNSRecordType::A);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].type, DNSRecordType::CNAME);
+    EXPECT_EQ(records[1].data, "192.0.2.1");
+    EXPECT_EQ(upstream.stats().requests, 1u);
+
+    // 第二次查询由缓存应答，名称大小写不影响命中
+    records = client.query("www.example.com", DNSRecordType::A);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(upstream.stats().requests, 1u);
+
+    auto stats = forwarder.stats();
+    EXPECT_EQ(stats.udp_queries, 2u);
+    EXPECT_EQ(stats.forwarded, 1u);
+    EXPECT_EQ(stats.cache_hits, 1u);
+}
+
+TEST_F(DoHForwarderTest, FallsBackToTcpForLargeAnswers) {
+    DoHStubServer upstream(make_stub_zone());
+    upstream.start();
+    DoHForwarder forwarder(serve_config(), upstream.url(), DoHMethod::GET, make_cache());
+    forwarder.start();
+
+    DnsUdpClient client("127.0.0.1", forwarder.dns_port());
+    auto records = client.query("big.example.com", DNSRecordType::A);
+    EXPECT_EQ(records.size(), 40u);
+    EXPECT_EQ(client.tcp_fallbacks(), 1u);
+    EXPECT_EQ(forwarder.stats().tcp_queries, 1u);
+}
+
+TEST_F(DoHForwarderTest, ServesDoHEndpoint) {
+    DoHStubServer upstream(make_stub_zone());
+    upstream.start();
+    DoHForwarder forwarder(serve_config(1), upstream.url(), DoHMethod::GET, make_cache());
+    forwarder.start();
+
+    DoHClient client(forwarder.url(), nullptr);
+    for (DoHMethod method : {DoHMethod::GET, DoHMethod::POST}) {
+        auto records = client.query("example.com", DNSRecordType::AAAA, method, false);
+        ASSERT_EQ(records.size(), 1u);
+        EXPECT_EQ(records[0].data, "2001:db8::1");
+    }
+    EXPECT_EQ(forwarder.stats().http_requests, 2u);
+    EXPECT_EQ(upstream.stats().requests, 1u);
+
+    std::string metrics = raw_http(forwarder.http_port(), "GET /metrics HTTP/1.1\r\nConnection: close\r\n\r\n");
+    EXPECT_NE(metrics.find(" 200 "), std::string::npos);
+    EXPECT_NE(metrics.find("doh_queries_total{method=\"get\",provider=\""), std::string::npos);
+    EXPECT_NE(metrics.find("doh_forwarder_outcomes_total{outcome=\"cache_hit\"} 1\n"), std::string::npos);
+
+    EXPECT_NE(raw_http(forwarder.http_port(), "GET /other HTTP/1.1\r\nConnection: close\r\n\r\n").find(" 404 "),
+              std::string::npos);
+    EXPECT_NE(raw_http(forwarder.http_port(), "PUT /dns-query HTTP/1.1\r\nConnection: close\r\n\r\n").find(" 405 "),
+              std::string::npos);
+    EXPECT_NE(raw_http(forwarder.http_port(), "GET /dns-query?dns=AAAA HTTP/1.1\r\nConnection: close\r\n\r\n")
+                  .find(" 400 "),
+              std::string::npos);
+}
+
+TEST_F(DoHForwarderTest, UpstreamFailureYieldsServfail) {
+    StubServerOptions options;
+    options.error_rate = 1.0;
+    DoHStubServer upstream(make_stub_zone(), options);
+    upstream.start();
+    DoHForwarder forwarder(serve_config(), upstream.url(), DoHMethod::POST, make_cache());
+    forwarder.start();
+
+    DnsUdpClient client("127.0.0.1", forwarder.dns_port(), std::chrono::milliseconds(5000));
+    auto results = client.query_batch({{"example.com", DNSRecordType::A}});
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].rcode, 2);
+    EXPECT_TRUE(results[0].records.empty());
+    EXPECT_EQ(forwarder.stats().servfail, 1u);
+}
+
+// 不存在的名称以NXDOMAIN应答并写入否定缓存，第二次查询不再转发
+TEST_F(DoHForwarderTest, AnswersNxdomainAndCachesIt) {
+    DoHStubServer upstream(make_stub_zone());
+    upstream.start();
+    DoHForwarder forwarder(serve_config(), upstream.url(), DoHMethod::POST, make_cache());
+    forwarder.start();
+
+    DnsUdpClient client("127.0.0.1", forwarder.dns_port(), std::chrono::milliseconds(5000));
+    for (int i = 0; i < 2; ++i) {
+        auto results = client.query_batch({{"missing.example.com", DNSRecordType::A}});
+        ASSERT_EQ(results.size(), 1u);
+        EXPECT_EQ(results[0].rcode, 3);
+        EXPECT_TRUE(results[0].records.empty());
+    }
+
+    auto stats = forwarder.stats();
+    EXPECT_EQ(stats.forwarded, 1u);
+    EXPECT_EQ(stats.cache_hits, 1u);
+    EXPECT_EQ(stats.negative, 2u);
+    EXPECT_EQ(stats.servfail, 0u);
+    EXPECT_EQ(upstream.stats().requests, 1u);
+}
+
+// 名称存在但没有所查类型的记录时以NOERROR、空回答应答（NODATA）
+TEST_F(DoHForwarderTest, AnswersNodataForMissingType) {
+    DoHStubServer upstream(make_stub_zone());
+    upstream.start();
+    DoHForwarder forwarder(serve_config(), upstream.url(), DoHMethod::GET, make_cache());
+    forwarder.start();
+
+    DnsUdpClient client("127.0.0.1", forwarder.dns_port(), std::chrono::milliseconds(5000));
+    for (int i = 0; i < 2; ++i) {
+        auto results = client.query_batch({{"big.example.com", DNSRecordType::AAAA}});
+        ASSERT_EQ(results.size(), 1u);
+        EXPECT_EQ(results[0].rcode, 0);
+        EXPECT_TRUE(results[0].records.empty());
+    }
+
+    auto stats = forwarder.stats();
+    EXPECT_EQ(stats.forwarded, 1u);
+    EXPECT_EQ(stats.cache_hits, 1u);
+    EXPECT_EQ(stats.negative, 2u);
+    EXPECT_EQ(stats.servfail, 0u);
+}
+
+// 多个事件循环共享端口，并发客户端的查询都得到正确应答
+TEST_F(DoHForwarderTest, LoopsShareThePortUnderConcurrentClients) {
+    DoHStubServer upstream(make_stub_zone());
+    upstream.start();
+    DoHForwarder forwarder(serve_config(4), upstream.url(), DoHMethod::POST, make_cache());
+    forwarder.start();
+
+    constexpr int kClients = 8;
+    constexpr int kQueries = 200;
+    std::vector<std::thread> threads;
+    std::vector<int> answered(kClients, 0);
+    for (int c = 0; c < kClients; ++c) {
+        threads.emplace_back([&, c]() {
+            DnsUdpClient client("127.0.0.1", forwarder.dns_port());
+            std::vector<DnsUdpQuestion> questions;
+            for (int i = 0; i < kQueries; ++i) {
+                questions.push_back({i % 2 ? "www.example.com" : "example.com", DNSRecordType::A});
+            }
+            for (const auto &result : client.query_batch(questions)) {
+                if (result.rcode == 0 && !result.records.empty() && result.records.back().data == "192.0.2.1") {
+                    ++answered[c];
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int c = 0; c < kClients; ++c) {
+        EXPECT_EQ(answered[c], kQueries);
+    }
+    auto stats = forwarder.stats();
+    EXPECT_GE(stats.udp_queries, static_cast<uint64_t>(kClients * kQueries));  // 可能含重传
+    EXPECT_EQ(stats.cache_hits + stats.forwarded, stats.udp_queries);
+}
+
+// 在途查询达到上限时，后续未命中的查询不转发，直接应答SERVFAIL
+TEST_F(DoHForwarderTest, AnswersServfailWhenTooManyQueriesInFlight) {
+    StubServerOptions options;
+    options.latency_ms = 300;
+    DoHStubServer upstream(make_stub_zone(), options);
+    upstream.start();
+    ServeConfig config = serve_config(1);
+    config.max_in_flight = 1;
+    DoHForwarder forwarder(config, upstream.url(), DoHMethod::POST, make_cache());
+    forwarder.start();
+
+    DnsUdpClient client("127.0.0.1", forwarder.dns_port(), std::chrono::milliseconds(5000));
+    auto results = client.query_batch({{"example.com", DNSRecordType::A},
+                                       {"example.com", DNSRecordType::AAAA},
+                                       {"www.example.com", DNSRecordType::A}});
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(results[0].rcode, 0);
+    ASSERT_EQ(results[0].records.size(), 1u);
+    EXPECT_EQ(results[1].rcode, 2);
+    EXPECT_EQ(results[2].rcode, 2);
+
+    auto stats = forwarder.stats();
+    EXPECT_EQ(stats.forwarded, 1u);
+    EXPECT_EQ(stats.overloaded, 2u);
+    EXPECT_EQ(stats.servfail, 0u);
+    EXPECT_EQ(upstream.stats().requests, 1u);
+}
+
+// 对端发送流水线请求后半关闭，已缓冲的请求在前一个请求的上游结果返回后仍被应答
+TEST_F(DoHForwarderTest, AnswersBufferedPipelinedRequestsAfterHalfClose) {
+    StubServerOptions options;
+    options.latency_ms = 100;
+    DoHStubServer upstream(make_stub_zone(), options);
+    upstream.start();
+    DoHForwarder forwarder(serve_config(1), upstream.url(), DoHMethod::POST, make_cache());
+    forwarder.start();
+
+    std::string request;
+    for (const char *domain : {"example.com", "www.example.com"}) {
+        request += "GET /dns-query?dns=" + dns_param(domain, DNSRecordType::A) + " HTTP/1.1\r\n\r\n";
+    }
+    std::string response = raw_http(forwarder.http_port(), request, true);
+    EXPECT_EQ(count(response, "HTTP/1.1 200 "), 2u);
+    EXPECT_EQ(forwarder.stats().http_requests, 2u);
+}
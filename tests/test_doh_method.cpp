@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "doh_method.hpp"
+
+namespace {
+const std::string kServer = "https://dns.example/dns-query";
+}
+
+TEST(DoHMethodTest, ParsesConfigNames) {
+    DoHMethod method = DoHMethod::GET;
+    EXPECT_TRUE(parse_doh_method("POST", method));
+    EXPECT_EQ(method, DoHMethod::POST);
+    EXPECT_TRUE(parse_doh_method("json_get", method));
+    EXPECT_EQ(method, DoHMethod::JSON_GET);
+    EXPECT_FALSE(parse_doh_method("put", method));
+    EXPECT_STREQ(doh_method_config_name(DoHMethod::GET), "get");
+}
+
+// 没有探测结果时先用调用方指定的方法，其余按代价排序
+TEST(DoHMethodTest, UnknownServerKeepsRequestedMethodFirst) {
+    DoHMethodCache cache;
+    EXPECT_EQ(cache.get(kServer, DoHMethod::GET), MethodSupport::Unknown);
+    EXPECT_EQ(cache.order(kServer, DoHMethod::JSON_GET, 40),
+              (std::vector<DoHMethod>{DoHMethod::JSON_GET, DoHMethod::GET, DoHMethod::POST}));
+    EXPECT_EQ(cache.order(kServer, DoHMethod::GET, 300),
+              (std::vector<DoHMethod>{DoHMethod::GET, DoHMethod::POST, DoHMethod::JSON_GET}));
+}
+
+// 已知可用的方法按代价优先，已知不可用的方法不再尝试
+TEST(DoHMethodTest, PrefersCheapestSupportedMethod) {
+    DoHMethodCache cache;
+    auto now = DoHMethodCache::Clock::now();
+    cache.record(kServer, DoHMethod::GET, true, now);
+    cache.record(kServer, DoHMethod::POST, true, now);
+    cache.record(kServer, DoHMethod::JSON_GET, false, now);
+
+    EXPECT_EQ(cache.order(kServer, DoHMethod::JSON_GET, 40, now),
+              (std::vector<DoHMethod>{DoHMethod::GET, DoHMethod::POST}));
+    // 大报文优先POST
+    EXPECT_EQ(cache.order(kServer, DoHMethod::GET, DoHMethodCache::kLargeQuerySize + 1, now),
+              (std::vector<DoHMethod>{DoHMethod::POST, DoHMethod::GET}));
+
+    // 全部不可用时仍尝试指定的方法
+    cache.record(kServer, DoHMethod::GET, false, now);
+    cache.record(kServer, DoHMethod::POST, false, now);
+    EXPECT_EQ(cache.order(kServer, DoHMethod::POST, 40, now), (std::vector<DoHMethod>{DoHMethod::POST}));
+}
+
+TEST(DoHMethodTest, ResultsExpireAfterTtl) {
+    DoHMethodCache cache(std::chrono::seconds(60));
+    auto now = DoHMethodCache::Clock::now();
+    cache.record(kServer, DoHMethod::GET, false, now);
+    EXPECT_EQ(cache.get(kServer, DoHMethod::GET, now + std::chrono::seconds(59)), MethodSupport::Unsupported);
+    EXPECT_EQ(cache.get(kServer, DoHMethod::GET, now + std::chrono::seconds(60)), MethodSupport::Unknown);
+    EXPECT_EQ(cache.order(kServer, DoHMethod::GET, 40, now + std::chrono::seconds(60)).front(), DoHMethod::GET);
+
+    cache.set_ttl(std::chrono::seconds(10));
+    EXPECT_EQ(cache.get(kServer, DoHMethod::GET, now + std::chrono::seconds(10)), MethodSupport::Unknown);
+    cache.clear();
+    EXPECT_EQ(cache.get(kServer, DoHMethod::GET, now), MethodSupport::Unknown);
+}
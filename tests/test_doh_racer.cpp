@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "doh_racer.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+
+class DoHRacerTest : public ::testing::Test {
+protected:
+    static std::vector<DoHServerConfig> make_servers() {
+        return {
+            {"json_only", "http://127.0.0.1:1/resolve", {"json"}, 1, 2, true},
+            {"disabled", "http://127.0.0.1:1/dns-query", {"get", "post"}, 2, 2, false},
+            {"no_methods", "http://127.0.0.1:1/dns-query", {}, 3, 2, true},
+            {"wire", "http://127.0.0.1:1/dns-query", {"get", "post"}, 4, 2, true},
+            {"extra", "http://127.0.0.1:1/dns-query", {"get"}, 5, 2, true},
+        };
+    }
+};
+
+TEST_F(DoHRacerTest, CandidatesSkipDisabledAndRespectLimit) {
+    RaceConfig config;
+    config.max_providers = 2;
+
+    DoHRacer racer(make_servers(), config);
+    ASSERT_EQ(racer.candidates().size(), 2u);
+    EXPECT_EQ(racer.candidates()[0].name, "json_only");
+    EXPECT_EQ(racer.candidates()[1].name, "wire");
+}
+
+TEST_F(DoHRacerTest, SelectMethodPrefersRequestedMethod) {
+    DoHServerConfig server{"s", "https://example/dns-query", {"get", "post"}, 1, 10, true};
+    DoHMethod method = DoHMethod::JSON_GET;
+
+    ASSERT_TRUE(DoHRacer::select_method(server, DoHMethod::POST, method));
+    EXPECT_EQ(method, DoHMethod::POST);
+
+    // 不支持时使用服务商支持的第一个方法
+    ASSERT_TRUE(DoHRacer::select_method(server, DoHMethod::JSON_GET, method));
+    EXPECT_EQ(method, DoHMethod::GET);
+
+    server.methods.clear();
+    EXPECT_FALSE(DoHRacer::select_method(server, DoHMethod::GET, method));
+}
+
+TEST_F(DoHRacerTest, AllProvidersFailing) {
+    RaceConfig config;
+    config.max_providers = 3;
+    config.stagger_ms = 1000;
+
+    // 本地未监听端口，连接会被立即拒绝；失败后应立即启动下一个服务商而不是等待stagger
+    DoHRacer racer(make_servers(), config);
+    auto result = racer.race("example.com", DNSRecordType::A, DoHMethod::GET);
+
+    EXPECT_TRUE(result.records.empty());
+    EXPECT_TRUE(result.winner.empty());
+    EXPECT_EQ(result.launched, 3);
+    EXPECT_EQ(result.failed, 3);
+    EXPECT_LT(result.elapsed.count(), 1000);
+}
+
+// 总是返回503的服务商失败后熔断，之后的竞速直接跳过它
+TEST_F(DoHRacerTest, SkipsProviderWithOpenCircuit) {
+    DnsZone zone = make_stub_zone();
+    StubServerOptions failing_options;
+    failing_options.error_rate = 1.0;
+    DoHStubServer failing(zone, failing_options);
+    StubServerOptions healthy_options;
+    healthy_options.latency_ms = 50;  // 保证失败的服务商先返回，而不是落败被取消
+    DoHStubServer healthy(zone, healthy_options);
+    failing.start();
+    healthy.start();
+
+    // stagger 为0时所有放行的服务商同时启动
+    RaceConfig config;
+    config.max_providers = 2;
+    config.stagger_ms = 0;
+    HealthConfig health_config;
+    health_config.failure_threshold = 1;
+    ProviderHealth health(health_config);
+    DoHRacer racer({{"failing", failing.url(), {"get"}, 1, 5, true}, {"healthy", healthy.url(), {"get"}, 2, 5, true}},
+                   config, 5, &DoHConnectionPool::instance(), &health);
+    EXPECT_EQ(racer.candidates()[0].name, "failing");
+
+    auto result = racer.race("example.com");
+    EXPECT_EQ(result.winner, "healthy");
+    EXPECT_EQ(result.launched, 2);
+    EXPECT_EQ(health.state(failing.url()), CircuitState::Open);
+    EXPECT_EQ(racer.candidates()[0].name, "healthy");
+
+    result = racer.race("example.com");
+    EXPECT_EQ(result.winner, "healthy");
+    EXPECT_EQ(result.launched, 1);
+    EXPECT_EQ(failing.stats().requests, 1u);
+    EXPECT_EQ(health.stats(healthy.url()).successes, 2u);
+    EXPECT_EQ(health.stats(failing.url()).failures, 1u);
+}
+
+// 拒绝所用方法（405）的服务商不计入熔断，换用其他方法仍可使用
+TEST_F(DoHRacerTest, MethodRejectionDoesNotOpenCircuit) {
+    StubServerOptions rejecting_options;
+    rejecting_options.error_rate = 1.0;
+    rejecting_options.error_status = 405;
+    DoHStubServer rejecting(make_stub_zone(), rejecting_options);
+    rejecting.start();
+
+    RaceConfig config;
+    config.max_providers = 1;
+    HealthConfig health_config;
+    health_config.failure_threshold = 1;
+    ProviderHealth health(health_config);
+    DoHRacer racer({{"rejecting", rejecting.url(), {"get"}, 1, 5, true}}, config, 5, &DoHConnectionPool::instance(),
+                   &health);
+
+    for (int i = 0; i < 2; ++i) {
+        auto result = racer.race("example.com");
+        EXPECT_TRUE(result.records.empty());
+        EXPECT_EQ(result.launched, 1);
+    }
+    EXPECT_EQ(health.state(rejecting.url()), CircuitState::Closed);
+    EXPECT_EQ(health.stats(rejecting.url()).failures, 0u);
+    EXPECT_EQ(rejecting.stats().requests, 2u);
+}
+
+// 无法编码的域名在启动任何请求之前失败，服务商的探测资格与之后的竞速不受影响
+TEST_F(DoHRacerTest, MalformedNameFailsBeforeLaunching) {
+    DoHStubServer server(make_stub_zone());
+    server.start();
+
+    RaceConfig config;
+    config.max_providers = 2;
+    config.stagger_ms = 0;
+    ProviderHealth health;
+    DoHRacer racer({{"json", server.url("/resolve"), {"json"}, 1, 5, true}, {"wire", server.url(), {"get"}, 2, 5, true}},
+                   config, 5, &DoHConnectionPool::instance(), &health);
+
+    auto result = racer.race("a..example");
+    EXPECT_TRUE(result.records.empty());
+    EXPECT_EQ(result.launched, 0);
+    result = racer.race(std::string(64, 'a') + ".example");
+    EXPECT_EQ(result.launched, 0);
+    EXPECT_EQ(server.stats().requests, 0u);
+
+    result = racer.race("example.com");
+    EXPECT_FALSE(result.records.empty());
+    EXPECT_EQ(health.state(server.url()), CircuitState::Closed);
+}
@@ -0,0 +1,222 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "doh_client.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+
+class DoHStubServerTest : public ::testing::Test {
+protected:
+    static std::string wire_query(const std::string& domain, DNSRecordType type) {
+        DnsQueryBuffer query;
+        query.encode(domain, static_cast<uint16_t>(type));
+        return std::string(query.bytes(), query.size);
+    }
+};
+
+TEST_F(DoHStubServerTest, ZoneLookupFollowsCnameChain) {
+    DnsZone zone = make_stub_zone();
+    EXPECT_EQ(zone.size(), 46u);
+
+    auto answer = zone.lookup("ALIAS.example.com.", DNSRecordType::A);
+    EXPECT_EQ(answer.rcode, 0);
+    ASSERT_EQ(answer.records.size(), 3u);
+    EXPECT_EQ(answer.records[0]->type, DNSRecordType::CNAME);
+    EXPECT_EQ(answer.records[1]->type, DNSRecordType::CNAME);
+    EXPECT_EQ(answer.records[1]->ttl, 60u);
+    EXPECT_EQ(answer.records[2]->data, "192.0.2.1");
+    EXPECT_EQ(answer.records[2]->ttl, 120u);
+
+    EXPECT_EQ(zone.lookup("www.example.com", DNSRecordType::CNAME).records.size(), 1u);
+    EXPECT_EQ(zone.lookup("missing.example.com", DNSRecordType::A).rcode, 3);
+
+    auto empty = zone.lookup("example.com", DNSRecordType::NS);
+    EXPECT_EQ(empty.rcode, 0);
+    EXPECT_TRUE(empty.records.empty());
+}
+
+TEST_F(DoHStubServerTest, ZoneRejectsMalformedLines) {
+    for (const char* line : {"example.com. IN A 999.1.1.1", "example.com. IN BOGUS x", "example.com. 60 IN A",
+                             "example.com. IN MX mail.example.com.", "example.com. IN TXT \"open",
+                             "bad..name. IN A 192.0.2.1"}) {
+        std::istringstream input(line);
+        DnsZone zone;
+        EXPECT_THROW(zone.load(input), ConfigException) << line;
+    }
+    EXPECT_THROW(DnsZone::load_file("does/not/exist.zone"), ConfigException);
+}
+
+TEST_F(DoHStubServerTest, AnswersWireQueries) {
+    DoHStubServer server(make_stub_zone());
+
+    HttpRequest post{"POST", "/dns-query", "", wire_query("www.example.com", DNSRecordType::A)};
+    auto response = server.respond(post);
+    EXPECT_EQ(response.status, 200);
+    EXPECT_EQ(response.content_type, "application/dns-message");
+    EXPECT_EQ(response.max_age, 60);
+
+    auto records = parse_dns_wireformat_response(response.body);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].type, DNSRecordType::CNAME);
+    EXPECT_EQ(records[0].data, "example.com");
+    EXPECT_EQ(records[1].data, "192.0.2.1");
+
+    HttpRequest get{"GET", "/dns-query", "dns=" + base64url_encode(wire_query("example.com", DNSRecordType::TXT)),
+                    ""};
+    records = parse_dns_wireformat_response(server.respond(get).body);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "\"v=spf1 -all\" \"second string\"");
+
+    get.query = "dns=" + base64url_encode(wire_query("missing.example.com", DNSRecordType::A));
+    DnsMessageParser parser(server.respond(get).body);
+    EXPECT_EQ(parser.header().rcode(), 3);
+}
+
+TEST_F(DoHStubServerTest, AnswersJsonQueries) {
+    DoHStubServer server(make_stub_zone());
+
+    HttpRequest request{"GET", "/resolve", "name=example.com&type=MX", ""};
+    auto response = server.respond(request);
+    EXPECT_EQ(response.status, 200);
+    EXPECT_EQ(response.content_type, "application/dns-json");
+
+    auto parsed = parse_dns_json(response.body.data(), response.body.size());
+    EXPECT_EQ(parsed.status, 0);
+    ASSERT_EQ(parsed.answers.size(), 1u);
+    EXPECT_EQ(parsed.answers[0].type, DNSRecordType::MX);
+    EXPECT_EQ(parsed.answers[0].ttl, 120u);
+
+    request.query = "name=nothing.example.com&type=1";
+    response = server.respond(request);
+    EXPECT_EQ(parse_dns_json(response.body.data(), response.body.size()).status, 3);
+}
+
+TEST_F(DoHStubServerTest, RejectsBadRequests) {
+    DoHStubServer server(make_stub_zone());
+    EXPECT_EQ(server.respond({"GET", "/dns-query", "dns=!!!", ""}).status, 400);
+    EXPECT_EQ(server.respond({"GET", "/dns-query", "", ""}).status, 400);
+    EXPECT_EQ(server.respond({"POST", "/dns-query", "", "short"}).status, 400);
+    EXPECT_EQ(server.respond({"PUT", "/dns-query", "", ""}).status, 405);
+    EXPECT_EQ(server.respond({"GET", "/resolve", "type=A", ""}).status, 400);
+    EXPECT_EQ(server.respond({"GET", "/resolve", "name=example.com&type=BOGUS", ""}).status, 400);
+    EXPECT_EQ(server.respond({"GET", "/other", "", ""}).status, 404);
+}
+
+TEST_F(DoHStubServerTest, TruncatedResponsesCarryNoAnswers) {
+    DoHStubServer server(make_stub_zone());
+    auto response = server.respond({"POST", "/dns-query", "", wire_query("example.com", DNSRecordType::A)}, true);
+    DnsMessageParser parser(response.body);
+    EXPECT_TRUE(parser.header().truncated());
+    EXPECT_EQ(parser.header().ancount, 0);
+
+    response = server.respond({"GET", "/resolve", "name=example.com", ""}, true);
+    EXPECT_NE(response.body.find("\"TC\":true"), std::string::npos);
+    EXPECT_TRUE(parse_json_response(response.body).empty());
+}
+
+// 通过回环地址用 DoHClient 完整走一遍三种方法
+TEST_F(DoHStubServerTest, ServesDoHClientOverLoopback) {
+    DoHStubServer server(make_stub_zone());
+    ASSERT_NE(server.start(), 0);
+
+    DoHClient client(server.url("/dns-query"));
+    auto records = client.query("www.example.com", DNSRecordType::A, DoHMethod::GET, false);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[1].data, "192.0.2.1");
+
+    records = client.query("example.com", DNSRecordType::AAAA, DoHMethod::POST, false);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "2001:db8::1");
+
+    DoHClient json_client(server.url("/resolve"));
+    records = json_client.query("alias.example.com", DNSRecordType::A, DoHMethod::JSON_GET, false);
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(records[2].data, "192.0.2.1");
+
+    auto stats = server.stats();
+    EXPECT_EQ(stats.requests, 3u);
+    EXPECT_LE(stats.connections, 2u);  // 同一客户端的请求复用连接
+    server.stop();
+}
+
+// 方法不受支持时自动改用其他方法，之后直接使用已知可用的方法
+TEST_F(DoHStubServerTest, DiscoversSupportedMethod) {
+    DoHStubServer server(make_stub_zone());
+    server.start();
+
+    DoHMethodCache methods;
+    DoHClient client(server.url("/resolve"));  // 只支持JSON API
+    client.set_method_cache(&methods);
+    client.set_single_flight(nullptr);
+
+    auto records = client.query("alias.example.com", DNSRecordType::A, DoHMethod::GET, false);
+    ASSERT_EQ(records.size(), 3u);
+    EXPECT_EQ(server.stats().requests, 3u);  // GET被拒绝(400)，POST被拒绝(405)，JSON成功
+    EXPECT_EQ(methods.get(server.url("/resolve"), DoHMethod::GET), MethodSupport::Unsupported);
+    EXPECT_EQ(methods.get(server.url("/resolve"), DoHMethod::POST), MethodSupport::Unsupported);
+    EXPECT_EQ(methods.get(server.url("/resolve"), DoHMethod::JSON_GET), MethodSupport::Supported);
+
+    records = client.query("www.example.com", DNSRecordType::A, DoHMethod::GET, false);
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(server.stats().requests, 4u);
+
+    DoHClient wire_client(server.url("/dns-query"));
+    wire_client.set_method_cache(&methods);
+    auto supported = wire_client.probe_methods("example.com");
+    ASSERT_EQ(supported.size(), 2u);
+    EXPECT_EQ(supported[0], DoHMethod::GET);
+    EXPECT_EQ(supported[1], DoHMethod::POST);
+}
+
+TEST_F(DoHStubServerTest, InjectsErrorsAndTruncation) {
+    StubServerOptions failing;
+    failing.error_rate = 1.0;
+    DoHStubServer error_server(make_stub_zone(), failing);
+    error_server.start();
+    DoHClient error_client(error_server.url("/dns-query"));
+    EXPECT_TRUE(error_client.query("example.com", DNSRecordType::A, DoHMethod::GET, false).empty());
+    EXPECT_EQ(error_server.stats().injected_errors, 1u);
+
+    StubServerOptions truncating;
+    truncating.truncate_rate = 1.0;
+    truncating.latency_ms = 20;
+    DoHStubServer truncating_server(make_stub_zone(), truncating);
+    truncating_server.start();
+    DoHClient truncating_client(truncating_server.url("/dns-query"));
+    auto started = std::chrono::steady_clock::now();
+    EXPECT_TRUE(truncating_client.query("example.com", DNSRecordType::A, DoHMethod::POST, false).empty());
+    EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(20));
+    EXPECT_EQ(truncating_server.stats().truncated, 1u);
+}
+
+// 多个线程各自的客户端同时查询同一域名，只向上游发出一个请求
+TEST_F(DoHStubServerTest, CoalescesConcurrentClientQueries) {
+    StubServerOptions slow;
+    slow.latency_ms = 200;
+    DoHStubServer server(make_stub_zone(), slow);
+    server.start();
+
+    DoHSingleFlight group;
+    constexpr int kClients = 8;
+    std::vector<std::vector<DNSRecord>> results(kClients);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kClients; ++i) {
+        threads.emplace_back([&, i]() {
+            DoHClient client(server.url("/dns-query"));
+            client.set_single_flight(&group);
+            results[i] = client.query("example.com", DNSRecordType::A, DoHMethod::POST, false);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& records : results) {
+        ASSERT_EQ(records.size(), 1u);
+        EXPECT_EQ(records[0].data, "192.0.2.1");
+    }
+    EXPECT_GT(group.saved_requests(), 0u);
+    EXPECT_EQ(server.stats().requests + group.saved_requests(), static_cast<uint64_t>(kClients));
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "doh_stub_server.hpp"
+#include "dual_stack.hpp"
+#include "stub_zone.hpp"
+
+namespace {
+DNSRecord address(DNSRecordType type, const std::string& data) { return {"example.com", type, 60, data}; }
+}  // namespace
+
+TEST(DualStackTest, AddressPrecedenceFollowsRfc6724PolicyTable) {
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "::1")), 50);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "2001:db8::1")), 40);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::A, "192.0.2.1")), 35);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "::ffff:192.0.2.1")), 35);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "2002:c000:201::1")), 30);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "2001:0:4136:e378::1")), 5);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "fd00::1")), 3);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::AAAA, "fec0::1")), 1);
+    EXPECT_EQ(address_precedence(address(DNSRecordType::A, "not-an-address")), -1);
+    EXPECT_EQ(address_precedence({"example.com", DNSRecordType::CNAME, 60, "www.example.com"}), -1);
+}
+
+TEST(DualStackTest, MergeOrdersByPrecedenceAndDropsNonAddresses) {
+    std::vector<DNSRecord> ipv4 = {
+        {"alias.example.com", DNSRecordType::CNAME, 60, "example.com"},
+        address(DNSRecordType::A, "192.0.2.1"),
+        address(DNSRecordType::A, "192.0.2.2"),
+        address(DNSRecordType::A, "192.0.2.1"),
+    };
+    std::vector<DNSRecord> ipv6 = {
+        address(DNSRecordType::AAAA, "fd00::1"),
+        address(DNSRecordType::AAAA, "2001:db8::1"),
+    };
+    auto merged = merge_dual_stack(ipv4, ipv6);
+    ASSERT_EQ(merged.size(), 4u);
+    EXPECT_EQ(merged[0].data, "2001:db8::1");
+    EXPECT_EQ(merged[1].data, "192.0.2.1");
+    EXPECT_EQ(merged[2].data, "192.0.2.2");
+    EXPECT_EQ(merged[3].data, "fd00::1");  // ULA 排在IPv4之后
+}
+
+// A与AAAA并发查询，耗时接近单个查询
+TEST(DualStackTest, ResolvesBothFamiliesInParallel) {
+    StubServerOptions options;
+    options.latency_ms = 150;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    AsyncDoHClient client(server.url());
+    DualStackResolver resolver(client, DoHMethod::POST, false);
+    auto cache = std::make_shared<DnsCache>(CacheConfig{});
+    resolver.set_cache(cache);
+
+    auto started = std::chrono::steady_clock::now();
+    auto records = resolver.resolve("example.com");
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].type, DNSRecordType::AAAA);
+    EXPECT_EQ(records[1].type, DNSRecordType::A);
+    EXPECT_LT(elapsed, std::chrono::milliseconds(290));
+    EXPECT_EQ(server.stats().requests, 2u);
+
+    // 两族均已缓存，不再发起请求
+    records = resolver.resolve("example.com");
+    EXPECT_EQ(records.size(), 2u);
+    EXPECT_EQ(server.stats().requests, 2u);
+}
+
+TEST(DualStackTest, SystemResolverReturnsSortedAddresses) {
+    auto records = DualStackResolver::resolve_system("localhost", std::chrono::milliseconds(2000));
+    ASSERT_FALSE(records.empty());
+    for (size_t i = 1; i < records.size(); ++i) {
+        EXPECT_GE(address_precedence(records[i - 1]), address_precedence(records[i]));
+    }
+}
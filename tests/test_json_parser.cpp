@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include "tools.hpp"
+
+// Google JSON API 的典型响应，Question 中的 name/type 不应被当作回答
+static const char* kGoogleResponse = R"({
+  "Status": 0, "TC": false, "RD": true, "RA": true, "AD": false, "CD": false,
+  "Question": [{"name": "www.example.com.", "type": 1}],
+  "Answer": [
+    {"name": "www.example.com.", "type": 5, "TTL": 300, "data": "example.edgesuite.net."},
+    {"name": "example.edgesuite.net.", "type": 1, "TTL": 20, "data": "93.184.216.34"},
+    {"name": "example.edgesuite.net.", "type": 28, "TTL": 20, "data": "2606:2800:220:1::248"}
+  ],
+  "Comment": "Response from 192.0.2.1."
+})";
+
+TEST(JsonParserTest, ExtractsStatusAndAnswers) {
+    auto response = parse_dns_json(kGoogleResponse, std::strlen(kGoogleResponse));
+    EXPECT_EQ(response.status, 0);
+    ASSERT_EQ(response.answers.size(), 3u);
+
+    EXPECT_EQ(response.answers[0].name, "www.example.com.");
+    EXPECT_EQ(response.answers[0].type, DNSRecordType::CNAME);
+    EXPECT_EQ(response.answers[0].ttl, 300u);
+    EXPECT_EQ(response.answers[0].data, "example.edgesuite.net");
+
+    EXPECT_EQ(response.answers[1].type, DNSRecordType::A);
+    EXPECT_EQ(response.answers[1].ttl, 20u);
+    EXPECT_EQ(response.answers[1].data, "93.184.216.34");
+
+    EXPECT_EQ(response.answers[2].type, DNSRecordType::AAAA);
+    EXPECT_EQ(response.answers[2].data, "2606:2800:220:1::248");
+}
+
+TEST(JsonParserTest, NxdomainWithoutAnswer) {
+    const std::string json = R"({"Status": 3, "Question": [{"name": "nope.example.", "type": 1}],
+        "Authority": [{"name": "example.", "type": 6, "TTL": 900, "data": "ns. host. 1 2 3 4 5"}]})";
+    auto response = parse_dns_json(json.data(), json.size());
+    EXPECT_EQ(response.status, 3);
+    EXPECT_TRUE(response.answers.empty());
+}
+
+TEST(JsonParserTest, FieldOrderDoesNotMatter) {
+    const std::string json =
+        R"({"Answer": [{"data": "ns1.example.com.", "TTL": 60, "type": 2, "name": "example.com."}], "Status": 0})";
+    auto response = parse_dns_json(json.data(), json.size());
+    EXPECT_EQ(response.status, 0);
+    ASSERT_EQ(response.answers.size(), 1u);
+    EXPECT_EQ(response.answers[0].type, DNSRecordType::NS);
+    EXPECT_EQ(response.answers[0].data, "ns1.example.com");
+}
+
+TEST(JsonParserTest, OtherTypesKeepJsonStringForm) {
+    const std::string json = R"({"Status": 0, "Answer": [
+        {"name": "example.com.", "type": 16, "TTL": 60, "data": "\"v=spf1 -all\""},
+        {"name": "example.com.", "type": 15, "TTL": 60, "data": "10 mail.example.com."}]})";
+    auto response = parse_dns_json(json.data(), json.size());
+    ASSERT_EQ(response.answers.size(), 2u);
+    EXPECT_EQ(response.answers[0].data, R"("\"v=spf1 -all\"")");
+    EXPECT_EQ(response.answers[1].data, R"("10 mail.example.com.")");
+}
+
+TEST(JsonParserTest, IgnoresUnknownAndNestedFields) {
+    const std::string json = R"({"Status": 0, "edns_client_subnet": "0.0.0.0/0",
+        "Answer": [{"name": "a.example.", "type": 1, "TTL": 5, "data": "192.0.2.1",
+                    "extra": {"name": "bogus", "TTL": 999, "list": [1, 2, {"type": 5}]}}],
+        "Additional": [{"name": "b.example.", "type": 1, "TTL": 5, "data": "192.0.2.2"}]})";
+    auto response = parse_dns_json(json.data(), json.size());
+    ASSERT_EQ(response.answers.size(), 1u);
+    EXPECT_EQ(response.answers[0].name, "a.example.");
+    EXPECT_EQ(response.answers[0].type, DNSRecordType::A);
+    EXPECT_EQ(response.answers[0].ttl, 5u);
+}
+
+TEST(JsonParserTest, WrongValueTypesAreSkipped) {
+    const std::string json = R"({"Status": "0", "Answer": [{"name": 1, "type": "A", "TTL": -1, "data": ["x"]}]})";
+    auto response = parse_dns_json(json.data(), json.size());
+    EXPECT_EQ(response.status, -1);
+    ASSERT_EQ(response.answers.size(), 1u);
+    EXPECT_TRUE(response.answers[0].name.empty());
+    EXPECT_EQ(response.answers[0].ttl, 0u);
+    EXPECT_TRUE(response.answers[0].data.empty());
+}
+
+TEST(JsonParserTest, DoesNotRequireNullTerminator) {
+    const std::string json = std::string(R"({"Status": 0, "Answer": []})") + "garbage";
+    auto response = parse_dns_json(json.data(), json.size() - 7);
+    EXPECT_EQ(response.status, 0);
+    EXPECT_TRUE(response.answers.empty());
+}
+
+TEST(JsonParserTest, MalformedInputThrows) {
+    for (const std::string json : {"", "[]", "42", "{\"Status\": 0", "{\"Answer\": [}", "{} {}"}) {
+        EXPECT_THROW(parse_dns_json(json.data(), json.size()), ParseException) << json;
+    }
+}
+
+TEST(JsonParserTest, ParseJsonResponseReturnsEmptyOnError) {
+    EXPECT_TRUE(parse_json_response("<html>502 Bad Gateway</html>").empty());
+    EXPECT_EQ(parse_json_response(kGoogleResponse).size(), 3u);
+}
@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
+#include <spdlog/sinks/base_sink.h>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include "logger.hpp"
 
 class LoggerTest : public ::testing::Test {
@@ -187,4 +192,68 @@ TEST_F(LoggerTest, MultipleInitCalls) {
     
     EXPECT_NE(content.find("First init message"), std::string::npos);
     EXPECT_NE(content.find("Second init message"), std::string::npos);
-} 
\ No newline at end of file
+}
+
+TEST_F(LoggerTest, AsyncLoggingWritesAllMessagesOnShutdown) {
+    Logger::init("debug", true, test_log_file_, false, 64, true);
+
+    // 队列满时阻塞，消息不会丢失；shutdown() 等待后台线程写完
+    for (int i = 0; i < 200; ++i) {
+        Logger::debug("Async message {}", i);
+    }
+    EXPECT_EQ(Logger::dropped_messages(), 0u);
+    Logger::shutdown();
+
+    std::ifstream log_file(test_log_file_);
+    std::string content((std::istreambuf_iterator<char>(log_file)),
+                        std::istreambuf_iterator<char>());
+
+    EXPECT_NE(content.find("Async message 0\n"), std::string::npos);
+    EXPECT_NE(content.find("Async message 199\n"), std::string::npos);
+}
+
+// 每条消息耗时1ms的sink，使后台线程跟不上调用方
+class SlowCountingSink : public spdlog::sinks::base_sink<std::mutex> {
+public:
+    std::atomic<int> written{0};
+
+protected:
+    void sink_it_(const spdlog::details::log_msg &) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ++written;
+    }
+    void flush_() override {}
+};
+
+TEST_F(LoggerTest, AsyncOverrunDropsOldestMessages) {
+    auto sink = std::make_shared<SlowCountingSink>();
+    Logger::init_with_sink(sink, "info", 2, false);
+
+    // 队列只有2个槽位且不阻塞：调用方不等待，来不及写出的消息被覆盖并计数
+    for (int i = 0; i < 100; ++i) {
+        Logger::info("Overrun message {}", i);
+    }
+    size_t dropped = Logger::dropped_messages();
+    EXPECT_GT(dropped, 0u);
+    Logger::shutdown();
+    EXPECT_EQ(static_cast<size_t>(sink->written.load()) + dropped, 100u);
+}
+
+TEST_F(LoggerTest, MacrosSkipArgumentsForDisabledLevels) {
+    Logger::init("info", true, test_log_file_);
+
+    int evaluated = 0;
+    auto argument = [&evaluated]() {
+        ++evaluated;
+        return std::string("value");
+    };
+    DOH_LOG_DEBUG("Debug {}", argument());
+    EXPECT_EQ(evaluated, 0);
+    DOH_LOG_INFO("Info {}", argument());
+    EXPECT_EQ(evaluated, 1);
+
+    EXPECT_FALSE(Logger::enabled(spdlog::level::debug));
+    EXPECT_TRUE(Logger::enabled(spdlog::level::warn));
+    Logger::shutdown();
+    EXPECT_FALSE(Logger::enabled(spdlog::level::critical));
+}
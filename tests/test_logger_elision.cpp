@@ -0,0 +1,56 @@
+// 以 DOH_LOG_ACTIVE_LEVEL=SPDLOG_LEVEL_INFO 单独编译（见 CMakeLists.txt），验证低于编译期最低级别的日志被删除
+#include <gtest/gtest.h>
+#include <spdlog/sinks/ostream_sink.h>
+#include <sstream>
+#include <string>
+#include "logger.hpp"
+
+static_assert(DOH_LOG_ACTIVE_LEVEL == SPDLOG_LEVEL_INFO, "test_logger_elision must be built with an info minimum");
+
+class LoggerElisionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Logger::init_with_sink(std::make_shared<spdlog::sinks::ostream_sink_st>(output_), "trace");
+    }
+
+    void TearDown() override { Logger::shutdown(); }
+
+    std::ostringstream output_;
+};
+
+TEST_F(LoggerElisionTest, LevelsBelowMinimumAreCompiledOut) {
+    EXPECT_FALSE(Logger::compiled(spdlog::level::trace));
+    EXPECT_FALSE(Logger::compiled(spdlog::level::debug));
+    EXPECT_TRUE(Logger::compiled(spdlog::level::info));
+
+    // 运行时级别为trace，但debug与trace在编译期已被删除：参数不求值，也没有输出
+    int evaluated = 0;
+    auto argument = [&evaluated]() {
+        ++evaluated;
+        return std::string("value");
+    };
+    DOH_LOG_TRACE("Trace {}", argument());
+    DOH_LOG_DEBUG("Debug {}", argument());
+    Logger::debug("Direct debug {}", 1);
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_FALSE(Logger::enabled(spdlog::level::debug));
+
+    DOH_LOG_INFO("Info {}", argument());
+    EXPECT_EQ(evaluated, 1);
+
+    std::string content = output_.str();
+    EXPECT_EQ(content.find("Trace value"), std::string::npos);
+    EXPECT_EQ(content.find("Debug value"), std::string::npos);
+    EXPECT_EQ(content.find("Direct debug"), std::string::npos);
+    EXPECT_NE(content.find("Info value"), std::string::npos);
+}
+
+TEST_F(LoggerElisionTest, WarnsOnceWhenRuntimeLevelIsBelowMinimum) {
+    // SetUp 中以trace初始化时已经提示过，之后再调整级别不再重复
+    Logger::set_level("debug");
+    Logger::set_level("trace");
+    std::string content = output_.str();
+    size_t notice = content.find("is below the compiled minimum info");
+    EXPECT_NE(notice, std::string::npos);
+    EXPECT_EQ(content.find("is below the compiled minimum", notice + 1), std::string::npos);
+}
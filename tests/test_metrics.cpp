@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "doh_client.hpp"
+#include "doh_stub_server.hpp"
+#include "metrics.hpp"
+#include "stub_zone.hpp"
+
+TEST(MetricsTest, CountersSumAcrossLiveAndExitedThreads) {
+    Counter counter = MetricsRegistry::instance().counter("test_events_total", "Events", {{"case", "threads"}});
+    uint64_t before = counter.value();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([counter]() {
+            for (int i = 0; i < 1000; ++i) {
+                counter.inc();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    counter.inc(5);
+    EXPECT_EQ(counter.value() - before, 4005u);
+
+    // 相同名称与标签返回同一个计数器
+    Counter same = MetricsRegistry::instance().counter("test_events_total", "Events", {{"case", "threads"}});
+    same.inc();
+    EXPECT_EQ(counter.value() - before, 4006u);
+}
+
+TEST(MetricsTest, HistogramBucketsAreLogLinear) {
+    for (uint64_t v : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 100ull, 1000ull, 123456ull, 99999999ull}) {
+        size_t index = Histogram::bucket_index(v);
+        EXPECT_LE(Histogram::bucket_lower_bound(index), v);
+        EXPECT_GT(Histogram::bucket_lower_bound(index + 1), v);
+        // 相对误差不超过12.5%
+        EXPECT_LE(Histogram::bucket_lower_bound(index + 1) - Histogram::bucket_lower_bound(index),
+                  std::max<uint64_t>(1, v / 8 + 1));
+    }
+    EXPECT_EQ(Histogram::bucket_index(uint64_t{1} << 40), Histogram::kBuckets - 1);
+
+    Histogram histogram = MetricsRegistry::instance().histogram("test_latency_seconds", "Latency");
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        histogram.record(v);
+    }
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 500500u);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.5)), 500.0, 500.0 / 8);
+    EXPECT_NEAR(static_cast<double>(snapshot.percentile(0.99)), 990.0, 990.0 / 8);
+}
+
+TEST(MetricsTest, ExportsPrometheusText) {
+    auto &registry = MetricsRegistry::instance();
+    registry.counter("test_export_total", "Exported \"counter\"", {{"path", "a\"b"}}).inc(3);
+    CounterArray codes = registry.counter_array("test_codes_total", "Codes", "code", 100, 10);
+    codes.inc(104, 2);
+    codes.inc(500);  // 超出范围，计入溢出槽
+    EXPECT_EQ(codes.value(104), 2u);
+    EXPECT_EQ(codes.value(500), 0u);
+    Histogram histogram = registry.histogram("test_export_seconds", "Latency", {{"method", "get"}});
+    histogram.record(200);
+    histogram.record(3000000);
+
+    std::string text = registry.prometheus_text();
+    EXPECT_NE(text.find("# TYPE test_export_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("test_export_total{path=\"a\\\"b\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_codes_total{code=\"104\"} 2\n"), std::string::npos);
+    EXPECT_EQ(text.find("test_codes_total{code=\"105\"}"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_export_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("test_export_seconds_bucket{method=\"get\",le=\"0.000128\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("test_export_seconds_bucket{method=\"get\",le=\"0.000256\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_export_seconds_bucket{method=\"get\",le=\"+Inf\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("test_export_seconds_sum{method=\"get\"} 3.000200\n"), std::string::npos);
+    EXPECT_NE(text.find("test_export_seconds_count{method=\"get\"} 2\n"), std::string::npos);
+}
+
+TEST(MetricsTest, DoHRequestsRecordStatusBytesAndLatency) {
+    DoHStubServer server(make_stub_zone());
+    server.start();
+
+    auto &metrics = DoHMetrics::instance();
+    DoHProviderMetrics *provider = metrics.provider(server.url());
+    uint64_t queries = provider->queries[static_cast<int>(DoHMethod::POST)].value();
+    uint64_t status_200 = metrics.http_status.value(200);
+    uint64_t status_404 = metrics.http_status.value(404);
+    uint64_t received = metrics.bytes_received.value();
+    uint64_t timings = metrics.duration[static_cast<int>(DoHMethod::POST)].snapshot().count;
+
+    DoHClient client(server.url(), nullptr);
+    client.set_method_cache(nullptr);
+    EXPECT_EQ(client.query("example.com", DNSRecordType::A, DoHMethod::POST, false).size(), 1u);
+    EXPECT_EQ(provider->queries[static_cast<int>(DoHMethod::POST)].value() - queries, 1u);
+    EXPECT_EQ(metrics.http_status.value(200) - status_200, 1u);
+    EXPECT_GT(metrics.bytes_received.value() - received, 0u);
+    EXPECT_EQ(metrics.duration[static_cast<int>(DoHMethod::POST)].snapshot().count - timings, 1u);
+
+    DoHClient wrong_path(server.url("/missing"), nullptr);
+    wrong_path.set_method_cache(nullptr);
+    EXPECT_TRUE(wrong_path.query("example.com", DNSRecordType::A, DoHMethod::GET, false).empty());
+    EXPECT_EQ(metrics.http_status.value(404) - status_404, 1u);
+}
+
+TEST(MetricsTest, DoHRequestsRecordPhaseTimings) {
+    StubServerOptions options;
+    options.latency_ms = 20;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    DoHProviderMetrics *provider = DoHMetrics::instance().provider(server.url());
+    auto phase_count = [provider](DoHPhase phase) {
+        return provider->phases[static_cast<size_t>(phase)].snapshot().count;
+    };
+    uint64_t totals = phase_count(DoHPhase::Total);
+    uint64_t parses = phase_count(DoHPhase::Parse);
+    uint64_t encodes = phase_count(DoHPhase::Encode);
+
+    DoHClient client(server.url(), nullptr);
+    client.set_method_cache(nullptr);
+    ASSERT_EQ(client.query("example.com", DNSRecordType::A, DoHMethod::GET, false).size(), 1u);
+
+    // 服务器的延迟计入首字节时间；明文HTTP没有TLS握手
+    const DoHRequestTiming &timing = client.last_timing();
+    EXPECT_GE(timing.first_byte, 20000u);
+    EXPECT_GE(timing.total, timing.first_byte);
+    EXPECT_EQ(timing.tls, 0u);
+    EXPECT_EQ(phase_count(DoHPhase::Total) - totals, 1u);
+    EXPECT_EQ(phase_count(DoHPhase::Parse) - parses, 1u);
+    EXPECT_EQ(phase_count(DoHPhase::Encode) - encodes, 1u);
+
+    std::string report = DoHMetrics::instance().phase_report();
+    EXPECT_NE(report.find("first_byte"), std::string::npos);
+    EXPECT_NE(report.find("p99 ms"), std::string::npos);
+}
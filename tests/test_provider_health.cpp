@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include "doh_client.hpp"
+#include "doh_stub_server.hpp"
+#include "provider_health.hpp"
+#include "stub_zone.hpp"
+
+class ProviderHealthTest : public ::testing::Test {
+protected:
+    static HealthConfig make_config() {
+        HealthConfig config;
+        config.failure_threshold = 3;
+        config.open_ms = 1000;
+        config.max_open_ms = 3000;
+        return config;
+    }
+
+    static DoHServerConfig server(const std::string& url, int priority) {
+        return {url, url, {"get"}, priority, 5, true};
+    }
+
+    ProviderHealth::Clock::time_point now_ = ProviderHealth::Clock::now();
+};
+
+TEST_F(ProviderHealthTest, TracksLatencyAndErrorRate) {
+    ProviderHealth health(make_config());
+    for (int ms : {10, 20, 30, 40, 200}) {
+        health.record_success("a", std::chrono::milliseconds(ms));
+    }
+    health.record_failure("a", now_);
+
+    auto stats = health.stats("a");
+    EXPECT_EQ(stats.successes, 5u);
+    EXPECT_EQ(stats.failures, 1u);
+    EXPECT_DOUBLE_EQ(stats.latency_p50_ms, 30);
+    EXPECT_DOUBLE_EQ(stats.latency_p95_ms, 40);
+    EXPECT_GT(stats.latency_ewma_ms, 10);
+    EXPECT_LT(stats.latency_ewma_ms, 200);
+    EXPECT_NEAR(stats.error_rate, 0.1, 1e-9);
+    EXPECT_EQ(stats.state, CircuitState::Closed);
+
+    EXPECT_EQ(health.stats("unknown").successes, 0u);
+}
+
+TEST_F(ProviderHealthTest, CircuitOpensThenProbes) {
+    ProviderHealth health(make_config());
+    for (int i = 0; i < 2; ++i) {
+        health.record_failure("a", now_);
+    }
+    EXPECT_TRUE(health.allow("a", now_));
+
+    health.record_failure("a", now_);
+    EXPECT_EQ(health.state("a", now_), CircuitState::Open);
+    EXPECT_FALSE(health.allow("a", now_ + std::chrono::milliseconds(999)));
+
+    // 冷却结束后只放行一个探测请求
+    auto later = now_ + std::chrono::milliseconds(1000);
+    EXPECT_EQ(health.state("a", later), CircuitState::HalfOpen);
+    EXPECT_TRUE(health.allow("a", later));
+    EXPECT_FALSE(health.allow("a", later));
+
+    // 探测失败：重新打开，冷却时间翻倍
+    health.record_failure("a", later);
+    EXPECT_FALSE(health.allow("a", later + std::chrono::milliseconds(1999)));
+    auto probe = later + std::chrono::milliseconds(2000);
+    EXPECT_TRUE(health.allow("a", probe));
+
+    // 探测被放弃时释放资格，探测成功后关闭
+    health.record_abandoned("a", std::chrono::milliseconds(5));
+    EXPECT_TRUE(health.allow("a", probe));
+    health.record_success("a", std::chrono::milliseconds(15));
+    EXPECT_EQ(health.state("a", probe), CircuitState::Closed);
+    EXPECT_TRUE(health.allow("a", probe));
+}
+
+TEST_F(ProviderHealthTest, CooldownIsCapped) {
+    ProviderHealth health(make_config());
+    auto now = now_;
+    for (int i = 0; i < 3; ++i) {
+        health.record_failure("a", now);
+    }
+    for (int round = 0; round < 4; ++round) {
+        now += std::chrono::milliseconds(3000);
+        ASSERT_TRUE(health.allow("a", now));
+        health.record_failure("a", now);
+    }
+    EXPECT_FALSE(health.allow("a", now + std::chrono::milliseconds(2999)));
+    EXPECT_TRUE(health.allow("a", now + std::chrono::milliseconds(3000)));
+}
+
+TEST_F(ProviderHealthTest, RankPrefersFastHealthyProviders) {
+    ProviderHealth health(make_config());
+    std::vector<DoHServerConfig> servers = {server("slow", 1), server("fast", 2), server("broken", 3),
+                                            server("new", 4)};
+
+    // 没有样本时按静态优先级
+    auto ranked = health.rank(servers, now_);
+    EXPECT_EQ(ranked[0].name, "slow");
+    EXPECT_EQ(ranked[3].name, "new");
+
+    for (int i = 0; i < 5; ++i) {
+        health.record_success("slow", std::chrono::milliseconds(400));
+        health.record_success("fast", std::chrono::milliseconds(20));
+    }
+    for (int i = 0; i < 3; ++i) {
+        health.record_failure("broken", now_);
+    }
+
+    ranked = health.rank(servers, now_);
+    ASSERT_EQ(ranked.size(), 4u);
+    EXPECT_EQ(ranked[0].name, "fast");
+    EXPECT_EQ(ranked[1].name, "new");
+    EXPECT_EQ(ranked[2].name, "slow");
+    EXPECT_EQ(ranked[3].name, "broken");  // 熔断打开的排在最后
+    EXPECT_LT(health.score(servers[1]), health.score(servers[0]));
+}
+
+TEST_F(ProviderHealthTest, ConfigureAndSelectSkipOpenProviders) {
+    ProviderHealth health;
+    HealthConfig config = make_config();
+    config.failure_threshold = 1;
+    health.configure(config);
+
+    health.record_failure("a", now_);
+    EXPECT_FALSE(health.available("a", now_));
+    EXPECT_TRUE(health.available("a", now_ + std::chrono::milliseconds(1000)));
+
+    std::vector<DoHServerConfig> servers = {server("a", 1), server("b", 2), server("c", 3)};
+    servers[1].enabled = false;
+    EXPECT_EQ(health.select("a", servers, now_), "c");
+    EXPECT_EQ(health.select("c", servers, now_), "c");
+    health.record_failure("c", now_);
+    EXPECT_EQ(health.select("a", servers, now_), "a");  // 全部不可用时保持首选
+}
+
+// DoHClient 把结果回报给熔断器，熔断打开后不再向服务商发请求
+TEST_F(ProviderHealthTest, ClientStopsQueryingOpenProvider) {
+    StubServerOptions options;
+    options.error_rate = 1.0;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    HealthConfig config = make_config();
+    config.failure_threshold = 2;
+    ProviderHealth health(config);
+    DoHClient client(server.url(), nullptr);
+    client.set_method_cache(nullptr);
+    client.set_single_flight(nullptr);
+    client.set_provider_health(&health);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(client.query("example.com", DNSRecordType::A, DoHMethod::POST, false).empty());
+    }
+    EXPECT_EQ(server.stats().requests, 2u);
+    EXPECT_EQ(health.stats(server.url()).failures, 2u);
+    EXPECT_EQ(health.state(server.url()), CircuitState::Open);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "doh_stub_server.hpp"
+#include "resolver_service.hpp"
+#include "stub_zone.hpp"
+
+// 多个工作线程各自的客户端并发解析，结果与单线程一致
+TEST(ResolverServiceTest, ResolvesConcurrentlyOnWorkerClients) {
+    StubServerOptions options;
+    options.latency_ms = 5;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    ResolverService service(server.url(), 4, DoHMethod::POST);
+    service.set_single_flight(nullptr);
+    EXPECT_EQ(service.threads(), 4u);
+
+    constexpr int kQueries = 64;
+    std::vector<std::future<std::vector<DNSRecord>>> futures;
+    for (int i = 0; i < kQueries; ++i) {
+        futures.push_back(service.resolve(i % 2 ? "www.example.com" : "example.com", DNSRecordType::A));
+    }
+    for (int i = 0; i < kQueries; ++i) {
+        auto records = futures[i].get();
+        ASSERT_EQ(records.size(), i % 2 ? 2u : 1u);
+        EXPECT_EQ(records.back().data, "192.0.2.1");
+    }
+
+    auto completed = service.completed_per_thread();
+    EXPECT_EQ(std::accumulate(completed.begin(), completed.end(), uint64_t{0}), static_cast<uint64_t>(kQueries));
+    EXPECT_EQ(server.stats().requests, static_cast<uint64_t>(kQueries));
+    EXPECT_GE(server.stats().connections, 2u);  // 每个工作线程使用自己的curl句柄与连接
+}
+
+TEST(ResolverServiceTest, FailedQueryYieldsEmptyResult) {
+    StubServerOptions options;
+    options.error_rate = 1.0;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    ResolverService service(server.url(), 2);
+    std::promise<size_t> done;
+    service.resolve("example.com", DNSRecordType::A,
+                    [&done](std::vector<DNSRecord> records) { done.set_value(records.size()); });
+    EXPECT_EQ(done.get_future().get(), 0u);
+}
+
+// 查询抛出异常（标签超过63字节，编码失败）时回调仍以空结果执行
+TEST(ResolverServiceTest, ThrowingQueryStillInvokesCallback) {
+    DoHStubServer server(make_stub_zone());
+    server.start();
+
+    ResolverService service(server.url(), 2, DoHMethod::POST);
+    service.set_single_flight(nullptr);
+    std::promise<size_t> done;
+    service.resolve(std::string(64, 'a') + ".example.com", DNSRecordType::A,
+                    [&done](std::vector<DNSRecord> records) { done.set_value(records.size()); });
+    auto result = done.get_future();
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(result.get(), 0u);
+
+    // future重载同样得到空结果而不是broken_promise
+    EXPECT_TRUE(service.resolve(std::string(64, 'b') + ".example.com").get().empty());
+}
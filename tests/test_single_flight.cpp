@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "single_flight.hpp"
+
+// 发起者的请求一直等到其余调用者全部挂上后才完成
+TEST(SingleFlightTest, ConcurrentCallersShareOneCall) {
+    SingleFlight<std::vector<int>> group;
+    std::atomic<int> calls{0};
+    std::atomic<int> shared_count{0};
+    constexpr int kThreads = 16;
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<int>> results(kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            bool shared = false;
+            results[t] = group.run(
+                "example.com A",
+                [&]() {
+                    ++calls;
+                    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                    while (group.saved_requests() < kThreads - 1 && std::chrono::steady_clock::now() < deadline) {
+                        std::this_thread::yield();
+                    }
+                    return std::vector<int>{1, 2, 3};
+                },
+                &shared);
+            if (shared) {
+                ++shared_count;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_EQ(shared_count.load(), kThreads - 1);
+    EXPECT_EQ(group.saved_requests(), static_cast<uint64_t>(kThreads - 1));
+    EXPECT_EQ(group.in_flight(), 0u);
+    for (const auto& result : results) {
+        EXPECT_EQ(result, (std::vector<int>{1, 2, 3}));
+    }
+}
+
+TEST(SingleFlightTest, SequentialCallsAreNotMerged) {
+    SingleFlight<int> group;
+    int calls = 0;
+    EXPECT_EQ(group.run("a", [&]() { return ++calls; }), 1);
+    EXPECT_EQ(group.run("a", [&]() { return ++calls; }), 2);
+    EXPECT_EQ(group.run("b", [&]() { return ++calls; }), 3);
+    EXPECT_EQ(group.saved_requests(), 0u);
+}
+
+TEST(SingleFlightTest, ExceptionsReachEveryWaiter) {
+    SingleFlight<int> group;
+    std::atomic<int> failures{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            try {
+                group.run("broken", [&]() -> int {
+                    while (group.saved_requests() < 3) {
+                        std::this_thread::yield();
+                    }
+                    throw std::runtime_error("upstream failed");
+                });
+            } catch (const std::runtime_error&) {
+                ++failures;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(failures.load(), 4);
+    EXPECT_EQ(group.in_flight(), 0u);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "doh_client.hpp"
+#include "doh_stub_server.hpp"
+#include "stub_zone.hpp"
+#include "system_resolver.hpp"
+
+namespace {
+// 延迟 delay 后返回一条固定记录的解析函数
+SystemDnsResolver::LookupFunction slow_lookup(std::chrono::milliseconds delay, std::atomic<int>* calls) {
+    return [delay, calls](const std::string& domain, int) {
+        calls->fetch_add(1);
+        std::this_thread::sleep_for(delay);
+        return std::vector<DNSRecord>{{domain, DNSRecordType::A, 300, "198.51.100.7"}};
+    };
+}
+}  // namespace
+
+TEST(SystemDnsResolverTest, ResolvesLocalhost) {
+    SystemDnsResolver resolver(1);
+    auto records = resolver.resolve("localhost", AF_INET, std::chrono::milliseconds(2000));
+    ASSERT_FALSE(records.empty());
+    EXPECT_EQ(records[0].type, DNSRecordType::A);
+    EXPECT_EQ(records[0].data, "127.0.0.1");
+}
+
+// 超时立即返回；排队中被放弃的查询不再执行
+TEST(SystemDnsResolverTest, TimeoutReturnsEarlyAndSkipsAbandonedLookups) {
+    std::atomic<int> calls{0};
+    SystemDnsResolver resolver(1, 8, slow_lookup(std::chrono::milliseconds(300), &calls));
+
+    auto started = std::chrono::steady_clock::now();
+    auto first = resolver.start("slow.example", AF_INET);
+    EXPECT_TRUE(resolver.resolve("queued.example", AF_INET, std::chrono::milliseconds(50)).empty());
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(250));
+    EXPECT_EQ(resolver.timeouts(), 1u);
+
+    std::vector<DNSRecord> records;
+    ASSERT_TRUE(first->wait_until(std::chrono::steady_clock::now() + std::chrono::seconds(2), records));
+    ASSERT_EQ(records.size(), 1u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(calls.load(), 1);
+}
+
+TEST(SystemDnsResolverTest, RejectsWhenQueueIsFull) {
+    std::atomic<int> calls{0};
+    SystemDnsResolver resolver(1, 1, slow_lookup(std::chrono::milliseconds(100), &calls));
+    auto running = resolver.start("a.example", AF_INET);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));  // 等待第一个查询开始执行
+    auto queued = resolver.start("b.example", AF_INET);
+    auto rejected = resolver.start("c.example", AF_INET);
+
+    std::vector<DNSRecord> records{{"x", DNSRecordType::A, 1, "192.0.2.1"}};
+    ASSERT_TRUE(rejected->wait_until(std::chrono::steady_clock::now(), records));
+    EXPECT_TRUE(records.empty());
+    EXPECT_EQ(resolver.rejected(), 1u);
+}
+
+// DoH失败时使用与DoH同时启动的系统解析结果，总耗时不是两者之和
+TEST(SystemDnsResolverTest, ClientRacesSystemDnsWithDoH) {
+    StubServerOptions options;
+    options.error_rate = 1.0;
+    options.latency_ms = 200;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    std::atomic<int> calls{0};
+    SystemDnsResolver resolver(1, 8, slow_lookup(std::chrono::milliseconds(200), &calls));
+    DoHClient client(server.url());
+    client.set_single_flight(nullptr);
+    client.set_system_resolver(&resolver);
+    client.set_race_system_dns(true);
+
+    auto started = std::chrono::steady_clock::now();
+    auto records = client.query("raced.example", DNSRecordType::A, DoHMethod::POST, true);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].data, "198.51.100.7");
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(380));
+    EXPECT_EQ(calls.load(), 1);
+}
+
+TEST(SystemDnsResolverTest, ClientFallbackRespectsTimeout) {
+    StubServerOptions options;
+    options.error_rate = 1.0;
+    DoHStubServer server(make_stub_zone(), options);
+    server.start();
+
+    std::atomic<int> calls{0};
+    SystemDnsResolver resolver(1, 8, slow_lookup(std::chrono::milliseconds(500), &calls));
+    DoHClient client(server.url());
+    client.set_single_flight(nullptr);
+    client.set_system_resolver(&resolver);
+    client.set_fallback_timeout(std::chrono::milliseconds(100));
+
+    auto started = std::chrono::steady_clock::now();
+    EXPECT_TRUE(client.query("hung.example", DNSRecordType::A, DoHMethod::POST, true).empty());
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(400));
+    EXPECT_EQ(resolver.timeouts(), 1u);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include "work_stealing_pool.hpp"
+
+TEST(WorkStealingPoolTest, RunsAllTasksBeforeDestruction) {
+    std::atomic<int> done{0};
+    {
+        WorkStealingPool pool(4);
+        EXPECT_EQ(pool.size(), 4u);
+        for (int i = 0; i < 1000; ++i) {
+            pool.submit([&done](size_t) { done.fetch_add(1); });
+        }
+    }
+    EXPECT_EQ(done.load(), 1000);
+}
+
+// 工作线程内提交的子任务进入本线程队列，本线程被占用时由其他线程窃取
+TEST(WorkStealingPoolTest, IdleWorkersStealSubmittedSubtasks) {
+    std::mutex mutex;
+    std::set<size_t> workers;
+    std::atomic<int> done{0};
+    WorkStealingPool pool(4);
+    pool.submit([&](size_t parent) {
+        for (int i = 0; i < 16; ++i) {
+            pool.submit([&](size_t worker) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                std::lock_guard<std::mutex> lock(mutex);
+                workers.insert(worker);
+                done.fetch_add(1);
+            });
+        }
+        // 父任务继续占用本线程，子任务只能被窃取
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(mutex);
+        workers.erase(parent);
+    });
+    while (done.load() < 16) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GE(pool.steals(), 3u);
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_GE(workers.size(), 2u);
+}
+
+TEST(WorkStealingPoolTest, SurvivesThrowingTask) {
+    std::atomic<int> done{0};
+    {
+        WorkStealingPool pool(1);
+        pool.submit([](size_t) { throw std::runtime_error("boom"); });
+        pool.submit([&done](size_t) { done.fetch_add(1); });
+    }
+    EXPECT_EQ(done.load(), 1);
+}